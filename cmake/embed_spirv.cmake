@@ -0,0 +1,30 @@
+# Writes a SPIR-V module out as a C++ header defining an aligned constexpr
+# array of its words.
+#
+#   cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<name> -P embed_spirv.cmake
+
+file(READ "${INPUT}" hex HEX)
+
+string(LENGTH "${hex}" length)
+math(EXPR remainder "${length} % 8")
+if(length EQUAL 0 OR NOT remainder EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a whole number of SPIR-V words")
+endif()
+
+# SPIR-V is written little-endian: turn every 4 bytes into a word, 8 words
+# to a line.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " words "${hex}")
+set(word "0x[0-9a-f]+, ")
+string(REGEX REPLACE "(${word}${word}${word}${word}${word}${word}${word}${word})" "\\1\n    " words "${words}")
+string(REGEX REPLACE "\n    $" "" words "${words}")
+string(REGEX REPLACE ", $" "," words "${words}")
+string(REPLACE ", \n" ",\n" words "${words}")
+
+file(WRITE "${OUTPUT}"
+    "// Generated from ${INPUT}; do not edit.\n"
+    "#include <cstdint>\n"
+    "\n"
+    "alignas(16) constexpr uint32_t ${SYMBOL}[] = {\n"
+    "    ${words}\n"
+    "};\n"
+)
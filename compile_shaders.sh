@@ -1,7 +1,13 @@
 #!/usr/bin/env sh
 
-./vulkan/macOS/bin/glslangValidator -V src/shaders/demo.vert
-./vulkan/macOS/bin/glslangValidator -V src/shaders/demo.frag
+./vulkan/macOS/bin/glslangValidator -V src/shaders/demo.vert -o src/shaders/vert.spv
+./vulkan/macOS/bin/glslangValidator -V src/shaders/demo.frag -o src/shaders/frag.spv
+./vulkan/macOS/bin/glslangValidator -V src/shaders/tile.vert -o src/shaders/tile_vert.spv
+./vulkan/macOS/bin/glslangValidator -V src/shaders/tile.frag -o src/shaders/tile_frag.spv
+./vulkan/macOS/bin/glslangValidator -V src/shaders/particles.comp -o src/shaders/particles_comp.spv
+./vulkan/macOS/bin/glslangValidator -V src/shaders/particle.vert -o src/shaders/particle_vert.spv
+./vulkan/macOS/bin/glslangValidator -V src/shaders/particle.frag -o src/shaders/particle_frag.spv
 
-mv vert.spv src/shaders
-mv frag.spv src/shaders
+# Offline permutations, for the features that can't be specialization
+# constants.
+./vulkan/macOS/bin/glslangValidator -V src/shaders/demo.frag -DCUTOUT -o src/shaders/frag_cutout.spv
@@ -0,0 +1,239 @@
+#ifndef __WFN_ENG_ASSET_HPP__
+#define __WFN_ENG_ASSET_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::asset {
+    ////
+    // typedef AssetId
+    //
+    // The key of an asset in a pack: the hash of its path.
+    typedef uint64_t AssetId;
+
+    ////
+    // AssetId id(std::string_view)
+    //
+    // Hashes the path of an asset (relative to the packed directory, with
+    // '/' separators) into its id: 64-bit FNV-1a, so that ids can be
+    // computed at compile time.
+    constexpr AssetId id(std::string_view path) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (char c : path) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    ////
+    // enum class Codec
+    //
+    // How an entry is stored. LZ4 and zstd are only available when the
+    // build found the libraries (WFN_ENG_HAVE_LZ4, WFN_ENG_HAVE_ZSTD).
+    enum class Codec : uint8_t {
+        None = 0,
+        Lz4  = 1,
+        Zstd = 2
+    };
+
+    ////
+    // bool available(Codec)
+    //
+    // Whether this build can read and write the provided codec.
+    bool available(Codec);
+
+    ////
+    // struct PackHeader
+    //
+    // The fixed header at the start of a pack file, followed by the table
+    // of contents.
+    struct PackHeader {
+        char magic[4];
+        uint16_t version;
+        uint16_t reserved;
+        uint32_t count;
+        uint32_t alignment;
+        uint64_t size;
+    };
+
+    ////
+    // struct PackEntry
+    //
+    // An entry of the table of contents, which is sorted by id. Entries of
+    // at least largeEntry bytes start on a cache line (64 bytes), others on
+    // 16 bytes.
+    struct PackEntry {
+        AssetId id;
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        Codec codec;
+        uint8_t reserved[7];
+    };
+
+    ////
+    // size_t largeEntry
+    //
+    // The size from which entries are aligned to a cache line.
+    const size_t largeEntry = 64;
+
+    ////
+    // struct Blob
+    //
+    // A view of the bytes of an uncompressed entry, straight from the
+    // mapped file (e.g. to copy into a staging buffer).
+    struct Blob {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    ////
+    // class Pack
+    //
+    // Reads a pack file through a read-only memory mapping: opening it only
+    // validates the header and the table of contents, and entries are paged
+    // in as they're touched. Lookups binary search the table. The views it
+    // hands out live as long as the Pack.
+    class Pack {
+        int _fd;
+        const uint8_t *_data;
+        size_t _size;
+        const PackEntry *_entries;
+        uint32_t _count;
+
+    public:
+        ////
+        // Pack(const std::string&)
+        //
+        // Maps a pack file, throwing if it isn't one or if an entry is
+        // malformed (outside of the file, out of order, or with an unknown
+        // codec).
+        explicit Pack(const std::string&);
+
+        ////
+        // ~Pack()
+        //
+        // Unmaps the file.
+        ~Pack();
+
+        ////
+        // const PackEntry *find(AssetId)
+        //
+        // The entry of an asset, or nullptr.
+        const PackEntry *find(AssetId) const;
+
+        ////
+        // size_t count()
+        //
+        // The number of entries.
+        size_t count() const;
+
+        ////
+        // const PackEntry& entry(size_t)
+        //
+        // An entry by index, in id order.
+        const PackEntry& entry(size_t) const;
+
+        ////
+        // Blob view(const PackEntry&)
+        //
+        // The bytes of an entry as stored: the asset itself if it's
+        // uncompressed, without any copy.
+        Blob view(const PackEntry&) const;
+
+        ////
+        // Blob view(AssetId)
+        //
+        // The bytes of an uncompressed asset, without any copy. Throws if
+        // it's missing or compressed.
+        Blob view(AssetId) const;
+
+        ////
+        // void read(const PackEntry&, void *)
+        //
+        // Writes an asset (entry.size bytes) to the provided memory,
+        // decompressing it if needed.
+        void read(const PackEntry&, void *) const;
+
+        ////
+        // void prefetch(const PackEntry&)
+        //
+        // Asks the kernel to start paging an entry in.
+        void prefetch(const PackEntry&) const;
+
+        // Following Rule of 3's
+        Pack(const Pack&) = delete;
+        Pack& operator=(const Pack&) = delete;
+    };
+
+    ////
+    // struct PackStats
+    //
+    // Counters on a PackWriter. Compressed entries are the ones stored
+    // compressed: an entry is stored raw when compressing it doesn't save
+    // at least an eighth.
+    struct PackStats {
+        uint64_t entries = 0;
+        uint64_t compressed = 0;
+        uint64_t bytes = 0;
+        uint64_t storedBytes = 0;
+        uint64_t fileBytes = 0;
+    };
+
+    ////
+    // class PackWriter
+    //
+    // Builds a pack file from assets added in any order.
+    class PackWriter {
+        struct Pending {
+            AssetId id;
+            std::string path;
+            std::vector<uint8_t> data;
+            Codec codec;
+        };
+
+        std::vector<Pending> _pending;
+        PackStats _stats;
+
+    public:
+        PackWriter() = default;
+
+        ////
+        // void add(const std::string&, std::vector<uint8_t>, Codec)
+        //
+        // Adds an asset by path, to be compressed with the provided codec
+        // when that pays off. Throws if its id collides with another one's.
+        void add(const std::string&, std::vector<uint8_t>, Codec = Codec::None);
+
+        ////
+        // void write(const std::string&)
+        //
+        // Writes the pack file, then forgets the assets.
+        void write(const std::string&);
+
+        ////
+        // const PackStats& stats()
+        //
+        // The counters of the last write.
+        const PackStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        PackWriter(const PackWriter&) = delete;
+        PackWriter& operator=(const PackWriter&) = delete;
+    };
+}
+
+#endif
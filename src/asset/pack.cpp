@@ -0,0 +1,227 @@
+#include "../asset.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef WFN_ENG_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef WFN_ENG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace wfn_eng::asset {
+    ////
+    // bool available(Codec)
+    //
+    // Whether this build can read and write the provided codec.
+    bool available(Codec codec) {
+        switch (codec) {
+        case Codec::None:
+            return true;
+#ifdef WFN_ENG_HAVE_LZ4
+        case Codec::Lz4:
+            return true;
+#endif
+#ifdef WFN_ENG_HAVE_ZSTD
+        case Codec::Zstd:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    ////
+    // class Pack
+    //
+    // Reads a pack file through a read-only memory mapping.
+
+    ////
+    // Pack(const std::string&)
+    //
+    // Maps a pack file, throwing if it isn't one. Every entry is checked to
+    // lie within the file, so views never need to be, and to have a codec
+    // the format knows, stored as it says: an uncompressed entry's stored
+    // size is its size, and an LZ4 one's sizes fit LZ4's ints.
+    Pack::Pack(const std::string& path)
+            : _fd(-1)
+            , _data(nullptr)
+            , _size(0)
+            , _entries(nullptr)
+            , _count(0) {
+        _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_fd < 0)
+            throw WfnError("wfn_eng::asset::Pack", "Pack", "Open " + path);
+
+        struct stat info;
+        if (fstat(_fd, &info) != 0 || info.st_size < (off_t)sizeof(PackHeader)) {
+            close(_fd);
+            throw WfnError("wfn_eng::asset::Pack", "Pack", "Truncated header");
+        }
+        _size = static_cast<size_t>(info.st_size);
+
+        void *mapped = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(_fd);
+            throw WfnError("wfn_eng::asset::Pack", "Pack", "Map " + path);
+        }
+        _data = static_cast<const uint8_t *>(mapped);
+
+        const PackHeader *header = reinterpret_cast<const PackHeader *>(_data);
+        bool valid =
+            std::memcmp(header->magic, "WFNP", 4) == 0 &&
+            header->version == 1 &&
+            header->size == _size &&
+            sizeof(PackHeader) + (uint64_t)header->count * sizeof(PackEntry) <= _size;
+
+        if (valid) {
+            _entries = reinterpret_cast<const PackEntry *>(_data + sizeof(PackHeader));
+            _count = header->count;
+
+            for (uint32_t i = 0; i < _count && valid; i++) {
+                const PackEntry& entry = _entries[i];
+                valid = entry.offset <= _size && entry.storedSize <= _size - entry.offset &&
+                        (i == 0 || _entries[i - 1].id < entry.id);
+
+                switch (entry.codec) {
+                case Codec::None:
+                    valid = valid && entry.size == entry.storedSize;
+                    break;
+                case Codec::Lz4:
+                    valid = valid && entry.size <= INT_MAX && entry.storedSize <= INT_MAX;
+                    break;
+                case Codec::Zstd:
+                    break;
+                default:
+                    valid = false;
+                    break;
+                }
+            }
+        }
+
+        if (!valid) {
+            munmap(const_cast<uint8_t *>(_data), _size);
+            close(_fd);
+            throw WfnError("wfn_eng::asset::Pack", "Pack", "Not a pack");
+        }
+
+        // The table of contents gets searched right away.
+        madvise(const_cast<uint8_t *>(_data), sizeof(PackHeader) + _count * sizeof(PackEntry), MADV_WILLNEED);
+    }
+
+    ////
+    // ~Pack()
+    //
+    // Unmaps the file.
+    Pack::~Pack() {
+        munmap(const_cast<uint8_t *>(_data), _size);
+        close(_fd);
+    }
+
+    ////
+    // const PackEntry *find(AssetId)
+    //
+    // The entry of an asset, or nullptr.
+    const PackEntry *Pack::find(AssetId id) const {
+        const PackEntry *end = _entries + _count;
+        const PackEntry *it = std::lower_bound(_entries, end, id, [](const PackEntry& entry, AssetId id) {
+            return entry.id < id;
+        });
+
+        return it != end && it->id == id ? it : nullptr;
+    }
+
+    ////
+    // size_t count()
+    //
+    // The number of entries.
+    size_t Pack::count() const { return _count; }
+
+    ////
+    // const PackEntry& entry(size_t)
+    //
+    // An entry by index, in id order.
+    const PackEntry& Pack::entry(size_t i) const { return _entries[i]; }
+
+    ////
+    // Blob view(const PackEntry&)
+    //
+    // The bytes of an entry as stored.
+    Blob Pack::view(const PackEntry& entry) const {
+        return Blob { _data + entry.offset, static_cast<size_t>(entry.storedSize) };
+    }
+
+    ////
+    // Blob view(AssetId)
+    //
+    // The bytes of an uncompressed asset, without any copy.
+    Blob Pack::view(AssetId id) const {
+        const PackEntry *entry = find(id);
+        if (entry == nullptr)
+            throw WfnError("wfn_eng::asset::Pack", "view", "Find asset");
+        if (entry->codec != Codec::None)
+            throw WfnError("wfn_eng::asset::Pack", "view", "View compressed asset");
+
+        return view(*entry);
+    }
+
+    ////
+    // void read(const PackEntry&, void *)
+    //
+    // Writes an asset (entry.size bytes) to the provided memory,
+    // decompressing it if needed. The constructor rejected unknown codecs,
+    // so the only one left to fail on is a known one this build lacks.
+    void Pack::read(const PackEntry& entry, void *destination) const {
+        const uint8_t *source = _data + entry.offset;
+        bool succeeded = false;
+
+        switch (entry.codec) {
+        case Codec::None:
+            std::memcpy(destination, source, entry.size);
+            succeeded = true;
+            break;
+
+#ifdef WFN_ENG_HAVE_LZ4
+        case Codec::Lz4:
+            succeeded = LZ4_decompress_safe(
+                reinterpret_cast<const char *>(source),
+                static_cast<char *>(destination),
+                static_cast<int>(entry.storedSize),
+                static_cast<int>(entry.size)
+            ) == static_cast<int>(entry.size);
+            break;
+#endif
+
+#ifdef WFN_ENG_HAVE_ZSTD
+        case Codec::Zstd:
+            succeeded = ZSTD_decompress(destination, entry.size, source, entry.storedSize) == entry.size;
+            break;
+#endif
+
+        default:
+            throw WfnError("wfn_eng::asset::Pack", "read", "Decompress (codec not built in)");
+        }
+
+        if (!succeeded)
+            throw WfnError("wfn_eng::asset::Pack", "read", "Decompress");
+    }
+
+    ////
+    // void prefetch(const PackEntry&)
+    //
+    // Asks the kernel to start paging an entry in. madvise wants a page
+    // aligned start.
+    void Pack::prefetch(const PackEntry& entry) const {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t start = entry.offset & ~(page - 1);
+        madvise(const_cast<uint8_t *>(_data) + start, entry.offset + entry.storedSize - start, MADV_WILLNEED);
+    }
+}
@@ -0,0 +1,182 @@
+#include "../asset.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef WFN_ENG_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef WFN_ENG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+////
+// std::vector<uint8_t> compress(const std::vector<uint8_t>&, Codec)
+//
+// Compresses an asset, returning nothing when the codec isn't built in or
+// fails.
+static std::vector<uint8_t> compress(const std::vector<uint8_t>& data, wfn_eng::asset::Codec codec) {
+    std::vector<uint8_t> out;
+
+    switch (codec) {
+#ifdef WFN_ENG_HAVE_LZ4
+    case wfn_eng::asset::Codec::Lz4: {
+        out.resize(LZ4_compressBound(static_cast<int>(data.size())));
+        int size = LZ4_compress_default(
+            reinterpret_cast<const char *>(data.data()),
+            reinterpret_cast<char *>(out.data()),
+            static_cast<int>(data.size()),
+            static_cast<int>(out.size())
+        );
+        out.resize(size > 0 ? size : 0);
+        break;
+    }
+#endif
+
+#ifdef WFN_ENG_HAVE_ZSTD
+    case wfn_eng::asset::Codec::Zstd: {
+        // Packing is offline, so spend the time on the ratio.
+        out.resize(ZSTD_compressBound(data.size()));
+        size_t size = ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 19);
+        out.resize(ZSTD_isError(size) ? 0 : size);
+        break;
+    }
+#endif
+
+    default:
+        break;
+    }
+
+    return out;
+}
+
+////
+// uint64_t alignEntry(uint64_t, uint64_t)
+//
+// The offset of an entry of the provided size, at or after an offset.
+static uint64_t alignEntry(uint64_t offset, uint64_t size) {
+    uint64_t alignment = size >= wfn_eng::asset::largeEntry ? 64 : 16;
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+namespace wfn_eng::asset {
+    ////
+    // class PackWriter
+    //
+    // Builds a pack file from assets added in any order.
+
+    ////
+    // void add(const std::string&, std::vector<uint8_t>, Codec)
+    //
+    // Adds an asset by path, to be compressed with the provided codec when
+    // that pays off.
+    void PackWriter::add(const std::string& path, std::vector<uint8_t> data, Codec codec) {
+        if (!available(codec))
+            throw WfnError("wfn_eng::asset::PackWriter", "add", "Compress (codec not built in)");
+
+        _pending.push_back(Pending { id(path), path, std::move(data), codec });
+    }
+
+    ////
+    // void write(const std::string&)
+    //
+    // Writes the pack file: the header, the table of contents sorted by id,
+    // then every entry aligned, in id order (so that a walk of the table
+    // reads the file front to back).
+    void PackWriter::write(const std::string& path) {
+        std::sort(_pending.begin(), _pending.end(), [](const Pending& a, const Pending& b) {
+            return a.id < b.id;
+        });
+
+        for (size_t i = 1; i < _pending.size(); i++) {
+            if (_pending[i - 1].id == _pending[i].id) {
+                throw WfnError(
+                    "wfn_eng::asset::PackWriter",
+                    "write",
+                    "Hash " + _pending[i - 1].path + " and " + _pending[i].path + " apart"
+                );
+            }
+        }
+
+        _stats = PackStats {};
+        _stats.entries = _pending.size();
+
+        std::vector<PackEntry> entries(_pending.size());
+        uint64_t offset = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+
+        for (size_t i = 0; i < _pending.size(); i++) {
+            Pending& pending = _pending[i];
+            PackEntry& entry = entries[i];
+
+            entry = PackEntry {};
+            entry.id = pending.id;
+            entry.size = pending.data.size();
+            entry.codec = Codec::None;
+
+            if (pending.codec != Codec::None) {
+                std::vector<uint8_t> packed = compress(pending.data, pending.codec);
+                if (!packed.empty() && packed.size() <= pending.data.size() - pending.data.size() / 8) {
+                    pending.data.swap(packed);
+                    entry.codec = pending.codec;
+                    _stats.compressed++;
+                }
+            }
+
+            entry.storedSize = pending.data.size();
+            entry.offset = alignEntry(offset, entry.storedSize);
+            offset = entry.offset + entry.storedSize;
+
+            _stats.bytes += entry.size;
+            _stats.storedBytes += entry.storedSize;
+        }
+
+        PackHeader header = {};
+        std::memcpy(header.magic, "WFNP", 4);
+        header.version = 1;
+        header.count = static_cast<uint32_t>(entries.size());
+        header.alignment = 64;
+        header.size = offset;
+
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            throw WfnError("wfn_eng::asset::PackWriter", "write", "Open " + path);
+
+        static const uint8_t padding[64] = {};
+        bool written =
+            std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(entries.data(), sizeof(PackEntry), entries.size(), file) == entries.size();
+
+        uint64_t at = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+        for (size_t i = 0; i < entries.size() && written; i++) {
+            size_t gap = static_cast<size_t>(entries[i].offset - at);
+            written =
+                std::fwrite(padding, 1, gap, file) == gap &&
+                std::fwrite(_pending[i].data.data(), 1, _pending[i].data.size(), file) == _pending[i].data.size();
+            at = entries[i].offset + entries[i].storedSize;
+        }
+
+        if (std::fclose(file) != 0 || !written)
+            throw WfnError("wfn_eng::asset::PackWriter", "write", "Write " + path);
+
+        _stats.fileBytes = offset;
+        _pending.clear();
+    }
+
+    ////
+    // const PackStats& stats()
+    //
+    // The counters of the last write.
+    const PackStats& PackWriter::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void PackWriter::report(std::ostream& out) const {
+        out << "Packed " << _stats.entries << " assets (" << _stats.compressed << " compressed): "
+            << _stats.bytes << " bytes stored in " << _stats.storedBytes << ", "
+            << _stats.fileBytes << " byte file" << std::endl;
+    }
+}
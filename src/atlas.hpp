@@ -0,0 +1,340 @@
+#ifndef __WFN_ENG_ATLAS_HPP__
+#define __WFN_ENG_ATLAS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "asset.hpp"
+#include "error.hpp"
+
+namespace wfn_eng::atlas {
+    ////
+    // typedef FrameId
+    //
+    // Names a frame of an Atlas: its index in the frame table, so a lookup
+    // is a single array access. Frames are numbered in path order.
+    typedef uint32_t FrameId;
+
+    ////
+    // const FrameId noFrame
+    //
+    // What find returns for a frame that isn't in the atlas.
+    const FrameId noFrame = ~0u;
+
+    ////
+    // struct Rect
+    //
+    // A rectangle of texels on a page.
+    struct Rect {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    ////
+    // class MaxRects
+    //
+    // Packs rectangles onto a single page with the MaxRects algorithm: it
+    // keeps every maximal free rectangle (they overlap), places each new
+    // rectangle where it leaves the shortest leftover side, then splits
+    // and prunes the free rectangles it overlaps.
+    class MaxRects {
+        uint32_t _width;
+        uint32_t _height;
+        uint64_t _used;
+        std::vector<Rect> _free;
+
+        ////
+        // void split(const Rect&)
+        //
+        // Replaces every free rectangle that overlaps a placed one with the
+        // parts of it left free, then drops the ones inside another.
+        void split(const Rect&);
+
+    public:
+        ////
+        // MaxRects(uint32_t, uint32_t)
+        //
+        // Constructs an empty page of the provided size.
+        MaxRects(uint32_t, uint32_t);
+
+        ////
+        // bool insert(uint32_t, uint32_t, Rect&)
+        //
+        // Places a rectangle, returning false if it doesn't fit anywhere.
+        bool insert(uint32_t, uint32_t, Rect&);
+
+        ////
+        // double occupancy()
+        //
+        // The share of the page that is used.
+        double occupancy() const;
+    };
+
+    ////
+    // struct AtlasHeader
+    //
+    // The fixed header at the start of an atlas file, followed by the
+    // frame table, then the name table.
+    struct AtlasHeader {
+        char magic[4];
+        uint16_t version;
+        uint16_t pages;
+        uint32_t count;
+        uint32_t pageWidth;
+        uint32_t pageHeight;
+        uint32_t reserved;
+    };
+
+    ////
+    // struct Frame
+    //
+    // A frame of the frame table: where it is on its page, in texture
+    // coordinates, and where the trimmed texels sit in the original frame,
+    // in texels. A fully transparent frame is trimmed to nothing.
+    struct Frame {
+        float u0, v0, u1, v1;
+        uint16_t page;
+        uint16_t width;
+        uint16_t height;
+        uint16_t sourceWidth;
+        uint16_t sourceHeight;
+        uint16_t offsetX;
+        uint16_t offsetY;
+        uint16_t reserved;
+    };
+
+    ////
+    // struct NameEntry
+    //
+    // An entry of the name table, which is sorted by id: the hash of a
+    // frame's path (asset::id), for looking frames up once at load time.
+    struct NameEntry {
+        asset::AssetId id;
+        FrameId frame;
+        uint32_t reserved;
+    };
+
+    ////
+    // class Atlas
+    //
+    // The frame table of an atlas, read from an atlas file. The pages are
+    // loaded separately, as textures.
+    class Atlas {
+        uint32_t _pages;
+        uint32_t _pageWidth;
+        uint32_t _pageHeight;
+        std::vector<Frame> _frames;
+        std::vector<NameEntry> _names;
+
+    public:
+        ////
+        // Atlas(const uint8_t *, size_t)
+        //
+        // Reads an atlas file, throwing if it isn't one.
+        Atlas(const uint8_t *, size_t);
+
+        ////
+        // const Frame& frame(FrameId)
+        //
+        // A frame, by id. The id must be below count().
+        const Frame& frame(FrameId id) const { return _frames[id]; }
+
+        ////
+        // FrameId find(asset::AssetId)
+        //
+        // The id of a frame from the hash of its path, or noFrame.
+        FrameId find(asset::AssetId) const;
+
+        ////
+        // size_t count()
+        //
+        // The number of frames.
+        size_t count() const;
+
+        ////
+        // uint32_t pages()
+        //
+        // The number of pages.
+        uint32_t pages() const;
+
+        uint32_t pageWidth() const;
+        uint32_t pageHeight() const;
+
+        // Following Rule of 3's
+        Atlas(const Atlas&) = delete;
+        Atlas& operator=(const Atlas&) = delete;
+    };
+
+    ////
+    // struct SpriteVertex
+    //
+    // A corner of a sprite quad.
+    struct SpriteVertex {
+        float x, y;
+        float u, v;
+    };
+
+    ////
+    // class SpriteBatch
+    //
+    // Builds the quads of the sprites of a frame, grouped by page, so all
+    // the sprites on one page take a single draw however many there are.
+    // The Atlas must outlive the batch.
+    class SpriteBatch {
+        const Atlas& _atlas;
+        std::vector<std::vector<SpriteVertex>> _pages;
+
+    public:
+        ////
+        // SpriteBatch(const Atlas&)
+        //
+        // Constructs an empty batch.
+        SpriteBatch(const Atlas&);
+
+        ////
+        // void clear()
+        //
+        // Drops the sprites, keeping the memory for the next frame.
+        void clear();
+
+        ////
+        // void add(FrameId, float, float, float, bool)
+        //
+        // Adds a sprite of a frame with the top left corner of the original
+        // (untrimmed) frame at a position, scaled, and mirrored horizontally
+        // within the original frame if flipped. Two triangles per sprite.
+        void add(FrameId, float, float, float = 1.0f, bool = false);
+
+        ////
+        // const std::vector<SpriteVertex>& vertices(uint32_t)
+        //
+        // The vertices of the sprites on a page.
+        const std::vector<SpriteVertex>& vertices(uint32_t) const;
+
+        ////
+        // size_t draws()
+        //
+        // The number of pages with any sprites: the draws the batch takes.
+        size_t draws() const;
+
+        // Following Rule of 3's
+        SpriteBatch(const SpriteBatch&) = delete;
+        SpriteBatch& operator=(const SpriteBatch&) = delete;
+    };
+
+    ////
+    // struct AtlasConfig
+    //
+    // How an AtlasWriter lays out its pages: their size, and the texels
+    // between frames (half of them filled with each frame's edge texels, so
+    // filtering never bleeds in a neighbour).
+    struct AtlasConfig {
+        uint32_t pageSize = 2048;
+        uint32_t padding = 2;
+    };
+
+    ////
+    // struct AtlasStats
+    //
+    // Counters on an AtlasWriter. The source texels are those of the
+    // frames as added; the packed ones, those left after trimming.
+    struct AtlasStats {
+        uint64_t frames = 0;
+        uint64_t pages = 0;
+        uint64_t groupsSplit = 0;
+        uint64_t sourceTexels = 0;
+        uint64_t packedTexels = 0;
+        uint64_t pageTexels = 0;
+        uint64_t packNanos = 0;
+    };
+
+    ////
+    // class AtlasWriter
+    //
+    // Packs RGBA8 frames into atlas pages, offline. Frames are trimmed to
+    // their opaque texels, and the frames of a group (e.g. one character)
+    // go on a single page whenever they fit on one, so that the sprites of
+    // the group batch into one draw.
+    class AtlasWriter {
+        struct Pending {
+            asset::AssetId id;
+            std::string path;
+            std::string group;
+            uint32_t width;
+            uint32_t height;
+            std::vector<uint8_t> rgba;
+            Rect trim;
+        };
+
+        AtlasConfig _config;
+        std::vector<Pending> _pending;
+
+        std::vector<uint8_t> _table;
+        std::vector<std::vector<uint8_t>> _pages;
+
+        AtlasStats _stats;
+
+    public:
+        ////
+        // AtlasWriter(const AtlasConfig&)
+        //
+        // Constructs an empty writer.
+        AtlasWriter(const AtlasConfig& = AtlasConfig());
+
+        ////
+        // void add(const std::string&, const std::string&, uint32_t, uint32_t, std::vector<uint8_t>)
+        //
+        // Adds a frame by path, in a group, from its RGBA8 texels. Throws if
+        // its id collides with another one's, or if it can't fit on a page.
+        void add(const std::string&, const std::string&, uint32_t, uint32_t, std::vector<uint8_t>);
+
+        ////
+        // void pack()
+        //
+        // Packs every frame added, building the frame table and the pages,
+        // then forgets the frames.
+        void pack();
+
+        ////
+        // const std::vector<uint8_t>& table()
+        //
+        // The atlas file of the last pack.
+        const std::vector<uint8_t>& table() const;
+
+        ////
+        // const std::vector<std::vector<uint8_t>>& pages()
+        //
+        // The RGBA8 texels of every page of the last pack.
+        const std::vector<std::vector<uint8_t>>& pages() const;
+
+        ////
+        // void write(const std::string&)
+        //
+        // Packs, then writes the frame table to <prefix>.atlas and each
+        // page to <prefix>_<page>.ktx2.
+        void write(const std::string&);
+
+        ////
+        // const AtlasStats& stats()
+        //
+        // The counters of the last pack.
+        const AtlasStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        AtlasWriter(const AtlasWriter&) = delete;
+        AtlasWriter& operator=(const AtlasWriter&) = delete;
+    };
+}
+
+#endif
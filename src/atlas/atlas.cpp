@@ -0,0 +1,150 @@
+#include "../atlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace wfn_eng::atlas {
+    ////
+    // class Atlas
+    //
+    // The frame table of an atlas, read from an atlas file.
+
+    ////
+    // Atlas(const uint8_t *, size_t)
+    //
+    // Reads an atlas file, throwing if it isn't one. Every frame is checked
+    // to be on a page and every name to point at a frame, so lookups never
+    // need to be.
+    Atlas::Atlas(const uint8_t *file, size_t size) {
+        AtlasHeader header;
+        if (size < sizeof(header))
+            throw WfnError("wfn_eng::atlas::Atlas", "Atlas", "Truncated header");
+        std::memcpy(&header, file, sizeof(header));
+
+        bool valid =
+            std::memcmp(header.magic, "WFNA", 4) == 0 &&
+            header.version == 1 &&
+            sizeof(AtlasHeader) + (uint64_t)header.count * (sizeof(Frame) + sizeof(NameEntry)) <= size;
+
+        if (valid) {
+            _pages = header.pages;
+            _pageWidth = header.pageWidth;
+            _pageHeight = header.pageHeight;
+
+            _frames.resize(header.count);
+            _names.resize(header.count);
+            std::memcpy(_frames.data(), file + sizeof(AtlasHeader), header.count * sizeof(Frame));
+            std::memcpy(_names.data(), file + sizeof(AtlasHeader) + header.count * sizeof(Frame), header.count * sizeof(NameEntry));
+
+            for (uint32_t i = 0; i < header.count && valid; i++) {
+                valid = (_frames[i].width == 0 || _frames[i].page < _pages) &&
+                        _names[i].frame < header.count &&
+                        (i == 0 || _names[i - 1].id < _names[i].id);
+            }
+        }
+
+        if (!valid)
+            throw WfnError("wfn_eng::atlas::Atlas", "Atlas", "Not an atlas");
+    }
+
+    ////
+    // FrameId find(asset::AssetId)
+    //
+    // The id of a frame from the hash of its path, or noFrame. Binary
+    // searches the name table, so it's meant for load time: draws keep the
+    // FrameId.
+    FrameId Atlas::find(asset::AssetId id) const {
+        auto it = std::lower_bound(_names.begin(), _names.end(), id, [](const NameEntry& entry, asset::AssetId id) {
+            return entry.id < id;
+        });
+
+        return it != _names.end() && it->id == id ? it->frame : noFrame;
+    }
+
+    ////
+    // size_t count()
+    //
+    // The number of frames.
+    size_t Atlas::count() const { return _frames.size(); }
+
+    ////
+    // uint32_t pages()
+    //
+    // The number of pages.
+    uint32_t Atlas::pages() const { return _pages; }
+
+    uint32_t Atlas::pageWidth() const { return _pageWidth; }
+    uint32_t Atlas::pageHeight() const { return _pageHeight; }
+
+    ////
+    // class SpriteBatch
+    //
+    // Builds the quads of the sprites of a frame, grouped by page.
+
+    ////
+    // SpriteBatch(const Atlas&)
+    //
+    // Constructs an empty batch, with a vertex list per page.
+    SpriteBatch::SpriteBatch(const Atlas& atlas)
+            : _atlas(atlas)
+            , _pages(atlas.pages()) { }
+
+    ////
+    // void clear()
+    //
+    // Drops the sprites, keeping the memory for the next frame.
+    void SpriteBatch::clear() {
+        for (std::vector<SpriteVertex>& page : _pages)
+            page.clear();
+    }
+
+    ////
+    // void add(FrameId, float, float, float, bool)
+    //
+    // Adds a sprite of a frame. The trimmed texels are placed where they
+    // were in the original frame, so trimming never moves a sprite; a
+    // flipped sprite mirrors that placement and swaps its u coordinates.
+    void SpriteBatch::add(FrameId id, float x, float y, float scale, bool flip) {
+        const Frame& frame = _atlas.frame(id);
+        if (frame.width == 0)
+            return;
+
+        uint32_t left = flip ? frame.sourceWidth - frame.offsetX - frame.width : frame.offsetX;
+        float x0 = x + left * scale;
+        float y0 = y + frame.offsetY * scale;
+        float x1 = x0 + frame.width * scale;
+        float y1 = y0 + frame.height * scale;
+
+        float u0 = flip ? frame.u1 : frame.u0;
+        float u1 = flip ? frame.u0 : frame.u1;
+
+        std::vector<SpriteVertex>& page = _pages[frame.page];
+        page.push_back(SpriteVertex { x0, y0, u0, frame.v0 });
+        page.push_back(SpriteVertex { x1, y0, u1, frame.v0 });
+        page.push_back(SpriteVertex { x1, y1, u1, frame.v1 });
+        page.push_back(SpriteVertex { x0, y0, u0, frame.v0 });
+        page.push_back(SpriteVertex { x1, y1, u1, frame.v1 });
+        page.push_back(SpriteVertex { x0, y1, u0, frame.v1 });
+    }
+
+    ////
+    // const std::vector<SpriteVertex>& vertices(uint32_t)
+    //
+    // The vertices of the sprites on a page.
+    const std::vector<SpriteVertex>& SpriteBatch::vertices(uint32_t page) const {
+        return _pages[page];
+    }
+
+    ////
+    // size_t draws()
+    //
+    // The number of pages with any sprites.
+    size_t SpriteBatch::draws() const {
+        size_t draws = 0;
+        for (const std::vector<SpriteVertex>& page : _pages) {
+            if (!page.empty())
+                draws++;
+        }
+        return draws;
+    }
+}
@@ -0,0 +1,139 @@
+#include "../atlas.hpp"
+
+#include <algorithm>
+#include <limits>
+
+////
+// bool overlaps(const Rect&, const Rect&)
+//
+// Whether two rectangles share any texel.
+static bool overlaps(const wfn_eng::atlas::Rect& a, const wfn_eng::atlas::Rect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+////
+// bool contains(const Rect&, const Rect&)
+//
+// Whether the first rectangle holds the whole second one.
+static bool contains(const wfn_eng::atlas::Rect& outer, const wfn_eng::atlas::Rect& inner) {
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+namespace wfn_eng::atlas {
+    ////
+    // class MaxRects
+    //
+    // Packs rectangles onto a single page with the MaxRects algorithm.
+
+    ////
+    // MaxRects(uint32_t, uint32_t)
+    //
+    // Constructs an empty page of the provided size: a single free
+    // rectangle covering all of it.
+    MaxRects::MaxRects(uint32_t width, uint32_t height)
+            : _width(width)
+            , _height(height)
+            , _used(0) {
+        _free.push_back(Rect { 0, 0, width, height });
+    }
+
+    ////
+    // bool insert(uint32_t, uint32_t, Rect&)
+    //
+    // Places a rectangle by best short side fit: in the free rectangle
+    // where the shorter of the two leftover sides is the smallest, breaking
+    // ties on the longer one.
+    bool MaxRects::insert(uint32_t width, uint32_t height, Rect& placed) {
+        const Rect *best = nullptr;
+        uint32_t bestShort = std::numeric_limits<uint32_t>::max();
+        uint32_t bestLong = std::numeric_limits<uint32_t>::max();
+
+        for (const Rect& free : _free) {
+            if (free.width < width || free.height < height)
+                continue;
+
+            uint32_t leftoverX = free.width - width;
+            uint32_t leftoverY = free.height - height;
+            uint32_t shortSide = std::min(leftoverX, leftoverY);
+            uint32_t longSide = std::max(leftoverX, leftoverY);
+
+            if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+                best = &free;
+                bestShort = shortSide;
+                bestLong = longSide;
+            }
+        }
+
+        if (best == nullptr)
+            return false;
+
+        placed = Rect { best->x, best->y, width, height };
+        split(placed);
+        _used += (uint64_t)width * height;
+        return true;
+    }
+
+    ////
+    // void split(const Rect&)
+    //
+    // Replaces every free rectangle that overlaps a placed one with up to
+    // four maximal rectangles around it, then drops the free rectangles
+    // that lie inside another.
+    void MaxRects::split(const Rect& placed) {
+        std::vector<Rect> pieces;
+
+        for (size_t i = 0; i < _free.size();) {
+            Rect free = _free[i];
+            if (!overlaps(free, placed)) {
+                i++;
+                continue;
+            }
+
+            uint32_t freeRight = free.x + free.width;
+            uint32_t freeBottom = free.y + free.height;
+            uint32_t placedRight = placed.x + placed.width;
+            uint32_t placedBottom = placed.y + placed.height;
+
+            if (placed.x > free.x)
+                pieces.push_back(Rect { free.x, free.y, placed.x - free.x, free.height });
+            if (placedRight < freeRight)
+                pieces.push_back(Rect { placedRight, free.y, freeRight - placedRight, free.height });
+            if (placed.y > free.y)
+                pieces.push_back(Rect { free.x, free.y, free.width, placed.y - free.y });
+            if (placedBottom < freeBottom)
+                pieces.push_back(Rect { free.x, placedBottom, free.width, freeBottom - placedBottom });
+
+            _free[i] = _free.back();
+            _free.pop_back();
+        }
+
+        _free.insert(_free.end(), pieces.begin(), pieces.end());
+
+        for (size_t i = 0; i < _free.size(); i++) {
+            for (size_t j = i + 1; j < _free.size();) {
+                if (contains(_free[i], _free[j])) {
+                    _free[j] = _free.back();
+                    _free.pop_back();
+                } else if (contains(_free[j], _free[i])) {
+                    _free[i] = _free[j];
+                    _free[j] = _free.back();
+                    _free.pop_back();
+                    j = i + 1;
+                } else {
+                    j++;
+                }
+            }
+        }
+    }
+
+    ////
+    // double occupancy()
+    //
+    // The share of the page that is used.
+    double MaxRects::occupancy() const {
+        return (double)_used / ((uint64_t)_width * _height);
+    }
+}
@@ -0,0 +1,309 @@
+#include "../atlas.hpp"
+#include "../texture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+////
+// Rect trim(const std::vector<uint8_t>&, uint32_t, uint32_t)
+//
+// The bounds of the texels of an RGBA8 frame with any alpha, or an empty
+// rectangle if it's fully transparent.
+static wfn_eng::atlas::Rect trim(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height) {
+    uint32_t left = width, top = height, right = 0, bottom = 0;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *row = rgba.data() + (uint64_t)y * width * 4;
+        for (uint32_t x = 0; x < width; x++) {
+            if (row[x * 4 + 3] == 0)
+                continue;
+
+            left = std::min(left, x);
+            right = std::max(right, x + 1);
+            top = std::min(top, y);
+            bottom = std::max(bottom, y + 1);
+        }
+    }
+
+    if (right == 0)
+        return wfn_eng::atlas::Rect {};
+    return wfn_eng::atlas::Rect { left, top, right - left, bottom - top };
+}
+
+////
+// void writeFile(const std::string&, const std::vector<uint8_t>&)
+//
+// Writes a whole file, throwing if it can't.
+static void writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        throw wfn_eng::WfnError("wfn_eng::atlas::AtlasWriter", "write", "Open " + path);
+
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    if (std::fclose(file) != 0 || !written)
+        throw wfn_eng::WfnError("wfn_eng::atlas::AtlasWriter", "write", "Write " + path);
+}
+
+namespace wfn_eng::atlas {
+    ////
+    // class AtlasWriter
+    //
+    // Packs RGBA8 frames into atlas pages, offline.
+
+    ////
+    // AtlasWriter(const AtlasConfig&)
+    //
+    // Constructs an empty writer.
+    AtlasWriter::AtlasWriter(const AtlasConfig& config)
+            : _config(config) { }
+
+    ////
+    // void add(const std::string&, const std::string&, uint32_t, uint32_t, std::vector<uint8_t>)
+    //
+    // Adds a frame by path, in a group, trimming it right away.
+    void AtlasWriter::add(const std::string& path, const std::string& group, uint32_t width, uint32_t height, std::vector<uint8_t> rgba) {
+        if (rgba.size() != (uint64_t)width * height * 4)
+            throw WfnError("wfn_eng::atlas::AtlasWriter", "add", "Read " + path + " (not RGBA8)");
+
+        Rect trimmed = trim(rgba, width, height);
+        if (width > 0xFFFF || height > 0xFFFF ||
+            trimmed.width + _config.padding > _config.pageSize ||
+            trimmed.height + _config.padding > _config.pageSize) {
+            throw WfnError("wfn_eng::atlas::AtlasWriter", "add", "Fit " + path + " on a page");
+        }
+
+        _pending.push_back(Pending { asset::id(path), path, group, width, height, std::move(rgba), trimmed });
+    }
+
+    ////
+    // void pack()
+    //
+    // Packs every frame added. Each group is packed tallest frame first,
+    // onto the first page with room for all of it (a fresh one if need be);
+    // only a group larger than a whole page is split, frame by frame. Each
+    // frame takes a cell of its trimmed size plus the padding, and its edge
+    // texels are repeated out to the cell's borders.
+    void AtlasWriter::pack() {
+        auto start = std::chrono::steady_clock::now();
+
+        std::sort(_pending.begin(), _pending.end(), [](const Pending& a, const Pending& b) {
+            return a.path < b.path;
+        });
+
+        std::vector<NameEntry> names(_pending.size());
+        for (size_t i = 0; i < _pending.size(); i++)
+            names[i] = NameEntry { _pending[i].id, static_cast<FrameId>(i), 0 };
+        std::sort(names.begin(), names.end(), [](const NameEntry& a, const NameEntry& b) {
+            return a.id < b.id;
+        });
+
+        for (size_t i = 1; i < names.size(); i++) {
+            if (names[i - 1].id == names[i].id) {
+                throw WfnError(
+                    "wfn_eng::atlas::AtlasWriter",
+                    "pack",
+                    "Hash " + _pending[names[i - 1].frame].path + " and " + _pending[names[i].frame].path + " apart"
+                );
+            }
+        }
+
+        _stats = AtlasStats {};
+        _stats.frames = _pending.size();
+
+        // The frames of each group, in the order they're packed.
+        std::vector<std::vector<size_t>> groups;
+        {
+            std::vector<size_t> order;
+            for (size_t i = 0; i < _pending.size(); i++) {
+                if (_pending[i].trim.width > 0)
+                    order.push_back(i);
+            }
+
+            std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+                const Pending& pa = _pending[a];
+                const Pending& pb = _pending[b];
+                if (pa.group != pb.group)
+                    return pa.group < pb.group;
+                return pa.trim.height != pb.trim.height ? pa.trim.height > pb.trim.height : pa.trim.width > pb.trim.width;
+            });
+
+            for (size_t i = 0; i < order.size(); i++) {
+                if (i == 0 || _pending[order[i]].group != _pending[order[i - 1]].group)
+                    groups.emplace_back();
+                groups.back().push_back(order[i]);
+            }
+        }
+
+        std::vector<MaxRects> pages;
+        std::vector<uint32_t> pageOf(_pending.size(), 0);
+        std::vector<Rect> cellOf(_pending.size());
+        const uint32_t size = _config.pageSize;
+        const uint32_t padding = _config.padding;
+
+        for (const std::vector<size_t>& group : groups) {
+            uint64_t groupTexels = 0;
+            for (size_t index : group)
+                groupTexels += (uint64_t)(_pending[index].trim.width + padding) * (_pending[index].trim.height + padding);
+
+            bool placed = false;
+            for (size_t p = 0; p <= pages.size() && !placed; p++) {
+                // Not worth a try when the group is larger than the room left.
+                if (p < pages.size() && groupTexels > (1.0 - pages[p].occupancy()) * size * size)
+                    continue;
+
+                MaxRects page = p < pages.size() ? pages[p] : MaxRects(size, size);
+
+                placed = true;
+                for (size_t i = 0; i < group.size() && placed; i++) {
+                    const Pending& frame = _pending[group[i]];
+                    placed = page.insert(frame.trim.width + padding, frame.trim.height + padding, cellOf[group[i]]);
+                    pageOf[group[i]] = static_cast<uint32_t>(p);
+                }
+
+                if (placed && p < pages.size())
+                    pages[p] = std::move(page);
+                else if (placed)
+                    pages.push_back(std::move(page));
+            }
+
+            if (placed)
+                continue;
+
+            _stats.groupsSplit++;
+            for (size_t index : group) {
+                const Pending& frame = _pending[index];
+                for (size_t p = 0; ; p++) {
+                    if (p == pages.size())
+                        pages.emplace_back(size, size);
+                    if (pages[p].insert(frame.trim.width + padding, frame.trim.height + padding, cellOf[index])) {
+                        pageOf[index] = static_cast<uint32_t>(p);
+                        break;
+                    }
+                }
+            }
+        }
+
+        _pages.assign(pages.size(), std::vector<uint8_t>((uint64_t)size * size * 4, 0));
+        std::vector<Frame> frames(_pending.size());
+
+        for (size_t i = 0; i < _pending.size(); i++) {
+            const Pending& pending = _pending[i];
+            Frame& frame = frames[i];
+
+            frame = Frame {};
+            frame.sourceWidth = static_cast<uint16_t>(pending.width);
+            frame.sourceHeight = static_cast<uint16_t>(pending.height);
+            _stats.sourceTexels += (uint64_t)pending.width * pending.height;
+
+            if (pending.trim.width == 0)
+                continue;
+
+            const Rect& cell = cellOf[i];
+            const Rect& trim = pending.trim;
+            uint32_t x = cell.x + padding / 2;
+            uint32_t y = cell.y + padding / 2;
+
+            frame.page = static_cast<uint16_t>(pageOf[i]);
+            frame.width = static_cast<uint16_t>(trim.width);
+            frame.height = static_cast<uint16_t>(trim.height);
+            frame.offsetX = static_cast<uint16_t>(trim.x);
+            frame.offsetY = static_cast<uint16_t>(trim.y);
+            frame.u0 = (float)x / size;
+            frame.v0 = (float)y / size;
+            frame.u1 = (float)(x + trim.width) / size;
+            frame.v1 = (float)(y + trim.height) / size;
+            _stats.packedTexels += (uint64_t)trim.width * trim.height;
+
+            // The whole cell, each texel from the nearest one of the frame.
+            uint8_t *page = _pages[pageOf[i]].data();
+            for (uint32_t cy = cell.y; cy < cell.y + cell.height; cy++) {
+                uint32_t sy = trim.y + std::min(trim.height - 1, cy > y ? cy - y : 0);
+                const uint8_t *row = pending.rgba.data() + ((uint64_t)sy * pending.width + trim.x) * 4;
+                uint8_t *out = page + ((uint64_t)cy * size + cell.x) * 4;
+
+                for (uint32_t cx = cell.x; cx < cell.x + cell.width; cx++, out += 4) {
+                    uint32_t sx = std::min(trim.width - 1, cx > x ? cx - x : 0);
+                    std::memcpy(out, row + sx * 4, 4);
+                }
+            }
+        }
+
+        AtlasHeader header = {};
+        std::memcpy(header.magic, "WFNA", 4);
+        header.version = 1;
+        header.pages = static_cast<uint16_t>(pages.size());
+        header.count = static_cast<uint32_t>(frames.size());
+        header.pageWidth = size;
+        header.pageHeight = size;
+
+        _table.resize(sizeof(AtlasHeader) + frames.size() * (sizeof(Frame) + sizeof(NameEntry)));
+        std::memcpy(_table.data(), &header, sizeof(header));
+        std::memcpy(_table.data() + sizeof(AtlasHeader), frames.data(), frames.size() * sizeof(Frame));
+        std::memcpy(_table.data() + sizeof(AtlasHeader) + frames.size() * sizeof(Frame), names.data(), names.size() * sizeof(NameEntry));
+
+        _stats.pages = pages.size();
+        _stats.pageTexels = (uint64_t)size * size * pages.size();
+        _stats.packNanos = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+        );
+        _pending.clear();
+    }
+
+    ////
+    // const std::vector<uint8_t>& table()
+    //
+    // The atlas file of the last pack.
+    const std::vector<uint8_t>& AtlasWriter::table() const { return _table; }
+
+    ////
+    // const std::vector<std::vector<uint8_t>>& pages()
+    //
+    // The RGBA8 texels of every page of the last pack.
+    const std::vector<std::vector<uint8_t>>& AtlasWriter::pages() const { return _pages; }
+
+    ////
+    // void write(const std::string&)
+    //
+    // Packs, then writes the frame table and the pages, as sRGB KTX2 files
+    // with a single level (the mips are generated when they're loaded).
+    void AtlasWriter::write(const std::string& prefix) {
+        pack();
+        writeFile(prefix + ".atlas", _table);
+
+        uint32_t size = _config.pageSize;
+        for (size_t i = 0; i < _pages.size(); i++) {
+            texture::Image image;
+            image.format = VK_FORMAT_R8G8B8A8_SRGB;
+            image.width = size;
+            image.height = size;
+            image.levels.push_back(texture::Level { 0, (uint64_t)size * size * 4, size, size });
+
+            // Lent to the image rather than copied.
+            image.data.swap(_pages[i]);
+            std::vector<uint8_t> file = texture::writeKtx2(image);
+            image.data.swap(_pages[i]);
+
+            writeFile(prefix + "_" + std::to_string(i) + ".ktx2", file);
+        }
+    }
+
+    ////
+    // const AtlasStats& stats()
+    //
+    // The counters of the last pack.
+    const AtlasStats& AtlasWriter::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void AtlasWriter::report(std::ostream& out) const {
+        out << "Atlas: " << _stats.frames << " frames on " << _stats.pages << " pages ("
+            << _stats.groupsSplit << " groups split), "
+            << (_stats.pageTexels > 0 ? 100.0 * _stats.packedTexels / _stats.pageTexels : 0.0) << "% occupied, trimming kept "
+            << (_stats.sourceTexels > 0 ? 100.0 * _stats.packedTexels / _stats.sourceTexels : 0.0) << "% of the texels, packed in "
+            << _stats.packNanos / 1000000.0 << "ms" << std::endl;
+    }
+}
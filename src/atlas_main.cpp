@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "atlas.hpp"
+#include "texture.hpp"
+
+////
+// wfn_atlas
+//
+// Packs every KTX2 frame (RGBA8, level 0) under a directory into atlas
+// pages, keyed by its path relative to the directory and grouped by the
+// directory it's in:
+//
+//   wfn_atlas <directory> <prefix> [page size] [padding]
+//
+// Writes <prefix>.atlas and <prefix>_<page>.ktx2.
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <directory> <prefix> [page size] [padding]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path root = argv[1];
+    std::string prefix = argv[2];
+
+    wfn_eng::atlas::AtlasConfig config;
+    if (argc > 3)
+        config.pageSize = static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10));
+    if (argc > 4)
+        config.padding = static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10));
+
+    try {
+        wfn_eng::atlas::AtlasWriter writer(config);
+
+        for (const auto& file : std::filesystem::recursive_directory_iterator(root)) {
+            if (!file.is_regular_file() || file.path().extension() != ".ktx2")
+                continue;
+
+            std::ifstream in(file.path(), std::ios::ate | std::ios::binary);
+            if (!in.is_open()) {
+                std::cerr << "Failed to open " << file.path() << std::endl;
+                return 1;
+            }
+
+            std::vector<uint8_t> data(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(reinterpret_cast<char *>(data.data()), data.size());
+
+            wfn_eng::texture::Image image = wfn_eng::texture::readKtx2(data.data(), data.size());
+            if (image.format != VK_FORMAT_R8G8B8A8_UNORM && image.format != VK_FORMAT_R8G8B8A8_SRGB) {
+                std::cerr << file.path() << " isn't RGBA8" << std::endl;
+                return 1;
+            }
+
+            std::filesystem::path relative = file.path().lexically_relative(root);
+            image.data.resize(image.levels[0].size);
+
+            writer.add(
+                relative.generic_string(),
+                relative.parent_path().generic_string(),
+                image.width,
+                image.height,
+                std::move(image.data)
+            );
+        }
+
+        writer.write(prefix);
+        writer.report(std::cout);
+    } catch (const wfn_eng::WfnError& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#ifndef __WFN_ENG_BENCH_HPP__
+#define __WFN_ENG_BENCH_HPP__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace wfn_eng::bench {
+    ////
+    // const uint32_t seed
+    //
+    // What every bench seeds its std::mt19937 with, so that two runs fill
+    // the same data and their timings compare.
+    const uint32_t seed = 1;
+
+    ////
+    // using Seconds
+    //
+    // A measured time.
+    using Seconds = std::chrono::duration<double>;
+
+    ////
+    // Seconds time(Function&&)
+    //
+    // How long running the provided function once takes.
+    template <typename Function>
+    Seconds time(Function&& function) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    ////
+    // Seconds repeat(size_t, Function&&)
+    //
+    // How long one run of the provided function takes on average, over the
+    // provided number of runs after a first untimed one.
+    template <typename Function>
+    Seconds repeat(size_t rounds, Function&& function) {
+        function();
+        return time([&]() {
+            for (size_t round = 0; round < rounds; round++)
+                function();
+        }) / rounds;
+    }
+
+    ////
+    // size_t rounds(size_t, size_t)
+    //
+    // How many runs over the provided number of items add up to about the
+    // provided budget of items, at least one.
+    size_t rounds(size_t budget, size_t items);
+
+    ////
+    // void fill(std::mt19937&, Iterator, Iterator, Distribution)
+    //
+    // Fills a range with values drawn from the provided distribution.
+    template <typename Iterator, typename Distribution>
+    void fill(std::mt19937& rng, Iterator first, Iterator last, Distribution distribution) {
+        for (; first != last; ++first)
+            *first = distribution(rng);
+    }
+
+    ////
+    // std::vector<uint8_t> bytes(std::mt19937&, size_t)
+    //
+    // The provided number of random bytes.
+    std::vector<uint8_t> bytes(std::mt19937&, size_t);
+
+    ////
+    // std::string duration(Seconds)
+    //
+    // A time in the unit that suits it, from nanoseconds to seconds, with
+    // three significant digits: "412ns", "1.38ms".
+    std::string duration(Seconds);
+
+    ////
+    // void sort(size_t)
+    //
+    // Fills a render queue with the provided number of random draws (made-up
+    // handles, spread over 64 pipelines, 1024 materials and 256 meshes, a
+    // quarter of them translucent), then reports the cost of sorting them
+    // on one thread and on every worker, and the binds the sort saves.
+    void sort(size_t);
+
+    ////
+    // void pack(size_t)
+    //
+    // Writes the provided number of small assets (64 bytes to 4KiB) both as
+    // loose files and as a pack in the temporary directory, then reports
+    // how long reading every byte of every asset takes each way. Both runs
+    // read from the page cache.
+    void pack(size_t);
+
+    ////
+    // void io(size_t)
+    //
+    // Writes the provided number of assets in the temporary directory (most
+    // of them 1 to 64KiB, every fifth 64KiB to 1MiB), then reports how long
+    // loading all of them takes: one blocking ifstream at a time, as shaders
+    // used to be read; with pread; with io_uring; and with io_uring and
+    // O_DIRECT. Each is timed cold, right after the files are dropped from
+    // the page cache, and warm, right after reading them through it.
+    void io(size_t);
+
+    ////
+    // void atlas(size_t)
+    //
+    // Packs the provided number of random sprite frames (characters of 100
+    // frames, each with a transparent border to trim) into 2048x2048 atlas
+    // pages, then reports the packing and how long building the sprites of
+    // every frame takes, along with the draws they batch into.
+    void atlas(size_t);
+
+    ////
+    // void math(size_t)
+    //
+    // Runs the batch transform kernels of every instruction set the CPU
+    // supports on the provided number of random entities: building their
+    // model matrices, composing them with their parents' and bounding their
+    // boxes, then reports transforms per second for each, along with the
+    // largest difference from glm.
+    void math(size_t);
+
+    ////
+    // void cull(size_t)
+    //
+    // Culls the provided number of random objects scattered around a camera
+    // (bounding spheres and boxes against its frustum, and 2D rectangles
+    // against a 1920x1080 view) with every supported instruction set, on
+    // one thread and on every worker, then reports how long each takes and
+    // whether the visible lists match the scalar ones.
+    void cull(size_t);
+
+    ////
+    // void physics(size_t)
+    //
+    // Runs the broadphase on 100, 1000 and 10000 random boxes (four per
+    // owner, over a world sized for a few overlaps each), the provided
+    // number of times each, and reports the average and best run along with
+    // the broadphase counters. Every run's pairs are checked against brute
+    // force.
+    void physics(size_t);
+
+    ////
+    // void hash(size_t)
+    //
+    // Scatters the provided number of entities over a square world (about
+    // one per 16x16 units), then reports how long rebuilding a spatial hash
+    // of 64 unit cells takes, and how long 1024 radius queries (of 64 units)
+    // and 1024 rect queries (of 320x180) take one at a time, as batches
+    // across the workers and by brute force. Every result is checked
+    // against brute force.
+    void hash(size_t);
+
+    ////
+    // void tilemap(size_t)
+    //
+    // Fills a square map of about the provided number of 16 unit tiles
+    // (from 64 tile frames, a tenth of the cells empty) in 32x32 chunks,
+    // bakes every chunk, then scrolls a 1280x720 camera across it for 1000
+    // frames, editing 16 random tiles every tenth frame. Reports what a
+    // frame costs the CPU with chunks (finding the visible ones and
+    // rebaking the dirty ones) against building the quads of every tile in
+    // view each frame.
+    void tilemap(size_t);
+
+    ////
+    // void rollback(size_t)
+    //
+    // Runs two rollback sessions against each other over loopback peers (2
+    // ticks of delay plus up to 4 of jitter) for the provided number of
+    // ticks, on states of 4KiB up to 4MiB. Each step changes a few hundred
+    // words of the state, and inputs change every few frames so that
+    // predictions miss. Every frame both sides have confirmed is checked to
+    // hash the same on both. Reports the rollbacks and the snapshot timings
+    // of each size.
+    void rollback(size_t);
+}
+
+#endif
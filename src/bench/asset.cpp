@@ -0,0 +1,83 @@
+#include "../bench.hpp"
+#include "../asset.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace wfn_eng::bench {
+    ////
+    // void pack(size_t)
+    //
+    // Writes the provided number of small assets (64 bytes to 4KiB) both as
+    // loose files and as a pack in the temporary directory, then reports
+    // how long reading every byte of every asset takes each way. Both runs
+    // read from the page cache.
+    void pack(size_t assets) {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "wfn_eng_pack_bench";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> sizes(64, 4096);
+
+        std::vector<std::string> paths(assets);
+        std::vector<asset::AssetId> ids(assets);
+        asset::PackWriter writer;
+
+        for (size_t i = 0; i < assets; i++) {
+            std::string name = "asset_" + std::to_string(i) + ".bin";
+            std::vector<uint8_t> data = bytes(rng, sizes(rng));
+
+            paths[i] = (directory / name).string();
+            ids[i] = asset::id(name);
+
+            FILE *file = std::fopen(paths[i].c_str(), "wb");
+            if (file == nullptr)
+                throw std::runtime_error("Failed to write " + paths[i]);
+            std::fwrite(data.data(), 1, data.size(), file);
+            std::fclose(file);
+
+            writer.add(name, std::move(data));
+        }
+
+        std::string packPath = (directory / "assets.pack").string();
+        writer.write(packPath);
+
+        uint64_t looseSum = 0;
+        std::vector<uint8_t> buffer;
+        Seconds loose = time([&]() {
+            for (const std::string& path : paths) {
+                FILE *file = std::fopen(path.c_str(), "rb");
+                std::fseek(file, 0, SEEK_END);
+                buffer.resize(std::ftell(file));
+                std::fseek(file, 0, SEEK_SET);
+                std::fread(buffer.data(), 1, buffer.size(), file);
+                std::fclose(file);
+
+                for (uint8_t byte : buffer)
+                    looseSum += byte;
+            }
+        });
+
+        uint64_t packSum = 0;
+        Seconds packed = time([&]() {
+            asset::Pack pack(packPath);
+            for (asset::AssetId id : ids) {
+                asset::Blob blob = pack.view(id);
+                for (size_t i = 0; i < blob.size; i++)
+                    packSum += blob.data[i];
+            }
+        });
+
+        std::filesystem::remove_all(directory);
+
+        if (looseSum != packSum)
+            throw std::runtime_error("Pack contents differ from the loose files");
+
+        writer.report(std::cout);
+        std::cout << "Read " << assets << " assets: loose files " << duration(loose) << ", pack "
+                  << duration(packed) << " (" << loose / packed << "x)" << std::endl;
+    }
+}
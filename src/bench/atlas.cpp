@@ -0,0 +1,58 @@
+#include "../bench.hpp"
+#include "../atlas.hpp"
+
+#include <iostream>
+
+namespace wfn_eng::bench {
+    ////
+    // void atlas(size_t)
+    //
+    // Packs the provided number of random sprite frames (characters of 100
+    // frames, each with a transparent border to trim) into 2048x2048 atlas
+    // pages, then reports the packing and how long building the sprites of
+    // every frame takes, along with the draws they batch into.
+    void atlas(size_t frames) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<uint32_t> sizes(64, 256);
+
+        atlas::AtlasWriter writer;
+        for (size_t i = 0; i < frames; i++) {
+            uint32_t width = sizes(rng);
+            uint32_t height = sizes(rng);
+
+            // Opaque in the middle half, give or take.
+            std::vector<uint8_t> rgba((uint64_t)width * height * 4, 0);
+            uint32_t left = rng() % (width / 4 + 1), top = rng() % (height / 4 + 1);
+            uint32_t right = width - rng() % (width / 4 + 1), bottom = height - rng() % (height / 4 + 1);
+            for (uint32_t y = top; y < bottom; y++) {
+                for (uint32_t x = left; x < right; x++)
+                    rgba[((uint64_t)y * width + x) * 4 + 3] = 255;
+            }
+
+            std::string character = "character_" + std::to_string(i / 100);
+            writer.add(character + "/frame_" + std::to_string(i % 100), character, width, height, std::move(rgba));
+        }
+
+        writer.pack();
+        writer.report(std::cout);
+
+        atlas::Atlas table(writer.table().data(), writer.table().size());
+        atlas::SpriteBatch batch(table);
+
+        // Every frame on screen at once, as many times as it takes to time.
+        size_t vertices = 0;
+        Seconds round = repeat(rounds(4000000, frames), [&]() {
+            batch.clear();
+            for (atlas::FrameId id = 0; id < table.count(); id++)
+                batch.add(id, (float)(id % 64) * 32.0f, (float)(id / 64) * 32.0f, 1.0f, (id & 1) != 0);
+
+            vertices = 0;
+            for (uint32_t page = 0; page < table.pages(); page++)
+                vertices += batch.vertices(page).size();
+        });
+
+        std::cout << "Sprites: " << frames << " frames in " << batch.draws() << " draws (one texture per frame: "
+                  << frames << "), " << duration(round / frames) << " per sprite (" << vertices << " vertices)"
+                  << std::endl;
+    }
+}
@@ -0,0 +1,114 @@
+#include "../bench.hpp"
+#include "../cull.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+namespace wfn_eng::bench {
+    ////
+    // void cull(size_t)
+    //
+    // Culls the provided number of random objects scattered around a camera
+    // (bounding spheres and boxes against its frustum, and 2D rectangles
+    // against a 1920x1080 view) with every supported instruction set, on
+    // one thread and on every worker, then reports how long each takes and
+    // whether the visible lists match the scalar ones.
+    void cull(size_t objects) {
+        using math::Isa;
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> positions(-200.0f, 200.0f);
+        std::uniform_real_distribution<float> sizes(0.5f, 4.0f);
+        std::uniform_real_distribution<float> screen(-4000.0f, 4000.0f);
+        std::uniform_real_distribution<float> sprites(16.0f, 256.0f);
+
+        math::Columns sphereColumns(4, objects), boxColumns(6, objects), rectColumns(4, objects);
+        math::Aabb3 boxes = boxColumns.aabb3();
+        for (size_t i = 0; i < objects; i++) {
+            float size = sizes(rng);
+            for (size_t k = 0; k < 3; k++) {
+                float center = positions(rng);
+                sphereColumns.column(k)[i] = center;
+                boxes.min[k][i] = center - size;
+                boxes.max[k][i] = center + size;
+            }
+            sphereColumns.column(3)[i] = size;
+
+            float x = screen(rng), y = screen(rng);
+            rectColumns.column(0)[i] = x;
+            rectColumns.column(1)[i] = y;
+            rectColumns.column(2)[i] = x + sprites(rng);
+            rectColumns.column(3)[i] = y + sprites(rng);
+        }
+
+        cull::Spheres spheres = {
+            sphereColumns.column(0), sphereColumns.column(1), sphereColumns.column(2), sphereColumns.column(3)
+        };
+        cull::Rects rects = {
+            rectColumns.column(0), rectColumns.column(1), rectColumns.column(2), rectColumns.column(3)
+        };
+
+        // Looking down -z from the middle of the objects, as in Vulkan.
+        float viewProjection[16] = {};
+        {
+            const float near = 0.1f, far = 300.0f, aspect = 16.0f / 9.0f;
+            const float focal = 1.0f / std::tan(3.14159265f / 6.0f);
+            viewProjection[0] = focal / aspect;
+            viewProjection[5] = -focal;
+            viewProjection[10] = far / (near - far);
+            viewProjection[11] = -1.0f;
+            viewProjection[14] = near * far / (near - far);
+        }
+        cull::Frustum frustum = cull::frustum(viewProjection);
+        cull::Rect camera = { -960.0f, -540.0f, 960.0f, 540.0f };
+
+        struct Test {
+            const char *name;
+            std::function<size_t (cull::Culler&, uint32_t *)> run;
+            std::vector<uint32_t> expected;
+        };
+
+        Test tests[] = {
+            { "spheres", [&](cull::Culler& culler, uint32_t *out) { return culler.spheres(frustum, spheres, objects, out); }, {} },
+            { "boxes", [&](cull::Culler& culler, uint32_t *out) { return culler.boxes(frustum, boxes, objects, out); }, {} },
+            { "rects", [&](cull::Culler& culler, uint32_t *out) { return culler.rects(camera, rects, objects, out); }, {} }
+        };
+
+        cull::Culler serial(1);
+        cull::Culler parallel;
+        std::vector<uint32_t> visible(objects);
+
+        const Isa best = math::isa();
+        const size_t count = rounds(20000000, objects);
+
+        std::cout << "Culling " << objects << " objects (" << count << " rounds):" << std::endl;
+        for (Isa isa : { Isa::Scalar, Isa::Avx2 }) {
+            if (!math::supported(isa) || (isa == Isa::Avx2 && cull::avx2Kernels() == nullptr)) {
+                std::cout << "  " << math::name(isa) << ": not supported" << std::endl;
+                continue;
+            }
+            math::setIsa(isa);
+
+            for (cull::Culler *culler : { &serial, &parallel }) {
+                std::cout << "  " << math::name(isa) << ", " << culler->threads() << " threads:";
+
+                for (Test& test : tests) {
+                    size_t found = 0;
+                    Seconds round = repeat(count, [&]() { found = test.run(*culler, visible.data()); });
+
+                    if (test.expected.empty())
+                        test.expected.assign(visible.begin(), visible.begin() + found);
+                    bool matches = std::equal(test.expected.begin(), test.expected.end(), visible.begin(), visible.begin() + found);
+
+                    std::cout << " " << test.name << " " << duration(round / objects) << " ("
+                              << found << " visible" << (matches ? "" : ", differs from scalar") << "),";
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        math::setIsa(best);
+    }
+}
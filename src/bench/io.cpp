@@ -0,0 +1,143 @@
+#include "../bench.hpp"
+#include "../io.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wfn_eng::bench {
+    ////
+    // void io(size_t)
+    //
+    // Writes the provided number of assets in the temporary directory (most
+    // of them 1 to 64KiB, every fifth 64KiB to 1MiB), then reports how long
+    // loading all of them takes: one blocking ifstream at a time, as shaders
+    // used to be read; with pread; with io_uring; and with io_uring and
+    // O_DIRECT. Each is timed cold, right after the files are dropped from
+    // the page cache, and warm, right after reading them through it.
+    void io(size_t assets) {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "wfn_eng_io_bench";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> smallSizes(1024, 64 * 1024);
+        std::uniform_int_distribution<size_t> largeSizes(64 * 1024, 1024 * 1024);
+
+        std::vector<std::string> paths(assets);
+        std::vector<std::vector<uint8_t>> data(assets);
+        uint64_t total = 0;
+        uint64_t writtenSum = 0;
+
+        for (size_t i = 0; i < assets; i++) {
+            data[i] = bytes(rng, i % 5 == 4 ? largeSizes(rng) : smallSizes(rng));
+            for (uint8_t byte : data[i])
+                writtenSum += byte;
+            total += data[i].size();
+
+            paths[i] = (directory / ("asset_" + std::to_string(i) + ".bin")).string();
+            FILE *file = std::fopen(paths[i].c_str(), "wb");
+            if (file == nullptr)
+                throw std::runtime_error("Failed to write " + paths[i]);
+            std::fwrite(data[i].data(), 1, data[i].size(), file);
+
+            // Only clean pages can be dropped from the cache.
+            std::fflush(file);
+            fdatasync(fileno(file));
+            std::fclose(file);
+        }
+
+        auto evict = [&]() {
+            for (const std::string& path : paths) {
+                int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+        };
+
+        auto loadStream = [&]() -> uint64_t {
+            for (size_t i = 0; i < assets; i++) {
+                std::ifstream in(paths[i], std::ios::binary);
+                in.read(reinterpret_cast<char *>(data[i].data()), data[i].size());
+            }
+            return assets;
+        };
+
+        // A batch of files open at a time, to stay under the descriptor
+        // limit.
+        auto loadReader = [&](io::Backend backend, bool direct) -> uint64_t {
+            const size_t batch = 512;
+            io::Reader reader(256, backend);
+            std::vector<io::File> files;
+            std::vector<io::Read> reads;
+
+            for (size_t first = 0; first < assets; first += batch) {
+                size_t count = std::min(batch, assets - first);
+                files.clear();
+                files.reserve(count);
+                reads.assign(count, io::Read());
+
+                for (size_t i = 0; i < count; i++) {
+                    files.emplace_back(paths[first + i], direct);
+                    reads[i].file = &files[i];
+                    reads[i].size = data[first + i].size();
+                    reads[i].data = data[first + i].data();
+                }
+
+                reader.read(reads.data(), reads.size());
+                for (const io::Read& read : reads) {
+                    if (read.result != static_cast<int64_t>(read.size))
+                        throw std::runtime_error("Failed to read an asset");
+                }
+            }
+            return reader.stats().batches;
+        };
+
+        struct Method {
+            const char *name;
+            std::function<uint64_t ()> load;
+        };
+
+        Method methods[] = {
+            { "ifstream", loadStream },
+            { "pread", [&]() { return loadReader(io::Backend::Pread, false); } },
+            { "io_uring", [&]() { return loadReader(io::Backend::Uring, false); } },
+            { "io_uring O_DIRECT", [&]() { return loadReader(io::Backend::Uring, true); } }
+        };
+
+        const double mebibytes = total / (1024.0 * 1024.0);
+        std::cout << "Loading " << assets << " assets, " << total / (1024 * 1024) << "MiB:" << std::endl;
+        for (const Method& method : methods) {
+            for (std::vector<uint8_t>& asset : data)
+                std::fill(asset.begin(), asset.end(), 0);
+
+            evict();
+            uint64_t calls = 0;
+            Seconds cold = time([&]() { calls = method.load(); });
+
+            uint64_t readSum = 0;
+            for (const std::vector<uint8_t>& asset : data) {
+                for (uint8_t byte : asset)
+                    readSum += byte;
+            }
+            if (readSum != writtenSum)
+                throw std::runtime_error(std::string("Assets read with ") + method.name + " differ");
+
+            loadStream();
+            Seconds warm = time([&]() { method.load(); });
+
+            std::cout << "  " << method.name << ": cold " << duration(cold) << " (" << mebibytes / cold.count()
+                      << "MiB/s), warm " << duration(warm) << " (" << mebibytes / warm.count() << "MiB/s), "
+                      << calls << " read calls" << std::endl;
+        }
+
+        std::filesystem::remove_all(directory);
+    }
+}
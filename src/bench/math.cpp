@@ -0,0 +1,90 @@
+#include "../bench.hpp"
+#include "../math.hpp"
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+namespace wfn_eng::bench {
+    ////
+    // void math(size_t)
+    //
+    // Runs the batch transform kernels of every instruction set the CPU
+    // supports on the provided number of random entities: building their
+    // model matrices, composing them with their parents' and bounding their
+    // boxes, then reports transforms per second for each, along with the
+    // largest difference from glm.
+    void math(size_t entities) {
+        using math::Isa;
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> values(-4.0f, 4.0f);
+
+        math::Columns trsColumns(10, entities), parentColumns(12, entities);
+        math::Columns modelColumns(12, entities), worldColumns(12, entities);
+        math::Columns localBoxes(6, entities), worldBoxes(6, entities);
+
+        math::Trs3 trs = trsColumns.trs3();
+        math::Aabb3 local = localBoxes.aabb3();
+        for (size_t i = 0; i < entities; i++) {
+            float rotation[4], length = 0.0f;
+            for (float& r : rotation) {
+                r = values(rng);
+                length += r * r;
+            }
+            for (int k = 0; k < 4; k++)
+                trs.r[k][i] = rotation[k] / std::sqrt(length);
+
+            for (int k = 0; k < 3; k++) {
+                trs.t[k][i] = values(rng);
+                trs.s[k][i] = 1.0f + values(rng) * 0.125f;
+                local.min[k][i] = -1.0f - values(rng) * 0.125f;
+                local.max[k][i] = 1.0f + values(rng) * 0.125f;
+            }
+        }
+        for (size_t k = 0; k < parentColumns.columns(); k++)
+            fill(rng, parentColumns.column(k), parentColumns.column(k) + entities, values);
+
+        math::Affine3 parent = parentColumns.affine3();
+        math::Affine3 model = modelColumns.affine3();
+        math::Affine3 world = worldColumns.affine3();
+        math::Aabb3 bounds = worldBoxes.aabb3();
+
+        struct Kernel {
+            const char *name;
+            std::function<void ()> run;
+        };
+
+        Kernel kernels[] = {
+            { "model", [&]() { math::model(trs, model, entities); } },
+            { "compose", [&]() { math::compose(parent, model, world, entities); } },
+            { "bounds", [&]() { math::bounds(world, local, bounds, entities); } }
+        };
+
+        const Isa best = math::isa();
+        const size_t count = rounds(20000000, entities);
+
+        std::cout << "Transforming " << entities << " entities (" << count << " rounds):" << std::endl;
+        for (Isa isa : { Isa::Scalar, Isa::Sse2, Isa::Avx2 }) {
+            if (!math::supported(isa)) {
+                std::cout << "  " << math::name(isa) << ": not supported" << std::endl;
+                continue;
+            }
+
+            math::setIsa(isa);
+            std::cout << "  " << math::name(isa) << ":";
+
+            Seconds total(0);
+            for (const Kernel& kernel : kernels) {
+                Seconds round = repeat(count, kernel.run);
+                total += round;
+                std::cout << " " << kernel.name << " " << entities / round.count() / 1e6 << "M/s,";
+            }
+
+            std::cout << " all three " << entities / total.count() / 1e6 << "M entities/s, "
+                      << math::check(isa, 4099) << " from glm" << std::endl;
+        }
+
+        math::setIsa(best);
+    }
+}
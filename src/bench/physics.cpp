@@ -0,0 +1,199 @@
+#include "../bench.hpp"
+#include "../physics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+namespace wfn_eng::bench {
+    ////
+    // void physics(size_t)
+    //
+    // Runs the broadphase on 100, 1000 and 10000 random boxes (four per
+    // owner, over a world sized for a few overlaps each), the provided
+    // number of times each, and reports the average and best run along with
+    // the broadphase counters. Every run's pairs are checked against brute
+    // force.
+    void physics(size_t runs) {
+        using physics::Fixed;
+
+        for (size_t count : { size_t(100), size_t(1000), size_t(10000) }) {
+            const int32_t side = static_cast<int32_t>(std::sqrt((double)count) * 48.0);
+
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<int32_t> positions(0, side), sizes(8, 64);
+            std::uniform_int_distribution<uint32_t> layers(0, 3), masks(1, 15);
+
+            physics::BoxSet boxes;
+            boxes.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                int32_t x = positions(rng), y = positions(rng);
+                physics::Box box = {
+                    Fixed::fromInt(x), Fixed::fromInt(y),
+                    Fixed::fromInt(x + sizes(rng)), Fixed::fromInt(y + sizes(rng))
+                };
+                boxes.add(box, static_cast<uint16_t>(i / 4), static_cast<uint8_t>(1u << layers(rng)), static_cast<uint8_t>(masks(rng)));
+            }
+
+            std::vector<physics::Pair> expected;
+            for (uint32_t a = 0; a < count; a++) {
+                for (uint32_t b = a + 1; b < count; b++) {
+                    bool overlaps =
+                        boxes.minX()[a] <= boxes.maxX()[b] && boxes.minX()[b] <= boxes.maxX()[a] &&
+                        boxes.minY()[a] <= boxes.maxY()[b] && boxes.minY()[b] <= boxes.maxY()[a];
+                    bool wanted = (boxes.mask()[a] & boxes.layer()[b]) || (boxes.mask()[b] & boxes.layer()[a]);
+                    if (overlaps && wanted && boxes.owner()[a] != boxes.owner()[b])
+                        expected.push_back(physics::Pair { a, b });
+                }
+            }
+
+            auto byIndex = [](const physics::Pair& l, const physics::Pair& r) {
+                return l.a != r.a ? l.a < r.a : l.b < r.b;
+            };
+
+            physics::Broadphase broadphase;
+            std::vector<physics::Pair> pairs;
+            uint64_t total = 0, best = std::numeric_limits<uint64_t>::max();
+            bool matches = true;
+            for (size_t run = 0; run < runs; run++) {
+                pairs.clear();
+                broadphase.run(boxes, pairs);
+                total += broadphase.stats().nanos;
+                best = std::min(best, broadphase.stats().nanos);
+
+                std::sort(pairs.begin(), pairs.end(), byIndex);
+                matches &= pairs.size() == expected.size() && std::equal(
+                    pairs.begin(), pairs.end(), expected.begin(),
+                    [](const physics::Pair& l, const physics::Pair& r) { return l.a == r.a && l.b == r.b; }
+                );
+            }
+
+            broadphase.report(std::cout);
+            std::cout << "  " << runs << " runs: avg " << duration(Seconds(total / 1e9 / runs))
+                      << ", best " << duration(Seconds(best / 1e9))
+                      << (matches ? "" : ", differs from brute force") << std::endl;
+        }
+    }
+
+    ////
+    // void hash(size_t)
+    //
+    // Scatters the provided number of entities over a square world (about
+    // one per 16x16 units), then reports how long rebuilding a spatial hash
+    // of 64 unit cells takes, and how long 1024 radius queries (of 64 units)
+    // and 1024 rect queries (of 320x180) take one at a time, as batches
+    // across the workers and by brute force. Every result is checked
+    // against brute force.
+    void hash(size_t entities) {
+        using physics::Fixed;
+
+        const size_t queries = 1024;
+        const int32_t side = static_cast<int32_t>(std::sqrt((double)entities) * 16.0) + 1;
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int32_t> positions(0, side * 65536);
+
+        std::vector<int32_t> x(entities), y(entities);
+        fill(rng, x.begin(), x.end(), positions);
+        fill(rng, y.begin(), y.end(), positions);
+
+        std::vector<physics::Circle> circles(queries);
+        std::vector<physics::Box> rects(queries);
+        for (size_t q = 0; q < queries; q++) {
+            Fixed cx = Fixed::fromRaw(positions(rng)), cy = Fixed::fromRaw(positions(rng));
+            circles[q] = physics::Circle { cx, cy, Fixed::fromInt(64) };
+            rects[q] = physics::Box { cx, cy, cx + Fixed::fromInt(320), cy + Fixed::fromInt(180) };
+        }
+
+        physics::SpatialHash grid(Fixed::fromInt(64));
+        const size_t count = rounds(2000000, entities);
+
+        Seconds rebuild = repeat(count, [&]() { grid.rebuild(x.data(), y.data(), entities); });
+
+        std::cout << "Spatial hash of " << entities << " entities (" << grid.stats().buckets << " buckets): rebuilt in "
+                  << duration(rebuild) << " (" << duration(rebuild / entities) << " per entity)" << std::endl;
+
+        // Brute force: every entity against every query, as the reference.
+        physics::QueryResults expectedCircles, expectedRects;
+        std::vector<uint32_t> hits(entities);
+        Seconds bruteCircles = time([&]() {
+            expectedCircles.offsets.assign(1, 0);
+            for (const physics::Circle& circle : circles) {
+                int64_t radius = circle.radius.raw;
+                for (size_t i = 0; i < entities; i++) {
+                    int64_t dx = x[i] - (int64_t)circle.x.raw, dy = y[i] - (int64_t)circle.y.raw;
+                    if (dx * dx + dy * dy <= radius * radius)
+                        expectedCircles.indices.push_back(static_cast<uint32_t>(i));
+                }
+                expectedCircles.offsets.push_back(static_cast<uint32_t>(expectedCircles.indices.size()));
+            }
+        });
+        Seconds bruteRects = time([&]() {
+            expectedRects.offsets.assign(1, 0);
+            for (const physics::Box& rect : rects) {
+                size_t found = physics::overlap(x.data(), y.data(), x.data(), y.data(), entities, rect, hits.data());
+                expectedRects.indices.insert(expectedRects.indices.end(), hits.begin(), hits.begin() + found);
+                expectedRects.offsets.push_back(static_cast<uint32_t>(expectedRects.indices.size()));
+            }
+        });
+
+        // The same indices as brute force, whatever the order.
+        auto matches = [&](const physics::QueryResults& results, const physics::QueryResults& expected) {
+            for (size_t q = 0; q < queries; q++) {
+                std::vector<uint32_t> found(results.found(q), results.found(q) + results.count(q));
+                std::sort(found.begin(), found.end());
+                if (!std::equal(found.begin(), found.end(), expected.found(q), expected.found(q) + expected.count(q)))
+                    return false;
+            }
+            return true;
+        };
+
+        struct Method {
+            const char *name;
+            std::function<void (size_t, std::vector<uint32_t>&)> one;
+            std::function<void (physics::QueryResults&)> batch;
+            Seconds brute;
+            const physics::QueryResults *expected;
+        };
+
+        Method methods[] = {
+            {
+                "radius",
+                [&](size_t q, std::vector<uint32_t>& found) { grid.radius(circles[q], found); },
+                [&](physics::QueryResults& results) { grid.radius(circles.data(), queries, results); },
+                bruteCircles,
+                &expectedCircles
+            },
+            {
+                "rect",
+                [&](size_t q, std::vector<uint32_t>& found) { grid.rect(rects[q], found); },
+                [&](physics::QueryResults& results) { grid.rects(rects.data(), queries, results); },
+                bruteRects,
+                &expectedRects
+            }
+        };
+
+        physics::QueryResults results;
+        for (const Method& method : methods) {
+            Seconds one = time([&]() {
+                results.offsets.assign(1, 0);
+                results.indices.clear();
+                for (size_t q = 0; q < queries; q++) {
+                    method.one(q, results.indices);
+                    results.offsets.push_back(static_cast<uint32_t>(results.indices.size()));
+                }
+            });
+            bool oneMatches = matches(results, *method.expected);
+
+            Seconds batched = repeat(count, [&]() { method.batch(results); });
+            bool batchMatches = matches(results, *method.expected);
+
+            std::cout << "  " << queries << " " << method.name << " queries (" << results.indices.size() << " found): one at a time "
+                      << duration(one) << ", batched on " << grid.threads() << " threads " << duration(batched)
+                      << ", brute force " << duration(method.brute)
+                      << (oneMatches && batchMatches ? "" : ", differs from brute force") << std::endl;
+        }
+    }
+}
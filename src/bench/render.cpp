@@ -0,0 +1,62 @@
+#include "../bench.hpp"
+#include "../render.hpp"
+
+#include <iostream>
+
+namespace wfn_eng::bench {
+    ////
+    // void sort(size_t)
+    //
+    // Fills a render queue with the provided number of random draws (made-up
+    // handles, spread over 64 pipelines, 1024 materials and 256 meshes, a
+    // quarter of them translucent), then reports the cost of sorting them
+    // on one thread and on every worker, and the binds the sort saves.
+    void sort(size_t draws) {
+        const int iterations = 100;
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<uint32_t> pipelines(1, 64);
+        std::uniform_int_distribution<uint32_t> materials(1, 1024);
+        std::uniform_int_distribution<uint32_t> meshes(1, 256);
+        std::uniform_real_distribution<float> depths(0.1f, 100.0f);
+
+        std::vector<std::pair<uint64_t, render::Draw>> batch(draws);
+        for (auto& entry : batch) {
+            uint32_t pipeline = pipelines(rng);
+            uint32_t material = materials(rng);
+            uint32_t mesh = meshes(rng);
+            uint32_t depth = render::key::depth(depths(rng), 0.1f, 100.0f);
+
+            render::Draw& draw = entry.second;
+            draw.pipeline = (VkPipeline)(uintptr_t)pipeline;
+            draw.layout = (VkPipelineLayout)(uintptr_t)1;
+            draw.material = (VkDescriptorSet)(uintptr_t)material;
+            draw.vertexBuffer = (VkBuffer)(uintptr_t)mesh;
+            draw.indexBuffer = (VkBuffer)(uintptr_t)mesh;
+            draw.indexCount = 36;
+
+            entry.first = rng() % 4 == 0
+                ? render::key::translucent(0, pipeline, material, depth)
+                : render::key::opaque(0, pipeline, material, depth);
+        }
+
+        for (size_t threads : { (size_t)1, (size_t)0 }) {
+            render::RenderQueue queue(threads);
+            uint64_t sortNanos = 0;
+            for (int i = 0; i < iterations; i++) {
+                queue.clear();
+                for (auto& entry : batch)
+                    queue.push(entry.first, entry.second);
+
+                queue.sort();
+                sortNanos += queue.stats().sortNanos;
+            }
+
+            render::QueueStats stats = queue.measure();
+            std::cout << "Sorted " << draws << " draws in " << duration(Seconds(sortNanos / 1e9 / iterations))
+                      << " on " << (threads == 1 ? std::string("1 thread") : "all threads")
+                      << ": " << stats.binds() << " binds, " << stats.bindsSaved()
+                      << " saved of " << stats.naiveBinds << std::endl;
+        }
+    }
+}
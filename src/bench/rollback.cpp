@@ -0,0 +1,106 @@
+#include "../bench.hpp"
+#include "../rollback.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+namespace wfn_eng::bench {
+    ////
+    // void rollback(size_t)
+    //
+    // Runs two rollback sessions against each other over loopback peers (2
+    // ticks of delay plus up to 4 of jitter) for the provided number of
+    // ticks, on states of 4KiB up to 4MiB. Each step changes a few hundred
+    // words of the state, and inputs change every few frames so that
+    // predictions miss. Every frame both sides have confirmed is checked to
+    // hash the same on both. Reports the rollbacks and the snapshot timings
+    // of each size.
+    void rollback(size_t ticks) {
+        const size_t depth = 12;
+        const size_t sizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+
+        // Changes every 4 to 11 frames, the same on both sides.
+        auto input = [](size_t player, uint32_t frame) {
+            uint64_t x = (player + 1) * 0x9E3779B97F4A7C15ULL ^ (frame / (4 + player * 7)) * 0xBF58476D1CE4E5B9ULL;
+            x ^= x >> 31;
+            return static_cast<rollback::Input>(x * 0x94D049BB133111EBULL >> 48);
+        };
+
+        for (size_t bytes : sizes) {
+            rollback::StateArena arenas[2] = {
+                rollback::StateArena(bytes),
+                rollback::StateArena(bytes)
+            };
+
+            std::unique_ptr<rollback::Session> sessions[2];
+            for (size_t side = 0; side < 2; side++) {
+                uint64_t *words = arenas[side].allocate<uint64_t>(bytes / sizeof(uint64_t));
+                size_t count = bytes / sizeof(uint64_t);
+
+                sessions[side] = std::make_unique<rollback::Session>(
+                    arenas[side], depth, 2, side,
+                    [words, count](const rollback::Input *inputs) {
+                        uint64_t mix = words[0];
+                        for (size_t p = 0; p < 2; p++)
+                            mix = (mix ^ inputs[p]) * 0x9E3779B97F4A7C15ULL + 1;
+                        words[0] = mix;
+
+                        for (uint64_t k = 0; k < 256; k++)
+                            words[1 + ((mix >> 16) + k * 0x9E37) % (count - 1)] += mix + k;
+                    }
+                );
+            }
+
+            // peers[side] carries the other side's inputs to it.
+            rollback::LoopbackPeer peers[2] = {
+                rollback::LoopbackPeer(2, 4),
+                rollback::LoopbackPeer(2, 4)
+            };
+
+            int64_t verified = -1;
+            uint64_t checked = 0, mismatches = 0;
+            for (size_t tick = 0; tick < ticks; tick++) {
+                bool advanced = true;
+                for (size_t side = 0; side < 2; side++) {
+                    rollback::Session& session = *sessions[side];
+                    if (!session.canAdvance()) {
+                        advanced = false;
+                        continue;
+                    }
+
+                    uint32_t frame = session.frame();
+                    session.addLocalInput(input(side, frame));
+                    peers[1 - side].send(side, frame, input(side, frame));
+                    session.advance();
+                }
+
+                // Deliveries schedule rollbacks that the next advance runs,
+                // so the snapshots are only final once both sides advanced.
+                if (advanced) {
+                    int64_t confirmed = std::min(sessions[0]->confirmedFrame(), sessions[1]->confirmedFrame());
+                    for (int64_t frame = verified + 1; frame <= confirmed; frame++) {
+                        uint32_t f = static_cast<uint32_t>(frame);
+                        if (!sessions[0]->snapshots().holds(f) || !sessions[1]->snapshots().holds(f))
+                            continue;
+
+                        checked++;
+                        if (!sessions[0]->verify(f, sessions[1]->checksum(f)))
+                            mismatches++;
+                    }
+                    verified = std::max(verified, confirmed);
+                }
+
+                for (size_t side = 0; side < 2; side++)
+                    peers[side].tick(*sessions[side]);
+            }
+
+            const rollback::SessionStats& stats = sessions[0]->stats();
+            std::cout << "Rollback: " << bytes / 1024 << "KiB of state, " << sessions[0]->frame() << " frames, "
+                      << stats.rollbacks << " rollbacks (" << stats.resimulatedFrames << " frames resimulated, at most "
+                      << stats.maxRollback << "), " << checked << " frames checked, " << mismatches << " desyncs" << std::endl;
+            std::cout << "  ";
+            sessions[0]->snapshots().report(std::cout);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include "../bench.hpp"
+#include "../atlas.hpp"
+#include "../tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace wfn_eng::bench {
+    ////
+    // void tilemap(size_t)
+    //
+    // Fills a square map of about the provided number of 16 unit tiles
+    // (from 64 tile frames, a tenth of the cells empty) in 32x32 chunks,
+    // bakes every chunk, then scrolls a 1280x720 camera across it for 1000
+    // frames, editing 16 random tiles every tenth frame. Reports what a
+    // frame costs the CPU with chunks (finding the visible ones and
+    // rebaking the dirty ones) against building the quads of every tile in
+    // view each frame.
+    void tilemap(size_t tiles) {
+        const uint32_t side = std::max<uint32_t>(1, static_cast<uint32_t>(std::sqrt((double)tiles)));
+        const float tileSize = 16.0f;
+        const size_t frames = 1000;
+
+        atlas::AtlasWriter writer;
+        for (uint32_t i = 0; i < 64; i++)
+            writer.add("tiles/tile_" + std::to_string(i), "tiles", 16, 16, std::vector<uint8_t>(16 * 16 * 4, 255));
+        writer.pack();
+
+        atlas::Atlas frameTable(writer.table().data(), writer.table().size());
+        std::vector<atlas::FrameId> tileset;
+        for (atlas::FrameId id = 0; id < frameTable.count(); id++)
+            tileset.push_back(id);
+
+        tilemap::Tilemap map(frameTable, tileset, side, side, tileSize);
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<uint32_t> picks(0, 639);
+        std::vector<tilemap::TileId> cells((size_t)side * side);
+        for (tilemap::TileId& cell : cells) {
+            uint32_t pick = picks(rng);
+            cell = pick < 64 ? tilemap::noTile : static_cast<tilemap::TileId>(pick % 64 + 1);
+        }
+        map.fill(cells.data());
+
+        // What ChunkBuffers::upload does, but for the copies.
+        std::vector<atlas::SpriteVertex> vertices;
+        std::vector<uint32_t> pageQuads;
+        std::vector<uint32_t> chunkQuads(map.chunks(), 0);
+        auto bakeDirty = [&]() {
+            size_t baked = map.dirty().size();
+            for (uint32_t chunk : map.dirty())
+                chunkQuads[chunk] = map.bake(chunk, vertices, pageQuads);
+            map.clean(baked);
+            return baked;
+        };
+
+        size_t chunks = 0;
+        Seconds firstBake = time([&]() { chunks = bakeDirty(); });
+
+        std::cout << "Tilemap: " << side << "x" << side << " tiles in " << chunks << " chunks, baked in "
+                  << duration(firstBake) << " (" << (uint64_t)map.chunks() * 32 * 32 * 64 / (1024 * 1024)
+                  << "MiB of slots)" << std::endl;
+
+        const float worldSize = side * tileSize;
+        auto camera = [&](size_t frame) {
+            float x = std::fmod(frame * 7.0f, std::max(worldSize - 1280.0f, 1.0f));
+            float y = std::fmod(frame * 3.0f, std::max(worldSize - 720.0f, 1.0f));
+            return cull::Rect { x, y, x + 1280.0f, y + 720.0f };
+        };
+
+        std::uniform_int_distribution<uint32_t> cellsAt(0, side - 1);
+        std::vector<uint32_t> visible;
+        size_t visibleChunks = 0, rebaked = 0;
+        Seconds chunked(0), edits(0);
+        for (size_t frame = 0; frame < frames; frame++) {
+            if (frame % 10 == 0) {
+                edits += time([&]() {
+                    for (int i = 0; i < 16; i++)
+                        map.set(cellsAt(rng), cellsAt(rng), static_cast<tilemap::TileId>(picks(rng) % 64 + 1));
+                    rebaked += bakeDirty();
+                });
+            }
+
+            chunked += time([&]() {
+                map.visible(camera(frame), visible);
+                for (uint32_t chunk : visible) {
+                    if (chunkQuads[chunk] > 0)
+                        visibleChunks++;
+                }
+            });
+        }
+
+        atlas::SpriteBatch batch(frameTable);
+        size_t quads = 0;
+        Seconds perTile = time([&]() {
+            for (size_t frame = 0; frame < frames; frame++) {
+                cull::Rect view = camera(frame);
+                uint32_t x0 = static_cast<uint32_t>(view.minX / tileSize), y0 = static_cast<uint32_t>(view.minY / tileSize);
+                uint32_t x1 = std::min(side - 1, static_cast<uint32_t>(view.maxX / tileSize));
+                uint32_t y1 = std::min(side - 1, static_cast<uint32_t>(view.maxY / tileSize));
+
+                batch.clear();
+                for (uint32_t y = y0; y <= y1; y++) {
+                    for (uint32_t x = x0; x <= x1; x++) {
+                        tilemap::TileId tile = map.get(x, y);
+                        if (tile != tilemap::noTile)
+                            batch.add(tileset[tile - 1], x * tileSize, y * tileSize);
+                    }
+                }
+                quads += batch.vertices(0).size() / 6;
+            }
+        });
+
+        std::cout << "  per frame: chunked " << duration(chunked / frames) << " (" << visibleChunks / frames
+                  << " chunks), per tile " << duration(perTile / frames) << " (" << quads / frames << " quads)"
+                  << std::endl;
+        std::cout << "  edits: " << frames / 10 * 16 << " tiles rebaked " << rebaked << " chunks in "
+                  << duration(edits / (frames / 10)) << " per edited frame" << std::endl;
+    }
+}
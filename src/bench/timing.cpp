@@ -0,0 +1,47 @@
+#include "../bench.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace wfn_eng::bench {
+    ////
+    // size_t rounds(size_t, size_t)
+    //
+    // How many runs over the provided number of items add up to about the
+    // provided budget of items, at least one.
+    size_t rounds(size_t budget, size_t items) {
+        return std::max<size_t>(1, budget / std::max<size_t>(items, 1));
+    }
+
+    ////
+    // std::vector<uint8_t> bytes(std::mt19937&, size_t)
+    //
+    // The provided number of random bytes.
+    std::vector<uint8_t> bytes(std::mt19937& rng, size_t size) {
+        std::vector<uint8_t> data(size);
+        for (uint8_t& byte : data)
+            byte = static_cast<uint8_t>(rng());
+        return data;
+    }
+
+    ////
+    // std::string duration(Seconds)
+    //
+    // A time in the unit that suits it, from nanoseconds to seconds, with
+    // three significant digits: "412ns", "1.38ms".
+    std::string duration(Seconds elapsed) {
+        static const char *units[] = { "ns", "us", "ms", "s" };
+
+        double value = elapsed.count() * 1e9;
+        size_t unit = 0;
+        while (unit + 1 < 4 && value >= 1000.0) {
+            value /= 1000.0;
+            unit++;
+        }
+
+        std::ostringstream out;
+        out << std::setprecision(3) << value << units[unit];
+        return out.str();
+    }
+}
@@ -0,0 +1,87 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "bench.hpp"
+#include "error.hpp"
+
+////
+// struct Bench
+//
+// A bench, by the name it's run with and what its count is.
+struct Bench {
+    const char *name;
+    const char *count;
+    void (*run)(size_t);
+};
+
+static const Bench benches[] = {
+    { "sort", "draws", wfn_eng::bench::sort },
+    { "pack", "assets", wfn_eng::bench::pack },
+    { "io", "assets", wfn_eng::bench::io },
+    { "atlas", "frames", wfn_eng::bench::atlas },
+    { "math", "entities", wfn_eng::bench::math },
+    { "cull", "objects", wfn_eng::bench::cull },
+    { "physics", "runs", wfn_eng::bench::physics },
+    { "hash", "entities", wfn_eng::bench::hash },
+    { "tilemap", "tiles", wfn_eng::bench::tilemap },
+    { "rollback", "ticks", wfn_eng::bench::rollback }
+};
+
+////
+// void usage(const char *)
+//
+// Prints how to run the tool and every bench it has.
+static void usage(const char *program) {
+    std::cerr << "Usage: " << program << " <bench> <count>" << std::endl;
+    for (const Bench& bench : benches)
+        std::cerr << "  " << bench.name << " <" << bench.count << ">" << std::endl;
+}
+
+////
+// wfn_bench
+//
+// Runs one of the engine's benches on random data, on the CPU only:
+//
+//   wfn_bench <bench> <count>
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const Bench *bench = nullptr;
+    for (const Bench& candidate : benches) {
+        if (std::strcmp(candidate.name, argv[1]) == 0)
+            bench = &candidate;
+    }
+    if (bench == nullptr) {
+        std::cerr << "Unknown bench: " << argv[1] << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long count = std::strtoull(argv[2], &end, 10);
+    if (argv[2][0] < '0' || argv[2][0] > '9' || *end != '\0' || errno != 0 || count == 0) {
+        std::cerr << "Expected a positive number of " << bench->count << ", got: " << argv[2] << std::endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        bench->run(static_cast<size_t>(count));
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (const wfn_eng::WfnError& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+#ifndef __WFN_ENG_CULL_HPP__
+#define __WFN_ENG_CULL_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "error.hpp"
+#include "math.hpp"
+
+namespace wfn_eng::cull {
+    ////
+    // struct Plane
+    //
+    // A plane as its normal and distance: a point p is on the inside when
+    // x * p.x + y * p.y + z * p.z + d >= 0. The normal has unit length.
+    struct Plane {
+        float x, y, z, d;
+    };
+
+    ////
+    // struct Frustum
+    //
+    // The six planes of a view frustum (left, right, bottom, top, near,
+    // far), facing inwards.
+    struct Frustum {
+        Plane planes[6];
+    };
+
+    ////
+    // Frustum frustum(const float *)
+    //
+    // Extracts the planes of a view-projection matrix, given as the 16
+    // floats of a column-major glm::mat4 (glm::value_ptr). The near plane is
+    // z >= -w, so either depth range works (with Vulkan's 0 to 1, a little
+    // in front of the near plane is kept).
+    Frustum frustum(const float *);
+
+    ////
+    // struct Rect
+    //
+    // A 2D camera rectangle, in world units.
+    struct Rect {
+        float minX, minY, maxX, maxY;
+    };
+
+    ////
+    // struct Spheres
+    //
+    // Bounding spheres, as structure-of-arrays.
+    struct Spheres {
+        const float *x;
+        const float *y;
+        const float *z;
+        const float *radius;
+    };
+
+    ////
+    // struct Rects
+    //
+    // 2D bounding rectangles, as structure-of-arrays.
+    struct Rects {
+        const float *minX;
+        const float *minY;
+        const float *maxX;
+        const float *maxY;
+    };
+
+    ////
+    // struct Kernels
+    //
+    // The culling kernels of a single instruction set. Each one tests the
+    // objects in [begin, end) and writes the indices of the visible ones, in
+    // order, from the provided output pointer, returning how many it wrote.
+    // The output must have room for end - begin indices. Objects touching a
+    // plane or the rectangle's edge are visible.
+    struct Kernels {
+        size_t (*spheres)(const Frustum&, const Spheres&, size_t, size_t, uint32_t *);
+        size_t (*boxes)(const Frustum&, const math::Aabb3&, size_t, size_t, uint32_t *);
+        size_t (*rects)(const Rect&, const Rects&, size_t, size_t, uint32_t *);
+    };
+
+    ////
+    // const Kernels *scalarKernels() / avx2Kernels()
+    //
+    // The kernels of each instruction set, or nullptr when they aren't
+    // built in. The AVX2 ones test eight objects at a time.
+    const Kernels *scalarKernels();
+    const Kernels *avx2Kernels();
+
+    ////
+    // const Kernels& kernels()
+    //
+    // The kernels matching math::isa(): AVX2 when it's picked and built in,
+    // scalar otherwise (there are no SSE2 kernels).
+    const Kernels& kernels();
+
+    ////
+    // struct CullStats
+    //
+    // What the last cull cost.
+    struct CullStats {
+        uint64_t tested = 0;
+        uint64_t visible = 0;
+        uint64_t threads = 0;
+        uint64_t nanos = 0;
+    };
+
+    ////
+    // class Culler
+    //
+    // Culls objects on the CPU, into a compact list of the indices of the
+    // visible ones (e.g. for pushing their draws into a RenderQueue). Large
+    // culls are split across a set of worker threads (plus the calling
+    // one): each one culls its slice straight into its part of the output,
+    // then the parts are moved together.
+    //
+    // The workers are started once and sleep between culls; culling
+    // allocates nothing.
+    class Culler {
+        ////
+        // enum class Job
+        //
+        // What the workers run.
+        enum class Job {
+            Spheres,
+            Boxes,
+            Rects
+        };
+
+        std::vector<std::thread> _workers;
+        std::vector<size_t> _counts;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        uint64_t _generation;
+        size_t _finished;
+        bool _quitting;
+
+        Job _job;
+        const Kernels *_kernels;
+        Frustum _frustum;
+        Rect _rect;
+        Spheres _spheres;
+        math::Aabb3 _boxes;
+        Rects _rects;
+        size_t _count;
+        uint32_t *_visible;
+        size_t _threads;
+
+        CullStats _stats;
+
+        ////
+        // void workLoop(size_t)
+        //
+        // The body of a worker thread.
+        void workLoop(size_t);
+
+        ////
+        // void run(size_t)
+        //
+        // Culls one thread's slice.
+        void run(size_t);
+
+        ////
+        // size_t cull(Job, size_t, uint32_t *)
+        //
+        // Runs a job over every object, on as many threads as it's worth.
+        size_t cull(Job, size_t, uint32_t *);
+
+    public:
+        ////
+        // size_t parallelThreshold
+        //
+        // Below this many objects, culling stays on the calling thread.
+        static const size_t parallelThreshold = 16384;
+
+        ////
+        // Culler(size_t)
+        //
+        // Starts a culler using the provided number of threads, counting the
+        // calling one. 0 picks one per hardware thread, up to 8.
+        Culler(size_t = 0);
+
+        ////
+        // ~Culler()
+        //
+        // Stops the workers.
+        ~Culler();
+
+        ////
+        // size_t spheres(const Frustum&, const Spheres&, size_t, uint32_t *)
+        //
+        // Culls bounding spheres against a frustum, writing the indices of
+        // the visible ones (room for every object is needed). Returns how
+        // many are visible.
+        size_t spheres(const Frustum&, const Spheres&, size_t, uint32_t *);
+
+        ////
+        // size_t boxes(const Frustum&, const math::Aabb3&, size_t, uint32_t *)
+        //
+        // Culls world boxes (e.g. from math::bounds) against a frustum.
+        size_t boxes(const Frustum&, const math::Aabb3&, size_t, uint32_t *);
+
+        ////
+        // size_t rects(const Rect&, const Rects&, size_t, uint32_t *)
+        //
+        // Culls 2D rectangles against a camera rectangle.
+        size_t rects(const Rect&, const Rects&, size_t, uint32_t *);
+
+        ////
+        // size_t threads()
+        //
+        // The number of threads a large cull is split across.
+        size_t threads() const;
+
+        ////
+        // const CullStats& stats()
+        //
+        // The counters of the last cull.
+        const CullStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        Culler(const Culler&) = delete;
+        Culler& operator=(const Culler&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "../cull.hpp"
+
+// Built with -mavx2 -mfma, like src/math/avx2.cpp, and only called once the
+// CPU is known to run it.
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+////
+// struct Compaction
+//
+// For each mask of eight visible bits, the lanes that are set, in order,
+// one per nibble of a word, and how many there are.
+struct Compaction {
+    uint32_t lanes[256];
+    uint8_t counts[256];
+
+    constexpr Compaction() : lanes(), counts() {
+        for (uint32_t mask = 0; mask < 256; mask++) {
+            uint32_t count = 0;
+            for (uint32_t lane = 0; lane < 8; lane++) {
+                if (mask & (1u << lane))
+                    lanes[mask] |= lane << (4 * count++);
+            }
+            counts[mask] = static_cast<uint8_t>(count);
+        }
+    }
+};
+
+static constexpr Compaction compaction;
+
+////
+// size_t store(__m256, size_t, uint32_t *, size_t)
+//
+// Writes the indices of the visible lanes of eight objects, starting with
+// index first, after the written ones. Always stores eight indices, which
+// fits: there are at least as many objects left as lanes past the written
+// ones.
+static inline size_t store(__m256 visible, size_t first, uint32_t *out, size_t written) {
+    int mask = _mm256_movemask_ps(visible);
+    __m256i lanes = _mm256_srlv_epi32(
+        _mm256_set1_epi32(static_cast<int>(compaction.lanes[mask])),
+        _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28)
+    );
+    __m256i indices = _mm256_add_epi32(
+        _mm256_and_si256(lanes, _mm256_set1_epi32(7)),
+        _mm256_set1_epi32(static_cast<int>(first))
+    );
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + written), indices);
+    return written + compaction.counts[mask];
+}
+
+////
+// size_t spheres(const Frustum&, const Spheres&, size_t, size_t, uint32_t *)
+//
+// Eight spheres at a time against each plane.
+static size_t spheres(
+        const wfn_eng::cull::Frustum& frustum,
+        const wfn_eng::cull::Spheres& spheres,
+        size_t begin,
+        size_t end,
+        uint32_t *out) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    size_t written = 0;
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(spheres.x + i);
+        __m256 y = _mm256_loadu_ps(spheres.y + i);
+        __m256 z = _mm256_loadu_ps(spheres.z + i);
+        __m256 radius = _mm256_xor_ps(_mm256_loadu_ps(spheres.radius + i), sign);
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const wfn_eng::cull::Plane& plane : frustum.planes) {
+            __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.x), x, _mm256_set1_ps(plane.d));
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.y), y, distance);
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.z), z, distance);
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, radius, _CMP_GE_OQ));
+        }
+
+        written = store(visible, i, out, written);
+    }
+
+    return written + wfn_eng::cull::scalarKernels()->spheres(frustum, spheres, i, end, out + written);
+}
+
+////
+// size_t boxes(const Frustum&, const Aabb3&, size_t, size_t, uint32_t *)
+//
+// Eight boxes at a time against each plane. Which corner is furthest along
+// a plane's normal is the same for every box, so it's picked once per
+// plane.
+static size_t boxes(
+        const wfn_eng::cull::Frustum& frustum,
+        const wfn_eng::math::Aabb3& boxes,
+        size_t begin,
+        size_t end,
+        uint32_t *out) {
+    const float *corners[6][3];
+    for (int p = 0; p < 6; p++) {
+        const wfn_eng::cull::Plane& plane = frustum.planes[p];
+        corners[p][0] = plane.x >= 0.0f ? boxes.max[0] : boxes.min[0];
+        corners[p][1] = plane.y >= 0.0f ? boxes.max[1] : boxes.min[1];
+        corners[p][2] = plane.z >= 0.0f ? boxes.max[2] : boxes.min[2];
+    }
+
+    size_t written = 0;
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const wfn_eng::cull::Plane& plane = frustum.planes[p];
+            __m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(corners[p][0] + i), _mm256_set1_ps(plane.d));
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(corners[p][1] + i), distance);
+            distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(corners[p][2] + i), distance);
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        written = store(visible, i, out, written);
+    }
+
+    return written + wfn_eng::cull::scalarKernels()->boxes(frustum, boxes, i, end, out + written);
+}
+
+////
+// size_t rects(const Rect&, const Rects&, size_t, size_t, uint32_t *)
+//
+// Eight rectangles at a time against the camera's.
+static size_t rects(
+        const wfn_eng::cull::Rect& camera,
+        const wfn_eng::cull::Rects& rects,
+        size_t begin,
+        size_t end,
+        uint32_t *out) {
+    const __m256 minX = _mm256_set1_ps(camera.minX), minY = _mm256_set1_ps(camera.minY);
+    const __m256 maxX = _mm256_set1_ps(camera.maxX), maxY = _mm256_set1_ps(camera.maxY);
+
+    size_t written = 0;
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(rects.minX + i), maxX, _CMP_LE_OQ),
+            _mm256_cmp_ps(_mm256_loadu_ps(rects.maxX + i), minX, _CMP_GE_OQ)
+        );
+        __m256 y = _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(rects.minY + i), maxY, _CMP_LE_OQ),
+            _mm256_cmp_ps(_mm256_loadu_ps(rects.maxY + i), minY, _CMP_GE_OQ)
+        );
+
+        written = store(_mm256_and_ps(x, y), i, out, written);
+    }
+
+    return written + wfn_eng::cull::scalarKernels()->rects(camera, rects, i, end, out + written);
+}
+#endif
+
+namespace wfn_eng::cull {
+    ////
+    // const Kernels *avx2Kernels()
+    //
+    // The AVX2 kernels, built in when this file is compiled for AVX2 and
+    // FMA.
+    const Kernels *avx2Kernels() {
+#if defined(__AVX2__) && defined(__FMA__)
+        static const Kernels kernels = { ::spheres, ::boxes, ::rects };
+        return &kernels;
+#else
+        return nullptr;
+#endif
+    }
+}
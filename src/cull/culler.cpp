@@ -0,0 +1,222 @@
+#include "../cull.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+////
+// size_t sliceStart(size_t, size_t, size_t)
+//
+// Where a thread's slice of a cull starts. Slices start on a multiple of
+// eight objects, so only the last one has a scalar tail.
+static size_t sliceStart(size_t count, size_t thread, size_t threads) {
+    if (thread == threads)
+        return count;
+    return (count * thread / threads) & ~static_cast<size_t>(7);
+}
+
+namespace wfn_eng::cull {
+    ////
+    // const Kernels& kernels()
+    //
+    // The kernels matching math::isa().
+    const Kernels& kernels() {
+        if (math::isa() == math::Isa::Avx2 && avx2Kernels() != nullptr)
+            return *avx2Kernels();
+        return *scalarKernels();
+    }
+
+    ////
+    // class Culler
+    //
+    // Culls objects on the CPU, into a compact list of visible indices.
+
+    ////
+    // Culler(size_t)
+    //
+    // Starts a culler using the provided number of threads, counting the
+    // calling one. 0 picks one per hardware thread, up to 8.
+    Culler::Culler(size_t threads)
+            : _generation(0)
+            , _finished(0)
+            , _quitting(false)
+            , _job(Job::Spheres)
+            , _kernels(nullptr)
+            , _frustum()
+            , _rect()
+            , _spheres()
+            , _boxes()
+            , _rects()
+            , _count(0)
+            , _visible(nullptr)
+            , _threads(1) {
+        if (threads == 0)
+            threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), 8);
+
+        _counts.resize(threads);
+        for (size_t i = 1; i < threads; i++)
+            _workers.emplace_back(&Culler::workLoop, this, i);
+    }
+
+    ////
+    // ~Culler()
+    //
+    // Stops the workers.
+    Culler::~Culler() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quitting = true;
+        }
+        _wake.notify_all();
+
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    ////
+    // void workLoop(size_t)
+    //
+    // The body of a worker thread.
+    void Culler::workLoop(size_t thread) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _quitting || _generation != seen; });
+                if (_quitting)
+                    return;
+                seen = _generation;
+            }
+
+            run(thread);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (++_finished == _workers.size())
+                _done.notify_one();
+        }
+    }
+
+    ////
+    // void run(size_t)
+    //
+    // Culls one thread's slice into the same slice of the output.
+    void Culler::run(size_t thread) {
+        size_t begin = sliceStart(_count, thread, _threads);
+        size_t end = sliceStart(_count, thread + 1, _threads);
+        uint32_t *out = _visible + begin;
+
+        switch (_job) {
+        case Job::Spheres:
+            _counts[thread] = _kernels->spheres(_frustum, _spheres, begin, end, out);
+            break;
+        case Job::Boxes:
+            _counts[thread] = _kernels->boxes(_frustum, _boxes, begin, end, out);
+            break;
+        case Job::Rects:
+            _counts[thread] = _kernels->rects(_rect, _rects, begin, end, out);
+            break;
+        }
+    }
+
+    ////
+    // size_t cull(Job, size_t, uint32_t *)
+    //
+    // Runs a job over every object, then moves each thread's visible
+    // indices down after the previous thread's. Each slice only moves
+    // towards the front, so the moves never overwrite anything still needed.
+    size_t Culler::cull(Job job, size_t count, uint32_t *visible) {
+        auto start = std::chrono::steady_clock::now();
+
+        _job = job;
+        _kernels = &kernels();
+        _count = count;
+        _visible = visible;
+
+        if (count < parallelThreshold || _workers.empty()) {
+            _threads = 1;
+            run(0);
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _threads = _workers.size() + 1;
+                _finished = 0;
+                _generation++;
+            }
+            _wake.notify_all();
+
+            run(0);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [&] { return _finished == _workers.size(); });
+        }
+
+        size_t written = _counts[0];
+        for (size_t thread = 1; thread < _threads; thread++) {
+            size_t begin = sliceStart(count, thread, _threads);
+            if (written != begin)
+                std::memmove(visible + written, visible + begin, _counts[thread] * sizeof(uint32_t));
+            written += _counts[thread];
+        }
+
+        _stats.tested = count;
+        _stats.visible = written;
+        _stats.threads = _threads;
+        _stats.nanos = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+        );
+        return written;
+    }
+
+    ////
+    // size_t spheres(const Frustum&, const Spheres&, size_t, uint32_t *)
+    //
+    // Culls bounding spheres against a frustum.
+    size_t Culler::spheres(const Frustum& frustum, const Spheres& spheres, size_t count, uint32_t *visible) {
+        _frustum = frustum;
+        _spheres = spheres;
+        return cull(Job::Spheres, count, visible);
+    }
+
+    ////
+    // size_t boxes(const Frustum&, const math::Aabb3&, size_t, uint32_t *)
+    //
+    // Culls world boxes against a frustum.
+    size_t Culler::boxes(const Frustum& frustum, const math::Aabb3& boxes, size_t count, uint32_t *visible) {
+        _frustum = frustum;
+        _boxes = boxes;
+        return cull(Job::Boxes, count, visible);
+    }
+
+    ////
+    // size_t rects(const Rect&, const Rects&, size_t, uint32_t *)
+    //
+    // Culls 2D rectangles against a camera rectangle.
+    size_t Culler::rects(const Rect& camera, const Rects& rects, size_t count, uint32_t *visible) {
+        _rect = camera;
+        _rects = rects;
+        return cull(Job::Rects, count, visible);
+    }
+
+    ////
+    // size_t threads()
+    //
+    // The number of threads a large cull is split across.
+    size_t Culler::threads() const {
+        return _workers.size() + 1;
+    }
+
+    ////
+    // const CullStats& stats()
+    //
+    // The counters of the last cull.
+    const CullStats& Culler::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void Culler::report(std::ostream& out) const {
+        out << "Cull: " << _stats.visible << " of " << _stats.tested << " visible, on "
+            << _stats.threads << " threads, in " << _stats.nanos / 1000.0 << "us" << std::endl;
+    }
+}
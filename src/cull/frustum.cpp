@@ -0,0 +1,33 @@
+#include "../cull.hpp"
+
+#include <cmath>
+
+namespace wfn_eng::cull {
+    ////
+    // Frustum frustum(const float *)
+    //
+    // Extracts the planes of a column-major view-projection matrix (Gribb
+    // and Hartmann): each one is the last row plus or minus another (x, y,
+    // then z), normalized so distances come out in world units.
+    Frustum frustum(const float *matrix) {
+        auto row = [matrix](int r, int k) { return matrix[k * 4 + r]; };
+
+        Frustum result;
+        for (int i = 0; i < 6; i++) {
+            int axis = i / 2;
+            float sign = i % 2 == 0 ? 1.0f : -1.0f;
+
+            float plane[4];
+            for (int k = 0; k < 4; k++)
+                plane[k] = row(3, k) + sign * row(axis, k);
+
+            float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length == 0.0f)
+                throw WfnError("wfn_eng::cull", "frustum", "Normalize a plane");
+
+            result.planes[i] = Plane { plane[0] / length, plane[1] / length, plane[2] / length, plane[3] / length };
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,87 @@
+#include "../cull.hpp"
+
+////
+// size_t spheres(const Frustum&, const Spheres&, size_t, size_t, uint32_t *)
+//
+// A sphere is culled once its center is further than its radius outside
+// of any plane.
+static size_t spheres(
+        const wfn_eng::cull::Frustum& frustum,
+        const wfn_eng::cull::Spheres& spheres,
+        size_t begin,
+        size_t end,
+        uint32_t *out) {
+    size_t written = 0;
+    for (size_t i = begin; i < end; i++) {
+        bool visible = true;
+        for (const wfn_eng::cull::Plane& plane : frustum.planes) {
+            float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.d;
+            visible &= distance >= -spheres.radius[i];
+        }
+
+        out[written] = static_cast<uint32_t>(i);
+        written += visible;
+    }
+    return written;
+}
+
+////
+// size_t boxes(const Frustum&, const Aabb3&, size_t, size_t, uint32_t *)
+//
+// A box is culled once its corner furthest along a plane's normal is
+// outside of it.
+static size_t boxes(
+        const wfn_eng::cull::Frustum& frustum,
+        const wfn_eng::math::Aabb3& boxes,
+        size_t begin,
+        size_t end,
+        uint32_t *out) {
+    size_t written = 0;
+    for (size_t i = begin; i < end; i++) {
+        bool visible = true;
+        for (const wfn_eng::cull::Plane& plane : frustum.planes) {
+            float x = plane.x >= 0.0f ? boxes.max[0][i] : boxes.min[0][i];
+            float y = plane.y >= 0.0f ? boxes.max[1][i] : boxes.min[1][i];
+            float z = plane.z >= 0.0f ? boxes.max[2][i] : boxes.min[2][i];
+            visible &= plane.x * x + plane.y * y + plane.z * z + plane.d >= 0.0f;
+        }
+
+        out[written] = static_cast<uint32_t>(i);
+        written += visible;
+    }
+    return written;
+}
+
+////
+// size_t rects(const Rect&, const Rects&, size_t, size_t, uint32_t *)
+//
+// A rectangle is visible when it overlaps the camera's.
+static size_t rects(
+        const wfn_eng::cull::Rect& camera,
+        const wfn_eng::cull::Rects& rects,
+        size_t begin,
+        size_t end,
+        uint32_t *out) {
+    size_t written = 0;
+    for (size_t i = begin; i < end; i++) {
+        bool visible =
+            (rects.minX[i] <= camera.maxX) & (rects.maxX[i] >= camera.minX) &
+            (rects.minY[i] <= camera.maxY) & (rects.maxY[i] >= camera.minY);
+
+        out[written] = static_cast<uint32_t>(i);
+        written += visible;
+    }
+    return written;
+}
+
+namespace wfn_eng::cull {
+    ////
+    // const Kernels *scalarKernels()
+    //
+    // The scalar kernels, always built in. The index is always written and
+    // only kept when visible, so there's no branch to mispredict.
+    const Kernels *scalarKernels() {
+        static const Kernels kernels = { ::spheres, ::boxes, ::rects };
+        return &kernels;
+    }
+}
@@ -13,6 +13,7 @@ namespace wfn_eng {
         std::string _module;
         std::string _method;
         std::string _action;
+        std::string _what;
 
     public:
         ////
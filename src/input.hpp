@@ -0,0 +1,272 @@
+#ifndef __WFN_ENG_INPUT_HPP__
+#define __WFN_ENG_INPUT_HPP__
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SDL.h>
+
+#include "error.hpp"
+#include "rollback.hpp"
+
+namespace wfn_eng::input {
+    typedef rollback::Input Input;
+
+    ////
+    // enum Button
+    //
+    // The bits of an Input.
+    enum Button : Input {
+        Up         = 1 << 0,
+        Down       = 1 << 1,
+        Left       = 1 << 2,
+        Right      = 1 << 3,
+        LightPunch = 1 << 4,
+        HeavyPunch = 1 << 5,
+        LightKick  = 1 << 6,
+        HeavyKick  = 1 << 7,
+    };
+
+    ////
+    // size_t maxPlayers
+    //
+    // The maximum number of players in a recording (the per-tick change mask
+    // is a single byte).
+    const size_t maxPlayers = 8;
+
+    ////
+    // Input sample(const Uint8 *, size_t)
+    //
+    // Builds the Input of a player from an SDL keyboard state array (as
+    // returned by SDL_GetKeyboardState). Player 0 uses WASD + UIJK, player 1
+    // uses the arrow keys + the numpad.
+    Input sample(const Uint8 *, size_t);
+
+    ////
+    // class Encoder
+    //
+    // Encodes a stream of per-tick inputs. Every tick is XORed against the
+    // previous one; ticks where nothing changed are folded into a run length,
+    // so a record only gets written when some player's input changes:
+    //
+    //   varint  unchanged ticks before this one
+    //   uint8   mask of players whose input changed (0 ends the stream)
+    //   varint  XOR delta, once per set bit of the mask
+    class Encoder {
+        size_t _players;
+        std::vector<Input> _previous;
+        uint64_t _run;
+        uint64_t _ticks;
+
+        ////
+        // void putVarint(std::vector<uint8_t>&, uint64_t)
+        //
+        // Appends a LEB128 varint.
+        static void putVarint(std::vector<uint8_t>&, uint64_t);
+
+    public:
+        ////
+        // Encoder(size_t)
+        //
+        // Constructs an encoder for the provided number of players.
+        Encoder(size_t);
+
+        ////
+        // void encode(const Input *, std::vector<uint8_t>&)
+        //
+        // Encodes one tick of inputs (one per player), appending any bytes to
+        // the output buffer.
+        void encode(const Input *, std::vector<uint8_t>&);
+
+        ////
+        // void finish(std::vector<uint8_t>&)
+        //
+        // Appends the end of stream marker, flushing the pending run.
+        void finish(std::vector<uint8_t>&);
+
+        ////
+        // uint64_t ticks()
+        //
+        // The number of ticks encoded.
+        uint64_t ticks() const;
+    };
+
+    ////
+    // class Decoder
+    //
+    // Decodes a stream written by an Encoder.
+    class Decoder {
+        const uint8_t *_data;
+        size_t _size;
+        size_t _offset;
+        size_t _players;
+        std::vector<Input> _current;
+        std::vector<Input> _next;
+        uint64_t _run;
+        bool _changed;
+        bool _done;
+
+        ////
+        // uint64_t getVarint()
+        //
+        // Reads a LEB128 varint, throwing a WfnError on truncated input.
+        uint64_t getVarint();
+
+        ////
+        // void readRecord()
+        //
+        // Reads the next record: the run of unchanged ticks and the inputs of
+        // the tick that follows it. A stream that stops on a record boundary
+        // (e.g. a recording that was never closed) simply ends there.
+        void readRecord();
+
+    public:
+        ////
+        // Decoder(const uint8_t *, size_t, size_t)
+        //
+        // Constructs a decoder over an encoded buffer (which must outlive the
+        // decoder) for the provided number of players.
+        Decoder(const uint8_t *, size_t, size_t);
+
+        ////
+        // bool next(Input *)
+        //
+        // Decodes the next tick into the provided array (one per player),
+        // returning false at the end of the stream.
+        bool next(Input *);
+    };
+
+    ////
+    // struct RecordingHeader
+    //
+    // The fixed header at the start of a recording file.
+    struct RecordingHeader {
+        char magic[4];
+        uint16_t version;
+        uint16_t players;
+        uint32_t tickRate;
+        uint32_t reserved;
+    };
+
+    ////
+    // class Recorder
+    //
+    // Records per-tick input to disk. Encoding happens on the calling thread
+    // into a small chunk buffer; full chunks are handed to a writer thread, so
+    // the frame never waits on the disk.
+    class Recorder {
+        Encoder _encoder;
+        std::vector<uint8_t> _chunk;
+
+        FILE *_file;
+        std::thread _writer;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::deque<std::vector<uint8_t>> _queue;
+        std::vector<std::vector<uint8_t>> _spare;
+        bool _closing;
+        bool _closed;
+
+        ////
+        // void writeLoop()
+        //
+        // The body of the writer thread.
+        void writeLoop();
+
+        ////
+        // void submit()
+        //
+        // Hands the current chunk to the writer thread.
+        void submit();
+
+    public:
+        ////
+        // size_t chunkSize
+        //
+        // The size at which a chunk is handed off to the writer.
+        static const size_t chunkSize = 4096;
+
+        ////
+        // Recorder(const std::string&, size_t, uint32_t)
+        //
+        // Opens a recording file for the provided number of players, at the
+        // provided tick rate.
+        Recorder(const std::string&, size_t, uint32_t);
+
+        ////
+        // ~Recorder()
+        //
+        // Closes the recording if it was not closed already.
+        ~Recorder();
+
+        ////
+        // void record(const Input *)
+        //
+        // Records one tick of inputs (one per player).
+        void record(const Input *);
+
+        ////
+        // void close()
+        //
+        // Finishes the stream and waits for the writer to drain it.
+        void close();
+
+        ////
+        // uint64_t ticks()
+        //
+        // The number of ticks recorded.
+        uint64_t ticks() const;
+
+        // Following Rule of 3's
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+    };
+
+    ////
+    // class Replay
+    //
+    // Reads a recording back, tick by tick.
+    class Replay {
+        RecordingHeader _header;
+        std::vector<uint8_t> _data;
+        Decoder _decoder;
+
+    public:
+        ////
+        // Replay(const std::string&)
+        //
+        // Loads a recording file.
+        Replay(const std::string&);
+
+        ////
+        // size_t players()
+        //
+        // The number of players in the recording.
+        size_t players() const;
+
+        ////
+        // uint32_t tickRate()
+        //
+        // The tick rate the recording was made at.
+        uint32_t tickRate() const;
+
+        ////
+        // bool next(Input *)
+        //
+        // Provides the inputs of the next tick, returning false once the
+        // recording is over.
+        bool next(Input *);
+
+        // Following Rule of 3's
+        Replay(const Replay&) = delete;
+        Replay& operator=(const Replay&) = delete;
+    };
+}
+
+#endif
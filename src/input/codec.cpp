@@ -0,0 +1,205 @@
+#include "../input.hpp"
+
+#include <algorithm>
+
+namespace wfn_eng::input {
+    ////
+    // class Encoder
+    //
+    // Encodes a stream of per-tick inputs. Every tick is XORed against the
+    // previous one; ticks where nothing changed are folded into a run length,
+    // so a record only gets written when some player's input changes:
+    //
+    //   varint  unchanged ticks before this one
+    //   uint8   mask of players whose input changed (0 ends the stream)
+    //   varint  XOR delta, once per set bit of the mask
+
+    ////
+    // void putVarint(std::vector<uint8_t>&, uint64_t)
+    //
+    // Appends a LEB128 varint.
+    void Encoder::putVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    ////
+    // Encoder(size_t)
+    //
+    // Constructs an encoder for the provided number of players.
+    Encoder::Encoder(size_t players) :
+            _players(players),
+            _previous(players, 0),
+            _run(0),
+            _ticks(0) {
+        if (players == 0 || players > maxPlayers) {
+            throw WfnError(
+                "wfn_eng::input::Encoder",
+                "Constructor",
+                "Invalid player count"
+            );
+        }
+    }
+
+    ////
+    // void encode(const Input *, std::vector<uint8_t>&)
+    //
+    // Encodes one tick of inputs (one per player), appending any bytes to
+    // the output buffer.
+    void Encoder::encode(const Input *inputs, std::vector<uint8_t>& out) {
+        _ticks++;
+
+        uint8_t mask = 0;
+        for (size_t p = 0; p < _players; p++) {
+            if (inputs[p] != _previous[p])
+                mask |= static_cast<uint8_t>(1 << p);
+        }
+
+        if (mask == 0) {
+            _run++;
+            return;
+        }
+
+        putVarint(out, _run);
+        out.push_back(mask);
+        for (size_t p = 0; p < _players; p++) {
+            if (mask & (1 << p)) {
+                putVarint(out, inputs[p] ^ _previous[p]);
+                _previous[p] = inputs[p];
+            }
+        }
+
+        _run = 0;
+    }
+
+    ////
+    // void finish(std::vector<uint8_t>&)
+    //
+    // Appends the end of stream marker, flushing the pending run.
+    void Encoder::finish(std::vector<uint8_t>& out) {
+        putVarint(out, _run);
+        out.push_back(0);
+        _run = 0;
+    }
+
+    ////
+    // uint64_t ticks()
+    //
+    // The number of ticks encoded.
+    uint64_t Encoder::ticks() const { return _ticks; }
+
+    ////
+    // class Decoder
+    //
+    // Decodes a stream written by an Encoder.
+
+    ////
+    // uint64_t getVarint()
+    //
+    // Reads a LEB128 varint, throwing a WfnError on truncated input.
+    uint64_t Decoder::getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (_offset >= _size)
+                break;
+
+            uint8_t byte = _data[_offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+
+        throw WfnError(
+            "wfn_eng::input::Decoder",
+            "getVarint",
+            "Truncated stream"
+        );
+    }
+
+    ////
+    // void readRecord()
+    //
+    // Reads the next record: the run of unchanged ticks and the inputs of
+    // the tick that follows it. A stream that stops on a record boundary
+    // (e.g. a recording that was never closed) simply ends there.
+    void Decoder::readRecord() {
+        _changed = false;
+        _run = 0;
+        if (_offset >= _size)
+            return;
+
+        _run = getVarint();
+        if (_offset >= _size) {
+            throw WfnError(
+                "wfn_eng::input::Decoder",
+                "readRecord",
+                "Truncated stream"
+            );
+        }
+
+        uint8_t mask = _data[_offset++];
+        if (mask == 0)
+            return;
+
+        _next = _current;
+        for (size_t p = 0; p < _players; p++) {
+            if (mask & (1 << p))
+                _next[p] ^= static_cast<Input>(getVarint());
+        }
+
+        _changed = true;
+    }
+
+    ////
+    // Decoder(const uint8_t *, size_t, size_t)
+    //
+    // Constructs a decoder over an encoded buffer (which must outlive the
+    // decoder) for the provided number of players.
+    Decoder::Decoder(const uint8_t *data, size_t size, size_t players) :
+            _data(data),
+            _size(size),
+            _offset(0),
+            _players(players),
+            _current(players, 0),
+            _next(players, 0),
+            _run(0),
+            _changed(false),
+            _done(false) {
+        if (players == 0 || players > maxPlayers) {
+            throw WfnError(
+                "wfn_eng::input::Decoder",
+                "Constructor",
+                "Invalid player count"
+            );
+        }
+
+        readRecord();
+    }
+
+    ////
+    // bool next(Input *)
+    //
+    // Decodes the next tick into the provided array (one per player),
+    // returning false at the end of the stream.
+    bool Decoder::next(Input *out) {
+        if (_done)
+            return false;
+
+        if (_run > 0) {
+            _run--;
+        } else if (_changed) {
+            _current.swap(_next);
+            readRecord();
+        } else {
+            _done = true;
+            return false;
+        }
+
+        std::copy(_current.begin(), _current.end(), out);
+        return true;
+    }
+}
@@ -0,0 +1,41 @@
+#include "../input.hpp"
+
+////
+// struct Binding
+//
+// The scancode of every button for one player, in Button bit order.
+struct Binding {
+    SDL_Scancode keys[8];
+};
+
+static const Binding bindings[] = {
+    {{
+        SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D,
+        SDL_SCANCODE_U, SDL_SCANCODE_I, SDL_SCANCODE_J, SDL_SCANCODE_K
+    }},
+    {{
+        SDL_SCANCODE_UP, SDL_SCANCODE_DOWN, SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT,
+        SDL_SCANCODE_KP_4, SDL_SCANCODE_KP_5, SDL_SCANCODE_KP_1, SDL_SCANCODE_KP_2
+    }},
+};
+
+namespace wfn_eng::input {
+    ////
+    // Input sample(const Uint8 *, size_t)
+    //
+    // Builds the Input of a player from an SDL keyboard state array (as
+    // returned by SDL_GetKeyboardState). Player 0 uses WASD + UIJK, player 1
+    // uses the arrow keys + the numpad.
+    Input sample(const Uint8 *keys, size_t player) {
+        if (player >= sizeof(bindings) / sizeof(bindings[0]))
+            return 0;
+
+        Input input = 0;
+        for (size_t bit = 0; bit < 8; bit++) {
+            if (keys[bindings[player].keys[bit]])
+                input |= static_cast<Input>(1 << bit);
+        }
+
+        return input;
+    }
+}
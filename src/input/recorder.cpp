@@ -0,0 +1,135 @@
+#include "../input.hpp"
+
+#include <cstring>
+
+namespace wfn_eng::input {
+    ////
+    // class Recorder
+    //
+    // Records per-tick input to disk. Encoding happens on the calling thread
+    // into a small chunk buffer; full chunks are handed to a writer thread, so
+    // the frame never waits on the disk.
+
+    ////
+    // void writeLoop()
+    //
+    // The body of the writer thread.
+    void Recorder::writeLoop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _wake.wait(lock, [this]() { return _closing || !_queue.empty(); });
+            if (_queue.empty())
+                break;
+
+            std::vector<uint8_t> chunk = std::move(_queue.front());
+            _queue.pop_front();
+
+            lock.unlock();
+            fwrite(chunk.data(), 1, chunk.size(), _file);
+            lock.lock();
+
+            chunk.clear();
+            _spare.push_back(std::move(chunk));
+        }
+
+        fflush(_file);
+    }
+
+    ////
+    // void submit()
+    //
+    // Hands the current chunk to the writer thread.
+    void Recorder::submit() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back(std::move(_chunk));
+            if (!_spare.empty()) {
+                _chunk = std::move(_spare.back());
+                _spare.pop_back();
+            } else {
+                _chunk = std::vector<uint8_t>();
+            }
+        }
+
+        _chunk.reserve(chunkSize * 2);
+        _wake.notify_one();
+    }
+
+    ////
+    // Recorder(const std::string&, size_t, uint32_t)
+    //
+    // Opens a recording file for the provided number of players, at the
+    // provided tick rate.
+    Recorder::Recorder(const std::string& path, size_t players, uint32_t tickRate) :
+            _encoder(players),
+            _closing(false),
+            _closed(false) {
+        _file = fopen(path.c_str(), "wb");
+        if (_file == nullptr) {
+            throw WfnError(
+                "wfn_eng::input::Recorder",
+                "Constructor",
+                "Open file"
+            );
+        }
+
+        RecordingHeader header = {};
+        std::memcpy(header.magic, "WFNR", 4);
+        header.version = 1;
+        header.players = static_cast<uint16_t>(players);
+        header.tickRate = tickRate;
+        fwrite(&header, sizeof(header), 1, _file);
+
+        // Chunks are recycled through _spare, so steady-state recording does
+        // not allocate.
+        _chunk.reserve(chunkSize * 2);
+        _writer = std::thread(&Recorder::writeLoop, this);
+    }
+
+    ////
+    // ~Recorder()
+    //
+    // Closes the recording if it was not closed already.
+    Recorder::~Recorder() {
+        close();
+    }
+
+    ////
+    // void record(const Input *)
+    //
+    // Records one tick of inputs (one per player).
+    void Recorder::record(const Input *inputs) {
+        _encoder.encode(inputs, _chunk);
+        if (_chunk.size() >= chunkSize)
+            submit();
+    }
+
+    ////
+    // void close()
+    //
+    // Finishes the stream and waits for the writer to drain it.
+    void Recorder::close() {
+        if (_closed)
+            return;
+
+        _encoder.finish(_chunk);
+        submit();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closing = true;
+        }
+
+        _wake.notify_one();
+        _writer.join();
+
+        fclose(_file);
+        _closed = true;
+    }
+
+    ////
+    // uint64_t ticks()
+    //
+    // The number of ticks recorded.
+    uint64_t Recorder::ticks() const { return _encoder.ticks(); }
+}
@@ -0,0 +1,81 @@
+#include "../input.hpp"
+
+#include <cstring>
+#include <fstream>
+
+////
+// std::vector<uint8_t> load(const std::string&, RecordingHeader&)
+//
+// Loads a whole recording file, validating and extracting its header.
+static std::vector<uint8_t> load(const std::string& path, wfn_eng::input::RecordingHeader& header) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw wfn_eng::WfnError(
+            "wfn_eng::input::Replay",
+            "Constructor",
+            "Open file"
+        );
+    }
+
+    size_t size = static_cast<size_t>(file.tellg());
+    std::vector<uint8_t> data(size);
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(data.data()), size);
+
+    if (size < sizeof(header)) {
+        throw wfn_eng::WfnError(
+            "wfn_eng::input::Replay",
+            "Constructor",
+            "Truncated header"
+        );
+    }
+
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, "WFNR", 4) != 0 || header.version != 1) {
+        throw wfn_eng::WfnError(
+            "wfn_eng::input::Replay",
+            "Constructor",
+            "Not a recording"
+        );
+    }
+
+    return data;
+}
+
+namespace wfn_eng::input {
+    ////
+    // class Replay
+    //
+    // Reads a recording back, tick by tick.
+
+    ////
+    // Replay(const std::string&)
+    //
+    // Loads a recording file.
+    Replay::Replay(const std::string& path) :
+            _data(load(path, _header)),
+            _decoder(
+                _data.data() + sizeof(RecordingHeader),
+                _data.size() - sizeof(RecordingHeader),
+                _header.players
+            ) { }
+
+    ////
+    // size_t players()
+    //
+    // The number of players in the recording.
+    size_t Replay::players() const { return _header.players; }
+
+    ////
+    // uint32_t tickRate()
+    //
+    // The tick rate the recording was made at.
+    uint32_t Replay::tickRate() const { return _header.tickRate; }
+
+    ////
+    // bool next(Input *)
+    //
+    // Provides the inputs of the next tick, returning false once the
+    // recording is over.
+    bool Replay::next(Input *inputs) { return _decoder.next(inputs); }
+}
@@ -0,0 +1,252 @@
+#ifndef __WFN_ENG_IO_HPP__
+#define __WFN_ENG_IO_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::io {
+    ////
+    // enum class Backend
+    //
+    // How a Reader reads: io_uring on Linux, otherwise one blocking pread
+    // after another.
+    enum class Backend {
+        Pread,
+        Uring
+    };
+
+    ////
+    // const uint64_t largeRead
+    //
+    // Reads of at least this many bytes from a file opened for O_DIRECT go
+    // through the registered buffers; anything else goes straight into its
+    // destination.
+    const uint64_t largeRead = 64 * 1024;
+
+    ////
+    // const uint64_t directAlignment
+    //
+    // The offset and length alignment of an O_DIRECT read.
+    const uint64_t directAlignment = 4096;
+
+    ////
+    // class File
+    //
+    // A file open for reading, with a second O_DIRECT descriptor when it was
+    // asked for and the filesystem supports it (tmpfs doesn't, for one).
+    class File {
+        int _fd;
+        int _direct;
+        uint64_t _size;
+
+    public:
+        ////
+        // File(const std::string&, bool)
+        //
+        // Opens a file, throwing if it can't be read. With direct, also
+        // tries to open it for O_DIRECT.
+        explicit File(const std::string&, bool = false);
+
+        ////
+        // File(File&&)
+        //
+        // Takes the descriptors of another File.
+        File(File&&);
+
+        ////
+        // ~File()
+        //
+        // Closes the descriptors.
+        ~File();
+
+        ////
+        // int fd()
+        //
+        // The buffered descriptor.
+        int fd() const;
+
+        ////
+        // int direct()
+        //
+        // The O_DIRECT descriptor, or -1.
+        int direct() const;
+
+        ////
+        // uint64_t size()
+        //
+        // The size of the file when it was opened.
+        uint64_t size() const;
+
+        // Following Rule of 3's
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+    };
+
+    ////
+    // struct Read
+    //
+    // A range of a file to read into memory. Once read, result holds the
+    // bytes read (fewer than size past the end of the file), or -errno.
+    struct Read {
+        const File *file = nullptr;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint8_t *data = nullptr;
+        int64_t result = 0;
+    };
+
+    ////
+    // struct IoStats
+    //
+    // Counters on a Reader. A batch is one system call submitting and
+    // reaping any number of reads.
+    struct IoStats {
+        uint64_t reads = 0;
+        uint64_t bytes = 0;
+        uint64_t batches = 0;
+        uint64_t submitted = 0;
+        uint64_t maxInFlight = 0;
+        uint64_t fixedReads = 0;
+        uint64_t directReads = 0;
+        uint64_t directFallbacks = 0;
+        uint64_t shortReads = 0;
+        uint64_t errors = 0;
+    };
+
+    ////
+    // class Reader
+    //
+    // Reads batches of file ranges. With io_uring, up to its depth of reads
+    // are in flight at once, and every round trip to the kernel submits
+    // all the reads that fit and reaps every completion. Large O_DIRECT
+    // reads are split into chunks, each read into one of a few page-aligned
+    // buffers registered with the ring (so the kernel doesn't pin them for
+    // every read) and then copied out. The buffers give O_DIRECT the
+    // alignment it needs: a chunk is read from the block boundary at or
+    // before it, whatever the destination. Buffered reads skip them, since
+    // the kernel copies out of the page cache anyway. A Reader belongs to
+    // one thread.
+    class Reader {
+        ////
+        // struct Chunk
+        //
+        // A read in flight: part (or all) of a Read.
+        struct Chunk {
+            Read *read;
+            uint64_t done;
+            uint64_t length;
+            uint64_t skip;
+            int slot;
+            bool direct;
+        };
+
+        Backend _backend;
+        unsigned _depth;
+
+        // The rings, mapped from the kernel.
+        int _ring;
+        void *_sqMapping;
+        size_t _sqMappingSize;
+        void *_cqMapping;
+        size_t _cqMappingSize;
+        void *_sqes;
+        size_t _sqesSize;
+        unsigned *_sqHead;
+        unsigned *_sqTail;
+        unsigned *_sqMask;
+        unsigned *_sqArray;
+        unsigned *_cqHead;
+        unsigned *_cqTail;
+        unsigned *_cqMask;
+        void *_cqes;
+
+        // The registered buffers, as one mapping.
+        uint8_t *_slots;
+        size_t _slotSize;
+        std::vector<int> _freeSlots;
+
+        // Indexed by the user data of a submission.
+        std::vector<Chunk> _chunks;
+        std::vector<unsigned> _freeChunks;
+        std::deque<Chunk> _retries;
+
+        IoStats _stats;
+
+        ////
+        // void readPread(Read *, size_t)
+        //
+        // The fallback backend.
+        void readPread(Read *, size_t);
+
+        ////
+        // void readUring(Read *, size_t)
+        //
+        // The io_uring backend.
+        void readUring(Read *, size_t);
+
+        ////
+        // bool prepare(const Chunk&)
+        //
+        // Queues a chunk in the submission ring, returning false if there's
+        // no room.
+        bool prepare(const Chunk&);
+
+        ////
+        // void complete(unsigned, int)
+        //
+        // Handles the completion of a chunk.
+        void complete(unsigned, int);
+
+    public:
+        ////
+        // Reader(unsigned, Backend)
+        //
+        // Sets up a reader with the provided number of reads in flight.
+        // Falls back to pread if io_uring isn't available (not Linux, too
+        // old a kernel, or disabled), and runs without registered buffers
+        // if they can't be locked in memory.
+        explicit Reader(unsigned = 256, Backend = Backend::Uring);
+
+        ////
+        // ~Reader()
+        //
+        // Tears down the rings.
+        ~Reader();
+
+        ////
+        // void read(Read *, size_t)
+        //
+        // Reads every range, returning once all of them are done.
+        void read(Read *, size_t);
+
+        ////
+        // Backend backend()
+        //
+        // The backend actually in use.
+        Backend backend() const;
+
+        ////
+        // const IoStats& stats()
+        //
+        // The counters of the reader.
+        const IoStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include "../io.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wfn_eng::io {
+    ////
+    // class File
+    //
+    // A file open for reading.
+
+    ////
+    // File(const std::string&, bool)
+    //
+    // Opens a file, throwing if it can't be read. With direct, also tries
+    // to open it for O_DIRECT; a filesystem that refuses just leaves the
+    // reads buffered.
+    File::File(const std::string& path, bool direct)
+            : _fd(-1)
+            , _direct(-1)
+            , _size(0) {
+        _fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_fd < 0)
+            throw WfnError("wfn_eng::io::File", "File", "Open " + path);
+
+        struct stat info;
+        if (fstat(_fd, &info) != 0) {
+            close(_fd);
+            throw WfnError("wfn_eng::io::File", "File", "Stat " + path);
+        }
+        _size = info.st_size;
+
+#ifdef O_DIRECT
+        if (direct)
+            _direct = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+#endif
+    }
+
+    ////
+    // File(File&&)
+    //
+    // Takes the descriptors of another File.
+    File::File(File&& other)
+            : _fd(other._fd)
+            , _direct(other._direct)
+            , _size(other._size) {
+        other._fd = -1;
+        other._direct = -1;
+    }
+
+    ////
+    // ~File()
+    //
+    // Closes the descriptors.
+    File::~File() {
+        if (_direct >= 0)
+            close(_direct);
+        if (_fd >= 0)
+            close(_fd);
+    }
+
+    ////
+    // int fd()
+    //
+    // The buffered descriptor.
+    int File::fd() const { return _fd; }
+
+    ////
+    // int direct()
+    //
+    // The O_DIRECT descriptor, or -1.
+    int File::direct() const { return _direct; }
+
+    ////
+    // uint64_t size()
+    //
+    // The size of the file when it was opened.
+    uint64_t File::size() const { return _size; }
+}
@@ -0,0 +1,424 @@
+#include "../io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define WFN_ENG_HAVE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// The registered buffers: enough for a few large reads in flight, and well
+// under the default locked memory limit.
+static const size_t slotCount = 16;
+static const size_t slotSize = 256 * 1024;
+
+// sqe.len is 32 bits, so huge unregistered reads are split too.
+static const uint64_t maxChunk = 1 << 30;
+
+namespace wfn_eng::io {
+    ////
+    // class Reader
+    //
+    // Reads batches of file ranges, through io_uring when it can.
+
+    ////
+    // Reader(unsigned, Backend)
+    //
+    // Sets up the rings and registers the buffers. The raw system calls
+    // stand in for liburing, which isn't a dependency; the kernel's own
+    // header is all it takes. Anything that fails along the way leaves the
+    // reader on pread (or, for the buffers, on unregistered reads).
+    Reader::Reader(unsigned depth, Backend backend)
+            : _backend(Backend::Pread)
+            , _depth(std::max(depth, 1u))
+            , _ring(-1)
+            , _sqMapping(nullptr)
+            , _sqMappingSize(0)
+            , _cqMapping(nullptr)
+            , _cqMappingSize(0)
+            , _sqes(nullptr)
+            , _sqesSize(0)
+            , _sqHead(nullptr)
+            , _sqTail(nullptr)
+            , _sqMask(nullptr)
+            , _sqArray(nullptr)
+            , _cqHead(nullptr)
+            , _cqTail(nullptr)
+            , _cqMask(nullptr)
+            , _cqes(nullptr)
+            , _slots(nullptr)
+            , _slotSize(0) {
+#ifdef WFN_ENG_HAVE_URING
+        if (backend != Backend::Uring)
+            return;
+
+        io_uring_params params = {};
+        int ring = static_cast<int>(syscall(__NR_io_uring_setup, _depth, &params));
+        if (ring < 0)
+            return;
+        _ring = ring;
+
+        _sqMappingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cqMappingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            _sqMappingSize = _cqMappingSize = std::max(_sqMappingSize, _cqMappingSize);
+
+        void *sq = mmap(nullptr, _sqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED)
+            return;
+        _sqMapping = sq;
+
+        void *cq = single ? sq : mmap(nullptr, _cqMappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+            return;
+        _cqMapping = cq;
+
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return;
+        _sqes = sqes;
+
+        uint8_t *sqBytes = static_cast<uint8_t *>(sq);
+        uint8_t *cqBytes = static_cast<uint8_t *>(cq);
+        _sqHead = reinterpret_cast<unsigned *>(sqBytes + params.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned *>(sqBytes + params.sq_off.tail);
+        _sqMask = reinterpret_cast<unsigned *>(sqBytes + params.sq_off.ring_mask);
+        _sqArray = reinterpret_cast<unsigned *>(sqBytes + params.sq_off.array);
+        _cqHead = reinterpret_cast<unsigned *>(cqBytes + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned *>(cqBytes + params.cq_off.tail);
+        _cqMask = reinterpret_cast<unsigned *>(cqBytes + params.cq_off.ring_mask);
+        _cqes = cqBytes + params.cq_off.cqes;
+
+        // The kernel rounds the depth up to a power of two. Never more
+        // reads in flight than submission entries keeps the completion
+        // ring (twice as large) from overflowing.
+        _depth = params.sq_entries;
+        _chunks.resize(_depth);
+        for (unsigned i = _depth; i > 0; i--)
+            _freeChunks.push_back(i - 1);
+
+        void *slots = mmap(nullptr, slotCount * slotSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slots != MAP_FAILED) {
+            iovec buffers[slotCount];
+            for (size_t i = 0; i < slotCount; i++) {
+                buffers[i].iov_base = static_cast<uint8_t *>(slots) + i * slotSize;
+                buffers[i].iov_len = slotSize;
+            }
+
+            if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_BUFFERS, buffers, slotCount) == 0) {
+                _slots = static_cast<uint8_t *>(slots);
+                _slotSize = slotSize;
+                for (size_t i = slotCount; i > 0; i--)
+                    _freeSlots.push_back(static_cast<int>(i - 1));
+            } else {
+                munmap(slots, slotCount * slotSize);
+            }
+        }
+
+        _backend = Backend::Uring;
+#else
+        (void)backend;
+#endif
+    }
+
+    ////
+    // ~Reader()
+    //
+    // Tears down the rings. Closing the ring unregisters the buffers.
+    Reader::~Reader() {
+#ifdef WFN_ENG_HAVE_URING
+        if (_slots != nullptr)
+            munmap(_slots, slotCount * slotSize);
+        if (_sqes != nullptr)
+            munmap(_sqes, _sqesSize);
+        if (_cqMapping != nullptr && _cqMapping != _sqMapping)
+            munmap(_cqMapping, _cqMappingSize);
+        if (_sqMapping != nullptr)
+            munmap(_sqMapping, _sqMappingSize);
+        if (_ring >= 0)
+            close(_ring);
+#endif
+    }
+
+    ////
+    // void read(Read *, size_t)
+    //
+    // Reads every range, returning once all of them are done.
+    void Reader::read(Read *reads, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            reads[i].result = 0;
+
+        if (_backend == Backend::Uring)
+            readUring(reads, count);
+        else
+            readPread(reads, count);
+
+        for (size_t i = 0; i < count; i++) {
+            _stats.reads++;
+            if (reads[i].result < 0)
+                _stats.errors++;
+            else
+                _stats.bytes += reads[i].result;
+        }
+    }
+
+    ////
+    // void readPread(Read *, size_t)
+    //
+    // One blocking pread after another, each a batch of one.
+    void Reader::readPread(Read *reads, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            Read& read = reads[i];
+
+            uint64_t done = 0;
+            while (done < read.size) {
+                ssize_t got = pread(read.file->fd(), read.data + done, read.size - done, read.offset + done);
+                _stats.batches++;
+                _stats.submitted++;
+
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got < 0) {
+                    read.result = -errno;
+                    break;
+                }
+                if (got == 0)
+                    break;
+
+                done += got;
+            }
+
+            if (read.result == 0)
+                read.result = static_cast<int64_t>(done);
+        }
+
+        if (count > 0)
+            _stats.maxInFlight = 1;
+    }
+
+    ////
+    // void readUring(Read *, size_t)
+    //
+    // Fills the submission ring with chunks (retries first, then the next
+    // ranges in order), submits them and waits for at least one completion
+    // in a single system call, reaps every completion, and repeats until
+    // nothing is left in flight.
+    void Reader::readUring(Read *reads, size_t count) {
+#ifdef WFN_ENG_HAVE_URING
+        size_t next = 0;
+        uint64_t cursor = 0;
+        unsigned inFlight = 0;
+
+        while (true) {
+            unsigned queued = 0;
+
+            while (!_freeChunks.empty()) {
+                Chunk chunk;
+                bool retrying = !_retries.empty();
+
+                if (retrying) {
+                    chunk = _retries.front();
+                } else {
+                    while (next < count && cursor >= reads[next].size) {
+                        next++;
+                        cursor = 0;
+                    }
+                    if (next == count)
+                        break;
+
+                    Read& read = reads[next];
+                    uint64_t remaining = read.size - cursor;
+
+                    if (_slots != nullptr && read.size >= largeRead && read.file->direct() >= 0) {
+                        if (_freeSlots.empty())
+                            break;
+
+                        uint64_t skip = (read.offset + cursor) % directAlignment;
+                        chunk = Chunk { &read, cursor, std::min(remaining, _slotSize - skip), skip, _freeSlots.back(), true };
+                    } else {
+                        chunk = Chunk { &read, cursor, std::min(remaining, maxChunk), 0, -1, false };
+                    }
+                }
+
+                if (!prepare(chunk))
+                    break;
+
+                if (retrying) {
+                    _retries.pop_front();
+                } else {
+                    cursor += chunk.length;
+                    if (chunk.slot >= 0)
+                        _freeSlots.pop_back();
+                }
+
+                queued++;
+            }
+
+            if (queued == 0 && inFlight == 0)
+                break;
+
+            inFlight += queued;
+            _stats.submitted += queued;
+            _stats.maxInFlight = std::max<uint64_t>(_stats.maxInFlight, inFlight);
+
+            // Everything queued and not yet consumed by the kernel, which
+            // covers a previous call cut short by a signal.
+            unsigned pending = *_sqTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+            if (syscall(__NR_io_uring_enter, _ring, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    continue;
+                throw WfnError("wfn_eng::io::Reader", "read", "Enter io_uring");
+            }
+            _stats.batches++;
+
+            unsigned head = *_cqHead;
+            unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+            const io_uring_cqe *cqes = static_cast<const io_uring_cqe *>(_cqes);
+            for (; head != tail; head++) {
+                const io_uring_cqe& cqe = cqes[head & *_cqMask];
+                complete(static_cast<unsigned>(cqe.user_data), cqe.res);
+                inFlight--;
+            }
+            __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+        }
+#else
+        (void)reads;
+        (void)count;
+#endif
+    }
+
+    ////
+    // bool prepare(const Chunk&)
+    //
+    // Queues a chunk in the submission ring, returning false if there's no
+    // room. A chunk in a registered buffer reads into it with READ_FIXED,
+    // from the block boundary at or before it when it's O_DIRECT; any
+    // other reads straight into its destination.
+    bool Reader::prepare(const Chunk& chunk) {
+#ifdef WFN_ENG_HAVE_URING
+        unsigned tail = *_sqTail;
+        if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _depth)
+            return false;
+
+        unsigned index = _freeChunks.back();
+        _freeChunks.pop_back();
+        _chunks[index] = chunk;
+
+        const Read& read = *chunk.read;
+        unsigned entry = tail & *_sqMask;
+        io_uring_sqe& sqe = static_cast<io_uring_sqe *>(_sqes)[entry];
+        std::memset(&sqe, 0, sizeof(sqe));
+
+        sqe.fd = chunk.direct ? read.file->direct() : read.file->fd();
+        sqe.off = read.offset + chunk.done - chunk.skip;
+        sqe.user_data = index;
+
+        if (chunk.slot >= 0) {
+            uint64_t length = chunk.skip + chunk.length;
+            if (chunk.direct)
+                length = (length + directAlignment - 1) & ~(directAlignment - 1);
+
+            sqe.opcode = IORING_OP_READ_FIXED;
+            sqe.addr = reinterpret_cast<uint64_t>(_slots + chunk.slot * _slotSize);
+            sqe.len = static_cast<uint32_t>(length);
+            sqe.buf_index = static_cast<uint16_t>(chunk.slot);
+        } else {
+            sqe.opcode = IORING_OP_READ;
+            sqe.addr = reinterpret_cast<uint64_t>(read.data + chunk.done);
+            sqe.len = static_cast<uint32_t>(chunk.length);
+        }
+
+        _sqArray[entry] = entry;
+        __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+#else
+        (void)chunk;
+        return false;
+#endif
+    }
+
+    ////
+    // void complete(unsigned, int)
+    //
+    // Copies a chunk out of its registered buffer and frees it. A chunk
+    // that came back short of the end of the file, or that O_DIRECT
+    // refused, has its rest read again, buffered and straight into the
+    // destination.
+    void Reader::complete(unsigned index, int result) {
+        Chunk chunk = _chunks[index];
+        _freeChunks.push_back(index);
+        Read& read = *chunk.read;
+
+        uint64_t got = 0;
+        bool retry = false;
+
+        if (result == -EAGAIN || result == -EINTR) {
+            retry = true;
+        } else if (result == -EINVAL && chunk.direct) {
+            _stats.directFallbacks++;
+            retry = true;
+        } else if (result < 0) {
+            if (read.result >= 0)
+                read.result = result;
+        } else {
+            if (static_cast<uint64_t>(result) > chunk.skip)
+                got = std::min<uint64_t>(result - chunk.skip, chunk.length);
+
+            if (chunk.slot >= 0) {
+                std::memcpy(read.data + chunk.done, _slots + chunk.slot * _slotSize + chunk.skip, got);
+                _stats.fixedReads++;
+                if (chunk.direct)
+                    _stats.directReads++;
+            }
+
+            if (read.result >= 0)
+                read.result += got;
+
+            uint64_t end = read.offset + chunk.done + got;
+            if (got < chunk.length && end < read.file->size() && (result > 0 || chunk.direct)) {
+                _stats.shortReads++;
+                retry = true;
+            }
+        }
+
+        if (chunk.slot >= 0)
+            _freeSlots.push_back(chunk.slot);
+
+        if (retry && read.result >= 0)
+            _retries.push_back(Chunk { &read, chunk.done + got, chunk.length - got, 0, -1, false });
+    }
+
+    ////
+    // Backend backend()
+    //
+    // The backend actually in use.
+    Backend Reader::backend() const { return _backend; }
+
+    ////
+    // const IoStats& stats()
+    //
+    // The counters of the reader.
+    const IoStats& Reader::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void Reader::report(std::ostream& out) const {
+        out << "I/O (" << (_backend == Backend::Uring ? "io_uring" : "pread") << "): "
+            << _stats.reads << " reads, " << _stats.bytes << " bytes in " << _stats.batches
+            << " system calls, max " << _stats.maxInFlight << " in flight, "
+            << _stats.fixedReads << " registered (" << _stats.directReads << " O_DIRECT, "
+            << _stats.directFallbacks << " fell back), " << _stats.shortReads << " short, "
+            << _stats.errors << " failed" << std::endl;
+    }
+}
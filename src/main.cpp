@@ -6,16 +6,44 @@
 #include <stdexcept>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <set>
 
 #include "vulkan.hpp"
+#include "asset.hpp"
+#include "atlas.hpp"
+#include "cull.hpp"
 #include "sdl.hpp"
+#include "memory.hpp"
+#include "render.hpp"
+#include "shaders.hpp"
+#include "stream.hpp"
+#include "texture.hpp"
+#include "tilemap.hpp"
+#include "input.hpp"
+#include "sim.hpp"
 
 const int WIDTH  = 640;
 const int HEIGHT = 480;
 
+// The most fixed steps simulated per rendered frame, so that a long stall
+// (e.g. dragging the window) doesn't spiral into a catch-up loop.
+const int MAX_TICKS_PER_FRAME = 8;
+
+// The number of frames the CPU may record ahead of the GPU.
+const int MAX_FRAMES_IN_FLIGHT = 2;
+
+// Frames after the warm-up are expected to never touch the heap.
+const int WARMUP_FRAMES = 60;
+
 #define DEBUG
 
 #define NDEBUG
@@ -68,607 +96,70 @@ void DestroyDebugReportCallbackEXT(VkInstance instance, VkDebugReportCallbackEXT
 }
 
 ////
-// readFile
+// DemoFrag
 //
-// Utility function to load files into a vector of characters.
-static std::vector<char> readFile(const std::string& fileName) {
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
-        throw std::runtime_error("Failed to open file");
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-
-    return buffer;
-}
-
-////
-// Instance
-//
-// Utility class for creating a VkInstance.
-struct Instance {
-    const std::vector<const char *> validationLayers = {
-        "VK_LAYER_LUNARG_standard_validation"
+// The permutations of demo.frag: two color grades as specialization
+// constants, and a cutout built offline.
+struct DemoFrag {
+    enum class Feature : uint32_t {
+        Grayscale = 1 << 0,
+        Sepia     = 1 << 1,
+        Cutout    = 1 << 16
     };
 
-    ////
-    // checkValidationLayerSupport
-    //
-    // Checks if the application supports the required validation layers.
-    bool checkValidationLayerSupport() {
-        if (!enableValidationLayer)
-            return true;
-
-        uint32_t layerCount;
-        vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-
-        std::vector<VkLayerProperties> availableLayers(layerCount);
-        vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
-
-        for (const char *layerName: validationLayers) {
-            bool layerFound = false;
-            std::cout << "Searching for: " << layerName << std::endl;
-            for (const auto& layerProperties: availableLayers) {
-                std::cout << "  " << layerProperties.layerName << std::endl;
-                if (strcmp(layerName, layerProperties.layerName) == 0) {
-                    layerFound = true;
-                    break;
-                }
-            }
-
-            if (!layerFound) {
-                std::cout << std::endl;
-                return false;
-            }
-        }
-
-        std::cout << std::endl;
-        return true;
-    }
-
-    ////
-    // makeInstance
-    //
-    // Creates a VkInstance.
-    void makeInstance(SDL_Window *window) {
-        if (!checkValidationLayerSupport())
-            throw std::runtime_error("Validation layers requested but not found.");
-
-        // Constructing application info.
-        VkApplicationInfo appInfo = {};
-        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-        appInfo.pApplicationName = "Vulkan Test";
-        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.pEngineName = "No Engine";
-        appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
-
-        // Constructing instance construction info.
-        VkInstanceCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_MACOS_SURFACE_CREATE_INFO_MVK;
-        createInfo.pApplicationInfo = &appInfo;
-
-        // Registering ALL the extensions!
-        uint32_t extensionCount;
-        if (!SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, nullptr))
-            throw std::runtime_error("Could not get required extension count");
-
-        const char **pNames = new const char *[extensionCount];
-        if (!SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, pNames))
-            throw std::runtime_error("Could not get extensions.");
-
-        createInfo.enabledExtensionCount = extensionCount;
-        createInfo.ppEnabledExtensionNames = pNames;
-
-        // Adding validation layers
-        if (enableValidationLayer) {
-            createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-            createInfo.ppEnabledLayerNames = validationLayers.data();
-        } else
-            createInfo.enabledLayerCount = 0;
-
-
-        // Constructing the VkInstance
-        VkResult result;
-        if ((result = vkCreateInstance(&createInfo, nullptr, &instance)) != VK_SUCCESS) {
-            std::cerr << result << std::endl;
-            throw std::runtime_error("Failed to create instance.");
-        }
-
-        delete[] pNames;
-    }
-
-    VkInstance instance;
-
-    Instance(SDL_Window *window) {
-        makeInstance(window);
-    }
-
-    ~Instance() {
-        vkDestroyInstance(instance, nullptr);
-    }
-};
-
-////
-// QueueFamily
-//
-// A utility class for constructing a QueueFamily.
-struct QueueFamily {
-    int graphicsFamily = -1;
-    int presentFamily = -1;
-
-    void findValidQueueFamily(VkPhysicalDevice device, VkSurfaceKHR surface) {
-        uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-
-        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
-
-        for (int i = 0; i < queueFamilyCount; i++) {
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-
-            if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-                graphicsFamily = i;
-
-            if (queueFamilies[i].queueCount > 0 && presentSupport)
-                presentFamily = i;
-
-            if (isComplete())
-                break;
-        }
-    }
-
-    QueueFamily(VkPhysicalDevice device, VkSurfaceKHR surface) {
-        graphicsFamily = -1;
-        presentFamily = -1;
-        findValidQueueFamily(device, surface);
-    }
-
-    bool isComplete() { return graphicsFamily >= 0 && presentFamily >= 0; }
-};
-
-////
-// SwapChainSupport
-//
-// Provides information on the supported features for a VkPhysicalDevice.
-struct SwapChainSupport {
-    VkSurfaceCapabilitiesKHR capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR> presentModes;
-
-    SwapChainSupport(VkPhysicalDevice physical, VkSurfaceKHR surface) {
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical, surface, &capabilities);
-
-        uint32_t formatCount;
-        vkGetPhysicalDeviceSurfaceFormatsKHR(physical, surface, &formatCount, nullptr);
-        if (formatCount > 0) {
-            formats.resize(formatCount);
-            vkGetPhysicalDeviceSurfaceFormatsKHR(physical, surface, &formatCount, formats.data());
-        }
-
-        uint32_t presentModeCount;
-        vkGetPhysicalDeviceSurfacePresentModesKHR(physical, surface, &presentModeCount, nullptr);
-        if (presentModeCount > 0) {
-            presentModes.resize(presentModeCount);
-            vkGetPhysicalDeviceSurfacePresentModesKHR(physical, surface, &presentModeCount, presentModes.data());
-        }
-    }
-
-    ////
-    // sufficient
-    //
-    // Checks whether the capabilities, formats, and presentModes are
-    // sufficient.
-    bool sufficient() {
-#ifdef DEBUG
-        std::cout << "  Formats:       " << formats.size() << std::endl;
-        std::cout << "  Present Modes: " << presentModes.size() << std::endl;
-#endif
-        return !formats.empty() && !presentModes.empty();
-    }
-};
-
-////
-// Physical
-//
-// Utility class for choosing a VkPhysicalDevice.
-struct Physical {
-    const std::vector<const char *> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
-
-    ////
-    // areExtensionsSupported
-    //
-    // Returns whether or not a device supports a given set of extensions.
-    bool areExtensionsSupported(VkPhysicalDevice device) {
-        uint32_t supExtCt;
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &supExtCt, nullptr);
-
-        std::vector<VkExtensionProperties> supExt(supExtCt);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &supExtCt, supExt.data());
-
-#ifdef DEBUG
-        std::cout << "  Exts: " << std::endl;
-#endif
-
-        std::set<std::string> reqExt(deviceExtensions.begin(), deviceExtensions.end());
-        for (const auto& ext: supExt) {
-#ifdef DEBUG
-            std::cout << "    " << ext.extensionName << std::endl;
-#endif
-
-            reqExt.erase(ext.extensionName);
-        }
-
-        return reqExt.empty();
-    }
-
-    /////
-    // isDeviceSuitable
-    //
-    // Decides if a GPU is suitable.
-    bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties(device, &deviceProperties);
-
-#ifdef DEBUG
-        std::cout << "Device: " << deviceProperties.deviceName << std::endl;
-#endif
-
-        bool extSupport = areExtensionsSupported(device);
-        bool swapSupport = false;
-        if (extSupport) {
-            SwapChainSupport support(device, surface);
-            swapSupport = support.sufficient();
-        }
-
-        QueueFamily family(device, surface);
-        return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
-            family.isComplete() &&
-            extSupport &&
-            swapSupport;
-    }
-
-    ////
-    // pickPhysicalDevice
-    //
-    // Picks a physical device to use.
-    void pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface) {
-        physical = VK_NULL_HANDLE;
-        uint32_t deviceCount = 0;
-        vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
-        if (deviceCount == 0)
-            throw std::runtime_error("No physical devices found");
-
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-
-        for (const VkPhysicalDevice& device: devices) {
-            if (isDeviceSuitable(device, surface)) {
-                physical = device;
-                break;
-            }
-        }
-
-        if (physical == VK_NULL_HANDLE)
-            throw std::runtime_error("Failed to find a GPU");
-    }
-
-    VkPhysicalDevice physical;
-    VkPhysicalDeviceProperties props;
-    VkPhysicalDeviceFeatures features;
-
-    Physical(VkInstance instance, VkSurfaceKHR surface) {
-        pickPhysicalDevice(instance, surface);
-    }
-};
-
-////
-// Logical
-//
-// Container for the logical device and graphicsQueue.
-struct Logical {
-    QueueFamily* family;
-    VkDevice device;
-    VkQueue graphicsQueue;
-    VkQueue presentQueue;
-
-    ////
-    // makeDevice
-    //
-    // Constructs a new VkDevice.
-    void makeDevice(VkPhysicalDevice physical) {
-        VkDeviceQueueCreateInfo queueCreateInfo = {};
-        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueCreateInfo.queueFamilyIndex = family->graphicsFamily;
-        queueCreateInfo.queueCount = 1;
-
-        float queuePriority = 1.0f;
-        queueCreateInfo.pQueuePriorities = &queuePriority;
-
-        VkPhysicalDeviceFeatures deviceFeatures = {};
-
-        VkDeviceCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.pQueueCreateInfos = &queueCreateInfo;
-        createInfo.queueCreateInfoCount = 1;
-        createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = 0;
-
-        VkResult result;
-        if ((result = vkCreateDevice(physical, &createInfo, nullptr, &device)) != VK_SUCCESS) {
-            std::cerr << "Create device result: " << result << std::endl;
-            throw std::runtime_error("Failed to create device");
-        }
-
-        vkGetDeviceQueue(device, family->graphicsFamily, 0, &graphicsQueue);
-        vkGetDeviceQueue(device, family->presentFamily, 0, &presentQueue);
-    }
+    static constexpr uint32_t offline = static_cast<uint32_t>(Feature::Cutout);
 
-    Logical(VkPhysicalDevice physical, VkSurfaceKHR surface) {
-        family = new QueueFamily(physical, surface);
-        makeDevice(physical);
+    // Both grades replace the color, so only one applies.
+    static constexpr bool valid(uint32_t mask) {
+        return (mask & 3) != 3;
     }
 
-    ~Logical() {
-        delete family;
-        vkDestroyDevice(device, nullptr);
+    static const char *path(uint32_t offline) {
+        return offline != 0 ? "frag_cutout.spv" : "frag.spv";
     }
 };
 
-////
-// Surface
-//
-// Provides a surface for the... thing to do a thing.
-struct Surface {
-    VkInstance instance;
-    VkSurfaceKHR surface;
-
-    void createSurface(VkInstance instance, SDL_Window *window) {
-        if (!SDL_Vulkan_CreateSurface(window, instance, &surface))
-            throw std::runtime_error("Failed to build surface");
-    }
-
-    Surface(VkInstance instance, SDL_Window* window) {
-        this->instance = instance;
-        createSurface(instance, window);
-    }
-
-    ~Surface() {
-        vkDestroySurfaceKHR(instance, surface, nullptr);
-    }
-};
+typedef wfn_eng::vulkan::shader::Permutation<DemoFrag> PlainShading;
+typedef wfn_eng::vulkan::shader::Permutation<DemoFrag, DemoFrag::Feature::Grayscale> GrayscaleShading;
+typedef wfn_eng::vulkan::shader::Permutation<DemoFrag, DemoFrag::Feature::Sepia> SepiaShading;
+typedef wfn_eng::vulkan::shader::Permutation<DemoFrag, DemoFrag::Feature::Cutout, DemoFrag::Feature::Sepia> CutoutShading;
 
 ////
-// SwapChain
+// Shading
 //
-// Builds the SwapChain!
-struct SwapChain {
-    ////
-    // chooseFormat
-    //
-    // Chooses a VkSurfaceFormatKHR given the set of available formats.
-    VkSurfaceFormatKHR chooseFormat() {
-        // If there is no preferred format, choose the best one.
-        if (support.formats.size() == 1 && support.formats[0].format == VK_FORMAT_UNDEFINED) {
-            return {
-                VK_FORMAT_B8G8R8A8_UNORM,
-                VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
-            };
-        }
-
-        // See if the best format is in the set of preferred formats.
-        for (const auto& format: support.formats) {
-            if (format.format == VK_FORMAT_B8G8R8A8_UNORM && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
-                return format;
-        }
-
-        // Choose any old format.
-        return support.formats[0];
-    }
-
-    ////
-    // presentModeRanking
-    //
-    // Provides a ranking for VkPresentModeKHR such that we can choose the best
-    // one!
-    int presentModeRanking(VkPresentModeKHR presentMode) {
-        switch (presentMode) {
-        case VK_PRESENT_MODE_MAILBOX_KHR:
-            return 3;
-        case VK_PRESENT_MODE_FIFO_KHR:
-            return 2;
-        case VK_PRESENT_MODE_IMMEDIATE_KHR:
-            return 1;
-        default:
-            return 0;
-        };
-    }
-
-    ////
-    // choosePresentMode
-    //
-    // Chooses the VkPresentModeKHR given the set of available presentation
-    // modes.
-    VkPresentModeKHR choosePresentMode() {
-        VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-        int bestModeRanking = -1;
-
-        for (const auto& presentMode: support.presentModes) {
-            int n = presentModeRanking(presentMode);
-            if (n > bestModeRanking) {
-                bestMode = presentMode;
-                bestModeRanking = n;
-            }
-        }
-
-        return bestMode;
-    }
-
-    ////
-    // chooseExtent
-    //
-    // Chooses the extent that best matches the extents of the SDL_Window.
-    VkExtent2D chooseExtent() {
-        if (support.capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
-            return support.capabilities.currentExtent;
-        else {
-            VkExtent2D ext = { WIDTH, HEIGHT };
-
-            ext.width = std::max(
-                support.capabilities.minImageExtent.width,
-                std::min(
-                    support.capabilities.maxImageExtent.width,
-                    ext.width
-                )
-            );
-
-            ext.height = std::max(
-                support.capabilities.minImageExtent.height,
-                std::min(
-                    support.capabilities.maxImageExtent.height,
-                    ext.height
-                )
-            );
-
-            return ext;
-        }
-    }
-
-    void makeSwapChain(VkDevice device, VkSurfaceKHR surface) {
-        uint32_t imageCount = support.capabilities.minImageCount + 1;
-        if (support.capabilities.maxImageCount > 0 && imageCount > support.capabilities.maxImageCount)
-            imageCount = support.capabilities.maxImageCount;
-
-        VkSwapchainCreateInfoKHR createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-        createInfo.surface = surface;
-        createInfo.minImageCount = imageCount;
-        createInfo.imageFormat = format.format;
-        createInfo.imageColorSpace = format.colorSpace;
-        createInfo.imageExtent = extent;
-        createInfo.imageArrayLayers = 1;
-        createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-        VkResult result;
-        if ((result = vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain)) != VK_SUCCESS) {
-          std::cerr << "Swapchain result: " << result << std::endl;
-          throw std::runtime_error("Failed to create swapchain");
-        }
-
-        vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
-        swapChainImages.resize(imageCount);
-        vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
-    }
-
-    SwapChainSupport support;
-
-    VkSurfaceFormatKHR format;
-    VkPresentModeKHR presentMode;
-    VkExtent2D extent;
-
-    VkDevice device;
-    VkSwapchainKHR swapChain;
-    std::vector<VkImage> swapChainImages;
-
-    SwapChain(VkPhysicalDevice physical, VkDevice device, VkSurfaceKHR surface) :
-            support(physical, surface) {
-        format = chooseFormat();
-        presentMode = choosePresentMode();
-        extent = chooseExtent();
-        makeSwapChain(device, surface);
-
-        this->device = device;
-    }
-
-    ~SwapChain() {
-        vkDestroySwapchainKHR(device, swapChain, nullptr);
-    }
-};
-
-struct ImageViews {
-    VkDevice device;
-    std::vector<VkImageView> imageViews;
-
-    void makeImageViews(VkDevice device, SwapChain *swapChain) {
-        imageViews.resize(swapChain->swapChainImages.size());
-        for (size_t i = 0; i < swapChain->swapChainImages.size(); i++) {
-            VkImageViewCreateInfo createInfo = {};
-            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-            createInfo.image = swapChain->swapChainImages[i];
-            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-            createInfo.format = swapChain->format.format;
-            createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-            createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            createInfo.subresourceRange.baseMipLevel = 0;
-            createInfo.subresourceRange.levelCount = 1;
-            createInfo.subresourceRange.baseArrayLayer = 1;
-            createInfo.subresourceRange.layerCount = 1;
-
-            VkResult result;
-            if ((result = vkCreateImageView(device, &createInfo, nullptr, &imageViews[i])) != VK_SUCCESS) {
-                std::cerr << "Image view " << i << " result: " << result << std::endl;
-                throw std::runtime_error("Failed to create image view");
-            }
-        }
-    }
-
-    ImageViews(VkDevice device, SwapChain *swapChain) {
-        makeImageViews(device, swapChain);
-        this->device = device;
-    }
-
-    ~ImageViews() {
-        for (auto imageView: imageViews)
-            vkDestroyImageView(device, imageView, nullptr);
+// The fragment shader permutation the triangle is drawn with.
+struct Shading {
+    std::string fragName;
+    uint32_t fragFeatures;
+
+    template <typename Permutation>
+    static Shading of() {
+        return Shading { Permutation::path(), Permutation::specialized };
     }
 };
 
 struct GraphicsPipeline {
-    const std::string vertPath = "src/shaders/vert.spv";
-    const std::string fragPath = "src/shaders/frag.spv";
+    const std::string vertName = "vert.spv";
 
-    VkShaderModule makeShader(VkDevice device, const std::vector<char>& code) {
+    wfn_eng::vulkan::Handle<VkShaderModule> makeShader(VkDevice device, const wfn_eng::shaders::Spirv& code) {
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        createInfo.codeSize = code.bytes();
+        createInfo.pCode = code.code();
 
         VkShaderModule module;
         VkResult result;
-        if ((result = vkCreateShaderModule(device, &createInfo, nullptr, &module)) != VK_SUCCESS) {
+        if ((result = vkCreateShaderModule(device, &createInfo, wfn_eng::vulkan::allocator::callbacks(), &module)) != VK_SUCCESS) {
             std::cerr << "Shader module result: " << result << std::endl;
             throw std::runtime_error("Failed to create shader module");
         }
 
-        return module;
-    }
-
-    VkPipelineShaderStageCreateInfo shaderCreateInfo(VkShaderModule module, VkShaderStageFlagBits stage) {
-        VkPipelineShaderStageCreateInfo createInfo = {};
-
-        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        createInfo.stage = stage;
-        createInfo.module = module;
-        createInfo.pName = "main";
-
-        return createInfo;
+        return wfn_eng::vulkan::Handle<VkShaderModule>(device, module);
     }
 
-    void makeRenderPass(VkDevice device, SwapChain *swapChain) {
+    void makeRenderPass(VkDevice device, wfn_eng::vulkan::Swapchain& swapchain) {
         VkAttachmentDescription colorAttachment = {};
-        colorAttachment.format = swapChain->format.format;
+        colorAttachment.format = swapchain.format();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -703,313 +194,677 @@ struct GraphicsPipeline {
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        VkRenderPass handle;
+        if (vkCreateRenderPass(device, &renderPassInfo, wfn_eng::vulkan::allocator::callbacks(), &handle) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
+
+        renderPass = wfn_eng::vulkan::Handle<VkRenderPass>(device, handle);
     }
 
-    void makePipeline(VkDevice device, SwapChain *swapChain) {
-        VkShaderModule vertModule = makeShader(device, readFile(vertPath));
-        VkShaderModule fragModule = makeShader(device, readFile(fragPath));
+    void makePipeline(VkDevice device, wfn_eng::vulkan::PipelineManager& pipelines, wfn_eng::vulkan::LayoutCache& layouts, const Shading& shading) {
+        wfn_eng::shaders::Spirv vertCode = wfn_eng::shaders::load(vertName);
+        wfn_eng::shaders::Spirv fragCode = wfn_eng::shaders::load(shading.fragName);
 
-        auto vertCreateInfo = shaderCreateInfo(vertModule, VK_SHADER_STAGE_VERTEX_BIT);
-        auto fragCreateInfo = shaderCreateInfo(fragModule, VK_SHADER_STAGE_FRAGMENT_BIT);
+        vertModule = makeShader(device, vertCode);
+        fragModule = makeShader(device, fragCode);
 
-        VkPipelineShaderStageCreateInfo shaderStages[] = {
-            vertCreateInfo,
-            fragCreateInfo
-        };
+        // The layouts come from what the shaders declare.
+        vertReflection = wfn_eng::vulkan::shader::reflect(vertCode.code(), vertCode.words());
+        fragReflection = wfn_eng::vulkan::shader::reflect(fragCode.code(), fragCode.words());
+        pipelineLayout = layouts.layout({ &vertReflection, &fragReflection }).layout;
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapChain->extent.width;
-        viewport.height = (float)swapChain->extent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset = {0, 0};
-        scissor.extent = swapChain->extent;
-
-        VkPipelineViewportStateCreateInfo viewportState = {};
-        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
-        viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
-
-        VkPipelineRasterizationStateCreateInfo rasterizer = {};
-        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizer.depthClampEnable = VK_FALSE;
-        rasterizer.polygonMode = VK_POLYGON_MODE_FILL; // VK_POLYGON_MODE_LINE, VK_POLYGON_MODE_POINT
-        rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_FALSE;
-        rasterizer.depthBiasConstantFactor = 0.0f; // Optional
-        rasterizer.depthBiasClamp = 0.0f; // Optional
-        rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
-
-        VkPipelineMultisampleStateCreateInfo multisampling = {};
-        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampling.sampleShadingEnable = VK_FALSE;
-        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisampling.minSampleShading = 1.0f; // Optional
-        multisampling.pSampleMask = nullptr; // Optional
-        multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-        multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
-        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
-
-        VkPipelineColorBlendStateCreateInfo colorBlending = {};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
-        colorBlending.blendConstants[0] = 0.0f; // Optional
-        colorBlending.blendConstants[1] = 0.0f; // Optional
-        colorBlending.blendConstants[2] = 0.0f; // Optional
-        colorBlending.blendConstants[3] = 0.0f; // Optional
-
-        VkDynamicState dynamicStates[] = {
-            VK_DYNAMIC_STATE_VIEWPORT,
-            VK_DYNAMIC_STATE_LINE_WIDTH
-        };
+        key.vertex = vertModule.get();
+        key.fragment = fragModule.get();
+        key.fragmentFeatures = shading.fragFeatures;
+        key.vertexLayout = wfn_eng::vulkan::VertexLayout::packed(vertReflection);
+        key.layout = pipelineLayout;
+        key.renderPass = renderPass.get();
 
-        VkPipelineDynamicStateCreateInfo dynamicState = {};
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicState.dynamicStateCount = 2;
-        dynamicState.pDynamicStates = dynamicStates;
+        // Built up front: it's what every other pipeline falls back to.
+        pipelineId = pipelines.build(key);
+        pipeline = pipelines.get(pipelineId);
+    }
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0; // Optional
-        pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
-        pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-        pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+    // The shaders stay alive as long as the pipeline manager may compile
+    // pipelines from them.
+    wfn_eng::vulkan::Handle<VkShaderModule> vertModule;
+    wfn_eng::vulkan::Handle<VkShaderModule> fragModule;
+    wfn_eng::vulkan::Handle<VkRenderPass> renderPass;
 
-        VkResult result;
-        if ((result = vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout)) != VK_SUCCESS) {
-            std::cerr << "Graphics pipeline layout result: " << result << std::endl;
-            throw std::runtime_error("Failed to create graphics pipeline layout");
-        }
+    // Owned by the layout cache.
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
 
-        VkGraphicsPipelineCreateInfo pipelineInfo = {};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssembly;
-        pipelineInfo.pViewportState = &viewportState;
-        pipelineInfo.pRasterizationState = &rasterizer;
-        pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = nullptr; // Optional
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr; // Optional
-        pipelineInfo.layout = pipelineLayout;
-        pipelineInfo.renderPass = renderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-        pipelineInfo.basePipelineIndex = -1;
-
-        if ((result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)) != VK_SUCCESS) {
-            std::cerr << "Graphics pipeline result: " << result << std::endl;
-            throw std::runtime_error("Failed to create graphics pipeline");
-        }
-    }
+    // Owned by the pipeline manager.
+    wfn_eng::vulkan::PipelineId pipelineId = wfn_eng::vulkan::noPipeline;
+    VkPipeline pipeline = VK_NULL_HANDLE;
 
-    VkDevice device;
-    VkRenderPass renderPass;
-    VkPipelineLayout pipelineLayout;
-    VkPipeline pipeline;
+    // Kept to rebuild the pipeline when one of its shaders is reloaded.
+    wfn_eng::vulkan::PipelineKey key;
+    wfn_eng::vulkan::shader::Reflection vertReflection;
+    wfn_eng::vulkan::shader::Reflection fragReflection;
 
-    GraphicsPipeline(VkDevice device, SwapChain *swapChain) {
-        makeRenderPass(device, swapChain);
-        makePipeline(device, swapChain);
+    GraphicsPipeline(VkDevice device, wfn_eng::vulkan::Swapchain& swapchain, wfn_eng::vulkan::PipelineManager& pipelines, wfn_eng::vulkan::LayoutCache& layouts, const Shading& shading) {
+        makeRenderPass(device, swapchain);
+        makePipeline(device, pipelines, layouts, shading);
+    }
+};
 
-        this->device = device;
+////
+// TilePipeline
+//
+// Draws the chunks of a tilemap in the triangle's render pass: vertices
+// as atlas::SpriteVertex, the camera in push constants, and a material
+// per atlas page.
+struct TilePipeline {
+    wfn_eng::vulkan::Handle<VkShaderModule> vertModule;
+    wfn_eng::vulkan::Handle<VkShaderModule> fragModule;
+    wfn_eng::vulkan::shader::Reflection vertReflection;
+    wfn_eng::vulkan::shader::Reflection fragReflection;
+
+    // Owned by the layout cache.
+    wfn_eng::vulkan::ReflectedLayout layout;
+
+    // Owned by the pipeline manager.
+    wfn_eng::vulkan::PipelineId pipelineId = wfn_eng::vulkan::noPipeline;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    TilePipeline(VkDevice device, GraphicsPipeline& graphicsPipeline, wfn_eng::vulkan::PipelineManager& pipelines, wfn_eng::vulkan::LayoutCache& layouts) {
+        wfn_eng::shaders::Spirv vertCode = wfn_eng::shaders::load("tile_vert.spv");
+        wfn_eng::shaders::Spirv fragCode = wfn_eng::shaders::load("tile_frag.spv");
+
+        vertModule = graphicsPipeline.makeShader(device, vertCode);
+        fragModule = graphicsPipeline.makeShader(device, fragCode);
+
+        vertReflection = wfn_eng::vulkan::shader::reflect(vertCode.code(), vertCode.words());
+        fragReflection = wfn_eng::vulkan::shader::reflect(fragCode.code(), fragCode.words());
+        layout = layouts.layout({ &vertReflection, &fragReflection });
+
+        wfn_eng::vulkan::PipelineKey key;
+        key.vertex = vertModule.get();
+        key.fragment = fragModule.get();
+        key.vertexLayout = wfn_eng::vulkan::VertexLayout::packed(vertReflection);
+        key.layout = layout.layout;
+        key.renderPass = graphicsPipeline.renderPass.get();
+
+        // The chunk buffers hold SpriteVertex as is.
+        if (key.vertexLayout.stride != sizeof(wfn_eng::atlas::SpriteVertex))
+            throw std::runtime_error("The tile shader doesn't read SpriteVertex");
+
+        pipelineId = pipelines.build(key);
+        pipeline = pipelines.get(pipelineId);
     }
+};
+
+////
+// TileLayer
+//
+// The tilemap drawn behind the triangle with --tilemap: a small map over an
+// atlas packed in memory from a few solid tiles. Its chunks are baked and
+// uploaded once, with the triangle's texture, and the camera sees all of
+// it.
+struct TileLayer {
+    std::unique_ptr<TilePipeline> pipeline;
+    std::unique_ptr<wfn_eng::atlas::Atlas> atlas;
+    std::unique_ptr<wfn_eng::tilemap::Tilemap> map;
+    std::unique_ptr<wfn_eng::tilemap::ChunkBuffers> chunks;
+    std::vector<wfn_eng::texture::TextureId> pages;
+    wfn_eng::tilemap::TileMaterial material;
+    wfn_eng::cull::Rect camera;
 
-    ~GraphicsPipeline() {
-        vkDestroyPipeline(device, pipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-        vkDestroyRenderPass(device, renderPass, nullptr);
+    ////
+    // record
+    //
+    // Pushes the camera, then the draws of the chunks it sees. The camera
+    // outlives the binds of the pipelines the queue records before the
+    // tiles, as no other pipeline has push constants.
+    void record(VkCommandBuffer cmd, const wfn_eng::vulkan::DeviceTable& vk, wfn_eng::render::RenderQueue& queue) {
+        float scaleX = 2.0f / (camera.maxX - camera.minX), scaleY = 2.0f / (camera.maxY - camera.minY);
+        float constants[4] = { scaleX, scaleY, -1.0f - camera.minX * scaleX, -1.0f - camera.minY * scaleY };
+
+        vk.vkCmdPushConstants(cmd, material.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), constants);
+        chunks->push(camera, material, queue);
     }
 };
 
-struct FrameBuffers {
-    VkDevice device;
-    std::vector<VkFramebuffer> swapChainFrameBuffers;
+////
+// Particles
+//
+// The particles simulated on the compute queue with --async-compute, and
+// drawn as points over the triangle. Each frame in flight has its own
+// buffer, written whole by the frame's dispatch then handed to graphics
+// to read as vertices, so a dispatch never races the previous frame's
+// draw.
+struct Particles {
+    // As particles.comp declares them.
+    struct Particle {
+        float position[2];
+        float velocity[2];
+    };
 
-    FrameBuffers(VkDevice device, SwapChain *swapChain, ImageViews *imageViews, GraphicsPipeline *graphicsPipeline) {
-        swapChainFrameBuffers.resize(imageViews->imageViews.size());
-        for (int i = 0; i < imageViews->imageViews.size(); i++) {
-            VkImageView attachments[] = {
-                imageViews->imageViews[i]
-            };
+    struct Constants {
+        float time;
+        uint32_t count;
+    };
 
-            VkFramebufferCreateInfo createInfo = {};
-            createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            createInfo.renderPass = graphicsPipeline->renderPass;
-            createInfo.attachmentCount = 1;
-            createInfo.pAttachments = attachments;
-            createInfo.width = swapChain->extent.width;
-            createInfo.height = swapChain->extent.height;
-            createInfo.layers = 1;
-
-            VkResult result;
-            if ((result = vkCreateFramebuffer(device, &createInfo, nullptr, &swapChainFrameBuffers[i])) != VK_SUCCESS) {
-                std::cerr << "Framebuffer " << i << " result: " << result << std::endl;
-                throw std::runtime_error("Failed to create framebuffer");
-            }
+    struct Slot {
+        wfn_eng::vulkan::Handle<VkBuffer> buffer;
+        wfn_eng::vulkan::Handle<VkDeviceMemory> memory;
+
+        // Freed along with the pool.
+        VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+
+    static const uint32_t count = 1 << 18;
+
+    // The local_size_x of particles.comp.
+    static const uint32_t groupSize = 64;
+
+    wfn_eng::vulkan::Handle<VkShaderModule> compModule;
+    wfn_eng::vulkan::Handle<VkShaderModule> vertModule;
+    wfn_eng::vulkan::Handle<VkShaderModule> fragModule;
+    wfn_eng::vulkan::shader::Reflection compReflection;
+    wfn_eng::vulkan::shader::Reflection vertReflection;
+    wfn_eng::vulkan::shader::Reflection fragReflection;
+
+    // Owned by the layout cache.
+    wfn_eng::vulkan::ReflectedLayout computeLayout;
+    wfn_eng::vulkan::ReflectedLayout drawLayout;
+
+    wfn_eng::vulkan::Handle<VkPipeline> computePipeline;
+
+    // Owned by the pipeline manager.
+    wfn_eng::vulkan::PipelineId pipelineId = wfn_eng::vulkan::noPipeline;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    wfn_eng::vulkan::Handle<VkDescriptorPool> descriptorPool;
+    std::vector<Slot> slots;
+
+    // What the simulation's time counts from.
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    void createComputePipeline(VkDevice device, const wfn_eng::vulkan::DeviceTable& vk) {
+        VkComputePipelineCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        createInfo.stage.module = compModule.get();
+        createInfo.stage.pName = "main";
+        createInfo.layout = computeLayout.layout;
+
+        VkPipeline handle;
+        VkResult result;
+        if ((result = vk.vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &createInfo, wfn_eng::vulkan::allocator::callbacks(), &handle)) != VK_SUCCESS) {
+            std::cerr << "Compute pipeline result: " << result << std::endl;
+            throw std::runtime_error("Failed to create particle pipeline");
         }
 
-        this->device = device;
+        computePipeline = wfn_eng::vulkan::Handle<VkPipeline>(device, handle);
+    }
+
+    void createSlots(wfn_eng::vulkan::Device& device, size_t frames) {
+        VkDevice logical = device.logical();
+        const wfn_eng::vulkan::DeviceTable& vk = device.table();
+
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = (uint32_t)frames;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = (uint32_t)frames;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+
+        VkDescriptorPool pool;
+        if (vk.vkCreateDescriptorPool(logical, &poolInfo, wfn_eng::vulkan::allocator::callbacks(), &pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create particle descriptor pool");
+        descriptorPool = wfn_eng::vulkan::Handle<VkDescriptorPool>(logical, pool);
+
+        slots.resize(frames);
+        for (Slot& slot : slots) {
+            // Only ever used by one queue at a time, and handed over
+            // explicitly.
+            VkBufferCreateInfo bufferInfo = {};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = sizeof(Particle) * count;
+            bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VkBuffer buffer;
+            if (vk.vkCreateBuffer(logical, &bufferInfo, wfn_eng::vulkan::allocator::callbacks(), &buffer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create particle buffer");
+            slot.buffer = wfn_eng::vulkan::Handle<VkBuffer>(logical, buffer);
+
+            VkMemoryRequirements requirements;
+            vk.vkGetBufferMemoryRequirements(logical, buffer, &requirements);
+
+            VkMemoryAllocateInfo allocateInfo = {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocateInfo.allocationSize = requirements.size;
+            allocateInfo.memoryTypeIndex = wfn_eng::vulkan::util::memoryType(
+                device.physical(),
+                requirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+            );
+
+            VkDeviceMemory memory;
+            if (vk.vkAllocateMemory(logical, &allocateInfo, wfn_eng::vulkan::allocator::callbacks(), &memory) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate particle memory");
+            slot.memory = wfn_eng::vulkan::Handle<VkDeviceMemory>(logical, memory);
+
+            if (vk.vkBindBufferMemory(logical, buffer, memory, 0) != VK_SUCCESS)
+                throw std::runtime_error("Failed to bind particle memory");
+
+            VkDescriptorSetAllocateInfo setInfo = {};
+            setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            setInfo.descriptorPool = descriptorPool.get();
+            setInfo.descriptorSetCount = 1;
+            setInfo.pSetLayouts = &computeLayout.sets[0];
+
+            if (vk.vkAllocateDescriptorSets(logical, &setInfo, &slot.set) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate particle descriptor set");
+
+            VkDescriptorBufferInfo bufferRange = {};
+            bufferRange.buffer = buffer;
+            bufferRange.offset = 0;
+            bufferRange.range = VK_WHOLE_SIZE;
+
+            VkWriteDescriptorSet write = {};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = slot.set;
+            write.dstBinding = 0;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.pBufferInfo = &bufferRange;
+
+            vk.vkUpdateDescriptorSets(logical, 1, &write, 0, nullptr);
+        }
+    }
+
+    Particles(wfn_eng::vulkan::Device& device, GraphicsPipeline& graphicsPipeline, wfn_eng::vulkan::PipelineManager& pipelines, wfn_eng::vulkan::LayoutCache& layouts, size_t frames) {
+        VkDevice logical = device.logical();
+
+        wfn_eng::shaders::Spirv compCode = wfn_eng::shaders::load("particles_comp.spv");
+        wfn_eng::shaders::Spirv vertCode = wfn_eng::shaders::load("particle_vert.spv");
+        wfn_eng::shaders::Spirv fragCode = wfn_eng::shaders::load("particle_frag.spv");
+
+        compModule = graphicsPipeline.makeShader(logical, compCode);
+        vertModule = graphicsPipeline.makeShader(logical, vertCode);
+        fragModule = graphicsPipeline.makeShader(logical, fragCode);
+
+        compReflection = wfn_eng::vulkan::shader::reflect(compCode.code(), compCode.words());
+        vertReflection = wfn_eng::vulkan::shader::reflect(vertCode.code(), vertCode.words());
+        fragReflection = wfn_eng::vulkan::shader::reflect(fragCode.code(), fragCode.words());
+        computeLayout = layouts.layout({ &compReflection });
+        drawLayout = layouts.layout({ &vertReflection, &fragReflection });
+
+        if (computeLayout.setCount != 1 || compReflection.pushConstantSize != sizeof(Constants))
+            throw std::runtime_error("The particle shader doesn't match Particles");
+
+        createComputePipeline(logical, device.table());
+        createSlots(device, frames);
+
+        wfn_eng::vulkan::PipelineKey key;
+        key.vertex = vertModule.get();
+        key.fragment = fragModule.get();
+        key.vertexLayout = wfn_eng::vulkan::VertexLayout::packed(vertReflection);
+        key.layout = drawLayout.layout;
+        key.renderPass = graphicsPipeline.renderPass.get();
+        key.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        key.cullMode = VK_CULL_MODE_NONE;
+        key.blend = wfn_eng::vulkan::Blend::Additive;
+
+        // The particle buffers are bound as vertex buffers as is.
+        if (key.vertexLayout.stride != sizeof(Particle))
+            throw std::runtime_error("The particle shader doesn't read Particle");
+
+        pipelineId = pipelines.build(key);
+        pipeline = pipelines.get(pipelineId);
+    }
+
+    ////
+    // dispatch
+    //
+    // Records the simulation of a frame slot's particles into a compute
+    // command buffer.
+    void dispatch(VkCommandBuffer cmd, const wfn_eng::vulkan::DeviceTable& vk, size_t frame) {
+        Constants constants;
+        constants.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        constants.count = count;
+
+        vk.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.get());
+        vk.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout.layout, 0, 1, &slots[frame].set, 0, nullptr);
+        vk.vkCmdPushConstants(cmd, computeLayout.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vk.vkCmdDispatch(cmd, (count + groupSize - 1) / groupSize, 1, 1);
+    }
+
+    ////
+    // transfer
+    //
+    // Hands a frame slot's particles from the dispatch to the draw. They
+    // are never handed back: the next dispatch into the slot overwrites
+    // all of them, and a buffer whose contents are discarded may change
+    // queue families without a transfer.
+    wfn_eng::vulkan::BufferTransfer transfer(size_t frame) const {
+        wfn_eng::vulkan::BufferTransfer transfer;
+        transfer.buffer = slots[frame].buffer.get();
+        transfer.srcStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        transfer.srcAccess = VK_ACCESS_SHADER_WRITE_BIT;
+        transfer.dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        transfer.dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        return transfer;
     }
 
-    ~FrameBuffers() {
-        for (auto frameBuffer: swapChainFrameBuffers)
-            vkDestroyFramebuffer(device, frameBuffer, nullptr);
+    ////
+    // draw
+    //
+    // The draw of a frame slot's particles.
+    wfn_eng::render::Draw draw(size_t frame) const {
+        wfn_eng::render::Draw draw;
+        draw.pipeline = pipeline;
+        draw.layout = drawLayout.layout;
+        draw.vertexBuffer = slots[frame].buffer.get();
+        draw.vertexCount = count;
+        return draw;
     }
 };
 
 struct CommandBuffers {
     VkDevice device;
-    VkCommandPool commandPool;
+    wfn_eng::vulkan::Handle<VkCommandPool> commandPool;
+
+    // Freed along with the pool. With particles, one per swapchain image
+    // and frame slot, since each slot draws its own particle buffer.
     std::vector<VkCommandBuffer> commandBuffers;
+    size_t frames = 1;
 
-    void createCommandPool(VkDevice device, QueueFamily *queueFamily) {
+    // Time spent recording, to compare the dispatch modes.
+    double recordSeconds = 0;
+
+    // The frame's draws, sorted and filtered before recording.
+    wfn_eng::render::RenderQueue renderQueue { 1 };
+
+    void createCommandPool(VkDevice device, uint32_t queueFamily) {
         VkCommandPoolCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        createInfo.queueFamilyIndex = queueFamily->graphicsFamily;
+        createInfo.queueFamilyIndex = queueFamily;
         createInfo.flags = 0;
 
+        VkCommandPool pool;
         VkResult result;
-        if ((result = vkCreateCommandPool(device, &createInfo, nullptr, &commandPool)) != VK_SUCCESS) {
+        if ((result = vkCreateCommandPool(device, &createInfo, wfn_eng::vulkan::allocator::callbacks(), &pool)) != VK_SUCCESS) {
             std::cerr << "Command pool result: " << result << std::endl;
             throw std::runtime_error("Failed to make command pool");
         }
+
+        commandPool = wfn_eng::vulkan::Handle<VkCommandPool>(device, pool);
     }
 
-    void createCommandBuffers(SwapChain *swapChain, GraphicsPipeline *graphicsPipeline, FrameBuffers *frameBuffers) {
-        commandBuffers.resize(frameBuffers->swapChainFrameBuffers.size());
+    void createCommandBuffers(const wfn_eng::vulkan::DeviceTable& vk, wfn_eng::vulkan::Swapchain& swapchain, GraphicsPipeline& graphicsPipeline, VkDescriptorSet material, TileLayer *tiles, Particles *particles) {
+        frames = particles != nullptr ? particles->slots.size() : 1;
+        commandBuffers.resize(swapchain.size() * frames);
 
         VkCommandBufferAllocateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        createInfo.commandPool = commandPool;
+        createInfo.commandPool = commandPool.get();
         createInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         createInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
         VkResult result;
-        if ((result = vkAllocateCommandBuffers(device, &createInfo, commandBuffers.data())) != VK_SUCCESS) {
+        if ((result = vk.vkAllocateCommandBuffers(device, &createInfo, commandBuffers.data())) != VK_SUCCESS) {
             std::cerr << "Command buffers result: " << result << std::endl;
             throw std::runtime_error("Failed to allocate command buffers");
         }
 
+        auto start = std::chrono::steady_clock::now();
+
         for (size_t i = 0; i < commandBuffers.size(); i++) {
+            uint32_t image = (uint32_t)(i / frames);
+            size_t frame = i % frames;
+
             VkCommandBufferBeginInfo beginInfo = {};
             beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
             beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
             beginInfo.pInheritanceInfo = VK_NULL_HANDLE;
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
+            if (vk.vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
                 throw std::runtime_error("Failed to begin recording command buffer");
 
             VkRenderPassBeginInfo renderPassInfo = {};
             renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = graphicsPipeline->renderPass;
-            renderPassInfo.framebuffer = frameBuffers->swapChainFrameBuffers[i];
+            renderPassInfo.renderPass = graphicsPipeline.renderPass.get();
+            renderPassInfo.framebuffer = swapchain.frameBuffer(image);
             renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = swapChain->extent;
+            renderPassInfo.renderArea.extent = swapchain.extent();
 
             VkClearValue clearColor = { 0.3f, 0.3f, 0.3f, 1.0f };
             renderPassInfo.clearValueCount = 1;
             renderPassInfo.pClearValues = &clearColor;
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline->pipeline);
-            vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-            vkCmdEndRenderPass(commandBuffers[i]);
-
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+            wfn_eng::render::Draw triangle;
+            triangle.pipeline = graphicsPipeline.pipeline;
+            triangle.layout = graphicsPipeline.pipelineLayout;
+            triangle.material = material;
+            triangle.vertexCount = 3;
+
+            // On a layer above the tiles: there's no depth buffer, so the
+            // tiles have to be drawn first.
+            renderQueue.clear();
+            renderQueue.push(wfn_eng::render::key::opaque(1, 0, 0, 0), triangle);
+
+            // Blended over everything else.
+            if (particles != nullptr)
+                renderQueue.push(wfn_eng::render::key::translucent(2, 2, 0, 0), particles->draw(frame));
+
+            VkViewport viewport = {};
+            viewport.width = (float)swapchain.extent().width;
+            viewport.height = (float)swapchain.extent().height;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+
+            VkRect2D scissor = {};
+            scissor.extent = swapchain.extent();
+
+            vk.vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            vk.vkCmdSetViewport(commandBuffers[i], 0, 1, &viewport);
+            vk.vkCmdSetScissor(commandBuffers[i], 0, 1, &scissor);
+            if (tiles != nullptr)
+                tiles->record(commandBuffers[i], vk, renderQueue);
+            renderQueue.record(commandBuffers[i], vk);
+            vk.vkCmdEndRenderPass(commandBuffers[i]);
+
+            if (vk.vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
                 throw std::runtime_error("Failed to record command buffer");
         }
+
+        recordSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 
-    CommandBuffers(VkDevice device, QueueFamily *queueFamily, SwapChain *swapChain, GraphicsPipeline *graphicsPipeline, FrameBuffers *frameBuffers) {
-        createCommandPool(device, queueFamily);
-        createCommandBuffers(swapChain, graphicsPipeline, frameBuffers);
+    CommandBuffers(wfn_eng::vulkan::Device& device, wfn_eng::vulkan::Swapchain& swapchain, GraphicsPipeline& graphicsPipeline, VkDescriptorSet material, TileLayer *tiles, Particles *particles) {
+        this->device = device.logical();
 
-        this->device = device;
+        createCommandPool(device.logical(), device.graphicsFamily());
+        createCommandBuffers(device.table(), swapchain, graphicsPipeline, material, tiles, particles);
     }
 
-    ~CommandBuffers() {
-        vkDestroyCommandPool(device, commandPool, nullptr);
+    ////
+    // get
+    //
+    // The command buffer that draws a swapchain image in a frame slot.
+    VkCommandBuffer get(uint32_t image, size_t frame) const {
+        return commandBuffers[image * frames + frame % frames];
     }
 };
 
-struct Semaphores {
-    VkDevice device;
-    VkSemaphore imageAvailable;
-    VkSemaphore renderFinished;
+////
+// steadyNanos
+//
+// The steady clock in nanoseconds, as the hot reload timestamps edits.
+static uint64_t steadyNanos() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count()
+    );
+}
+
+////
+// HotSwap
+//
+// A pipeline rebuilt from reloaded shaders: compiling in the background
+// until it can be swapped in at a frame boundary, then waiting for the
+// first frame drawn with it to complete, to report the edit-to-pixels
+// latency.
+struct HotSwap {
+    wfn_eng::vulkan::PipelineId id = wfn_eng::vulkan::noPipeline;
+    wfn_eng::vulkan::PipelineKey key;
+
+    // Only for the shaders that were reloaded.
+    wfn_eng::vulkan::Handle<VkShaderModule> vertModule;
+    wfn_eng::vulkan::Handle<VkShaderModule> fragModule;
+    wfn_eng::vulkan::shader::Reflection vertReflection;
+    wfn_eng::vulkan::shader::Reflection fragReflection;
+
+    std::string names;
+    uint64_t editNanos = 0;
+    uint64_t compileNanos = 0;
+    uint64_t requestNanos = 0;
+    uint64_t swapNanos = 0;
+
+    // The graphics timeline value of the first frame drawn with it.
+    uint64_t shownValue = 0;
+};
+
+////
+// FrameSync
+//
+// The synchronization objects of every frame in flight: a semaphore pair to
+// order acquire, render and present, and the graphics timeline value that
+// tells the CPU when the frame's submission (and everything it used) is
+// done.
+struct FrameSync {
+    std::vector<wfn_eng::vulkan::Handle<VkSemaphore>> imageAvailable;
+    std::vector<wfn_eng::vulkan::Handle<VkSemaphore>> renderFinished;
+
+    // The graphics timeline value last submitted from each slot.
+    std::vector<uint64_t> submitted;
+
+    FrameSync(VkDevice device) {
+        submitted.resize(MAX_FRAMES_IN_FLIGHT, 0);
 
-    Semaphores(VkDevice device) {
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailable) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinished) != VK_SUCCESS) {
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            VkSemaphore available, finished;
 
-            throw std::runtime_error("Failed to create semaphores");
-        }
+            if (vkCreateSemaphore(device, &semaphoreInfo, wfn_eng::vulkan::allocator::callbacks(), &available) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create frame synchronization objects");
+            imageAvailable.emplace_back(device, available);
 
-        this->device = device;
+            if (vkCreateSemaphore(device, &semaphoreInfo, wfn_eng::vulkan::allocator::callbacks(), &finished) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create frame synchronization objects");
+            renderFinished.emplace_back(device, finished);
+        }
     }
+};
+
+////
+// Uploads
+//
+// A command buffer per frame in flight for the uploads (textures and
+// streamed assets), recorded fresh every frame that has any and submitted
+// ahead of the frame's draws.
+struct Uploads {
+    std::vector<wfn_eng::vulkan::Handle<VkCommandPool>> pools;
+
+    // Freed along with the pools.
+    std::vector<VkCommandBuffer> commandBuffers;
 
-    ~Semaphores() {
-        vkDestroySemaphore(device, renderFinished, nullptr);
-        vkDestroySemaphore(device, imageAvailable, nullptr);
+    Uploads(wfn_eng::vulkan::Device& device) {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = device.graphicsFamily();
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            VkCommandPool pool;
+            if (vkCreateCommandPool(device.logical(), &poolInfo, wfn_eng::vulkan::allocator::callbacks(), &pool) != VK_SUCCESS)
+                throw std::runtime_error("Failed to make upload command pool");
+            pools.emplace_back(device.logical(), pool);
+
+            VkCommandBufferAllocateInfo allocateInfo = {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = pool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocateInfo.commandBufferCount = 1;
+
+            if (device.table().vkAllocateCommandBuffers(device.logical(), &allocateInfo, &commandBuffers[i]) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate upload command buffer");
+        }
     }
 };
 
 class HelloTriangleApplication {
 private:
-    wfn_eng::sdl::Window *window;
+    std::unique_ptr<wfn_eng::sdl::Window> window;
+
+    wfn_eng::sim::World world;
+    std::unique_ptr<wfn_eng::input::Recorder> recorder;
+
+    wfn_eng::memory::FrameArenas frameArenas { MAX_FRAMES_IN_FLIGHT, 256 * 1024 };
+    size_t currentFrame = 0;
+
+    // Retired resources are keyed by graphics timeline value, and
+    // destroyed once the timeline reaches it.
+    wfn_eng::vulkan::DeletionQueue deletionQueue;
 
     VkDebugReportCallbackEXT callback;
 
-    Instance *instance;
-    Surface *surface;
-    Physical *physical;
-    Logical *logical;
-    SwapChain *swapChain;
-    ImageViews *imageViews;
-    GraphicsPipeline *graphicsPipeline;
-    FrameBuffers *frameBuffers;
-    CommandBuffers *commandBuffers;
-    Semaphores *semaphores;
+    std::unique_ptr<wfn_eng::vulkan::Core> core;
+    std::string pipelineCachePath;
+    std::unique_ptr<wfn_eng::vulkan::LayoutCache> layouts;
+    std::unique_ptr<wfn_eng::vulkan::PipelineManager> pipelines;
+    Shading shading = Shading::of<PlainShading>();
+    std::unique_ptr<GraphicsPipeline> graphicsPipeline;
+    std::unique_ptr<CommandBuffers> commandBuffers;
+    std::unique_ptr<FrameSync> frameSync;
+
+    // Only with --async-compute.
+    bool useAsyncCompute = false;
+    std::unique_ptr<wfn_eng::vulkan::AsyncCompute> asyncCompute;
+    std::unique_ptr<Particles> particles;
+
+    // Only with --hot-reload.
+    bool useHotReload = false;
+    std::unique_ptr<wfn_eng::shaders::HotReload> hotReload;
+    HotSwap compiling;
+    HotSwap swapped;
+
+    std::unique_ptr<wfn_eng::vulkan::StagingRing> stagingRing;
+    std::unique_ptr<Uploads> uploads;
+
+    // The triangle's texture, from --texture or a generated checkerboard.
+    std::string texturePath;
+    std::unique_ptr<wfn_eng::texture::Textures> textures;
+    wfn_eng::vulkan::Handle<VkDescriptorPool> descriptorPool;
+    VkDescriptorSet material = VK_NULL_HANDLE;
+
+    // Only with --tilemap.
+    bool useTilemap = false;
+    std::unique_ptr<TileLayer> tiles;
+
+    // Only with --stream.
+    std::string streamPath;
+    std::unique_ptr<wfn_eng::asset::Pack> streamPack;
+    std::unique_ptr<wfn_eng::stream::Streamer> streamer;
+    wfn_eng::stream::Budget uploadBudget;
+    uint64_t streamedBytes = 0;
+
+    double initSeconds = 0;
+    double recordSeconds = 0;
 
     /////
     // GLFW
@@ -1022,7 +877,7 @@ private:
             .flags = 0
         };
 
-        window = new wfn_eng::sdl::Window(cfg);
+        window = std::make_unique<wfn_eng::sdl::Window>(cfg);
     }
 
     ////
@@ -1036,78 +891,609 @@ private:
         createInfo.pfnCallback = debugCallback;
 
         VkResult result;
-        if ((result = CreateDebugReportCallbackEXT(instance->instance, &createInfo, nullptr, &callback)) != VK_SUCCESS) {
+        if ((result = CreateDebugReportCallbackEXT(core->base().instance(), &createInfo, wfn_eng::vulkan::allocator::callbacks(), &callback)) != VK_SUCCESS) {
             std::cerr << "Debug callback status: " << result << std::endl;
             throw std::runtime_error("Failed to create debug callback.");
         }
     }
 
     void initVulkan() {
-        instance = new Instance(window->ref());
+        auto start = std::chrono::steady_clock::now();
+
+        core = std::make_unique<wfn_eng::vulkan::Core>(*window, enableValidationLayer);
         initDebug();
 
-        surface = new Surface(instance->instance, window->ref());
-        physical = new Physical(instance->instance, surface->surface);
-        logical = new Logical(physical->physical, surface->surface);
-        swapChain = new SwapChain(physical->physical, logical->device, surface->surface);
-        imageViews = new ImageViews(logical->device, swapChain);
-        graphicsPipeline = new GraphicsPipeline(logical->device, swapChain);
-        frameBuffers = new FrameBuffers(logical->device, swapChain, imageViews, graphicsPipeline);
-        commandBuffers = new CommandBuffers(logical->device, logical->family, swapChain, graphicsPipeline, frameBuffers);
-        semaphores = new Semaphores(logical->device);
+        VkDevice device = core->device().logical();
+        wfn_eng::vulkan::Swapchain& swapchain = core->swapchain();
+
+        layouts = std::make_unique<wfn_eng::vulkan::LayoutCache>(core->device());
+        pipelines = std::make_unique<wfn_eng::vulkan::PipelineManager>(core->device(), pipelineCachePath);
+        graphicsPipeline = std::make_unique<GraphicsPipeline>(device, swapchain, *pipelines, *layouts, shading);
+        swapchain.makeFrameBuffers(graphicsPipeline->renderPass.get());
+        frameSync = std::make_unique<FrameSync>(device);
+
+        stagingRing = std::make_unique<wfn_eng::vulkan::StagingRing>(core->device(), 16 * 1024 * 1024);
+        uploads = std::make_unique<Uploads>(core->device());
+        initTextures();
+
+        // The particles are drawn by the recorded command buffers.
+        if (useAsyncCompute) {
+            asyncCompute = std::make_unique<wfn_eng::vulkan::AsyncCompute>(core->device(), MAX_FRAMES_IN_FLIGHT);
+            particles = std::make_unique<Particles>(core->device(), *graphicsPipeline, *pipelines, *layouts, MAX_FRAMES_IN_FLIGHT);
+        }
+
+        commandBuffers = std::make_unique<CommandBuffers>(core->device(), swapchain, *graphicsPipeline, material, tiles.get(), particles.get());
+        recordSeconds = commandBuffers->recordSeconds;
+
+        // Every compiled shader, as CMakeLists.txt builds them.
+        if (useHotReload) {
+            hotReload = std::make_unique<wfn_eng::shaders::HotReload>(std::vector<wfn_eng::shaders::Source> {
+                { "vert.spv", "demo.vert", {} },
+                { "frag.spv", "demo.frag", {} },
+                { "frag_cutout.spv", "demo.frag", { "-DCUTOUT" } }
+            });
+        }
+
+        if (!streamPath.empty())
+            initStreaming();
+
+        initSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    ////
+    // initTextures
+    //
+    // Uploads the triangle's texture before anything is drawn, and writes
+    // the material that samples it. The material is bound by the recorded
+    // command buffers, so it has to be written before they're recorded.
+    void initTextures() {
+        VkDevice device = core->device().logical();
+        const wfn_eng::vulkan::DeviceTable& vk = core->device().table();
+
+        textures = std::make_unique<wfn_eng::texture::Textures>(core->device());
+
+        wfn_eng::texture::TextureId albedo;
+        if (!texturePath.empty()) {
+            std::ifstream in(texturePath, std::ios::binary);
+            if (!in)
+                throw std::runtime_error("Failed to open " + texturePath);
+            std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            albedo = textures->add(wfn_eng::texture::readKtx2(file.data(), file.size()));
+        } else {
+            albedo = textures->add(wfn_eng::texture::checkerboard(256, 8));
+        }
+
+        if (useTilemap)
+            initTilemap();
+
+        // Submitted on its own, ahead of the first frame, on the first
+        // frame's upload command buffer.
+        VkCommandBuffer cmd = uploads->commandBuffers[0];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vk.vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin recording texture uploads");
+        textures->upload(cmd, *stagingRing);
+        if (tiles != nullptr)
+            tiles->chunks->upload(cmd, *stagingRing);
+        if (vk.vkEndCommandBuffer(cmd) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record texture uploads");
+
+        const wfn_eng::texture::Texture *texture = textures->get(albedo);
+        if (texture == nullptr)
+            throw std::runtime_error("Texture is larger than the staging ring");
+
+        wfn_eng::vulkan::Submission submission;
+        submission.execute(cmd);
+        frameSync->submitted[0] = core->device().graphicsTimeline().submit(submission).value;
+        stagingRing->submit(frameSync->submitted[0]);
+
+        // The triangle's material, and one per atlas page of the tiles.
+        uint32_t materials = 1 + (tiles != nullptr ? static_cast<uint32_t>(tiles->pages.size()) : 0);
+
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = materials;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = materials;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+
+        VkDescriptorPool pool;
+        if (vk.vkCreateDescriptorPool(device, &poolInfo, wfn_eng::vulkan::allocator::callbacks(), &pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create descriptor pool");
+        descriptorPool = wfn_eng::vulkan::Handle<VkDescriptorPool>(device, pool);
+
+        // The set the shaders declare the texture in.
+        VkDescriptorSetLayout setLayout = layouts->layout({
+            &graphicsPipeline->vertReflection,
+            &graphicsPipeline->fragReflection
+        }).sets[0];
+
+        material = writeMaterial(setLayout, texture);
+
+        if (tiles != nullptr) {
+            for (wfn_eng::texture::TextureId page : tiles->pages) {
+                const wfn_eng::texture::Texture *pageTexture = textures->get(page);
+                if (pageTexture == nullptr)
+                    throw std::runtime_error("Atlas page is larger than the staging ring");
+                tiles->material.pages.push_back(writeMaterial(tiles->pipeline->layout.sets[0], pageTexture));
+            }
+        }
+    }
+
+    ////
+    // writeMaterial
+    //
+    // Allocates a material from the descriptor pool, and writes the
+    // texture it samples.
+    VkDescriptorSet writeMaterial(VkDescriptorSetLayout setLayout, const wfn_eng::texture::Texture *texture) {
+        VkDevice device = core->device().logical();
+        const wfn_eng::vulkan::DeviceTable& vk = core->device().table();
+
+        VkDescriptorSetAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = descriptorPool.get();
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &setLayout;
+
+        VkDescriptorSet set;
+        if (vk.vkAllocateDescriptorSets(device, &allocateInfo, &set) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate material");
+
+        VkDescriptorImageInfo imageInfo = {};
+        imageInfo.sampler = texture->sampler();
+        imageInfo.imageView = texture->view();
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &imageInfo;
+
+        vk.vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        return set;
+    }
+
+    ////
+    // initTilemap
+    //
+    // Packs a few solid tiles into an atlas in memory, adds its pages as
+    // textures, and lays out a map of them the size of the window, for
+    // the tile pipeline. Its chunks are uploaded along with the textures.
+    void initTilemap() {
+        const uint32_t tileTexels = 16;
+        const uint32_t width = WIDTH / tileTexels, height = HEIGHT / tileTexels;
+        static const uint8_t colors[][3] = {
+            { 70, 120, 60 }, { 90, 150, 70 }, { 140, 120, 80 }, { 60, 90, 140 }
+        };
+        const size_t kinds = sizeof(colors) / sizeof(colors[0]);
+
+        tiles = std::make_unique<TileLayer>();
+        tiles->pipeline = std::make_unique<TilePipeline>(core->device().logical(), *graphicsPipeline, *pipelines, *layouts);
+
+        wfn_eng::atlas::AtlasConfig config;
+        config.pageSize = 256;
+        wfn_eng::atlas::AtlasWriter writer(config);
+        for (size_t kind = 0; kind < kinds; kind++) {
+            std::vector<uint8_t> rgba(tileTexels * tileTexels * 4);
+            for (size_t texel = 0; texel < tileTexels * tileTexels; texel++) {
+                std::memcpy(&rgba[texel * 4], colors[kind], 3);
+                rgba[texel * 4 + 3] = 255;
+            }
+            writer.add("tiles/" + std::to_string(kind), "tiles", tileTexels, tileTexels, std::move(rgba));
+        }
+        writer.pack();
+        tiles->atlas = std::make_unique<wfn_eng::atlas::Atlas>(writer.table().data(), writer.table().size());
+
+        // The pages as they were packed: no mips or filtering to bleed
+        // one tile into the next.
+        wfn_eng::texture::SamplerKey nearest;
+        nearest.filter = VK_FILTER_NEAREST;
+        nearest.mipmap = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        nearest.address = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        for (const std::vector<uint8_t>& texels : writer.pages()) {
+            wfn_eng::texture::Image page;
+            page.format = VK_FORMAT_R8G8B8A8_UNORM;
+            page.width = tiles->atlas->pageWidth();
+            page.height = tiles->atlas->pageHeight();
+            page.levels.push_back(wfn_eng::texture::Level { 0, texels.size(), page.width, page.height });
+            page.data = texels;
+            tiles->pages.push_back(textures->add(std::move(page), nearest));
+        }
+
+        std::vector<wfn_eng::atlas::FrameId> tileset;
+        for (size_t kind = 0; kind < kinds; kind++)
+            tileset.push_back(tiles->atlas->find(wfn_eng::asset::id("tiles/" + std::to_string(kind))));
+
+        tiles->map = std::make_unique<wfn_eng::tilemap::Tilemap>(*tiles->atlas, tileset, width, height, (float)tileTexels, 16);
+        std::vector<wfn_eng::tilemap::TileId> cells((size_t)width * height);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++)
+                cells[(size_t)y * width + x] = static_cast<wfn_eng::tilemap::TileId>((x / 5 + y / 5) % kinds + 1);
+        }
+        tiles->map->fill(cells.data());
+        tiles->chunks = std::make_unique<wfn_eng::tilemap::ChunkBuffers>(core->device(), *tiles->map);
+
+        tiles->material.pipeline = tiles->pipeline->pipeline;
+        tiles->material.layout = tiles->pipeline->layout.layout;
+        tiles->material.layer = 0;
+        tiles->material.pipelineKey = 1;
+        tiles->camera = wfn_eng::cull::Rect { 0.0f, 0.0f, (float)WIDTH, (float)HEIGHT };
+    }
+
+    ////
+    // initStreaming
+    //
+    // Streams in every file under the streamed directory, or every asset
+    // of the streamed pack, in the background. Nothing draws with them
+    // yet, so each upload only counts its bytes; an asset records its
+    // copies out of the staged range here.
+    void initStreaming() {
+        streamer = std::make_unique<wfn_eng::stream::Streamer>();
+
+        if (std::filesystem::is_regular_file(streamPath)) {
+            streamPack = std::make_unique<wfn_eng::asset::Pack>(streamPath);
+            for (size_t i = 0; i < streamPack->count(); i++) {
+                wfn_eng::stream::Request request;
+                request.pack = streamPack.get();
+                request.asset = streamPack->entry(i).id;
+                request.priority = wfn_eng::stream::Priority::Background;
+                request.upload = [this](VkCommandBuffer, const wfn_eng::vulkan::Staged& staged) {
+                    streamedBytes += staged.size;
+                };
+                request.failed = [id = request.asset]() {
+                    std::cerr << "Failed to stream asset " << std::hex << id << std::dec << std::endl;
+                };
+
+                streamer->request(std::move(request));
+            }
+            return;
+        }
+
+        for (const auto& file : std::filesystem::recursive_directory_iterator(streamPath)) {
+            if (!file.is_regular_file())
+                continue;
+
+            wfn_eng::stream::Request request;
+            request.path = file.path().string();
+            request.priority = wfn_eng::stream::Priority::Background;
+            request.upload = [this](VkCommandBuffer, const wfn_eng::vulkan::Staged& staged) {
+                streamedBytes += staged.size;
+            };
+            request.failed = [path = request.path]() {
+                std::cerr << "Failed to stream " << path << std::endl;
+            };
+
+            streamer->request(std::move(request));
+        }
+    }
+
+    ////
+    // recordUploads
+    //
+    // Records the added textures that fit in the ring, then the frame's
+    // share of the streamed uploads, returning the command buffer to
+    // submit, or nothing if nothing was ready.
+    VkCommandBuffer recordUploads() {
+        bool streaming = streamer != nullptr && streamer->ready();
+        if (!textures->pending() && !streaming)
+            return VK_NULL_HANDLE;
+
+        const wfn_eng::vulkan::DeviceTable& vk = core->device().table();
+        VkCommandBuffer cmd = uploads->commandBuffers[currentFrame];
+
+        vk.vkResetCommandPool(core->device().logical(), uploads->pools[currentFrame].get(), 0);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vk.vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin recording uploads");
+
+        size_t recorded = textures->upload(cmd, *stagingRing);
+        if (streaming)
+            recorded += streamer->upload(cmd, *stagingRing, uploadBudget);
+
+        if (vk.vkEndCommandBuffer(cmd) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record uploads");
+
+        return recorded > 0 ? cmd : VK_NULL_HANDLE;
     }
 
     ////
     // Game Logic
     void drawFrame() {
+        // Wait until the GPU is done with the last submission from this
+        // slot, which also proves every earlier frame has completed.
+        VkDevice device = core->device().logical();
+        const wfn_eng::vulkan::DeviceTable& vk = core->device().table();
+        wfn_eng::vulkan::Timeline& timeline = core->device().graphicsTimeline();
+
+        timeline.wait(frameSync->submitted[currentFrame]);
+        deletionQueue.collect(frameSync->submitted[currentFrame]);
+        stagingRing->collect(frameSync->submitted[currentFrame]);
+
+        // Between frames is the one point the command buffers can change.
+        if (hotReload != nullptr)
+            updateHotReload();
+
+        // Transient per-frame data goes in the frame's arena, which is
+        // reset rather than freed.
+        frameArenas.begin(currentFrame);
+
         uint32_t imageIndex;
-        vkAcquireNextImageKHR(
-            logical->device,
-            swapChain->swapChain,
+        vk.vkAcquireNextImageKHR(
+            device,
+            core->swapchain().get(),
             std::numeric_limits<uint64_t>::max(),
-            semaphores->imageAvailable,
+            frameSync->imageAvailable[currentFrame].get(),
             VK_NULL_HANDLE,
             &imageIndex
         );
 
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        // The frame's particles are simulated on the compute queue, and
+        // handed to graphics, which waits for them at vertex input.
+        if (asyncCompute != nullptr) {
+            VkCommandBuffer computeCommands = asyncCompute->beginCompute(currentFrame);
+            particles->dispatch(computeCommands, vk, currentFrame);
+            asyncCompute->transfer(wfn_eng::vulkan::AsyncCompute::Queue::Compute, particles->transfer(currentFrame));
+            asyncCompute->submitCompute(currentFrame);
+        }
+
+        VkSemaphore renderFinished = frameSync->renderFinished[currentFrame].get();
+
+        VkCommandBuffer uploadCommands = recordUploads();
+
+        wfn_eng::vulkan::Submission submission;
+        if (asyncCompute != nullptr)
+            asyncCompute->beginGraphics(currentFrame, submission, 0);
 
-        VkSemaphore waitSemaphores[] = { semaphores->imageAvailable };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        if (uploadCommands != VK_NULL_HANDLE)
+            submission.execute(uploadCommands);
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers->commandBuffers[imageIndex];
+        submission
+            .wait(frameSync->imageAvailable[currentFrame].get(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT)
+            .execute(commandBuffers->get(imageIndex, currentFrame))
+            .signal(renderFinished);
 
-        VkSemaphore signalSemaphores[] = { semaphores->renderFinished };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        if (asyncCompute != nullptr)
+            asyncCompute->endGraphics(currentFrame, submission);
 
-        if (vkQueueSubmit(logical->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
-            throw std::runtime_error("Failed to submit queue");
+        frameSync->submitted[currentFrame] = timeline.submit(submission).value;
+
+        // The staged ranges are in use until this frame completes.
+        stagingRing->submit(frameSync->submitted[currentFrame]);
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &renderFinished;
 
-        VkSwapchainKHR swapchains[] = { swapChain->swapChain };
+        VkSwapchainKHR swapchains[] = { core->swapchain().get() };
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapchains;
         presentInfo.pImageIndices = &imageIndex;
         presentInfo.pResults = nullptr;
 
-        vkQueuePresentKHR(logical->presentQueue, &presentInfo);
+        vk.vkQueuePresentKHR(core->device().presentationQueue(), &presentInfo);
+
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    }
+
+    ////
+    // updateHotReload
+    //
+    // Reports the latency of a swapped in pipeline once its first frame is
+    // done, swaps in a rebuilt pipeline once it's ready, and otherwise
+    // starts rebuilding the pipeline if its shaders were reloaded. One
+    // rebuild runs at a time; later reloads wait in the watcher.
+    void updateHotReload() {
+        wfn_eng::vulkan::Timeline& timeline = core->device().graphicsTimeline();
+
+        if (swapped.shownValue != 0 && timeline.reached(swapped.shownValue)) {
+            uint64_t now = steadyNanos();
+            std::cout << "Hot reload: " << swapped.names << " on screen "
+                      << (now - swapped.editNanos) / 1000000.0 << "ms after saving (compile "
+                      << swapped.compileNanos / 1000000.0 << "ms, pipeline "
+                      << (swapped.swapNanos - swapped.requestNanos) / 1000000.0 << "ms)" << std::endl;
+            swapped = HotSwap();
+        }
+
+        if (compiling.id != wfn_eng::vulkan::noPipeline) {
+            if (pipelines->failed(compiling.id)) {
+                std::cerr << "Hot reload: " << compiling.names << " failed to build a pipeline" << std::endl;
+                pipelines->retire(compiling.id);
+                retireHotSwap(compiling);
+                compiling = HotSwap();
+            } else if (pipelines->ready(compiling.id)) {
+                swapIn();
+            }
+
+            return;
+        }
+
+        std::vector<wfn_eng::shaders::Reload> reloads = hotReload->take();
+        if (!reloads.empty())
+            rebuild(reloads);
+    }
+
+    ////
+    // rebuild
+    //
+    // Requests the pipeline with the reloaded shaders it uses (the latest
+    // build of each), falling back to the current one until it's compiled.
+    void rebuild(std::vector<wfn_eng::shaders::Reload>& reloads) {
+        wfn_eng::shaders::Reload *vert = nullptr;
+        wfn_eng::shaders::Reload *frag = nullptr;
+        for (wfn_eng::shaders::Reload& reload : reloads) {
+            if (reload.name == graphicsPipeline->vertName)
+                vert = &reload;
+            else if (reload.name == shading.fragName)
+                frag = &reload;
+        }
+
+        // Another permutation: nothing drawn uses it.
+        if (vert == nullptr && frag == nullptr)
+            return;
+
+        VkDevice device = core->device().logical();
+
+        HotSwap swap;
+        swap.key = graphicsPipeline->key;
+        swap.vertReflection = graphicsPipeline->vertReflection;
+        swap.fragReflection = graphicsPipeline->fragReflection;
+        swap.editNanos = std::numeric_limits<uint64_t>::max();
+
+        try {
+            for (wfn_eng::shaders::Reload *reload : { vert, frag }) {
+                if (reload == nullptr)
+                    continue;
+
+                wfn_eng::vulkan::Handle<VkShaderModule> module = graphicsPipeline->makeShader(device, reload->code);
+                wfn_eng::vulkan::shader::Reflection reflection =
+                    wfn_eng::vulkan::shader::reflect(reload->code.code(), reload->code.words());
+
+                if (reload == vert) {
+                    swap.key.vertex = module.get();
+                    swap.key.vertexLayout = wfn_eng::vulkan::VertexLayout::packed(reflection);
+                    swap.vertModule = std::move(module);
+                    swap.vertReflection = std::move(reflection);
+                } else {
+                    swap.key.fragment = module.get();
+                    swap.fragModule = std::move(module);
+                    swap.fragReflection = std::move(reflection);
+                }
+
+                swap.names += (swap.names.empty() ? "" : ", ") + reload->name;
+                swap.editNanos = std::min(swap.editNanos, reload->editNanos);
+                swap.compileNanos += reload->compileNanos;
+            }
+
+            swap.key.layout = layouts->layout({ &swap.vertReflection, &swap.fragReflection }).layout;
+        } catch (const wfn_eng::WfnError& e) {
+            std::cerr << "Hot reload: " << e.what() << std::endl;
+            retireHotSwap(swap);
+            return;
+        }
+
+        swap.requestNanos = steadyNanos();
+        swap.id = pipelines->request(swap.key, graphicsPipeline->pipelineId);
+        compiling = std::move(swap);
+    }
+
+    ////
+    // swapIn
+    //
+    // Draws with the rebuilt pipeline from the next frame on. The old
+    // pipeline, its replaced shaders and the command buffers recorded with
+    // it are still in use by the frames in flight, so they go to the
+    // deletion queue.
+    void swapIn() {
+        uint64_t retireValue = core->device().graphicsTimeline().next().value;
+        GraphicsPipeline& graphics = *graphicsPipeline;
+
+        deletionQueue.push(retireValue, pipelines->retire(graphics.pipelineId));
+        if (compiling.vertModule) {
+            deletionQueue.push(retireValue, std::move(graphics.vertModule));
+            graphics.vertModule = std::move(compiling.vertModule);
+        }
+        if (compiling.fragModule) {
+            deletionQueue.push(retireValue, std::move(graphics.fragModule));
+            graphics.fragModule = std::move(compiling.fragModule);
+        }
+
+        graphics.pipelineId = compiling.id;
+        graphics.pipeline = pipelines->get(compiling.id);
+        graphics.pipelineLayout = compiling.key.layout;
+        graphics.key = compiling.key;
+        graphics.vertReflection = std::move(compiling.vertReflection);
+        graphics.fragReflection = std::move(compiling.fragReflection);
+
+        CommandBuffers *old = commandBuffers.release();
+        retire([old]() { delete old; });
+        commandBuffers = std::make_unique<CommandBuffers>(core->device(), core->swapchain(), graphics, material, tiles.get(), particles.get());
+
+        compiling.swapNanos = steadyNanos();
+        compiling.shownValue = retireValue;
+        swapped = std::move(compiling);
+        compiling = HotSwap();
+    }
+
+    ////
+    // retireHotSwap
+    //
+    // Hands the shaders of an abandoned rebuild to the deletion queue.
+    void retireHotSwap(HotSwap& swap) {
+        uint64_t retireValue = core->device().graphicsTimeline().next().value;
+        if (swap.vertModule)
+            deletionQueue.push(retireValue, std::move(swap.vertModule));
+        if (swap.fragModule)
+            deletionQueue.push(retireValue, std::move(swap.fragModule));
+    }
+
+    ////
+    // retire
+    //
+    // Hands a resource to the deletion queue instead of destroying it on the
+    // spot. It may still be used by the frame being recorded, so it is kept
+    // until the next submission completes.
+    void retire(wfn_eng::vulkan::DeletionQueue::Destroy destroy) {
+        deletionQueue.push(core->device().graphicsTimeline().next().value, std::move(destroy));
+    }
+
+    ////
+    // waitForFrames
+    //
+    // Waits for the graphics timeline to reach its last submission, then
+    // destroys everything the frames in flight were holding on to.
+    void waitForFrames() {
+        wfn_eng::vulkan::Timeline& timeline = core->device().graphicsTimeline();
+        timeline.waitIdle();
+        deletionQueue.collect(timeline.submitted());
+    }
+
+    ////
+    // tick
+    //
+    // Samples the input of every player and advances the simulation by a
+    // single fixed step, recording the input if requested.
+    void tick() {
+        const Uint8 *keys = SDL_GetKeyboardState(nullptr);
+
+        wfn_eng::rollback::Input inputs[wfn_eng::sim::players];
+        for (size_t p = 0; p < wfn_eng::sim::players; p++)
+            inputs[p] = wfn_eng::input::sample(keys, p);
+
+        if (recorder != nullptr)
+            recorder->record(inputs);
+
+        world.step(inputs);
     }
 
     void mainLoop() {
         bool quit = false;
         SDL_Event event;
 
+        const uint64_t tickLength = SDL_GetPerformanceFrequency() / wfn_eng::sim::tickRate;
+        uint64_t previous = SDL_GetPerformanceCounter();
+        uint64_t accumulator = 0;
+
+        uint64_t frames = 0;
+        uint64_t steadyAllocations = 0;
+
         while (true) {
+            uint64_t allocationsBefore = wfn_eng::memory::heapAllocations();
+
             while (SDL_PollEvent(&event)) {
                 if (event.type == SDL_QUIT)
                     quit = true;
@@ -1116,48 +1502,342 @@ private:
             if (quit == true)
                 break;
 
+            uint64_t now = SDL_GetPerformanceCounter();
+            accumulator += now - previous;
+            previous = now;
+
+            if (accumulator > tickLength * MAX_TICKS_PER_FRAME)
+                accumulator = tickLength * MAX_TICKS_PER_FRAME;
+
+            while (accumulator >= tickLength) {
+                tick();
+                accumulator -= tickLength;
+            }
+
             drawFrame();
+
+            if (++frames > WARMUP_FRAMES)
+                steadyAllocations += wfn_eng::memory::heapAllocations() - allocationsBefore;
+
             SDL_Delay(16);
         }
 
-        vkDeviceWaitIdle(logical->device);
+#ifdef DEBUG
+        std::cout << "Heap allocations in steady-state frames: " << steadyAllocations << std::endl;
+#endif
+
+        waitForFrames();
     }
 
     ////
     // Cleaning Up
     void cleanup() {
-        delete semaphores;
-        delete commandBuffers;
-        delete frameBuffers;
-        delete graphicsPipeline;
-        delete swapChain;
-        delete surface;
-        delete logical;
-        delete physical;
+        if (recorder != nullptr)
+            recorder->close();
+        recorder.reset();
+
+        // The timeline only covers the submissions; the presentation engine
+        // may still hold the last frame's semaphores, and nothing else will
+        // ever be submitted, so teardown is the one place an idle wait
+        // belongs.
+        vkDeviceWaitIdle(core->device().logical());
+        deletionQueue.flush();
+
+#ifdef DEBUG
+        const wfn_eng::vulkan::DeletionStats& deletion = deletionQueue.stats();
+        std::cout << "Deletion queue: " << deletion.destroyed << " destroyed, max length "
+                  << deletion.maxLength << ", max latency " << deletion.maxLatencyCollects
+                  << " frames / " << deletion.maxLatencyNanos / 1000 << "us" << std::endl;
+#endif
+
+#ifdef DEBUG
+        if (asyncCompute != nullptr)
+            asyncCompute->report(std::cout);
+        commandBuffers->renderQueue.report(std::cout);
+        pipelines->report(std::cout);
+        layouts->report(std::cout);
+        if (hotReload != nullptr)
+            hotReload->report(std::cout);
+        if (streamer != nullptr) {
+            streamer->report(std::cout);
+            std::cout << "Streamed " << streamedBytes << " bytes, " << streamer->pending()
+                      << " assets still pending" << std::endl;
+        }
+        textures->report(std::cout);
+        if (tiles != nullptr)
+            tiles->chunks->report(std::cout);
+        std::cout << "Shaders: " << wfn_eng::shaders::fileLoads() << " read from "
+                  << wfn_eng::shaders::directory() << std::endl;
+#endif
+
+        asyncCompute.reset();
+        hotReload.reset();
+
+        // The I/O threads first, so nothing is left half read, and nothing
+        // streams into a texture that's gone.
+        streamer.reset();
+        streamPack.reset();
+        textures.reset();
+        uploads.reset();
+        stagingRing.reset();
+        frameSync.reset();
+        commandBuffers.reset();
+        pipelines.reset();
+
+        // After the manager, which may still be compiling from them.
+        compiling = HotSwap();
+        tiles.reset();
+        particles.reset();
+        graphicsPipeline.reset();
+
+        // Frees the material along with the pool, before its layout.
+        descriptorPool.reset();
+        layouts.reset();
 
         if (enableValidationLayer)
-            DestroyDebugReportCallbackEXT(instance->instance, callback, nullptr);
-        delete instance;
+            DestroyDebugReportCallbackEXT(core->base().instance(), callback, wfn_eng::vulkan::allocator::callbacks());
+        core.reset();
+
+        window.reset();
 
-        delete window;
+#ifdef DEBUG
+        std::cout << "Vulkan init: " << initSeconds * 1000 << "ms" << std::endl;
+        std::cout << "Command recording: " << recordSeconds * 1000000 << "us ("
+                  << (wfn_eng::vulkan::dispatch::mode() == wfn_eng::vulkan::dispatch::Mode::Device ? "device" : "loader")
+                  << " dispatch)" << std::endl;
+        wfn_eng::vulkan::allocator::report(std::cout);
+#endif
     }
 
 public:
+    ////
+    // enableAsyncCompute
+    //
+    // Schedules compute work on the compute queue every frame, reporting
+    // how much of it overlapped graphics on exit.
+    void enableAsyncCompute() {
+        useAsyncCompute = true;
+    }
+
+    ////
+    // enableHotReload
+    //
+    // Recompiles shaders whenever their sources are saved, and swaps the
+    // pipelines built from them while running.
+    void enableHotReload() {
+        useHotReload = true;
+    }
+
+    ////
+    // streamDirectory
+    //
+    // Streams in every file under a directory (or every asset of a pack)
+    // in the background, uploading them a frame's budget at a time.
+    void streamDirectory(const std::string& path) {
+        streamPath = path;
+    }
+
+    ////
+    // enableTilemap
+    //
+    // Draws a small tilemap behind the triangle, through the tile
+    // pipeline.
+    void enableTilemap() {
+        useTilemap = true;
+    }
+
+    ////
+    // useTexture
+    //
+    // Draws the triangle with a KTX2 texture instead of the generated
+    // checkerboard.
+    void useTexture(const std::string& path) {
+        texturePath = path;
+    }
+
+    ////
+    // usePipelineCache
+    //
+    // Loads the pipeline cache from a file, and saves it back on exit.
+    void usePipelineCache(const std::string& path) {
+        pipelineCachePath = path;
+    }
+
+    ////
+    // useShading
+    //
+    // Picks the triangle's fragment shader permutation by name.
+    void useShading(const std::string& name) {
+        if (name == "plain")
+            shading = Shading::of<PlainShading>();
+        else if (name == "grayscale")
+            shading = Shading::of<GrayscaleShading>();
+        else if (name == "sepia")
+            shading = Shading::of<SepiaShading>();
+        else if (name == "cutout")
+            shading = Shading::of<CutoutShading>();
+        else
+            throw std::runtime_error("Unknown shading: " + name);
+    }
+
+    ////
+    // record
+    //
+    // Records the input of every tick of the next run to a file.
+    void record(const std::string& path) {
+        recorder = std::make_unique<wfn_eng::input::Recorder>(
+            path,
+            wfn_eng::sim::players,
+            wfn_eng::sim::tickRate
+        );
+    }
+
     void run() {
         initWindow();
         initVulkan();
         mainLoop();
         cleanup();
     }
+
+    ////
+    // replay
+    //
+    // Feeds a recording through the simulation as fast as possible, without
+    // a window or any rendering, and reports the simulation throughput.
+    void replay(const std::string& path) {
+        wfn_eng::input::Replay replay(path);
+        if (replay.players() != wfn_eng::sim::players)
+            throw std::runtime_error("Recording has the wrong number of players");
+
+        wfn_eng::rollback::Input inputs[wfn_eng::sim::players];
+        uint64_t ticks = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        while (replay.next(inputs)) {
+            world.step(inputs);
+            ticks++;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "Replayed " << ticks << " ticks in " << elapsed.count() << "s ("
+                  << ticks / elapsed.count() << " ticks/s)" << std::endl;
+        std::cout << "Final state checksum: " << std::hex << world.checksum() << std::dec << std::endl;
+    }
 };
 
-int main() {
+////
+// usage
+//
+// Prints the provided error, if any, and how to run the demo. Returns the
+// exit code for it.
+static int usage(const char *program, const std::string& error) {
+    std::ostream& out = error.empty() ? std::cout : std::cerr;
+    if (!error.empty())
+        out << error << std::endl;
+
+    out << "Usage: " << program << " [--record <file>] [--replay <file>] [--vk-allocator tracking|system]" << std::endl
+        << "        [--vk-dispatch device|loader] [--async-compute] [--hot-reload] [--tilemap]" << std::endl
+        << "        [--vk-pipeline-cache <file>] [--shading plain|grayscale|sepia|cutout]" << std::endl
+        << "        [--stream <directory|pack>] [--texture <file.ktx2>]" << std::endl;
+    return error.empty() ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    std::string recordPath;
+    std::string replayPath;
+    std::string pipelineCachePath;
+    std::string shading;
+    std::string streamPath;
+    std::string texturePath;
+    bool asyncCompute = false;
+    bool hotReload = false;
+    bool tilemap = false;
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+
+        // Switches, which take no value.
+        if (flag == "--help" || flag == "-h")
+            return usage(argv[0], "");
+        if (flag == "--async-compute") {
+            asyncCompute = true;
+            continue;
+        }
+        if (flag == "--hot-reload") {
+            hotReload = true;
+            continue;
+        }
+        if (flag == "--tilemap") {
+            tilemap = true;
+            continue;
+        }
+
+        if (flag.compare(0, 2, "--") != 0)
+            return usage(argv[0], "Unexpected argument: " + flag);
+        if (flag != "--record" && flag != "--replay" && flag != "--vk-allocator" && flag != "--vk-dispatch" &&
+            flag != "--vk-pipeline-cache" && flag != "--shading" && flag != "--stream" && flag != "--texture")
+            return usage(argv[0], "Unknown flag: " + flag);
+        if (i + 1 == argc)
+            return usage(argv[0], flag + " needs a value");
+
+        std::string value = argv[++i];
+        if (flag == "--record")
+            recordPath = value;
+        else if (flag == "--replay")
+            replayPath = value;
+        else if (flag == "--vk-pipeline-cache")
+            pipelineCachePath = value;
+        else if (flag == "--stream")
+            streamPath = value;
+        else if (flag == "--texture")
+            texturePath = value;
+        else if (flag == "--vk-allocator" && value == "tracking")
+            wfn_eng::vulkan::allocator::enable();
+        else if (flag == "--vk-dispatch" && value == "loader")
+            wfn_eng::vulkan::dispatch::setMode(wfn_eng::vulkan::dispatch::Mode::Loader);
+        else if (flag == "--shading" && (value == "plain" || value == "grayscale" || value == "sepia" || value == "cutout"))
+            shading = value;
+        else if (!(flag == "--vk-allocator" && value == "system") && !(flag == "--vk-dispatch" && value == "device"))
+            return usage(argv[0], "Unknown value for " + flag + ": " + value);
+    }
+
     HelloTriangleApplication app;
     try {
+        if (!replayPath.empty()) {
+            app.replay(replayPath);
+            return 0;
+        }
+
+        if (!recordPath.empty())
+            app.record(recordPath);
+
+        if (asyncCompute)
+            app.enableAsyncCompute();
+
+        if (hotReload)
+            app.enableHotReload();
+
+        if (tilemap)
+            app.enableTilemap();
+
+        if (!pipelineCachePath.empty())
+            app.usePipelineCache(pipelineCachePath);
+
+        if (!shading.empty())
+            app.useShading(shading);
+
+        if (!streamPath.empty())
+            app.streamDirectory(streamPath);
+
+        if (!texturePath.empty())
+            app.useTexture(texturePath);
+
         app.run();
     } catch (const std::runtime_error& e) {
         std::cerr << e.what() << std::endl;
         return 1;
+    } catch (const wfn_eng::WfnError& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
 
     return 0;
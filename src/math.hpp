@@ -0,0 +1,210 @@
+#ifndef __WFN_ENG_MATH_HPP__
+#define __WFN_ENG_MATH_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::math {
+    ////
+    // enum class Isa
+    //
+    // An instruction set the kernels are built for. SSE2 processes four
+    // transforms at a time and AVX2 (with FMA) eight; both are x86 only.
+    enum class Isa {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    ////
+    // const char *name(Isa)
+    //
+    // The name of an instruction set.
+    const char *name(Isa);
+
+    ////
+    // bool supported(Isa)
+    //
+    // Whether the kernels of an instruction set are built in and the CPU
+    // runs them.
+    bool supported(Isa);
+
+    ////
+    // void setIsa(Isa)
+    //
+    // Chooses the kernels the batch functions call, throwing if they
+    // aren't supported. By default, the best supported ones are picked the
+    // first time a batch function is called.
+    void setIsa(Isa);
+
+    ////
+    // Isa isa()
+    //
+    // The instruction set the batch functions use.
+    Isa isa();
+
+    ////
+    // struct Affine2
+    //
+    // A view of 2D affine transforms as structure-of-arrays: m[0..1] is the
+    // x axis, m[2..3] the y axis and m[4..5] the translation, as the
+    // columns of glm's mat3 (without the last row, always 0 0 1).
+    struct Affine2 {
+        float *m[6];
+    };
+
+    ////
+    // struct Affine3
+    //
+    // A view of 3D affine transforms as structure-of-arrays: m[0..8] is the
+    // 3x3 part, column by column, and m[9..11] the translation, as the
+    // columns of glm's mat4 (without the last row, always 0 0 0 1).
+    struct Affine3 {
+        float *m[12];
+    };
+
+    ////
+    // struct Trs3
+    //
+    // A view of 3D transforms as translation, unit quaternion rotation
+    // (x, y, z, w) and scale, as structure-of-arrays.
+    struct Trs3 {
+        float *t[3];
+        float *r[4];
+        float *s[3];
+    };
+
+    ////
+    // struct Aabb3
+    //
+    // A view of axis-aligned boxes as structure-of-arrays.
+    struct Aabb3 {
+        float *min[3];
+        float *max[3];
+    };
+
+    ////
+    // class Columns
+    //
+    // Owns the arrays behind a view: a number of columns of the same
+    // number of floats.
+    class Columns {
+        std::vector<float> _data;
+        size_t _columns;
+        size_t _count;
+
+    public:
+        ////
+        // Columns(size_t, size_t)
+        //
+        // Allocates the provided number of columns of the provided number
+        // of floats, zeroed.
+        Columns(size_t, size_t);
+
+        ////
+        // float *column(size_t)
+        //
+        // The floats of a column.
+        float *column(size_t);
+
+        ////
+        // size_t columns()
+        //
+        // The number of columns.
+        size_t columns() const;
+
+        ////
+        // size_t count()
+        //
+        // The number of floats in each column.
+        size_t count() const;
+
+        ////
+        // Affine2 affine2() / Affine3 affine3() / Trs3 trs3() / Aabb3 aabb3()
+        //
+        // Views of the columns, throwing if there aren't as many as the view
+        // needs (6, 12, 10 and 6).
+        Affine2 affine2();
+        Affine3 affine3();
+        Trs3 trs3();
+        Aabb3 aabb3();
+    };
+
+    ////
+    // Affine2 offset(const Affine2&, size_t) / Affine3 / Trs3 / Aabb3
+    //
+    // A view of the same arrays, starting the provided number of transforms
+    // in (e.g. to split a batch between threads).
+    Affine2 offset(const Affine2&, size_t);
+    Affine3 offset(const Affine3&, size_t);
+    Trs3 offset(const Trs3&, size_t);
+    Aabb3 offset(const Aabb3&, size_t);
+
+    ////
+    // struct Kernels
+    //
+    // The kernels of a single instruction set. Each one processes the
+    // provided number of transforms; outputs may not alias inputs.
+    struct Kernels {
+        void (*compose2)(const Affine2&, const Affine2&, const Affine2&, size_t);
+        void (*compose3)(const Affine3&, const Affine3&, const Affine3&, size_t);
+        void (*model)(const Trs3&, const Affine3&, size_t);
+        void (*bounds)(const Affine3&, const Aabb3&, const Aabb3&, size_t);
+    };
+
+    ////
+    // const Kernels *kernels(Isa)
+    //
+    // The kernels of an instruction set, or nullptr if they aren't
+    // supported.
+    const Kernels *kernels(Isa);
+
+    ////
+    // const Kernels *scalarKernels() / sse2Kernels() / avx2Kernels()
+    //
+    // The kernels of each instruction set, or nullptr when they aren't
+    // built in (whether or not the CPU runs them). The SIMD kernels hand
+    // their last few transforms to the scalar ones.
+    const Kernels *scalarKernels();
+    const Kernels *sse2Kernels();
+    const Kernels *avx2Kernels();
+
+    ////
+    // void compose(const Affine2&, const Affine2&, const Affine2&, size_t)
+    //
+    // Composes 2D transforms: out = parent * local, as with glm.
+    void compose(const Affine2&, const Affine2&, const Affine2&, size_t);
+
+    ////
+    // void compose(const Affine3&, const Affine3&, const Affine3&, size_t)
+    //
+    // Composes 3D transforms: out = parent * local, as with glm.
+    void compose(const Affine3&, const Affine3&, const Affine3&, size_t);
+
+    ////
+    // void model(const Trs3&, const Affine3&, size_t)
+    //
+    // Builds model matrices: translate * rotate * scale.
+    void model(const Trs3&, const Affine3&, size_t);
+
+    ////
+    // void bounds(const Affine3&, const Aabb3&, const Aabb3&, size_t)
+    //
+    // Transforms local boxes into the world boxes that bound them (the
+    // transformed center, and the extents through the absolute matrix).
+    void bounds(const Affine3&, const Aabb3&, const Aabb3&, size_t);
+
+    ////
+    // float check(Isa, size_t)
+    //
+    // Runs every kernel of an instruction set on the provided number of
+    // random transforms and returns the largest difference from glm,
+    // relative to the magnitude of the result.
+    float check(Isa, size_t);
+}
+
+#endif
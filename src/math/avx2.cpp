@@ -0,0 +1,177 @@
+#include "../math.hpp"
+
+// Built with -mavx2 -mfma (see CMakeLists.txt); only called once the CPU is
+// known to run it, so nothing in here may be shared with the rest of the
+// engine (no inline functions from headers, which the linker could pick).
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+////
+// void compose2(const Affine2&, const Affine2&, const Affine2&, size_t)
+//
+// out = parent * local, eight transforms at a time.
+static void compose2(
+        const wfn_eng::math::Affine2& parent,
+        const wfn_eng::math::Affine2& local,
+        const wfn_eng::math::Affine2& out,
+        size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 p0 = _mm256_loadu_ps(parent.m[0] + i), p1 = _mm256_loadu_ps(parent.m[1] + i);
+        __m256 p2 = _mm256_loadu_ps(parent.m[2] + i), p3 = _mm256_loadu_ps(parent.m[3] + i);
+        __m256 l0 = _mm256_loadu_ps(local.m[0] + i), l1 = _mm256_loadu_ps(local.m[1] + i);
+        __m256 l2 = _mm256_loadu_ps(local.m[2] + i), l3 = _mm256_loadu_ps(local.m[3] + i);
+        __m256 l4 = _mm256_loadu_ps(local.m[4] + i), l5 = _mm256_loadu_ps(local.m[5] + i);
+
+        _mm256_storeu_ps(out.m[0] + i, _mm256_fmadd_ps(p2, l1, _mm256_mul_ps(p0, l0)));
+        _mm256_storeu_ps(out.m[1] + i, _mm256_fmadd_ps(p3, l1, _mm256_mul_ps(p1, l0)));
+        _mm256_storeu_ps(out.m[2] + i, _mm256_fmadd_ps(p2, l3, _mm256_mul_ps(p0, l2)));
+        _mm256_storeu_ps(out.m[3] + i, _mm256_fmadd_ps(p3, l3, _mm256_mul_ps(p1, l2)));
+        _mm256_storeu_ps(out.m[4] + i, _mm256_fmadd_ps(p2, l5, _mm256_fmadd_ps(p0, l4, _mm256_loadu_ps(parent.m[4] + i))));
+        _mm256_storeu_ps(out.m[5] + i, _mm256_fmadd_ps(p3, l5, _mm256_fmadd_ps(p1, l4, _mm256_loadu_ps(parent.m[5] + i))));
+    }
+
+    wfn_eng::math::scalarKernels()->compose2(
+        wfn_eng::math::offset(parent, i),
+        wfn_eng::math::offset(local, i),
+        wfn_eng::math::offset(out, i),
+        count - i
+    );
+}
+
+////
+// void compose3(const Affine3&, const Affine3&, const Affine3&, size_t)
+//
+// out = parent * local, eight transforms at a time.
+static void compose3(
+        const wfn_eng::math::Affine3& parent,
+        const wfn_eng::math::Affine3& local,
+        const wfn_eng::math::Affine3& out,
+        size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 p[12];
+        for (int k = 0; k < 12; k++)
+            p[k] = _mm256_loadu_ps(parent.m[k] + i);
+
+        for (int c = 0; c < 4; c++) {
+            __m256 x = _mm256_loadu_ps(local.m[c * 3] + i);
+            __m256 y = _mm256_loadu_ps(local.m[c * 3 + 1] + i);
+            __m256 z = _mm256_loadu_ps(local.m[c * 3 + 2] + i);
+
+            for (int r = 0; r < 3; r++) {
+                __m256 value = c == 3 ? _mm256_fmadd_ps(p[r], x, p[9 + r]) : _mm256_mul_ps(p[r], x);
+                value = _mm256_fmadd_ps(p[3 + r], y, value);
+                _mm256_storeu_ps(out.m[c * 3 + r] + i, _mm256_fmadd_ps(p[6 + r], z, value));
+            }
+        }
+    }
+
+    wfn_eng::math::scalarKernels()->compose3(
+        wfn_eng::math::offset(parent, i),
+        wfn_eng::math::offset(local, i),
+        wfn_eng::math::offset(out, i),
+        count - i
+    );
+}
+
+////
+// void model(const Trs3&, const Affine3&, size_t)
+//
+// translate * rotate * scale, eight transforms at a time.
+static void model(const wfn_eng::math::Trs3& trs, const wfn_eng::math::Affine3& out, size_t count) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(trs.r[0] + i), y = _mm256_loadu_ps(trs.r[1] + i);
+        __m256 z = _mm256_loadu_ps(trs.r[2] + i), w = _mm256_loadu_ps(trs.r[3] + i);
+        __m256 sx = _mm256_loadu_ps(trs.s[0] + i), sy = _mm256_loadu_ps(trs.s[1] + i);
+        __m256 sz = _mm256_loadu_ps(trs.s[2] + i);
+
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        _mm256_storeu_ps(out.m[0] + i, _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx));
+        _mm256_storeu_ps(out.m[1] + i, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx));
+        _mm256_storeu_ps(out.m[2] + i, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx));
+        _mm256_storeu_ps(out.m[3] + i, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy));
+        _mm256_storeu_ps(out.m[4] + i, _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy));
+        _mm256_storeu_ps(out.m[5] + i, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy));
+        _mm256_storeu_ps(out.m[6] + i, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz));
+        _mm256_storeu_ps(out.m[7] + i, _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz));
+        _mm256_storeu_ps(out.m[8] + i, _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz));
+        _mm256_storeu_ps(out.m[9] + i, _mm256_loadu_ps(trs.t[0] + i));
+        _mm256_storeu_ps(out.m[10] + i, _mm256_loadu_ps(trs.t[1] + i));
+        _mm256_storeu_ps(out.m[11] + i, _mm256_loadu_ps(trs.t[2] + i));
+    }
+
+    wfn_eng::math::scalarKernels()->model(
+        wfn_eng::math::offset(trs, i),
+        wfn_eng::math::offset(out, i),
+        count - i
+    );
+}
+
+////
+// void bounds(const Affine3&, const Aabb3&, const Aabb3&, size_t)
+//
+// Arvo's method, eight boxes at a time.
+static void bounds(
+        const wfn_eng::math::Affine3& transform,
+        const wfn_eng::math::Aabb3& local,
+        const wfn_eng::math::Aabb3& world,
+        size_t count) {
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 center[3], extent[3];
+        for (int k = 0; k < 3; k++) {
+            __m256 min = _mm256_loadu_ps(local.min[k] + i);
+            __m256 max = _mm256_loadu_ps(local.max[k] + i);
+            center[k] = _mm256_mul_ps(_mm256_add_ps(min, max), half);
+            extent[k] = _mm256_mul_ps(_mm256_sub_ps(max, min), half);
+        }
+
+        for (int r = 0; r < 3; r++) {
+            __m256 c = _mm256_loadu_ps(transform.m[9 + r] + i);
+            __m256 e = _mm256_setzero_ps();
+            for (int k = 0; k < 3; k++) {
+                __m256 m = _mm256_loadu_ps(transform.m[k * 3 + r] + i);
+                c = _mm256_fmadd_ps(m, center[k], c);
+                e = _mm256_fmadd_ps(_mm256_andnot_ps(sign, m), extent[k], e);
+            }
+
+            _mm256_storeu_ps(world.min[r] + i, _mm256_sub_ps(c, e));
+            _mm256_storeu_ps(world.max[r] + i, _mm256_add_ps(c, e));
+        }
+    }
+
+    wfn_eng::math::scalarKernels()->bounds(
+        wfn_eng::math::offset(transform, i),
+        wfn_eng::math::offset(local, i),
+        wfn_eng::math::offset(world, i),
+        count - i
+    );
+}
+#endif
+
+namespace wfn_eng::math {
+    ////
+    // const Kernels *avx2Kernels()
+    //
+    // The AVX2 kernels, built in when this file is compiled for AVX2 and
+    // FMA.
+    const Kernels *avx2Kernels() {
+#if defined(__AVX2__) && defined(__FMA__)
+        static const Kernels kernels = { ::compose2, ::compose3, ::model, ::bounds };
+        return &kernels;
+#else
+        return nullptr;
+#endif
+    }
+}
@@ -0,0 +1,162 @@
+#include "../math.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+////
+// void difference(float&, float, float)
+//
+// Keeps the largest difference between a result and glm's, relative to
+// glm's (or absolute, below 1).
+static void difference(float& largest, float value, float reference) {
+    float error = std::fabs(value - reference) / std::max(1.0f, std::fabs(reference));
+    largest = std::max(largest, error);
+}
+
+////
+// glm::mat3 affine2(const Affine2&, size_t)
+//
+// A 2D transform of a view, as glm's mat3.
+static glm::mat3 affine2(const wfn_eng::math::Affine2& view, size_t i) {
+    return glm::mat3(
+        view.m[0][i], view.m[1][i], 0.0f,
+        view.m[2][i], view.m[3][i], 0.0f,
+        view.m[4][i], view.m[5][i], 1.0f
+    );
+}
+
+////
+// glm::mat4 affine3(const Affine3&, size_t)
+//
+// A 3D transform of a view, as glm's mat4.
+static glm::mat4 affine3(const wfn_eng::math::Affine3& view, size_t i) {
+    glm::mat4 matrix(1.0f);
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 3; r++)
+            matrix[c][r] = view.m[c * 3 + r][i];
+    }
+    return matrix;
+}
+
+namespace wfn_eng::math {
+    ////
+    // float check(Isa, size_t)
+    //
+    // Runs every kernel of an instruction set on random transforms, and
+    // compares the results with glm's, transform by transform. The count
+    // needn't be a multiple of the SIMD width: the tail is checked too.
+    float check(Isa isa, size_t count) {
+        const Kernels *checked = kernels(isa);
+        if (checked == nullptr)
+            throw WfnError("wfn_eng::math", "check", std::string("Run ") + name(isa) + " kernels");
+
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> value(-4.0f, 4.0f);
+        std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+
+        Columns parents(12, count), locals(12, count), outputs(12, count);
+        Columns trsColumns(10, count), localBoxes(6, count), worldBoxes(6, count);
+
+        for (Columns *columns : { &parents, &locals, &localBoxes }) {
+            for (size_t k = 0; k < columns->columns(); k++) {
+                for (size_t i = 0; i < count; i++)
+                    columns->column(k)[i] = value(rng);
+            }
+        }
+
+        Trs3 trs = trsColumns.trs3();
+        Aabb3 local = localBoxes.aabb3();
+        for (size_t i = 0; i < count; i++) {
+            glm::quat rotation = glm::normalize(glm::quat(value(rng), value(rng), value(rng), value(rng)));
+            trs.r[0][i] = rotation.x;
+            trs.r[1][i] = rotation.y;
+            trs.r[2][i] = rotation.z;
+            trs.r[3][i] = rotation.w;
+
+            for (int k = 0; k < 3; k++) {
+                trs.t[k][i] = value(rng);
+                trs.s[k][i] = scale(rng);
+
+                if (local.min[k][i] > local.max[k][i])
+                    std::swap(local.min[k][i], local.max[k][i]);
+            }
+        }
+
+        float largest = 0.0f;
+
+        // 2D composition.
+        {
+            Affine2 parent = parents.affine2(), child = locals.affine2(), out = outputs.affine2();
+            checked->compose2(parent, child, out, count);
+
+            for (size_t i = 0; i < count; i++) {
+                glm::mat3 reference = affine2(parent, i) * affine2(child, i);
+                for (int c = 0; c < 3; c++) {
+                    for (int r = 0; r < 2; r++)
+                        difference(largest, out.m[c * 2 + r][i], reference[c][r]);
+                }
+            }
+        }
+
+        // 3D composition.
+        {
+            Affine3 parent = parents.affine3(), child = locals.affine3(), out = outputs.affine3();
+            checked->compose3(parent, child, out, count);
+
+            for (size_t i = 0; i < count; i++) {
+                glm::mat4 reference = affine3(parent, i) * affine3(child, i);
+                for (int c = 0; c < 4; c++) {
+                    for (int r = 0; r < 3; r++)
+                        difference(largest, out.m[c * 3 + r][i], reference[c][r]);
+                }
+            }
+        }
+
+        // Model matrices, then the bounds of boxes through them.
+        {
+            Affine3 out = outputs.affine3();
+            Aabb3 world = worldBoxes.aabb3();
+            checked->model(trs, out, count);
+            checked->bounds(out, local, world, count);
+
+            for (size_t i = 0; i < count; i++) {
+                glm::quat rotation(trs.r[3][i], trs.r[0][i], trs.r[1][i], trs.r[2][i]);
+                glm::mat4 reference =
+                    glm::translate(glm::mat4(1.0f), glm::vec3(trs.t[0][i], trs.t[1][i], trs.t[2][i])) *
+                    glm::mat4_cast(rotation) *
+                    glm::scale(glm::mat4(1.0f), glm::vec3(trs.s[0][i], trs.s[1][i], trs.s[2][i]));
+
+                for (int c = 0; c < 4; c++) {
+                    for (int r = 0; r < 3; r++)
+                        difference(largest, out.m[c * 3 + r][i], reference[c][r]);
+                }
+
+                // The bounds of the eight corners, through glm's matrix.
+                glm::vec3 min(INFINITY), max(-INFINITY);
+                for (int corner = 0; corner < 8; corner++) {
+                    glm::vec4 point(
+                        corner & 1 ? local.max[0][i] : local.min[0][i],
+                        corner & 2 ? local.max[1][i] : local.min[1][i],
+                        corner & 4 ? local.max[2][i] : local.min[2][i],
+                        1.0f
+                    );
+                    glm::vec3 transformed = glm::vec3(reference * point);
+                    min = glm::min(min, transformed);
+                    max = glm::max(max, transformed);
+                }
+
+                for (int k = 0; k < 3; k++) {
+                    difference(largest, world.min[k][i], min[k]);
+                    difference(largest, world.max[k][i], max[k]);
+                }
+            }
+        }
+
+        return largest;
+    }
+}
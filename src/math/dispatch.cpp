@@ -0,0 +1,291 @@
+#include "../math.hpp"
+
+// The kernels the batch functions call, picked the first time they're
+// needed unless setIsa came first.
+static const wfn_eng::math::Kernels *currentKernels = nullptr;
+static wfn_eng::math::Isa currentIsa = wfn_eng::math::Isa::Scalar;
+
+////
+// bool cpuRuns(Isa)
+//
+// Whether the CPU runs an instruction set, regardless of what's built in.
+static bool cpuRuns(wfn_eng::math::Isa isa) {
+    switch (isa) {
+    case wfn_eng::math::Isa::Scalar:
+        return true;
+
+#if defined(__x86_64__) || defined(__i386__)
+    case wfn_eng::math::Isa::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case wfn_eng::math::Isa::Avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+
+    default:
+        return false;
+    }
+}
+
+////
+// const Kernels& current()
+//
+// The kernels to call, picking the best supported ones if none were chosen.
+static const wfn_eng::math::Kernels& current() {
+    using wfn_eng::math::Isa;
+
+    if (currentKernels == nullptr) {
+        for (Isa isa : { Isa::Avx2, Isa::Sse2, Isa::Scalar }) {
+            if (wfn_eng::math::supported(isa)) {
+                wfn_eng::math::setIsa(isa);
+                break;
+            }
+        }
+    }
+
+    return *currentKernels;
+}
+
+namespace wfn_eng::math {
+    ////
+    // const char *name(Isa)
+    //
+    // The name of an instruction set.
+    const char *name(Isa isa) {
+        switch (isa) {
+        case Isa::Scalar: return "scalar";
+        case Isa::Sse2: return "sse2";
+        case Isa::Avx2: return "avx2";
+        }
+
+        return "unknown";
+    }
+
+    ////
+    // bool supported(Isa)
+    //
+    // Whether the kernels of an instruction set are built in and the CPU
+    // runs them.
+    bool supported(Isa isa) {
+        return kernels(isa) != nullptr;
+    }
+
+    ////
+    // void setIsa(Isa)
+    //
+    // Chooses the kernels the batch functions call, throwing if they
+    // aren't supported.
+    void setIsa(Isa isa) {
+        const Kernels *chosen = kernels(isa);
+        if (chosen == nullptr)
+            throw WfnError("wfn_eng::math", "setIsa", std::string("Run ") + name(isa) + " kernels");
+
+        currentKernels = chosen;
+        currentIsa = isa;
+    }
+
+    ////
+    // Isa isa()
+    //
+    // The instruction set the batch functions use.
+    Isa isa() {
+        current();
+        return currentIsa;
+    }
+
+    ////
+    // const Kernels *kernels(Isa)
+    //
+    // The kernels of an instruction set, or nullptr if they aren't built in
+    // or the CPU doesn't run them.
+    const Kernels *kernels(Isa isa) {
+        if (!cpuRuns(isa))
+            return nullptr;
+
+        switch (isa) {
+        case Isa::Scalar: return scalarKernels();
+        case Isa::Sse2: return sse2Kernels();
+        case Isa::Avx2: return avx2Kernels();
+        }
+
+        return nullptr;
+    }
+
+    ////
+    // class Columns
+    //
+    // Owns the arrays behind a view.
+
+    ////
+    // Columns(size_t, size_t)
+    //
+    // Allocates the provided number of columns of the provided number of
+    // floats, zeroed.
+    Columns::Columns(size_t columns, size_t count)
+            : _data(columns * count, 0.0f)
+            , _columns(columns)
+            , _count(count) { }
+
+    ////
+    // float *column(size_t)
+    //
+    // The floats of a column.
+    float *Columns::column(size_t index) {
+        return _data.data() + index * _count;
+    }
+
+    ////
+    // size_t columns()
+    //
+    // The number of columns.
+    size_t Columns::columns() const { return _columns; }
+
+    ////
+    // size_t count()
+    //
+    // The number of floats in each column.
+    size_t Columns::count() const { return _count; }
+
+    ////
+    // Affine2 affine2()
+    //
+    // A view of the first 6 columns.
+    Affine2 Columns::affine2() {
+        if (_columns < 6)
+            throw WfnError("wfn_eng::math::Columns", "affine2", "View " + std::to_string(_columns) + " columns");
+
+        Affine2 view;
+        for (size_t k = 0; k < 6; k++)
+            view.m[k] = column(k);
+        return view;
+    }
+
+    ////
+    // Affine3 affine3()
+    //
+    // A view of the first 12 columns.
+    Affine3 Columns::affine3() {
+        if (_columns < 12)
+            throw WfnError("wfn_eng::math::Columns", "affine3", "View " + std::to_string(_columns) + " columns");
+
+        Affine3 view;
+        for (size_t k = 0; k < 12; k++)
+            view.m[k] = column(k);
+        return view;
+    }
+
+    ////
+    // Trs3 trs3()
+    //
+    // A view of the first 10 columns: translation, rotation, then scale.
+    Trs3 Columns::trs3() {
+        if (_columns < 10)
+            throw WfnError("wfn_eng::math::Columns", "trs3", "View " + std::to_string(_columns) + " columns");
+
+        Trs3 view;
+        for (size_t k = 0; k < 3; k++)
+            view.t[k] = column(k);
+        for (size_t k = 0; k < 4; k++)
+            view.r[k] = column(3 + k);
+        for (size_t k = 0; k < 3; k++)
+            view.s[k] = column(7 + k);
+        return view;
+    }
+
+    ////
+    // Aabb3 aabb3()
+    //
+    // A view of the first 6 columns: minimum, then maximum.
+    Aabb3 Columns::aabb3() {
+        if (_columns < 6)
+            throw WfnError("wfn_eng::math::Columns", "aabb3", "View " + std::to_string(_columns) + " columns");
+
+        Aabb3 view;
+        for (size_t k = 0; k < 3; k++) {
+            view.min[k] = column(k);
+            view.max[k] = column(3 + k);
+        }
+        return view;
+    }
+
+    ////
+    // Affine2 offset(const Affine2&, size_t)
+    //
+    // A view starting the provided number of transforms in.
+    Affine2 offset(const Affine2& view, size_t first) {
+        Affine2 out = view;
+        for (float *& m : out.m)
+            m += first;
+        return out;
+    }
+
+    ////
+    // Affine3 offset(const Affine3&, size_t)
+    //
+    // A view starting the provided number of transforms in.
+    Affine3 offset(const Affine3& view, size_t first) {
+        Affine3 out = view;
+        for (float *& m : out.m)
+            m += first;
+        return out;
+    }
+
+    ////
+    // Trs3 offset(const Trs3&, size_t)
+    //
+    // A view starting the provided number of transforms in.
+    Trs3 offset(const Trs3& view, size_t first) {
+        Trs3 out = view;
+        for (float *& t : out.t)
+            t += first;
+        for (float *& r : out.r)
+            r += first;
+        for (float *& s : out.s)
+            s += first;
+        return out;
+    }
+
+    ////
+    // Aabb3 offset(const Aabb3&, size_t)
+    //
+    // A view starting the provided number of boxes in.
+    Aabb3 offset(const Aabb3& view, size_t first) {
+        Aabb3 out = view;
+        for (size_t k = 0; k < 3; k++) {
+            out.min[k] += first;
+            out.max[k] += first;
+        }
+        return out;
+    }
+
+    ////
+    // void compose(const Affine2&, const Affine2&, const Affine2&, size_t)
+    //
+    // Composes 2D transforms with the chosen kernels.
+    void compose(const Affine2& parent, const Affine2& local, const Affine2& out, size_t count) {
+        current().compose2(parent, local, out, count);
+    }
+
+    ////
+    // void compose(const Affine3&, const Affine3&, const Affine3&, size_t)
+    //
+    // Composes 3D transforms with the chosen kernels.
+    void compose(const Affine3& parent, const Affine3& local, const Affine3& out, size_t count) {
+        current().compose3(parent, local, out, count);
+    }
+
+    ////
+    // void model(const Trs3&, const Affine3&, size_t)
+    //
+    // Builds model matrices with the chosen kernels.
+    void model(const Trs3& trs, const Affine3& out, size_t count) {
+        current().model(trs, out, count);
+    }
+
+    ////
+    // void bounds(const Affine3&, const Aabb3&, const Aabb3&, size_t)
+    //
+    // Transforms boxes with the chosen kernels.
+    void bounds(const Affine3& transform, const Aabb3& local, const Aabb3& world, size_t count) {
+        current().bounds(transform, local, world, count);
+    }
+}
@@ -0,0 +1,127 @@
+#include "../math.hpp"
+
+#include <cmath>
+
+////
+// void compose2(const Affine2&, const Affine2&, const Affine2&, size_t)
+//
+// out = parent * local, one transform at a time.
+static void compose2(
+        const wfn_eng::math::Affine2& parent,
+        const wfn_eng::math::Affine2& local,
+        const wfn_eng::math::Affine2& out,
+        size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float p0 = parent.m[0][i], p1 = parent.m[1][i], p2 = parent.m[2][i];
+        float p3 = parent.m[3][i], p4 = parent.m[4][i], p5 = parent.m[5][i];
+        float l0 = local.m[0][i], l1 = local.m[1][i], l2 = local.m[2][i];
+        float l3 = local.m[3][i], l4 = local.m[4][i], l5 = local.m[5][i];
+
+        out.m[0][i] = p0 * l0 + p2 * l1;
+        out.m[1][i] = p1 * l0 + p3 * l1;
+        out.m[2][i] = p0 * l2 + p2 * l3;
+        out.m[3][i] = p1 * l2 + p3 * l3;
+        out.m[4][i] = p0 * l4 + p2 * l5 + p4;
+        out.m[5][i] = p1 * l4 + p3 * l5 + p5;
+    }
+}
+
+////
+// void compose3(const Affine3&, const Affine3&, const Affine3&, size_t)
+//
+// out = parent * local: each column of the local transform through the
+// parent's 3x3 part, plus the parent's translation for the last one.
+static void compose3(
+        const wfn_eng::math::Affine3& parent,
+        const wfn_eng::math::Affine3& local,
+        const wfn_eng::math::Affine3& out,
+        size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float p[12];
+        for (int k = 0; k < 12; k++)
+            p[k] = parent.m[k][i];
+
+        for (int c = 0; c < 4; c++) {
+            float x = local.m[c * 3][i];
+            float y = local.m[c * 3 + 1][i];
+            float z = local.m[c * 3 + 2][i];
+
+            for (int r = 0; r < 3; r++) {
+                float value = p[r] * x + p[3 + r] * y + p[6 + r] * z;
+                out.m[c * 3 + r][i] = c == 3 ? value + p[9 + r] : value;
+            }
+        }
+    }
+}
+
+////
+// void model(const Trs3&, const Affine3&, size_t)
+//
+// The rotation matrix of the quaternion (as glm::mat3_cast), its columns
+// scaled, then the translation.
+static void model(const wfn_eng::math::Trs3& trs, const wfn_eng::math::Affine3& out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float x = trs.r[0][i], y = trs.r[1][i], z = trs.r[2][i], w = trs.r[3][i];
+        float sx = trs.s[0][i], sy = trs.s[1][i], sz = trs.s[2][i];
+
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float wx = w * x, wy = w * y, wz = w * z;
+
+        out.m[0][i] = (1.0f - 2.0f * (yy + zz)) * sx;
+        out.m[1][i] = 2.0f * (xy + wz) * sx;
+        out.m[2][i] = 2.0f * (xz - wy) * sx;
+        out.m[3][i] = 2.0f * (xy - wz) * sy;
+        out.m[4][i] = (1.0f - 2.0f * (xx + zz)) * sy;
+        out.m[5][i] = 2.0f * (yz + wx) * sy;
+        out.m[6][i] = 2.0f * (xz + wy) * sz;
+        out.m[7][i] = 2.0f * (yz - wx) * sz;
+        out.m[8][i] = (1.0f - 2.0f * (xx + yy)) * sz;
+        out.m[9][i] = trs.t[0][i];
+        out.m[10][i] = trs.t[1][i];
+        out.m[11][i] = trs.t[2][i];
+    }
+}
+
+////
+// void bounds(const Affine3&, const Aabb3&, const Aabb3&, size_t)
+//
+// Arvo's method, through the center and the half extents.
+static void bounds(
+        const wfn_eng::math::Affine3& transform,
+        const wfn_eng::math::Aabb3& local,
+        const wfn_eng::math::Aabb3& world,
+        size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float center[3], extent[3];
+        for (int k = 0; k < 3; k++) {
+            center[k] = (local.min[k][i] + local.max[k][i]) * 0.5f;
+            extent[k] = (local.max[k][i] - local.min[k][i]) * 0.5f;
+        }
+
+        for (int r = 0; r < 3; r++) {
+            float c = transform.m[9 + r][i];
+            float e = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                float m = transform.m[k * 3 + r][i];
+                c += m * center[k];
+                e += std::fabs(m) * extent[k];
+            }
+
+            world.min[r][i] = c - e;
+            world.max[r][i] = c + e;
+        }
+    }
+}
+
+namespace wfn_eng::math {
+    ////
+    // const Kernels *scalarKernels()
+    //
+    // The scalar kernels: always built in, and the reference the others
+    // are checked against.
+    const Kernels *scalarKernels() {
+        static const Kernels kernels = { ::compose2, ::compose3, ::model, ::bounds };
+        return &kernels;
+    }
+}
@@ -0,0 +1,181 @@
+#include "../math.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+////
+// __m128 madd(__m128, __m128, __m128)
+//
+// a * b + c, in two instructions (SSE2 has no FMA).
+static inline __m128 madd(__m128 a, __m128 b, __m128 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+////
+// void compose2(const Affine2&, const Affine2&, const Affine2&, size_t)
+//
+// out = parent * local, four transforms at a time.
+static void compose2(
+        const wfn_eng::math::Affine2& parent,
+        const wfn_eng::math::Affine2& local,
+        const wfn_eng::math::Affine2& out,
+        size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 p0 = _mm_loadu_ps(parent.m[0] + i), p1 = _mm_loadu_ps(parent.m[1] + i);
+        __m128 p2 = _mm_loadu_ps(parent.m[2] + i), p3 = _mm_loadu_ps(parent.m[3] + i);
+        __m128 l0 = _mm_loadu_ps(local.m[0] + i), l1 = _mm_loadu_ps(local.m[1] + i);
+        __m128 l2 = _mm_loadu_ps(local.m[2] + i), l3 = _mm_loadu_ps(local.m[3] + i);
+        __m128 l4 = _mm_loadu_ps(local.m[4] + i), l5 = _mm_loadu_ps(local.m[5] + i);
+
+        _mm_storeu_ps(out.m[0] + i, madd(p2, l1, _mm_mul_ps(p0, l0)));
+        _mm_storeu_ps(out.m[1] + i, madd(p3, l1, _mm_mul_ps(p1, l0)));
+        _mm_storeu_ps(out.m[2] + i, madd(p2, l3, _mm_mul_ps(p0, l2)));
+        _mm_storeu_ps(out.m[3] + i, madd(p3, l3, _mm_mul_ps(p1, l2)));
+        _mm_storeu_ps(out.m[4] + i, madd(p2, l5, madd(p0, l4, _mm_loadu_ps(parent.m[4] + i))));
+        _mm_storeu_ps(out.m[5] + i, madd(p3, l5, madd(p1, l4, _mm_loadu_ps(parent.m[5] + i))));
+    }
+
+    wfn_eng::math::scalarKernels()->compose2(
+        wfn_eng::math::offset(parent, i),
+        wfn_eng::math::offset(local, i),
+        wfn_eng::math::offset(out, i),
+        count - i
+    );
+}
+
+////
+// void compose3(const Affine3&, const Affine3&, const Affine3&, size_t)
+//
+// out = parent * local, four transforms at a time.
+static void compose3(
+        const wfn_eng::math::Affine3& parent,
+        const wfn_eng::math::Affine3& local,
+        const wfn_eng::math::Affine3& out,
+        size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 p[12];
+        for (int k = 0; k < 12; k++)
+            p[k] = _mm_loadu_ps(parent.m[k] + i);
+
+        for (int c = 0; c < 4; c++) {
+            __m128 x = _mm_loadu_ps(local.m[c * 3] + i);
+            __m128 y = _mm_loadu_ps(local.m[c * 3 + 1] + i);
+            __m128 z = _mm_loadu_ps(local.m[c * 3 + 2] + i);
+
+            for (int r = 0; r < 3; r++) {
+                __m128 value = madd(p[6 + r], z, madd(p[3 + r], y, _mm_mul_ps(p[r], x)));
+                _mm_storeu_ps(out.m[c * 3 + r] + i, c == 3 ? _mm_add_ps(value, p[9 + r]) : value);
+            }
+        }
+    }
+
+    wfn_eng::math::scalarKernels()->compose3(
+        wfn_eng::math::offset(parent, i),
+        wfn_eng::math::offset(local, i),
+        wfn_eng::math::offset(out, i),
+        count - i
+    );
+}
+
+////
+// void model(const Trs3&, const Affine3&, size_t)
+//
+// translate * rotate * scale, four transforms at a time.
+static void model(const wfn_eng::math::Trs3& trs, const wfn_eng::math::Affine3& out, size_t count) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(trs.r[0] + i), y = _mm_loadu_ps(trs.r[1] + i);
+        __m128 z = _mm_loadu_ps(trs.r[2] + i), w = _mm_loadu_ps(trs.r[3] + i);
+        __m128 sx = _mm_loadu_ps(trs.s[0] + i), sy = _mm_loadu_ps(trs.s[1] + i);
+        __m128 sz = _mm_loadu_ps(trs.s[2] + i);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        _mm_storeu_ps(out.m[0] + i, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+        _mm_storeu_ps(out.m[1] + i, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx));
+        _mm_storeu_ps(out.m[2] + i, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx));
+        _mm_storeu_ps(out.m[3] + i, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy));
+        _mm_storeu_ps(out.m[4] + i, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+        _mm_storeu_ps(out.m[5] + i, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy));
+        _mm_storeu_ps(out.m[6] + i, _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz));
+        _mm_storeu_ps(out.m[7] + i, _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz));
+        _mm_storeu_ps(out.m[8] + i, _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+        _mm_storeu_ps(out.m[9] + i, _mm_loadu_ps(trs.t[0] + i));
+        _mm_storeu_ps(out.m[10] + i, _mm_loadu_ps(trs.t[1] + i));
+        _mm_storeu_ps(out.m[11] + i, _mm_loadu_ps(trs.t[2] + i));
+    }
+
+    wfn_eng::math::scalarKernels()->model(
+        wfn_eng::math::offset(trs, i),
+        wfn_eng::math::offset(out, i),
+        count - i
+    );
+}
+
+////
+// void bounds(const Affine3&, const Aabb3&, const Aabb3&, size_t)
+//
+// Arvo's method, four boxes at a time. The absolute value clears the sign
+// bit.
+static void bounds(
+        const wfn_eng::math::Affine3& transform,
+        const wfn_eng::math::Aabb3& local,
+        const wfn_eng::math::Aabb3& world,
+        size_t count) {
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 center[3], extent[3];
+        for (int k = 0; k < 3; k++) {
+            __m128 min = _mm_loadu_ps(local.min[k] + i);
+            __m128 max = _mm_loadu_ps(local.max[k] + i);
+            center[k] = _mm_mul_ps(_mm_add_ps(min, max), half);
+            extent[k] = _mm_mul_ps(_mm_sub_ps(max, min), half);
+        }
+
+        for (int r = 0; r < 3; r++) {
+            __m128 c = _mm_loadu_ps(transform.m[9 + r] + i);
+            __m128 e = _mm_setzero_ps();
+            for (int k = 0; k < 3; k++) {
+                __m128 m = _mm_loadu_ps(transform.m[k * 3 + r] + i);
+                c = madd(m, center[k], c);
+                e = madd(_mm_andnot_ps(sign, m), extent[k], e);
+            }
+
+            _mm_storeu_ps(world.min[r] + i, _mm_sub_ps(c, e));
+            _mm_storeu_ps(world.max[r] + i, _mm_add_ps(c, e));
+        }
+    }
+
+    wfn_eng::math::scalarKernels()->bounds(
+        wfn_eng::math::offset(transform, i),
+        wfn_eng::math::offset(local, i),
+        wfn_eng::math::offset(world, i),
+        count - i
+    );
+}
+#endif
+
+namespace wfn_eng::math {
+    ////
+    // const Kernels *sse2Kernels()
+    //
+    // The SSE2 kernels, built in on every x86-64 compiler.
+    const Kernels *sse2Kernels() {
+#if defined(__SSE2__)
+        static const Kernels kernels = { ::compose2, ::compose3, ::model, ::bounds };
+        return &kernels;
+#else
+        return nullptr;
+#endif
+    }
+}
@@ -0,0 +1,543 @@
+#ifndef __WFN_ENG_MEMORY_HPP__
+#define __WFN_ENG_MEMORY_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::memory {
+    ////
+    // class Arena
+    //
+    // A bump allocator over a single block of memory. Allocation is a pointer
+    // increment; memory is only given back all at once (reset) or back to a
+    // previously taken marker (rewind). Nothing allocated from an arena has
+    // its destructor run, so it should only hold trivially destructible data.
+    class Arena {
+        std::byte *_data;
+        size_t _capacity;
+        size_t _used;
+        size_t _peak;
+        bool _owned;
+
+    public:
+        ////
+        // Arena(size_t)
+        //
+        // Constructs an arena owning a block of the provided size.
+        Arena(size_t);
+
+        ////
+        // Arena(void *, size_t)
+        //
+        // Constructs an arena over an externally owned block.
+        Arena(void *, size_t);
+
+        ////
+        // ~Arena()
+        //
+        // Releases the block, if the arena owns it.
+        ~Arena();
+
+        ////
+        // void *allocate(size_t, size_t)
+        //
+        // Allocates a block of the provided size and alignment. Throws a
+        // WfnError when the arena is exhausted.
+        void *allocate(size_t, size_t = alignof(std::max_align_t));
+
+        ////
+        // T *allocate<T>(size_t)
+        //
+        // Typed helper around allocate for an uninitialized array.
+        template <typename T>
+        T *allocate(size_t count = 1) {
+            return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        ////
+        // void release(void *, size_t)
+        //
+        // Gives a block back if it is the most recent allocation (which lets a
+        // growing vector reuse its space); otherwise does nothing.
+        void release(void *, size_t);
+
+        ////
+        // size_t mark()
+        //
+        // Provides a marker that the arena can later be rewound to.
+        size_t mark() const;
+
+        ////
+        // void rewind(size_t)
+        //
+        // Frees everything allocated since the marker was taken.
+        void rewind(size_t);
+
+        ////
+        // void reset()
+        //
+        // Frees everything.
+        void reset();
+
+        ////
+        // size_t used()
+        //
+        // The number of bytes currently allocated.
+        size_t used() const;
+
+        ////
+        // size_t peak()
+        //
+        // The highest number of bytes ever allocated at once.
+        size_t peak() const;
+
+        ////
+        // size_t capacity()
+        //
+        // The size of the block.
+        size_t capacity() const;
+
+        // Following Rule of 3's
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+    };
+
+    ////
+    // class FrameArenas
+    //
+    // One arena per frame in flight. Memory allocated while recording a frame
+    // stays valid until the same frame slot comes around again, which is when
+    // the GPU is done with it.
+    class FrameArenas {
+        std::vector<Arena *> _arenas;
+        size_t _current;
+
+    public:
+        ////
+        // FrameArenas(size_t, size_t)
+        //
+        // Constructs the provided number of arenas (the first argument), each
+        // of the provided size in bytes.
+        FrameArenas(size_t, size_t);
+
+        ////
+        // ~FrameArenas()
+        //
+        // Destroys every arena.
+        ~FrameArenas();
+
+        ////
+        // Arena& begin(size_t)
+        //
+        // Starts a frame in the provided frame slot, resetting its arena.
+        Arena& begin(size_t);
+
+        ////
+        // Arena& current()
+        //
+        // The arena of the frame currently being recorded.
+        Arena& current();
+
+        // Following Rule of 3's
+        FrameArenas(const FrameArenas&) = delete;
+        FrameArenas& operator=(const FrameArenas&) = delete;
+    };
+
+    ////
+    // Arena& scratch()
+    //
+    // The calling thread's scratch arena, for temporaries that don't outlive
+    // the function using them. Pair with a ScratchScope.
+    Arena& scratch();
+
+    ////
+    // class ScratchScope
+    //
+    // Rewinds the thread's scratch arena when it goes out of scope.
+    class ScratchScope {
+        Arena& _arena;
+        size_t _marker;
+
+    public:
+        ScratchScope();
+        ~ScratchScope();
+
+        ////
+        // Arena& arena()
+        //
+        // The scratch arena this scope rewinds.
+        Arena& arena();
+
+        // Following Rule of 3's
+        ScratchScope(const ScratchScope&) = delete;
+        ScratchScope& operator=(const ScratchScope&) = delete;
+    };
+
+    ////
+    // class FixedPool
+    //
+    // A pool of fixed-size blocks in one contiguous allocation, with the free
+    // list threaded through the free blocks themselves. Allocation and
+    // deallocation are O(1) and never touch the heap.
+    class FixedPool {
+        std::byte *_data;
+        size_t _blockSize;
+        size_t _align;
+        size_t _count;
+        size_t _live;
+        void *_free;
+
+    public:
+        ////
+        // FixedPool(size_t, size_t, size_t)
+        //
+        // Constructs a pool of blocks with the following information (in
+        // order of argument list):
+        //   - Block size
+        //   - Block count
+        //   - Alignment
+        FixedPool(size_t, size_t, size_t = alignof(std::max_align_t));
+
+        ////
+        // ~FixedPool()
+        //
+        // Releases the pool's memory.
+        ~FixedPool();
+
+        ////
+        // void *allocate()
+        //
+        // Takes a block from the pool. Throws a WfnError when it is empty.
+        void *allocate();
+
+        ////
+        // void deallocate(void *)
+        //
+        // Returns a block to the pool.
+        void deallocate(void *);
+
+        ////
+        // bool owns(const void *)
+        //
+        // Checks whether a pointer is one of the pool's blocks.
+        bool owns(const void *) const;
+
+        ////
+        // size_t live()
+        //
+        // The number of blocks currently allocated.
+        size_t live() const;
+
+        ////
+        // size_t capacity()
+        //
+        // The number of blocks in the pool.
+        size_t capacity() const;
+
+        // Following Rule of 3's
+        FixedPool(const FixedPool&) = delete;
+        FixedPool& operator=(const FixedPool&) = delete;
+    };
+
+    ////
+    // class Pool<T>
+    //
+    // A typed FixedPool that constructs and destroys its objects.
+    template <typename T>
+    class Pool {
+        FixedPool _pool;
+
+    public:
+        ////
+        // Pool(size_t)
+        //
+        // Constructs a pool able to hold the provided number of objects.
+        Pool(size_t count) :
+                _pool(sizeof(T) < sizeof(void *) ? sizeof(void *) : sizeof(T), count, alignof(T)) { }
+
+        ////
+        // T *create(Args&&...)
+        //
+        // Constructs an object in the pool.
+        template <typename... Args>
+        T *create(Args&&... args) {
+            void *block = _pool.allocate();
+            return new (block) T(std::forward<Args>(args)...);
+        }
+
+        ////
+        // void destroy(T *)
+        //
+        // Destroys an object and returns its block to the pool.
+        void destroy(T *object) {
+            object->~T();
+            _pool.deallocate(object);
+        }
+
+        ////
+        // size_t live()
+        //
+        // The number of live objects.
+        size_t live() const { return _pool.live(); }
+    };
+
+    ////
+    // struct Id<T>
+    //
+    // A generational 32-bit handle to a value in a Registry<T>: the low
+    // indexBits are the index of a slot, the rest is the generation of the
+    // slot when the handle was given out. Removing a value bumps its slot's
+    // generation, which turns every outstanding handle to it stale. The
+    // zero value is never given out, so a default Id is a null handle.
+    template <typename T>
+    struct Id {
+        static constexpr uint32_t indexBits = 20;
+        static constexpr uint32_t generationBits = 32 - indexBits;
+        static constexpr uint32_t indexMask = (1u << indexBits) - 1;
+        static constexpr uint32_t maxGeneration = (1u << generationBits) - 1;
+
+        uint32_t value = 0;
+
+        static constexpr Id make(uint32_t index, uint32_t generation) {
+            return Id { (generation << indexBits) | index };
+        }
+
+        constexpr uint32_t index() const { return value & indexMask; }
+        constexpr uint32_t generation() const { return value >> indexBits; }
+
+        constexpr explicit operator bool() const { return value != 0; }
+        constexpr bool operator==(Id o) const { return value == o.value; }
+        constexpr bool operator!=(Id o) const { return value != o.value; }
+    };
+
+    ////
+    // class Registry<T>
+    //
+    // Owns values in a single dense array and hands out Id<T>s instead of
+    // pointers. Lookups are an index into the slot array plus a generation
+    // compare, so a stale handle is caught in O(1) rather than dereferenced.
+    // Removal moves the last value into the hole, keeping the array dense
+    // for iteration (so pointers into it are only valid until the next add
+    // or remove; hold on to the Id instead).
+    //
+    // A slot whose generation runs out is retired rather than reused, so a
+    // handle can never alias a newer value.
+    template <typename T>
+    class Registry {
+        struct Slot {
+            uint32_t dense;
+            uint32_t generation;
+        };
+
+        static constexpr uint32_t empty = ~0u;
+
+        std::vector<T> _values;
+        std::vector<uint32_t> _owners;
+        std::vector<Slot> _slots;
+        std::vector<uint32_t> _free;
+
+    public:
+        ////
+        // Registry(size_t)
+        //
+        // Constructs an empty registry with room for the provided number of
+        // values.
+        Registry(size_t capacity = 0) {
+            _values.reserve(capacity);
+            _owners.reserve(capacity);
+            _slots.reserve(capacity);
+        }
+
+        ////
+        // Id<T> add(Args&&...)
+        //
+        // Constructs a value in the registry, returning its handle. Throws
+        // a WfnError when every index is taken.
+        template <typename... Args>
+        Id<T> add(Args&&... args) {
+            uint32_t index;
+            if (!_free.empty()) {
+                index = _free.back();
+                _free.pop_back();
+            } else {
+                if (_slots.size() > Id<T>::indexMask) {
+                    throw WfnError(
+                        "wfn_eng::memory::Registry",
+                        "add",
+                        "Out of indices"
+                    );
+                }
+
+                index = static_cast<uint32_t>(_slots.size());
+                _slots.push_back(Slot { empty, 1 });
+            }
+
+            _slots[index].dense = static_cast<uint32_t>(_values.size());
+            _values.emplace_back(std::forward<Args>(args)...);
+            _owners.push_back(index);
+
+            return Id<T>::make(index, _slots[index].generation);
+        }
+
+        ////
+        // bool contains(Id<T>)
+        //
+        // Checks whether a handle still refers to a live value.
+        bool contains(Id<T> id) const {
+            uint32_t index = id.index();
+            return index < _slots.size() &&
+                _slots[index].generation == id.generation() &&
+                _slots[index].dense != empty;
+        }
+
+        ////
+        // T *get(Id<T>)
+        //
+        // Looks up a value, returning nullptr for a stale or null handle.
+        T *get(Id<T> id) {
+            return contains(id) ? &_values[_slots[id.index()].dense] : nullptr;
+        }
+
+        const T *get(Id<T> id) const {
+            return contains(id) ? &_values[_slots[id.index()].dense] : nullptr;
+        }
+
+        ////
+        // T& at(Id<T>)
+        //
+        // Looks up a value, throwing a WfnError for a stale or null handle.
+        T& at(Id<T> id) {
+            T *value = get(id);
+            if (value == nullptr) {
+                throw WfnError(
+                    "wfn_eng::memory::Registry",
+                    "at",
+                    "Stale handle"
+                );
+            }
+
+            return *value;
+        }
+
+        ////
+        // T remove(Id<T>)
+        //
+        // Takes a value out of the registry (so that the caller decides when
+        // it is destroyed) and invalidates its handle. Throws a WfnError for
+        // a stale or null handle.
+        T remove(Id<T> id) {
+            if (!contains(id)) {
+                throw WfnError(
+                    "wfn_eng::memory::Registry",
+                    "remove",
+                    "Stale handle"
+                );
+            }
+
+            Slot& slot = _slots[id.index()];
+            uint32_t dense = slot.dense;
+            uint32_t last = static_cast<uint32_t>(_values.size() - 1);
+
+            T value = std::move(_values[dense]);
+            if (dense != last) {
+                _values[dense] = std::move(_values[last]);
+                _owners[dense] = _owners[last];
+                _slots[_owners[dense]].dense = dense;
+            }
+
+            _values.pop_back();
+            _owners.pop_back();
+
+            slot.dense = empty;
+            if (slot.generation < Id<T>::maxGeneration) {
+                slot.generation++;
+                _free.push_back(id.index());
+            }
+
+            return value;
+        }
+
+        ////
+        // Id<T> id(size_t)
+        //
+        // The handle of the value at a position of the dense array.
+        Id<T> id(size_t dense) const {
+            uint32_t index = _owners[dense];
+            return Id<T>::make(index, _slots[index].generation);
+        }
+
+        ////
+        // size_t size()
+        //
+        // The number of live values.
+        size_t size() const { return _values.size(); }
+
+        T *begin() { return _values.data(); }
+        T *end() { return _values.data() + _values.size(); }
+        const T *begin() const { return _values.data(); }
+        const T *end() const { return _values.data() + _values.size(); }
+
+        // Following Rule of 3's
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+    };
+
+    ////
+    // class ArenaAllocator<T>
+    //
+    // An STL-compatible allocator drawing from an Arena, so that standard
+    // containers can be used for transient data without touching the heap.
+    template <typename T>
+    class ArenaAllocator {
+        Arena *_arena;
+
+        template <typename U>
+        friend class ArenaAllocator;
+
+    public:
+        typedef T value_type;
+
+        ArenaAllocator(Arena& arena) : _arena(&arena) { }
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other._arena) { }
+
+        T *allocate(size_t count) { return _arena->allocate<T>(count); }
+        void deallocate(T *pointer, size_t count) { _arena->release(pointer, sizeof(T) * count); }
+
+        Arena& arena() const { return *_arena; }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return _arena == other._arena; }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const { return _arena != other._arena; }
+    };
+
+    ////
+    // ArenaVector<T>
+    //
+    // A std::vector living in an Arena.
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    ////
+    // uint64_t heapAllocations()
+    //
+    // The number of global operator new calls so far. Sampling this around a
+    // frame proves whether the frame touched the heap.
+    uint64_t heapAllocations();
+
+    ////
+    // uint64_t heapBytes()
+    //
+    // The number of bytes requested through global operator new so far.
+    uint64_t heapBytes();
+}
+
+#endif
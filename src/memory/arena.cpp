@@ -0,0 +1,199 @@
+#include "../memory.hpp"
+
+////
+// size_t alignUp(size_t, size_t)
+//
+// Rounds a size up to a multiple of a (power of two) alignment.
+static size_t alignUp(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+////
+// The size of each thread's scratch arena.
+static const size_t scratchSize = 1024 * 1024;
+
+namespace wfn_eng::memory {
+    ////
+    // class Arena
+    //
+    // A bump allocator over a single block of memory. Allocation is a pointer
+    // increment; memory is only given back all at once (reset) or back to a
+    // previously taken marker (rewind). Nothing allocated from an arena has
+    // its destructor run, so it should only hold trivially destructible data.
+
+    ////
+    // Arena(size_t)
+    //
+    // Constructs an arena owning a block of the provided size.
+    Arena::Arena(size_t capacity) :
+            _data(static_cast<std::byte *>(::operator new(capacity))),
+            _capacity(capacity),
+            _used(0),
+            _peak(0),
+            _owned(true) { }
+
+    ////
+    // Arena(void *, size_t)
+    //
+    // Constructs an arena over an externally owned block.
+    Arena::Arena(void *data, size_t capacity) :
+            _data(static_cast<std::byte *>(data)),
+            _capacity(capacity),
+            _used(0),
+            _peak(0),
+            _owned(false) { }
+
+    ////
+    // ~Arena()
+    //
+    // Releases the block, if the arena owns it.
+    Arena::~Arena() {
+        if (_owned)
+            ::operator delete(_data);
+    }
+
+    ////
+    // void *allocate(size_t, size_t)
+    //
+    // Allocates a block of the provided size and alignment. Throws a
+    // WfnError when the arena is exhausted.
+    void *Arena::allocate(size_t size, size_t align) {
+        // Align the address rather than the offset, since an external block
+        // may not be maximally aligned.
+        uintptr_t base = reinterpret_cast<uintptr_t>(_data);
+        size_t offset = alignUp(base + _used, align) - base;
+        if (offset + size > _capacity) {
+            throw WfnError(
+                "wfn_eng::memory::Arena",
+                "allocate",
+                "Arena exhausted"
+            );
+        }
+
+        _used = offset + size;
+        if (_used > _peak)
+            _peak = _used;
+
+        return _data + offset;
+    }
+
+    ////
+    // void release(void *, size_t)
+    //
+    // Gives a block back if it is the most recent allocation (which lets a
+    // growing vector reuse its space); otherwise does nothing.
+    void Arena::release(void *pointer, size_t size) {
+        if (static_cast<std::byte *>(pointer) + size == _data + _used)
+            _used -= size;
+    }
+
+    ////
+    // size_t mark()
+    //
+    // Provides a marker that the arena can later be rewound to.
+    size_t Arena::mark() const { return _used; }
+
+    ////
+    // void rewind(size_t)
+    //
+    // Frees everything allocated since the marker was taken.
+    void Arena::rewind(size_t marker) {
+        if (marker < _used)
+            _used = marker;
+    }
+
+    ////
+    // void reset()
+    //
+    // Frees everything.
+    void Arena::reset() { _used = 0; }
+
+    ////
+    // size_t used()
+    //
+    // The number of bytes currently allocated.
+    size_t Arena::used() const { return _used; }
+
+    ////
+    // size_t peak()
+    //
+    // The highest number of bytes ever allocated at once.
+    size_t Arena::peak() const { return _peak; }
+
+    ////
+    // size_t capacity()
+    //
+    // The size of the block.
+    size_t Arena::capacity() const { return _capacity; }
+
+    ////
+    // class FrameArenas
+    //
+    // One arena per frame in flight. Memory allocated while recording a frame
+    // stays valid until the same frame slot comes around again, which is when
+    // the GPU is done with it.
+
+    ////
+    // FrameArenas(size_t, size_t)
+    //
+    // Constructs the provided number of arenas (the first argument), each
+    // of the provided size in bytes.
+    FrameArenas::FrameArenas(size_t frames, size_t size) :
+            _current(0) {
+        for (size_t i = 0; i < frames; i++)
+            _arenas.push_back(new Arena(size));
+    }
+
+    ////
+    // ~FrameArenas()
+    //
+    // Destroys every arena.
+    FrameArenas::~FrameArenas() {
+        for (auto arena: _arenas)
+            delete arena;
+    }
+
+    ////
+    // Arena& begin(size_t)
+    //
+    // Starts a frame in the provided frame slot, resetting its arena.
+    Arena& FrameArenas::begin(size_t frame) {
+        _current = frame % _arenas.size();
+        _arenas[_current]->reset();
+        return *_arenas[_current];
+    }
+
+    ////
+    // Arena& current()
+    //
+    // The arena of the frame currently being recorded.
+    Arena& FrameArenas::current() { return *_arenas[_current]; }
+
+    ////
+    // Arena& scratch()
+    //
+    // The calling thread's scratch arena, for temporaries that don't outlive
+    // the function using them. Pair with a ScratchScope.
+    Arena& scratch() {
+        thread_local Arena arena(scratchSize);
+        return arena;
+    }
+
+    ////
+    // class ScratchScope
+    //
+    // Rewinds the thread's scratch arena when it goes out of scope.
+    ScratchScope::ScratchScope() :
+            _arena(scratch()),
+            _marker(_arena.mark()) { }
+
+    ScratchScope::~ScratchScope() {
+        _arena.rewind(_marker);
+    }
+
+    ////
+    // Arena& arena()
+    //
+    // The scratch arena this scope rewinds.
+    Arena& ScratchScope::arena() { return _arena; }
+}
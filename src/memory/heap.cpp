@@ -0,0 +1,88 @@
+#include "../memory.hpp"
+
+#include <atomic>
+#include <cstdlib>
+
+////
+// Counters updated by the global allocation functions below. Relaxed atomics
+// keep the bookkeeping to a single locked add per allocation.
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> bytes(0);
+
+////
+// void *countedAlloc(size_t, size_t)
+//
+// The allocation behind every replaced operator new.
+static void *countedAlloc(size_t size, size_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (size == 0)
+        size = 1;
+
+    void *pointer = nullptr;
+    if (align <= alignof(std::max_align_t))
+        pointer = std::malloc(size);
+    else if (posix_memalign(&pointer, align, size) != 0)
+        pointer = nullptr;
+
+    return pointer;
+}
+
+void *operator new(size_t size) {
+    void *pointer = countedAlloc(size, alignof(std::max_align_t));
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+    void *pointer = countedAlloc(size, static_cast<size_t>(align));
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size, std::align_val_t align) {
+    return ::operator new(size, align);
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+namespace wfn_eng::memory {
+    ////
+    // uint64_t heapAllocations()
+    //
+    // The number of global operator new calls so far. Sampling this around a
+    // frame proves whether the frame touched the heap.
+    uint64_t heapAllocations() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    ////
+    // uint64_t heapBytes()
+    //
+    // The number of bytes requested through global operator new so far.
+    uint64_t heapBytes() {
+        return bytes.load(std::memory_order_relaxed);
+    }
+}
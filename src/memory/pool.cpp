@@ -0,0 +1,103 @@
+#include "../memory.hpp"
+
+namespace wfn_eng::memory {
+    ////
+    // class FixedPool
+    //
+    // A pool of fixed-size blocks in one contiguous allocation, with the free
+    // list threaded through the free blocks themselves. Allocation and
+    // deallocation are O(1) and never touch the heap.
+
+    ////
+    // FixedPool(size_t, size_t, size_t)
+    //
+    // Constructs a pool of blocks with the following information (in
+    // order of argument list):
+    //   - Block size
+    //   - Block count
+    //   - Alignment
+    FixedPool::FixedPool(size_t blockSize, size_t count, size_t align) :
+            _count(count),
+            _live(0),
+            _free(nullptr) {
+        if (align < alignof(void *))
+            align = alignof(void *);
+
+        // Every block must be able to hold the free list link, and must keep
+        // the next block aligned.
+        if (blockSize < sizeof(void *))
+            blockSize = sizeof(void *);
+        _blockSize = (blockSize + align - 1) & ~(align - 1);
+        _align = align;
+
+        _data = static_cast<std::byte *>(
+            ::operator new(_blockSize * count, std::align_val_t(align))
+        );
+
+        for (size_t i = count; i > 0; i--) {
+            void *block = _data + (i - 1) * _blockSize;
+            *static_cast<void **>(block) = _free;
+            _free = block;
+        }
+    }
+
+    ////
+    // ~FixedPool()
+    //
+    // Releases the pool's memory.
+    FixedPool::~FixedPool() {
+        ::operator delete(_data, std::align_val_t(_align));
+    }
+
+    ////
+    // void *allocate()
+    //
+    // Takes a block from the pool. Throws a WfnError when it is empty.
+    void *FixedPool::allocate() {
+        if (_free == nullptr) {
+            throw WfnError(
+                "wfn_eng::memory::FixedPool",
+                "allocate",
+                "Pool exhausted"
+            );
+        }
+
+        void *block = _free;
+        _free = *static_cast<void **>(block);
+        _live++;
+
+        return block;
+    }
+
+    ////
+    // void deallocate(void *)
+    //
+    // Returns a block to the pool.
+    void FixedPool::deallocate(void *block) {
+        *static_cast<void **>(block) = _free;
+        _free = block;
+        _live--;
+    }
+
+    ////
+    // bool owns(const void *)
+    //
+    // Checks whether a pointer is one of the pool's blocks.
+    bool FixedPool::owns(const void *pointer) const {
+        const std::byte *p = static_cast<const std::byte *>(pointer);
+        return p >= _data && p < _data + _blockSize * _count &&
+            (p - _data) % _blockSize == 0;
+    }
+
+    ////
+    // size_t live()
+    //
+    // The number of blocks currently allocated.
+    size_t FixedPool::live() const { return _live; }
+
+    ////
+    // size_t capacity()
+    //
+    // The number of blocks in the pool.
+    size_t FixedPool::capacity() const { return _count; }
+}
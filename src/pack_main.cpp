@@ -0,0 +1,69 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset.hpp"
+
+////
+// wfn_pack
+//
+// Packs every file under a directory into a pack file, keyed by its path
+// relative to the directory:
+//
+//   wfn_pack <directory> <pack> [none|lz4|zstd]
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <directory> <pack> [none|lz4|zstd]" << std::endl;
+        return 1;
+    }
+
+    std::filesystem::path root = argv[1];
+    std::string output = argv[2];
+    std::string codecName = argc > 3 ? argv[3] : "none";
+
+    wfn_eng::asset::Codec codec;
+    if (codecName == "none")
+        codec = wfn_eng::asset::Codec::None;
+    else if (codecName == "lz4")
+        codec = wfn_eng::asset::Codec::Lz4;
+    else if (codecName == "zstd")
+        codec = wfn_eng::asset::Codec::Zstd;
+    else {
+        std::cerr << "Unknown codec: " << codecName << std::endl;
+        return 1;
+    }
+
+    try {
+        wfn_eng::asset::PackWriter writer;
+
+        for (const auto& file : std::filesystem::recursive_directory_iterator(root)) {
+            if (!file.is_regular_file())
+                continue;
+
+            std::ifstream in(file.path(), std::ios::ate | std::ios::binary);
+            if (!in.is_open()) {
+                std::cerr << "Failed to open " << file.path() << std::endl;
+                return 1;
+            }
+
+            std::vector<uint8_t> data(static_cast<size_t>(in.tellg()));
+            in.seekg(0);
+            in.read(reinterpret_cast<char *>(data.data()), data.size());
+
+            writer.add(file.path().lexically_relative(root).generic_string(), std::move(data), codec);
+        }
+
+        writer.write(output);
+        writer.report(std::cout);
+    } catch (const wfn_eng::WfnError& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
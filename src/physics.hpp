@@ -0,0 +1,461 @@
+#ifndef __WFN_ENG_PHYSICS_HPP__
+#define __WFN_ENG_PHYSICS_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::physics {
+    ////
+    // struct Fixed
+    //
+    // A signed Q16.16 fixed-point number. All of the simulation's positions
+    // and sizes use it, so that results are bit-identical on every machine
+    // (floating point results depend on the compiler and instruction set).
+    struct Fixed {
+        int32_t raw;
+
+        ////
+        // int fractionBits
+        //
+        // The number of bits below the binary point.
+        static constexpr int fractionBits = 16;
+
+        ////
+        // Fixed fromRaw(int32_t)
+        //
+        // Wraps an already scaled value.
+        static constexpr Fixed fromRaw(int32_t raw) { return Fixed { raw }; }
+
+        ////
+        // Fixed fromInt(int32_t)
+        //
+        // Converts a whole number.
+        static constexpr Fixed fromInt(int32_t value) {
+            return Fixed { static_cast<int32_t>(static_cast<uint32_t>(value) << fractionBits) };
+        }
+
+        ////
+        // Fixed fromRatio(int32_t, int32_t)
+        //
+        // Converts a fraction, e.g. fromRatio(1, 2) for 0.5.
+        static constexpr Fixed fromRatio(int32_t numerator, int32_t denominator) {
+            return Fixed {
+                static_cast<int32_t>((static_cast<int64_t>(numerator) << fractionBits) / denominator)
+            };
+        }
+
+        ////
+        // int32_t toInt()
+        //
+        // Truncates towards negative infinity.
+        constexpr int32_t toInt() const { return raw >> fractionBits; }
+
+        constexpr Fixed operator+(Fixed o) const { return Fixed { raw + o.raw }; }
+        constexpr Fixed operator-(Fixed o) const { return Fixed { raw - o.raw }; }
+        constexpr Fixed operator-() const { return Fixed { -raw }; }
+
+        constexpr Fixed operator*(Fixed o) const {
+            return Fixed {
+                static_cast<int32_t>((static_cast<int64_t>(raw) * o.raw) >> fractionBits)
+            };
+        }
+
+        constexpr Fixed operator/(Fixed o) const {
+            return Fixed {
+                static_cast<int32_t>((static_cast<int64_t>(raw) << fractionBits) / o.raw)
+            };
+        }
+
+        Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+        Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+
+        constexpr bool operator==(Fixed o) const { return raw == o.raw; }
+        constexpr bool operator!=(Fixed o) const { return raw != o.raw; }
+        constexpr bool operator<(Fixed o) const { return raw < o.raw; }
+        constexpr bool operator<=(Fixed o) const { return raw <= o.raw; }
+        constexpr bool operator>(Fixed o) const { return raw > o.raw; }
+        constexpr bool operator>=(Fixed o) const { return raw >= o.raw; }
+    };
+
+    ////
+    // struct Box
+    //
+    // An axis-aligned box, with inclusive bounds.
+    struct Box {
+        Fixed minX;
+        Fixed minY;
+        Fixed maxX;
+        Fixed maxY;
+    };
+
+    ////
+    // enum Layer
+    //
+    // The kind of a box. Each box also carries a mask of the layers it wants
+    // to be paired with.
+    enum Layer : uint8_t {
+        Push       = 1 << 0,
+        Hurt       = 1 << 1,
+        Hit        = 1 << 2,
+        Projectile = 1 << 3,
+    };
+
+    ////
+    // class BoxSet
+    //
+    // A structure-of-arrays collection of boxes. Keeping each bound in its
+    // own array lets the overlap kernel load four or eight boxes at once.
+    class BoxSet {
+        std::vector<int32_t> _minX;
+        std::vector<int32_t> _minY;
+        std::vector<int32_t> _maxX;
+        std::vector<int32_t> _maxY;
+        std::vector<uint16_t> _owner;
+        std::vector<uint8_t> _layer;
+        std::vector<uint8_t> _mask;
+
+    public:
+        ////
+        // uint32_t add(Box, uint16_t, uint8_t, uint8_t)
+        //
+        // Adds a box with the following information (in order of argument
+        // list), returning its index:
+        //   - Box    (the bounds)
+        //   - Owner  (boxes with the same owner are never paired)
+        //   - Layer  (the Layer of this box)
+        //   - Mask   (the Layers this box pairs with)
+        uint32_t add(Box, uint16_t, uint8_t, uint8_t);
+
+        ////
+        // void clear()
+        //
+        // Removes every box, keeping the allocations.
+        void clear();
+
+        ////
+        // void reserve(size_t)
+        //
+        // Reserves room for the provided number of boxes.
+        void reserve(size_t);
+
+        ////
+        // size_t size()
+        //
+        // The number of boxes.
+        size_t size() const;
+
+        ////
+        // Box box(uint32_t)
+        //
+        // Gathers the bounds of a single box.
+        Box box(uint32_t) const;
+
+        const int32_t *minX() const;
+        const int32_t *minY() const;
+        const int32_t *maxX() const;
+        const int32_t *maxY() const;
+        const uint16_t *owner() const;
+        const uint8_t *layer() const;
+        const uint8_t *mask() const;
+    };
+
+    ////
+    // size_t overlap(const int32_t *, const int32_t *, const int32_t *,
+    //                const int32_t *, size_t, Box, uint32_t *)
+    //
+    // The AABB overlap kernel. Tests a query box against a run of boxes given
+    // as raw SoA bounds (minX, minY, maxX, maxY, count), writing the indices
+    // of the overlapping boxes, in order, into the output array (which must
+    // hold count entries). Returns the number of indices written.
+    //
+    // Processes four boxes per iteration with SSE2 where available.
+    size_t overlap(
+        const int32_t *,
+        const int32_t *,
+        const int32_t *,
+        const int32_t *,
+        size_t,
+        Box,
+        uint32_t *
+    );
+
+    ////
+    // struct Pair
+    //
+    // Two overlapping boxes (indices into a BoxSet), with a < b.
+    struct Pair {
+        uint32_t a;
+        uint32_t b;
+    };
+
+    ////
+    // struct BroadphaseStats
+    //
+    // Counters on the last run of a Broadphase.
+    struct BroadphaseStats {
+        size_t boxes = 0;
+        size_t candidates = 0;
+        size_t pairs = 0;
+        uint64_t nanos = 0;
+    };
+
+    ////
+    // class Broadphase
+    //
+    // A sort-and-sweep broadphase. Boxes are sorted along X (ties broken by
+    // index, so the order, and therefore the output, is deterministic), then
+    // each box is swept against the boxes that start before it ends.
+    class Broadphase {
+        std::vector<uint32_t> _order;
+        std::vector<int32_t> _minX;
+        std::vector<int32_t> _minY;
+        std::vector<int32_t> _maxX;
+        std::vector<int32_t> _maxY;
+        std::vector<uint32_t> _hits;
+        BroadphaseStats _stats;
+
+    public:
+        ////
+        // void run(const BoxSet&, std::vector<Pair>&)
+        //
+        // Finds every pair of overlapping boxes that have different owners
+        // and where either box's mask includes the other's layer. Pairs are
+        // appended to the output vector.
+        void run(const BoxSet&, std::vector<Pair>&);
+
+        ////
+        // const BroadphaseStats& stats()
+        //
+        // Provides the counters of the last run.
+        const BroadphaseStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters of the last run.
+        void report(std::ostream&) const;
+    };
+
+    ////
+    // struct Circle
+    //
+    // A circle, as its center and radius (inclusive).
+    struct Circle {
+        Fixed x;
+        Fixed y;
+        Fixed radius;
+    };
+
+    ////
+    // struct QueryResults
+    //
+    // The results of a batch of queries: the indices found by query i are
+    // indices[offsets[i]] up to indices[offsets[i + 1]].
+    struct QueryResults {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> indices;
+
+        ////
+        // size_t count(size_t)
+        //
+        // The number of indices found by a query.
+        size_t count(size_t query) const { return offsets[query + 1] - offsets[query]; }
+
+        ////
+        // const uint32_t *found(size_t)
+        //
+        // The indices found by a query.
+        const uint32_t *found(size_t query) const { return indices.data() + offsets[query]; }
+    };
+
+    ////
+    // struct HashStats
+    //
+    // Counters on the last rebuild and the queries since.
+    struct HashStats {
+        size_t entities = 0;
+        size_t buckets = 0;
+        uint64_t rebuildNanos = 0;
+        uint64_t queries = 0;
+        uint64_t tested = 0;
+        uint64_t found = 0;
+    };
+
+    ////
+    // class SpatialHash
+    //
+    // A uniform grid of square cells, hashed into a power-of-two number of
+    // buckets (about one per entity), over a set of points. It's rebuilt
+    // every tick from SoA positions with a counting sort: every entity's
+    // bucket is counted, the counts prefix-summed, then each entity is
+    // scattered in, so each bucket is one contiguous run of indices and
+    // positions, with no allocation per cell. Rebuilding keeps the storage,
+    // so after the first few ticks nothing is allocated.
+    //
+    // Queries visit the cells they cover, and only take entities whose own
+    // cell is the one being visited (buckets are shared between cells), so
+    // nothing is found twice. Results come out cell by cell, in a
+    // deterministic order. Batches of queries are split across a set of
+    // worker threads (plus the calling one).
+    class SpatialHash {
+        int _cellShift;
+        uint32_t _bucketMask;
+        std::vector<uint32_t> _bucketOf;
+        std::vector<uint32_t> _starts;
+        std::vector<uint32_t> _entries;
+        std::vector<int32_t> _x;
+        std::vector<int32_t> _y;
+
+        ////
+        // enum class Job
+        //
+        // What the workers run.
+        enum class Job {
+            Circles,
+            Rects
+        };
+
+        std::vector<std::thread> _workers;
+        std::vector<std::vector<uint32_t>> _found;
+        std::vector<uint64_t> _tested;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        uint64_t _generation;
+        size_t _finished;
+        bool _quitting;
+
+        Job _job;
+        const Circle *_circles;
+        const Box *_rects;
+        size_t _queries;
+        QueryResults *_results;
+        size_t _threads;
+
+        HashStats _stats;
+
+        ////
+        // uint32_t bucket(int32_t, int32_t)
+        //
+        // The bucket of a cell.
+        uint32_t bucket(int32_t, int32_t) const;
+
+        ////
+        // template <typename Test> uint64_t visit(Box, Test, std::vector<uint32_t>&)
+        //
+        // Appends every entity in the cells a box covers that passes a test
+        // on its raw position, returning how many entities were tested.
+        template <typename Test>
+        uint64_t visit(Box, Test, std::vector<uint32_t>&) const;
+
+        ////
+        // uint64_t findCircle(Circle, std::vector<uint32_t>&) / findRect(Box, ...)
+        //
+        // Runs a single query, returning how many entities were tested.
+        uint64_t findCircle(Circle, std::vector<uint32_t>&) const;
+        uint64_t findRect(Box, std::vector<uint32_t>&) const;
+
+        ////
+        // void workLoop(size_t)
+        //
+        // The body of a worker thread.
+        void workLoop(size_t);
+
+        ////
+        // void run(size_t)
+        //
+        // Runs one thread's slice of a batch.
+        void run(size_t);
+
+        ////
+        // void batch(Job, size_t, QueryResults&)
+        //
+        // Runs a batch on as many threads as it's worth, then gathers every
+        // thread's indices into the results.
+        void batch(Job, size_t, QueryResults&);
+
+    public:
+        ////
+        // size_t parallelThreshold
+        //
+        // Batches of fewer queries stay on the calling thread.
+        static const size_t parallelThreshold = 64;
+
+        ////
+        // SpatialHash(Fixed, size_t)
+        //
+        // Starts an empty hash with cells of the provided size (rounded down
+        // to a power of two, at least 1/65536), using the provided number of
+        // threads for batches, counting the calling one. 0 picks one per
+        // hardware thread, up to 8.
+        SpatialHash(Fixed, size_t = 0);
+
+        ////
+        // ~SpatialHash()
+        //
+        // Stops the workers.
+        ~SpatialHash();
+
+        ////
+        // void rebuild(const int32_t *, const int32_t *, size_t)
+        //
+        // Rebuilds the hash from raw Fixed positions (x, y, count).
+        void rebuild(const int32_t *, const int32_t *, size_t);
+
+        ////
+        // void radius(Circle, std::vector<uint32_t>&)
+        //
+        // Appends the indices of the entities within a circle.
+        void radius(Circle, std::vector<uint32_t>&);
+
+        ////
+        // void rect(Box, std::vector<uint32_t>&)
+        //
+        // Appends the indices of the entities within a box.
+        void rect(Box, std::vector<uint32_t>&);
+
+        ////
+        // void radius(const Circle *, size_t, QueryResults&)
+        //
+        // Runs a batch of circle queries, replacing the results.
+        void radius(const Circle *, size_t, QueryResults&);
+
+        ////
+        // void rects(const Box *, size_t, QueryResults&)
+        //
+        // Runs a batch of box queries, replacing the results.
+        void rects(const Box *, size_t, QueryResults&);
+
+        ////
+        // size_t threads()
+        //
+        // The number of threads a large batch is split across.
+        size_t threads() const;
+
+        ////
+        // const HashStats& stats()
+        //
+        // The counters of the last rebuild and the queries since.
+        const HashStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        SpatialHash(const SpatialHash&) = delete;
+        SpatialHash& operator=(const SpatialHash&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "../physics.hpp"
+
+namespace wfn_eng::physics {
+    ////
+    // class BoxSet
+    //
+    // A structure-of-arrays collection of boxes. Keeping each bound in its
+    // own array lets the overlap kernel load four or eight boxes at once.
+
+    ////
+    // uint32_t add(Box, uint16_t, uint8_t, uint8_t)
+    //
+    // Adds a box with the following information (in order of argument
+    // list), returning its index:
+    //   - Box    (the bounds)
+    //   - Owner  (boxes with the same owner are never paired)
+    //   - Layer  (the Layer of this box)
+    //   - Mask   (the Layers this box pairs with)
+    uint32_t BoxSet::add(Box box, uint16_t owner, uint8_t layer, uint8_t mask) {
+        uint32_t index = static_cast<uint32_t>(_minX.size());
+
+        _minX.push_back(box.minX.raw);
+        _minY.push_back(box.minY.raw);
+        _maxX.push_back(box.maxX.raw);
+        _maxY.push_back(box.maxY.raw);
+        _owner.push_back(owner);
+        _layer.push_back(layer);
+        _mask.push_back(mask);
+
+        return index;
+    }
+
+    ////
+    // void clear()
+    //
+    // Removes every box, keeping the allocations.
+    void BoxSet::clear() {
+        _minX.clear();
+        _minY.clear();
+        _maxX.clear();
+        _maxY.clear();
+        _owner.clear();
+        _layer.clear();
+        _mask.clear();
+    }
+
+    ////
+    // void reserve(size_t)
+    //
+    // Reserves room for the provided number of boxes.
+    void BoxSet::reserve(size_t count) {
+        _minX.reserve(count);
+        _minY.reserve(count);
+        _maxX.reserve(count);
+        _maxY.reserve(count);
+        _owner.reserve(count);
+        _layer.reserve(count);
+        _mask.reserve(count);
+    }
+
+    ////
+    // size_t size()
+    //
+    // The number of boxes.
+    size_t BoxSet::size() const { return _minX.size(); }
+
+    ////
+    // Box box(uint32_t)
+    //
+    // Gathers the bounds of a single box.
+    Box BoxSet::box(uint32_t index) const {
+        return Box {
+            Fixed::fromRaw(_minX[index]),
+            Fixed::fromRaw(_minY[index]),
+            Fixed::fromRaw(_maxX[index]),
+            Fixed::fromRaw(_maxY[index])
+        };
+    }
+
+    const int32_t *BoxSet::minX() const { return _minX.data(); }
+    const int32_t *BoxSet::minY() const { return _minY.data(); }
+    const int32_t *BoxSet::maxX() const { return _maxX.data(); }
+    const int32_t *BoxSet::maxY() const { return _maxY.data(); }
+    const uint16_t *BoxSet::owner() const { return _owner.data(); }
+    const uint8_t *BoxSet::layer() const { return _layer.data(); }
+    const uint8_t *BoxSet::mask() const { return _mask.data(); }
+}
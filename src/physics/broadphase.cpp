@@ -0,0 +1,124 @@
+#include "../physics.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace wfn_eng::physics {
+    ////
+    // class Broadphase
+    //
+    // A sort-and-sweep broadphase. Boxes are sorted along X (ties broken by
+    // index, so the order, and therefore the output, is deterministic), then
+    // each box is swept against the boxes that start before it ends.
+
+    ////
+    // void run(const BoxSet&, std::vector<Pair>&)
+    //
+    // Finds every pair of overlapping boxes that have different owners
+    // and where either box's mask includes the other's layer. Pairs are
+    // appended to the output vector.
+    void Broadphase::run(const BoxSet& boxes, std::vector<Pair>& pairs) {
+        auto start = std::chrono::steady_clock::now();
+
+        size_t count = boxes.size();
+        const int32_t *minX = boxes.minX();
+
+        _order.resize(count);
+        for (size_t i = 0; i < count; i++)
+            _order[i] = static_cast<uint32_t>(i);
+
+        std::sort(_order.begin(), _order.end(), [minX](uint32_t a, uint32_t b) {
+            return minX[a] < minX[b] || (minX[a] == minX[b] && a < b);
+        });
+
+        // Gather the bounds in sorted order, so the sweep reads contiguous
+        // runs that the overlap kernel can consume directly.
+        _minX.resize(count);
+        _minY.resize(count);
+        _maxX.resize(count);
+        _maxY.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = _order[i];
+            _minX[i] = minX[index];
+            _minY[i] = boxes.minY()[index];
+            _maxX[i] = boxes.maxX()[index];
+            _maxY[i] = boxes.maxY()[index];
+        }
+
+        _hits.resize(count);
+
+        const uint16_t *owner = boxes.owner();
+        const uint8_t *layer = boxes.layer();
+        const uint8_t *mask = boxes.mask();
+
+        size_t candidates = 0;
+        size_t found = 0;
+        for (size_t i = 0; i < count; i++) {
+            // Only boxes that start before this one ends can overlap it.
+            size_t end = std::upper_bound(
+                _minX.begin() + i + 1,
+                _minX.end(),
+                _maxX[i]
+            ) - _minX.begin();
+
+            size_t run = end - (i + 1);
+            if (run == 0)
+                continue;
+
+            Box query = {
+                Fixed::fromRaw(_minX[i]),
+                Fixed::fromRaw(_minY[i]),
+                Fixed::fromRaw(_maxX[i]),
+                Fixed::fromRaw(_maxY[i])
+            };
+
+            size_t hits = overlap(
+                _minX.data() + i + 1,
+                _minY.data() + i + 1,
+                _maxX.data() + i + 1,
+                _maxY.data() + i + 1,
+                run,
+                query,
+                _hits.data()
+            );
+
+            candidates += run;
+            for (size_t h = 0; h < hits; h++) {
+                uint32_t a = _order[i];
+                uint32_t b = _order[i + 1 + _hits[h]];
+
+                if (owner[a] == owner[b])
+                    continue;
+                if (!(mask[a] & layer[b]) && !(mask[b] & layer[a]))
+                    continue;
+
+                pairs.push_back(Pair { std::min(a, b), std::max(a, b) });
+                found++;
+            }
+        }
+
+        _stats.boxes = count;
+        _stats.candidates = candidates;
+        _stats.pairs = found;
+        _stats.nanos = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start
+            ).count()
+        );
+    }
+
+    ////
+    // const BroadphaseStats& stats()
+    //
+    // Provides the counters of the last run.
+    const BroadphaseStats& Broadphase::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters of the last run.
+    void Broadphase::report(std::ostream& out) const {
+        out << "Broadphase: " << _stats.boxes << " boxes, " << _stats.candidates << " candidates, "
+            << _stats.pairs << " pairs in " << _stats.nanos / 1000.0 << "us" << std::endl;
+    }
+}
@@ -0,0 +1,355 @@
+#include "../physics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace wfn_eng::physics {
+    ////
+    // class SpatialHash
+    //
+    // A hashed uniform grid over a set of points, rebuilt every tick with a
+    // counting sort.
+
+    ////
+    // SpatialHash(Fixed, size_t)
+    //
+    // Starts an empty hash with cells of the provided size, rounded down to
+    // a power of two so a position's cell is a shift of its raw value.
+    SpatialHash::SpatialHash(Fixed cellSize, size_t threads)
+            : _cellShift(0)
+            , _bucketMask(0)
+            , _starts(2, 0)
+            , _generation(0)
+            , _finished(0)
+            , _quitting(false)
+            , _job(Job::Circles)
+            , _circles(nullptr)
+            , _rects(nullptr)
+            , _queries(0)
+            , _results(nullptr)
+            , _threads(1) {
+        if (cellSize.raw <= 0)
+            throw WfnError("wfn_eng::physics::SpatialHash", "SpatialHash", "Size a cell");
+
+        while (_cellShift < 30 && (cellSize.raw >> (_cellShift + 1)) > 0)
+            _cellShift++;
+
+        if (threads == 0)
+            threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), 8);
+
+        _found.resize(threads);
+        _tested.resize(threads);
+        for (size_t i = 1; i < threads; i++)
+            _workers.emplace_back(&SpatialHash::workLoop, this, i);
+    }
+
+    ////
+    // ~SpatialHash()
+    //
+    // Stops the workers.
+    SpatialHash::~SpatialHash() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quitting = true;
+        }
+        _wake.notify_all();
+
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    ////
+    // uint32_t bucket(int32_t, int32_t)
+    //
+    // The bucket of a cell: its coordinates multiplied by two large odd
+    // constants, mixed, then masked.
+    uint32_t SpatialHash::bucket(int32_t cellX, int32_t cellY) const {
+        uint32_t hash = static_cast<uint32_t>(cellX) * 0x9E3779B1u ^ static_cast<uint32_t>(cellY) * 0x85EBCA77u;
+        hash ^= hash >> 15;
+        return hash & _bucketMask;
+    }
+
+    ////
+    // void rebuild(const int32_t *, const int32_t *, size_t)
+    //
+    // Counts the entities of each bucket, turns the counts into where each
+    // bucket starts, then scatters the entities in (in index order within a
+    // bucket). Scattering moves each start to the next bucket's, so they're
+    // shifted back afterwards.
+    void SpatialHash::rebuild(const int32_t *x, const int32_t *y, size_t count) {
+        auto start = std::chrono::steady_clock::now();
+
+        uint32_t buckets = 16;
+        while (buckets < count && buckets < (1u << 30))
+            buckets <<= 1;
+        _bucketMask = buckets - 1;
+
+        _bucketOf.resize(count);
+        _entries.resize(count);
+        _x.resize(count);
+        _y.resize(count);
+        _starts.assign(buckets + 1, 0);
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t b = bucket(x[i] >> _cellShift, y[i] >> _cellShift);
+            _bucketOf[i] = b;
+            _starts[b]++;
+        }
+
+        uint32_t total = 0;
+        for (uint32_t b = 0; b < buckets; b++) {
+            uint32_t size = _starts[b];
+            _starts[b] = total;
+            total += size;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t at = _starts[_bucketOf[i]]++;
+            _entries[at] = static_cast<uint32_t>(i);
+            _x[at] = x[i];
+            _y[at] = y[i];
+        }
+
+        for (uint32_t b = buckets; b > 0; b--)
+            _starts[b] = _starts[b - 1];
+        _starts[0] = 0;
+
+        _stats = HashStats {};
+        _stats.entities = count;
+        _stats.buckets = buckets;
+        _stats.rebuildNanos = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+        );
+    }
+
+    ////
+    // template <typename Test> uint64_t visit(Box, Test, std::vector<uint32_t>&)
+    //
+    // Visits the cells a box covers, row by row. A box covering more cells
+    // than there are buckets would visit some buckets many times, so every
+    // entity is tested once instead.
+    template <typename Test>
+    uint64_t SpatialHash::visit(Box box, Test test, std::vector<uint32_t>& out) const {
+        int32_t minX = box.minX.raw >> _cellShift, maxX = box.maxX.raw >> _cellShift;
+        int32_t minY = box.minY.raw >> _cellShift, maxY = box.maxY.raw >> _cellShift;
+        if (maxX < minX || maxY < minY)
+            return 0;
+
+        uint64_t cells = (uint64_t)((int64_t)maxX - minX + 1) * (uint64_t)((int64_t)maxY - minY + 1);
+        if (cells > _bucketMask + 1ull) {
+            for (size_t k = 0; k < _entries.size(); k++) {
+                if (test(_x[k], _y[k]))
+                    out.push_back(_entries[k]);
+            }
+            return _entries.size();
+        }
+
+        uint64_t tested = 0;
+        for (int32_t cellY = minY; ; cellY++) {
+            for (int32_t cellX = minX; ; cellX++) {
+                uint32_t b = bucket(cellX, cellY);
+                for (uint32_t k = _starts[b]; k < _starts[b + 1]; k++) {
+                    if ((_x[k] >> _cellShift) == cellX && (_y[k] >> _cellShift) == cellY && test(_x[k], _y[k]))
+                        out.push_back(_entries[k]);
+                }
+                tested += _starts[b + 1] - _starts[b];
+
+                if (cellX == maxX)
+                    break;
+            }
+
+            if (cellY == maxY)
+                break;
+        }
+        return tested;
+    }
+
+    ////
+    // uint64_t findCircle(Circle, std::vector<uint32_t>&)
+    //
+    // A circle query: the cells of its bounding box, then the distance in
+    // 64 bits.
+    uint64_t SpatialHash::findCircle(Circle circle, std::vector<uint32_t>& out) const {
+        int64_t x = circle.x.raw, y = circle.y.raw, radius = circle.radius.raw;
+        int64_t radiusSquared = radius * radius;
+
+        Box box = {
+            circle.x - circle.radius,
+            circle.y - circle.radius,
+            circle.x + circle.radius,
+            circle.y + circle.radius
+        };
+
+        return visit(box, [=](int32_t px, int32_t py) {
+            int64_t dx = px - x, dy = py - y;
+            return dx * dx + dy * dy <= radiusSquared;
+        }, out);
+    }
+
+    ////
+    // uint64_t findRect(Box, std::vector<uint32_t>&)
+    //
+    // A box query.
+    uint64_t SpatialHash::findRect(Box box, std::vector<uint32_t>& out) const {
+        return visit(box, [=](int32_t px, int32_t py) {
+            return px >= box.minX.raw && px <= box.maxX.raw && py >= box.minY.raw && py <= box.maxY.raw;
+        }, out);
+    }
+
+    ////
+    // void radius(Circle, std::vector<uint32_t>&)
+    //
+    // Appends the indices of the entities within a circle.
+    void SpatialHash::radius(Circle query, std::vector<uint32_t>& out) {
+        size_t before = out.size();
+        _stats.tested += findCircle(query, out);
+        _stats.found += out.size() - before;
+        _stats.queries++;
+    }
+
+    ////
+    // void rect(Box, std::vector<uint32_t>&)
+    //
+    // Appends the indices of the entities within a box.
+    void SpatialHash::rect(Box query, std::vector<uint32_t>& out) {
+        size_t before = out.size();
+        _stats.tested += findRect(query, out);
+        _stats.found += out.size() - before;
+        _stats.queries++;
+    }
+
+    ////
+    // void workLoop(size_t)
+    //
+    // The body of a worker thread.
+    void SpatialHash::workLoop(size_t thread) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _quitting || _generation != seen; });
+                if (_quitting)
+                    return;
+                seen = _generation;
+            }
+
+            run(thread);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (++_finished == _workers.size())
+                _done.notify_one();
+        }
+    }
+
+    ////
+    // void run(size_t)
+    //
+    // Runs one thread's slice of a batch into its own list of indices,
+    // writing each query's count where its offset goes.
+    void SpatialHash::run(size_t thread) {
+        size_t begin = _queries * thread / _threads;
+        size_t end = _queries * (thread + 1) / _threads;
+
+        std::vector<uint32_t>& found = _found[thread];
+        found.clear();
+        _tested[thread] = 0;
+
+        for (size_t q = begin; q < end; q++) {
+            size_t before = found.size();
+            if (_job == Job::Circles)
+                _tested[thread] += findCircle(_circles[q], found);
+            else
+                _tested[thread] += findRect(_rects[q], found);
+            _results->offsets[q + 1] = static_cast<uint32_t>(found.size() - before);
+        }
+    }
+
+    ////
+    // void batch(Job, size_t, QueryResults&)
+    //
+    // Runs a batch on as many threads as it's worth, then turns the counts
+    // into offsets and copies each thread's indices to its slice's.
+    void SpatialHash::batch(Job job, size_t queries, QueryResults& results) {
+        _job = job;
+        _queries = queries;
+        _results = &results;
+        results.offsets.assign(queries + 1, 0);
+
+        if (queries < parallelThreshold || _workers.empty()) {
+            _threads = 1;
+            run(0);
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _threads = _workers.size() + 1;
+                _finished = 0;
+                _generation++;
+            }
+            _wake.notify_all();
+
+            run(0);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [&] { return _finished == _workers.size(); });
+        }
+
+        for (size_t q = 0; q < queries; q++)
+            results.offsets[q + 1] += results.offsets[q];
+
+        results.indices.resize(results.offsets[queries]);
+        for (size_t thread = 0; thread < _threads; thread++) {
+            const std::vector<uint32_t>& found = _found[thread];
+            if (!found.empty()) {
+                size_t first = results.offsets[queries * thread / _threads];
+                std::memcpy(results.indices.data() + first, found.data(), found.size() * sizeof(uint32_t));
+            }
+            _stats.tested += _tested[thread];
+        }
+
+        _stats.queries += queries;
+        _stats.found += results.indices.size();
+    }
+
+    ////
+    // void radius(const Circle *, size_t, QueryResults&)
+    //
+    // Runs a batch of circle queries, replacing the results.
+    void SpatialHash::radius(const Circle *circles, size_t count, QueryResults& results) {
+        _circles = circles;
+        batch(Job::Circles, count, results);
+    }
+
+    ////
+    // void rects(const Box *, size_t, QueryResults&)
+    //
+    // Runs a batch of box queries, replacing the results.
+    void SpatialHash::rects(const Box *boxes, size_t count, QueryResults& results) {
+        _rects = boxes;
+        batch(Job::Rects, count, results);
+    }
+
+    ////
+    // size_t threads()
+    //
+    // The number of threads a large batch is split across.
+    size_t SpatialHash::threads() const {
+        return _workers.size() + 1;
+    }
+
+    ////
+    // const HashStats& stats()
+    //
+    // The counters of the last rebuild and the queries since.
+    const HashStats& SpatialHash::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void SpatialHash::report(std::ostream& out) const {
+        out << "Spatial hash: " << _stats.entities << " entities in " << _stats.buckets << " buckets, rebuilt in "
+            << _stats.rebuildNanos / 1000.0 << "us; " << _stats.queries << " queries tested "
+            << _stats.tested << " entities and found " << _stats.found << std::endl;
+    }
+}
@@ -0,0 +1,71 @@
+#include "../physics.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace wfn_eng::physics {
+    ////
+    // size_t overlap(const int32_t *, const int32_t *, const int32_t *,
+    //                const int32_t *, size_t, Box, uint32_t *)
+    //
+    // The AABB overlap kernel. Tests a query box against a run of boxes given
+    // as raw SoA bounds (minX, minY, maxX, maxY, count), writing the indices
+    // of the overlapping boxes, in order, into the output array (which must
+    // hold count entries). Returns the number of indices written.
+    //
+    // Processes four boxes per iteration with SSE2 where available.
+    size_t overlap(
+            const int32_t *minX,
+            const int32_t *minY,
+            const int32_t *maxX,
+            const int32_t *maxY,
+            size_t count,
+            Box query,
+            uint32_t *out) {
+        size_t written = 0;
+        size_t i = 0;
+
+#if defined(__SSE2__)
+        const __m128i qMinX = _mm_set1_epi32(query.minX.raw);
+        const __m128i qMinY = _mm_set1_epi32(query.minY.raw);
+        const __m128i qMaxX = _mm_set1_epi32(query.maxX.raw);
+        const __m128i qMaxY = _mm_set1_epi32(query.maxY.raw);
+
+        for (; i + 4 <= count; i += 4) {
+            __m128i bMinX = _mm_loadu_si128(reinterpret_cast<const __m128i *>(minX + i));
+            __m128i bMinY = _mm_loadu_si128(reinterpret_cast<const __m128i *>(minY + i));
+            __m128i bMaxX = _mm_loadu_si128(reinterpret_cast<const __m128i *>(maxX + i));
+            __m128i bMaxY = _mm_loadu_si128(reinterpret_cast<const __m128i *>(maxY + i));
+
+            // Two boxes are apart if either one starts after the other ends,
+            // along either axis.
+            __m128i apart = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_cmpgt_epi32(bMinX, qMaxX),
+                    _mm_cmpgt_epi32(qMinX, bMaxX)
+                ),
+                _mm_or_si128(
+                    _mm_cmpgt_epi32(bMinY, qMaxY),
+                    _mm_cmpgt_epi32(qMinY, bMaxY)
+                )
+            );
+
+            int hits = ~_mm_movemask_ps(_mm_castsi128_ps(apart)) & 0xF;
+            while (hits) {
+                out[written++] = static_cast<uint32_t>(i + __builtin_ctz(hits));
+                hits &= hits - 1;
+            }
+        }
+#endif
+
+        for (; i < count; i++) {
+            bool apart = minX[i] > query.maxX.raw || query.minX.raw > maxX[i] ||
+                         minY[i] > query.maxY.raw || query.minY.raw > maxY[i];
+            if (!apart)
+                out[written++] = static_cast<uint32_t>(i);
+        }
+
+        return written;
+    }
+}
@@ -0,0 +1,310 @@
+#ifndef __WFN_ENG_RENDER_HPP__
+#define __WFN_ENG_RENDER_HPP__
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "error.hpp"
+#include "vulkan.hpp"
+
+namespace wfn_eng::render {
+    ////
+    // namespace key
+    //
+    // Packs the 64-bit sort key of a draw. Draws are submitted in increasing
+    // key order, so the most significant fields are the ones whose changes
+    // cost the most:
+    //
+    //   opaque:      layer:6 | 0 | pipeline:12 | material:16 | depth:24 | 0:5
+    //   translucent: layer:6 | 1 | ~depth:24 | pipeline:12 | material:16 | 0:5
+    //
+    // Opaque draws are grouped by pipeline, then material, then sorted front
+    // to back (for early depth rejection). Translucent draws come after the
+    // opaque ones of their layer, back to front, since blending needs it.
+    namespace key {
+        const int layerBits    = 6;
+        const int pipelineBits = 12;
+        const int materialBits = 16;
+        const int depthBits    = 24;
+
+        ////
+        // uint32_t depth(float, float, float)
+        //
+        // Quantizes a view-space depth between the provided near and far
+        // planes to depthBits. Values outside of the range are clamped.
+        uint32_t depth(float, float, float);
+
+        ////
+        // uint64_t opaque(uint32_t, uint32_t, uint32_t, uint32_t)
+        //
+        // The key of an opaque draw from its layer, pipeline, material and
+        // quantized depth. Every field is masked to its width.
+        uint64_t opaque(uint32_t, uint32_t, uint32_t, uint32_t);
+
+        ////
+        // uint64_t translucent(uint32_t, uint32_t, uint32_t, uint32_t)
+        //
+        // The key of a translucent draw from its layer, pipeline, material
+        // and quantized depth.
+        uint64_t translucent(uint32_t, uint32_t, uint32_t, uint32_t);
+
+        ////
+        // bool isTranslucent(uint64_t)
+        //
+        // Whether a key was made by translucent.
+        inline bool isTranslucent(uint64_t key) {
+            return (key >> (63 - layerBits)) & 1;
+        }
+    }
+
+    ////
+    // struct SortItem
+    //
+    // A key and the index of the draw it was made for.
+    struct SortItem {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    ////
+    // class RadixSorter
+    //
+    // A stable LSD radix sort over SortItems, 8 bits per pass. Each pass is
+    // split across a set of worker threads (plus the calling one): every
+    // thread builds the histogram of its slice, the prefix sums give each
+    // thread its own output offsets per digit, then the slices are scattered
+    // in parallel. Passes where every key has the same digit (e.g. the layer
+    // byte when everything is on one layer) are skipped.
+    //
+    // The workers are started once and sleep between sorts; sorting
+    // allocates nothing.
+    class RadixSorter {
+        static const size_t radix = 256;
+        static const int passes = 8;
+
+        std::vector<std::thread> _workers;
+        std::vector<std::array<uint32_t, radix>> _histograms;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        uint64_t _generation;
+        size_t _finished;
+        bool _quitting;
+
+        SortItem *_items;
+        SortItem *_scratch;
+        SortItem *_result;
+        size_t _count;
+        size_t _threads;
+
+        std::atomic<size_t> _arrived;
+        std::atomic<uint64_t> _phase;
+
+        ////
+        // void workLoop(size_t)
+        //
+        // The body of a worker thread.
+        void workLoop(size_t);
+
+        ////
+        // void run(size_t)
+        //
+        // Runs every pass over one thread's slice.
+        void run(size_t);
+
+        ////
+        // void barrier()
+        //
+        // Waits until every thread taking part in the sort gets here.
+        void barrier();
+
+    public:
+        ////
+        // size_t parallelThreshold
+        //
+        // Below this many items, sorting stays on the calling thread.
+        static const size_t parallelThreshold = 4096;
+
+        ////
+        // RadixSorter(size_t)
+        //
+        // Starts a sorter using the provided number of threads, counting the
+        // calling one. 0 picks one per hardware thread, up to 8.
+        RadixSorter(size_t);
+
+        ////
+        // ~RadixSorter()
+        //
+        // Stops the workers.
+        ~RadixSorter();
+
+        ////
+        // SortItem *sort(SortItem *, SortItem *, size_t)
+        //
+        // Sorts items by key, using scratch (of at least the same size) as
+        // the other buffer. Returns whichever of the two holds the result.
+        SortItem *sort(SortItem *, SortItem *, size_t);
+
+        ////
+        // size_t threads()
+        //
+        // The number of threads a large sort is split across.
+        size_t threads() const;
+
+        // Following Rule of 3's
+        RadixSorter(const RadixSorter&) = delete;
+        RadixSorter& operator=(const RadixSorter&) = delete;
+    };
+
+    ////
+    // struct Draw
+    //
+    // Everything needed to record one draw. A null descriptor set or buffer
+    // is not bound; an indexCount of 0 makes a non-indexed draw.
+    struct Draw {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkDescriptorSet material = VK_NULL_HANDLE;
+
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkDeviceSize vertexOffset = 0;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkDeviceSize indexOffset = 0;
+
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        uint32_t instanceCount = 1;
+        uint32_t firstVertex = 0;
+        uint32_t firstIndex = 0;
+        int32_t baseVertex = 0;
+    };
+
+    ////
+    // struct QueueStats
+    //
+    // What the last recorded frame cost. The naive count is the number of
+    // binds recording every draw with all of its own binds would have
+    // taken.
+    struct QueueStats {
+        uint64_t draws = 0;
+        uint64_t pipelineBinds = 0;
+        uint64_t descriptorBinds = 0;
+        uint64_t vertexBinds = 0;
+        uint64_t indexBinds = 0;
+        uint64_t naiveBinds = 0;
+        uint64_t sortNanos = 0;
+
+        ////
+        // uint64_t binds()
+        //
+        // The number of binds issued.
+        uint64_t binds() const {
+            return pipelineBinds + descriptorBinds + vertexBinds + indexBinds;
+        }
+
+        ////
+        // uint64_t bindsSaved()
+        //
+        // The number of binds sorting and filtering saved.
+        uint64_t bindsSaved() const { return naiveBinds - binds(); }
+    };
+
+    ////
+    // class RenderQueue
+    //
+    // Collects a frame's draws along with their sort keys, sorts them, and
+    // records them with the binds that would not change anything filtered
+    // out. Storage is kept between frames, so after the first few frames
+    // pushing, sorting and recording allocate nothing.
+    class RenderQueue {
+        std::vector<Draw> _draws;
+        std::vector<SortItem> _items;
+        std::vector<SortItem> _scratch;
+        SortItem *_sorted;
+        bool _isSorted;
+        RadixSorter _sorter;
+        QueueStats _stats;
+
+        ////
+        // template <typename Visitor> void walk(Visitor&)
+        //
+        // Visits the draws in sorted order, calling the provided visitor for
+        // each bind that changes state and for each draw.
+        template <typename Visitor>
+        void walk(Visitor&);
+
+    public:
+        ////
+        // RenderQueue(size_t)
+        //
+        // Constructs an empty queue, sorting with the provided number of
+        // threads (0 for one per hardware thread).
+        RenderQueue(size_t = 0);
+
+        ////
+        // void clear()
+        //
+        // Drops every draw, keeping the storage.
+        void clear();
+
+        ////
+        // void push(uint64_t, const Draw&)
+        //
+        // Adds a draw with the provided sort key (see namespace key).
+        void push(uint64_t, const Draw&);
+
+        ////
+        // void sort()
+        //
+        // Sorts the draws by key. Recording sorts first if this was not
+        // called.
+        void sort();
+
+        ////
+        // void record(VkCommandBuffer, const vulkan::DeviceTable&)
+        //
+        // Records the draws in key order into a command buffer inside a
+        // render pass, then updates the stats.
+        void record(VkCommandBuffer, const vulkan::DeviceTable&);
+
+        ////
+        // QueueStats measure()
+        //
+        // Counts the binds record would issue, without recording anything.
+        QueueStats measure();
+
+        ////
+        // size_t size()
+        //
+        // The number of draws pushed since the last clear.
+        size_t size() const;
+
+        ////
+        // const QueueStats& stats()
+        //
+        // The stats of the last record.
+        const QueueStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Prints the stats of the last record.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        RenderQueue(const RenderQueue&) = delete;
+        RenderQueue& operator=(const RenderQueue&) = delete;
+    };
+}
+
+#endif
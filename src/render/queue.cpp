@@ -0,0 +1,319 @@
+#include "../render.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace wfn_eng::render::key {
+    ////
+    // uint32_t depth(float, float, float)
+    //
+    // Quantizes a view-space depth between the provided near and far planes
+    // to depthBits. Values outside of the range are clamped.
+    uint32_t depth(float value, float near, float far) {
+        const uint32_t max = (1u << depthBits) - 1;
+
+        float t = (value - near) / (far - near);
+        if (!(t > 0.0f))
+            return 0;
+        if (t >= 1.0f)
+            return max;
+
+        return static_cast<uint32_t>(t * max);
+    }
+
+    ////
+    // uint64_t field(uint32_t, int)
+    //
+    // Masks a value to the provided number of bits.
+    static uint64_t field(uint32_t value, int bits) {
+        return value & ((1ull << bits) - 1);
+    }
+
+    ////
+    // uint64_t opaque(uint32_t, uint32_t, uint32_t, uint32_t)
+    //
+    // The key of an opaque draw from its layer, pipeline, material and
+    // quantized depth. Every field is masked to its width.
+    uint64_t opaque(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t depth) {
+        int shift = 64 - layerBits;
+        uint64_t key = field(layer, layerBits) << shift;
+
+        shift -= 1;
+        shift -= pipelineBits;
+        key |= field(pipeline, pipelineBits) << shift;
+        shift -= materialBits;
+        key |= field(material, materialBits) << shift;
+        shift -= depthBits;
+        key |= field(depth, depthBits) << shift;
+
+        return key;
+    }
+
+    ////
+    // uint64_t translucent(uint32_t, uint32_t, uint32_t, uint32_t)
+    //
+    // The key of a translucent draw from its layer, pipeline, material and
+    // quantized depth. The depth is inverted, so further draws come first.
+    uint64_t translucent(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t depth) {
+        int shift = 64 - layerBits;
+        uint64_t key = field(layer, layerBits) << shift;
+
+        shift -= 1;
+        key |= 1ull << shift;
+        shift -= depthBits;
+        key |= field(~depth, depthBits) << shift;
+        shift -= pipelineBits;
+        key |= field(pipeline, pipelineBits) << shift;
+        shift -= materialBits;
+        key |= field(material, materialBits) << shift;
+
+        return key;
+    }
+}
+
+namespace wfn_eng::render {
+    ////
+    // class RenderQueue
+    //
+    // Collects a frame's draws along with their sort keys, sorts them, and
+    // records them with redundant binds filtered out.
+
+    ////
+    // RenderQueue(size_t)
+    //
+    // Constructs an empty queue, sorting with the provided number of threads
+    // (0 for one per hardware thread).
+    RenderQueue::RenderQueue(size_t threads)
+            : _sorted(nullptr)
+            , _isSorted(false)
+            , _sorter(threads) { }
+
+    ////
+    // void clear()
+    //
+    // Drops every draw, keeping the storage.
+    void RenderQueue::clear() {
+        _draws.clear();
+        _items.clear();
+        _sorted = nullptr;
+        _isSorted = false;
+    }
+
+    ////
+    // void push(uint64_t, const Draw&)
+    //
+    // Adds a draw with the provided sort key (see namespace key).
+    void RenderQueue::push(uint64_t key, const Draw& draw) {
+        _items.push_back(SortItem { key, static_cast<uint32_t>(_draws.size()) });
+        _draws.push_back(draw);
+        _isSorted = false;
+    }
+
+    ////
+    // void sort()
+    //
+    // Sorts the draws by key. Recording sorts first if this was not called.
+    void RenderQueue::sort() {
+        auto start = std::chrono::steady_clock::now();
+
+        if (_scratch.size() < _items.size())
+            _scratch.resize(_items.size());
+
+        _sorted = _sorter.sort(_items.data(), _scratch.data(), _items.size());
+        _isSorted = true;
+
+        _stats.sortNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start
+        ).count();
+    }
+
+    ////
+    // template <typename Visitor> void walk(Visitor&)
+    //
+    // Visits the draws in sorted order, calling the provided visitor for
+    // each bind that changes state and for each draw. Descriptor sets stay
+    // bound across pipelines with the same layout, so only a layout change
+    // forces the material to be bound again.
+    template <typename Visitor>
+    void RenderQueue::walk(Visitor& visitor) {
+        if (!_isSorted)
+            sort();
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkDescriptorSet material = VK_NULL_HANDLE;
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkDeviceSize vertexOffset = 0;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkDeviceSize indexOffset = 0;
+
+        for (size_t i = 0; i < _items.size(); i++) {
+            const Draw& draw = _draws[_sorted[i].index];
+
+            if (draw.pipeline != pipeline) {
+                visitor.pipeline(draw);
+                pipeline = draw.pipeline;
+            }
+
+            if (draw.layout != layout) {
+                layout = draw.layout;
+                material = VK_NULL_HANDLE;
+            }
+
+            if (draw.material != VK_NULL_HANDLE && draw.material != material) {
+                visitor.material(draw);
+                material = draw.material;
+            }
+
+            if (draw.vertexBuffer != VK_NULL_HANDLE &&
+                (draw.vertexBuffer != vertexBuffer || draw.vertexOffset != vertexOffset)) {
+                visitor.vertexBuffer(draw);
+                vertexBuffer = draw.vertexBuffer;
+                vertexOffset = draw.vertexOffset;
+            }
+
+            if (draw.indexCount > 0 &&
+                (draw.indexBuffer != indexBuffer || draw.indexOffset != indexOffset)) {
+                visitor.indexBuffer(draw);
+                indexBuffer = draw.indexBuffer;
+                indexOffset = draw.indexOffset;
+            }
+
+            visitor.draw(draw);
+        }
+    }
+
+    ////
+    // struct BindCounter
+    //
+    // A walk visitor counting binds.
+    struct BindCounter {
+        QueueStats& stats;
+
+        void pipeline(const Draw&) { stats.pipelineBinds++; }
+        void material(const Draw&) { stats.descriptorBinds++; }
+        void vertexBuffer(const Draw&) { stats.vertexBinds++; }
+        void indexBuffer(const Draw&) { stats.indexBinds++; }
+
+        void draw(const Draw& draw) {
+            stats.draws++;
+            stats.naiveBinds += 1
+                + (draw.material != VK_NULL_HANDLE)
+                + (draw.vertexBuffer != VK_NULL_HANDLE)
+                + (draw.indexCount > 0);
+        }
+    };
+
+    ////
+    // struct BindRecorder
+    //
+    // A walk visitor recording into a command buffer, and counting binds.
+    struct BindRecorder : BindCounter {
+        VkCommandBuffer cmd;
+        const vulkan::DeviceTable& vk;
+
+        BindRecorder(QueueStats& stats, VkCommandBuffer cmd, const vulkan::DeviceTable& vk)
+                : BindCounter { stats }
+                , cmd(cmd)
+                , vk(vk) { }
+
+        void pipeline(const Draw& draw) {
+            BindCounter::pipeline(draw);
+            vk.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+        }
+
+        void material(const Draw& draw) {
+            BindCounter::material(draw);
+            vk.vkCmdBindDescriptorSets(
+                cmd,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                draw.layout,
+                0,
+                1,
+                &draw.material,
+                0,
+                nullptr
+            );
+        }
+
+        void vertexBuffer(const Draw& draw) {
+            BindCounter::vertexBuffer(draw);
+            vk.vkCmdBindVertexBuffers(cmd, 0, 1, &draw.vertexBuffer, &draw.vertexOffset);
+        }
+
+        void indexBuffer(const Draw& draw) {
+            BindCounter::indexBuffer(draw);
+            vk.vkCmdBindIndexBuffer(cmd, draw.indexBuffer, draw.indexOffset, VK_INDEX_TYPE_UINT32);
+        }
+
+        void draw(const Draw& draw) {
+            BindCounter::draw(draw);
+            if (draw.indexCount > 0) {
+                vk.vkCmdDrawIndexed(
+                    cmd,
+                    draw.indexCount,
+                    draw.instanceCount,
+                    draw.firstIndex,
+                    draw.baseVertex,
+                    0
+                );
+            } else {
+                vk.vkCmdDraw(cmd, draw.vertexCount, draw.instanceCount, draw.firstVertex, 0);
+            }
+        }
+    };
+
+    ////
+    // void record(VkCommandBuffer, const vulkan::DeviceTable&)
+    //
+    // Records the draws in key order into a command buffer inside a render
+    // pass, then updates the stats.
+    void RenderQueue::record(VkCommandBuffer cmd, const vulkan::DeviceTable& vk) {
+        QueueStats stats;
+        BindRecorder recorder(stats, cmd, vk);
+        walk(recorder);
+
+        stats.sortNanos = _stats.sortNanos;
+        _stats = stats;
+    }
+
+    ////
+    // QueueStats measure()
+    //
+    // Counts the binds record would issue, without recording anything.
+    QueueStats RenderQueue::measure() {
+        QueueStats stats;
+        BindCounter counter { stats };
+        walk(counter);
+
+        stats.sortNanos = _stats.sortNanos;
+        return stats;
+    }
+
+    ////
+    // size_t size()
+    //
+    // The number of draws pushed since the last clear.
+    size_t RenderQueue::size() const { return _draws.size(); }
+
+    ////
+    // const QueueStats& stats()
+    //
+    // The stats of the last record.
+    const QueueStats& RenderQueue::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Prints the stats of the last record.
+    void RenderQueue::report(std::ostream& out) const {
+        out << "Render queue: " << _stats.draws << " draws, "
+            << _stats.binds() << " binds ("
+            << _stats.pipelineBinds << " pipeline, "
+            << _stats.descriptorBinds << " descriptor, "
+            << _stats.vertexBinds << " vertex, "
+            << _stats.indexBinds << " index), "
+            << _stats.bindsSaved() << " saved of " << _stats.naiveBinds
+            << ", sorted in " << _stats.sortNanos / 1000.0 << "us" << std::endl;
+    }
+}
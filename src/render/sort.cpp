@@ -0,0 +1,189 @@
+#include "../render.hpp"
+
+#include <algorithm>
+
+namespace wfn_eng::render {
+    ////
+    // class RadixSorter
+    //
+    // A stable LSD radix sort over SortItems, 8 bits per pass.
+
+    ////
+    // RadixSorter(size_t)
+    //
+    // Starts a sorter using the provided number of threads, counting the
+    // calling one. 0 picks one per hardware thread, up to 8.
+    RadixSorter::RadixSorter(size_t threads)
+            : _generation(0)
+            , _finished(0)
+            , _quitting(false)
+            , _items(nullptr)
+            , _scratch(nullptr)
+            , _result(nullptr)
+            , _count(0)
+            , _threads(1)
+            , _arrived(0)
+            , _phase(0) {
+        if (threads == 0)
+            threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), 8);
+
+        _histograms.resize(threads);
+        for (size_t i = 1; i < threads; i++)
+            _workers.emplace_back(&RadixSorter::workLoop, this, i);
+    }
+
+    ////
+    // ~RadixSorter()
+    //
+    // Stops the workers.
+    RadixSorter::~RadixSorter() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quitting = true;
+        }
+        _wake.notify_all();
+
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    ////
+    // void workLoop(size_t)
+    //
+    // The body of a worker thread.
+    void RadixSorter::workLoop(size_t thread) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _quitting || _generation != seen; });
+                if (_quitting)
+                    return;
+                seen = _generation;
+            }
+
+            run(thread);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (++_finished == _workers.size())
+                _done.notify_one();
+        }
+    }
+
+    ////
+    // void barrier()
+    //
+    // Waits until every thread taking part in the sort gets here. Passes
+    // are far shorter than a sleep and wake-up, so this spins.
+    void RadixSorter::barrier() {
+        if (_threads == 1)
+            return;
+
+        uint64_t phase = _phase.load(std::memory_order_acquire);
+        if (_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == _threads) {
+            _arrived.store(0, std::memory_order_relaxed);
+            _phase.fetch_add(1, std::memory_order_release);
+        } else {
+            while (_phase.load(std::memory_order_acquire) == phase)
+                std::this_thread::yield();
+        }
+    }
+
+    ////
+    // void run(size_t)
+    //
+    // Runs every pass over one thread's slice. Every thread takes the same
+    // decisions (which passes to skip, which buffer is the source) from the
+    // same shared histograms, so they stay in step without talking.
+    void RadixSorter::run(size_t thread) {
+        size_t begin = _count * thread / _threads;
+        size_t end = _count * (thread + 1) / _threads;
+
+        SortItem *src = _items;
+        SortItem *dst = _scratch;
+
+        for (int pass = 0; pass < passes; pass++) {
+            int shift = pass * 8;
+
+            auto& histogram = _histograms[thread];
+            histogram.fill(0);
+            for (size_t i = begin; i < end; i++)
+                histogram[(src[i].key >> shift) & (radix - 1)]++;
+
+            barrier();
+
+            // Where each digit starts in the output, and where this thread's
+            // items of each digit go within that.
+            size_t totals[radix] = {};
+            size_t offsets[radix] = {};
+            for (size_t t = 0; t < _threads; t++) {
+                for (size_t d = 0; d < radix; d++) {
+                    if (t < thread)
+                        offsets[d] += _histograms[t][d];
+                    totals[d] += _histograms[t][d];
+                }
+            }
+
+            bool uniform = false;
+            size_t start = 0;
+            for (size_t d = 0; d < radix; d++) {
+                if (totals[d] == _count)
+                    uniform = true;
+                offsets[d] += start;
+                start += totals[d];
+            }
+
+            if (!uniform) {
+                for (size_t i = begin; i < end; i++)
+                    dst[offsets[(src[i].key >> shift) & (radix - 1)]++] = src[i];
+                std::swap(src, dst);
+            }
+
+            // No thread may start the next histogram before everyone's done
+            // reading this one (and writing their slice).
+            barrier();
+        }
+
+        if (thread == 0)
+            _result = src;
+    }
+
+    ////
+    // SortItem *sort(SortItem *, SortItem *, size_t)
+    //
+    // Sorts items by key, using scratch (of at least the same size) as the
+    // other buffer. Returns whichever of the two holds the result.
+    SortItem *RadixSorter::sort(SortItem *items, SortItem *scratch, size_t count) {
+        _items = items;
+        _scratch = scratch;
+        _count = count;
+
+        if (count < parallelThreshold || _workers.empty()) {
+            _threads = 1;
+            run(0);
+            return _result;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _threads = _workers.size() + 1;
+            _finished = 0;
+            _generation++;
+        }
+        _wake.notify_all();
+
+        run(0);
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [&] { return _finished == _workers.size(); });
+        return _result;
+    }
+
+    ////
+    // size_t threads()
+    //
+    // The number of threads a large sort is split across.
+    size_t RadixSorter::threads() const {
+        return _workers.size() + 1;
+    }
+}
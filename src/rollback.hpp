@@ -0,0 +1,435 @@
+#ifndef __WFN_ENG_ROLLBACK_HPP__
+#define __WFN_ENG_ROLLBACK_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::rollback {
+    ////
+    // Input
+    //
+    // The per-player, per-tick input that drives the simulation. Each bit is a
+    // button (or a direction), so inputs compare and copy as plain integers.
+    typedef uint16_t Input;
+
+    ////
+    // uint64_t hash(const void *, size_t)
+    //
+    // A fast, deterministic 64-bit hash over a block of memory. Used to
+    // checksum simulation state so that peers can detect desyncs. The result
+    // only depends on the bytes, so it is identical on every machine with the
+    // same endianness.
+    uint64_t hash(const void *, size_t);
+
+    ////
+    // class StateArena
+    //
+    // A fixed-capacity, contiguous block of memory that holds the entire
+    // simulation state. Everything the simulation needs to rewind must be
+    // allocated out of the arena and must be trivially copyable, so that
+    // taking a snapshot is a single memcpy of the used bytes.
+    class StateArena {
+        std::byte *_data;
+        size_t _capacity;
+        size_t _used;
+
+        friend class SnapshotRing;
+
+    public:
+        ////
+        // size_t alignment
+        //
+        // The alignment of the arena (and of every snapshot of it). Matches a
+        // cache line so that snapshot copies stay on aligned boundaries.
+        static constexpr size_t alignment = 64;
+
+        ////
+        // StateArena(size_t)
+        //
+        // Reserves an arena able to hold the provided number of bytes.
+        StateArena(size_t);
+
+        ////
+        // ~StateArena()
+        //
+        // Releases the arena memory.
+        ~StateArena();
+
+        ////
+        // void *allocate(size_t, size_t)
+        //
+        // Allocates a zeroed block of the provided size and alignment out of
+        // the arena. Throws a WfnError when the arena is exhausted, since the
+        // arena never grows (growing would invalidate every pointer into it).
+        void *allocate(size_t, size_t);
+
+        ////
+        // T *allocate<T>(size_t)
+        //
+        // Typed helper around allocate for an array of trivially copyable
+        // values.
+        template <typename T>
+        T *allocate(size_t count = 1) {
+            static_assert(
+                std::is_trivially_copyable_v<T>,
+                "Simulation state must be trivially copyable"
+            );
+
+            return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        ////
+        // void clear()
+        //
+        // Discards every allocation, zeroing the used bytes.
+        void clear();
+
+        ////
+        // std::byte *data()
+        //
+        // Provides access to the start of the arena.
+        std::byte *data();
+
+        ////
+        // size_t used()
+        //
+        // The number of bytes currently allocated, aka the snapshot size.
+        size_t used() const;
+
+        ////
+        // size_t capacity()
+        //
+        // The total number of bytes the arena can hold.
+        size_t capacity() const;
+
+        ////
+        // uint64_t checksum()
+        //
+        // Hashes the used bytes of the arena.
+        uint64_t checksum() const;
+
+        // Following Rule of 3's
+        StateArena(const StateArena&) = delete;
+        StateArena& operator=(const StateArena&) = delete;
+    };
+
+    ////
+    // struct SnapshotStats
+    //
+    // Timing information on the snapshot ring, used to keep track of how much
+    // of the frame rollback costs as the state grows. Hashing a snapshot is
+    // timed apart from saving it, since only desync checks need it.
+    struct SnapshotStats {
+        uint64_t saves = 0;
+        uint64_t restores = 0;
+        uint64_t lastSaveNanos = 0;
+        uint64_t lastRestoreNanos = 0;
+        uint64_t maxSaveNanos = 0;
+        uint64_t maxRestoreNanos = 0;
+        uint64_t totalSaveNanos = 0;
+        uint64_t totalRestoreNanos = 0;
+        uint64_t hashes = 0;
+        uint64_t totalHashNanos = 0;
+    };
+
+    ////
+    // class SnapshotRing
+    //
+    // A ring of snapshots of a StateArena, indexed by frame number. Every
+    // slot is a full copy of the arena in one contiguous allocation, so saving
+    // and restoring are straight memcpys.
+    class SnapshotRing {
+        struct Slot {
+            uint32_t frame;
+            bool valid;
+            bool hashed;
+            size_t size;
+            uint64_t checksum;
+        };
+
+        StateArena& _arena;
+        std::byte *_storage;
+        size_t _stride;
+        std::vector<Slot> _slots;
+        SnapshotStats _stats;
+
+        ////
+        // Slot& slot(uint32_t)
+        //
+        // Finds the slot a frame maps onto.
+        Slot& slot(uint32_t);
+        const Slot& slot(uint32_t) const;
+
+    public:
+        ////
+        // SnapshotRing(StateArena&, size_t)
+        //
+        // Constructs a ring holding the provided number of snapshots of a
+        // StateArena.
+        SnapshotRing(StateArena&, size_t);
+
+        ////
+        // ~SnapshotRing()
+        //
+        // Releases the snapshot storage.
+        ~SnapshotRing();
+
+        ////
+        // void save(uint32_t)
+        //
+        // Copies the current state of the arena into the slot for the provided
+        // frame.
+        void save(uint32_t);
+
+        ////
+        // void restore(uint32_t)
+        //
+        // Copies the snapshot of the provided frame back into the arena.
+        // Throws a WfnError if the frame is no longer held by the ring.
+        void restore(uint32_t);
+
+        ////
+        // bool holds(uint32_t)
+        //
+        // Checks whether the ring still holds a snapshot of the frame.
+        bool holds(uint32_t) const;
+
+        ////
+        // uint64_t checksum(uint32_t)
+        //
+        // Provides the checksum of a held snapshot, hashing it the first time
+        // it's asked for.
+        uint64_t checksum(uint32_t);
+
+        ////
+        // size_t depth()
+        //
+        // The number of snapshots the ring can hold.
+        size_t depth() const;
+
+        ////
+        // const SnapshotStats& stats()
+        //
+        // Provides the save and restore timings of the ring.
+        const SnapshotStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the timings.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        SnapshotRing(const SnapshotRing&) = delete;
+        SnapshotRing& operator=(const SnapshotRing&) = delete;
+    };
+
+    ////
+    // struct SessionStats
+    //
+    // Rollback counters for a Session.
+    struct SessionStats {
+        uint64_t rollbacks = 0;
+        uint64_t resimulatedFrames = 0;
+        uint32_t maxRollback = 0;
+        uint64_t desyncs = 0;
+    };
+
+    ////
+    // class Session
+    //
+    // Drives a rollback simulation. Inputs of remote players are predicted
+    // (by repeating their last known input) until the real inputs arrive. If a
+    // prediction turns out to be wrong, the state is restored to the first
+    // mispredicted frame and re-simulated up to the present.
+    class Session {
+    public:
+        ////
+        // Step
+        //
+        // Advances the simulation held in the arena by a single tick, given
+        // one Input per player.
+        typedef std::function<void (const Input *)> Step;
+
+    private:
+        StateArena& _arena;
+        SnapshotRing _ring;
+        Step _step;
+
+        size_t _players;
+        size_t _localPlayer;
+
+        std::vector<Input> _inputs;
+        std::vector<uint8_t> _known;
+        std::vector<int64_t> _slotFrame;
+        std::vector<Input> _lastKnown;
+        std::vector<int64_t> _lastKnownFrame;
+        std::vector<int64_t> _confirmedFrame;
+
+        uint32_t _frame;
+        int64_t _rollbackTo;
+        SessionStats _stats;
+
+        ////
+        // size_t slot(uint32_t)
+        //
+        // Finds the index of a frame in the input ring, clearing the slot if
+        // it last held an older frame.
+        size_t slot(uint32_t);
+
+        ////
+        // void predict(uint32_t)
+        //
+        // Fills in the predicted inputs of a frame.
+        void predict(uint32_t);
+
+        ////
+        // void simulate(uint32_t)
+        //
+        // Saves the state of a frame and then steps it.
+        void simulate(uint32_t);
+
+    public:
+        ////
+        // Session(StateArena&, size_t, size_t, size_t, Step)
+        //
+        // Constructs a session over the provided arena, with the following
+        // information (in order of argument list):
+        //   - Depth        (the maximum number of frames to roll back)
+        //   - Players      (the number of players)
+        //   - Local player (the index of the player on this machine)
+        //   - Step         (the simulation step function)
+        Session(StateArena&, size_t, size_t, size_t, Step);
+
+        ////
+        // void addLocalInput(Input)
+        //
+        // Registers the input of the local player for the current frame.
+        void addLocalInput(Input);
+
+        ////
+        // void addRemoteInput(size_t, uint32_t, Input)
+        //
+        // Registers the real input of a remote player for a frame, scheduling
+        // a rollback if the frame was already simulated with a different
+        // prediction. Inputs may arrive out of order. Throws a WfnError for
+        // an invalid player, a frame whose input is already known, or a
+        // frame outside of the window that can still be rolled back to.
+        void addRemoteInput(size_t, uint32_t, Input);
+
+        ////
+        // bool canAdvance()
+        //
+        // Whether the current frame can be simulated without getting further
+        // ahead of the remote players than the snapshot ring can rewind.
+        bool canAdvance() const;
+
+        ////
+        // void advance()
+        //
+        // Performs any pending rollback and then simulates the current frame.
+        void advance();
+
+        ////
+        // bool verify(uint32_t, uint64_t)
+        //
+        // Compares the checksum of a confirmed frame against the one reported
+        // by a remote peer, counting a desync on mismatch. Only meaningful
+        // after advance, once any pending rollback has been applied.
+        bool verify(uint32_t, uint64_t);
+
+        ////
+        // uint32_t frame()
+        //
+        // The next frame to be simulated.
+        uint32_t frame() const;
+
+        ////
+        // int64_t confirmedFrame()
+        //
+        // The latest frame up to which the inputs of every player are known,
+        // or -1 if there is none yet.
+        int64_t confirmedFrame() const;
+
+        ////
+        // uint64_t checksum(uint32_t)
+        //
+        // The checksum of the state at the start of a held frame.
+        uint64_t checksum(uint32_t);
+
+        ////
+        // const SnapshotRing& snapshots()
+        //
+        // Provides access to the snapshot ring (and its timings).
+        const SnapshotRing& snapshots() const;
+
+        ////
+        // const SessionStats& stats()
+        //
+        // Provides the rollback counters of the session.
+        const SessionStats& stats() const;
+
+        // Following Rule of 3's
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+    };
+
+    ////
+    // class LoopbackPeer
+    //
+    // A local stand-in for a network connection. Inputs sent into it are
+    // delivered after a fixed number of ticks (plus optional deterministic
+    // jitter, which reorders them like datagrams), which is enough to
+    // exercise prediction and rollback without a socket.
+    class LoopbackPeer {
+        struct Packet {
+            uint64_t deliverAt;
+            size_t player;
+            uint32_t frame;
+            Input input;
+        };
+
+        uint32_t _delay;
+        uint32_t _jitter;
+        uint64_t _tick;
+        uint64_t _seed;
+        std::deque<Packet> _packets;
+
+    public:
+        ////
+        // LoopbackPeer(uint32_t, uint32_t)
+        //
+        // Constructs a loopback peer that delays every packet by the first
+        // argument in ticks, plus up to the second argument in jitter.
+        LoopbackPeer(uint32_t, uint32_t = 0);
+
+        ////
+        // void send(size_t, uint32_t, Input)
+        //
+        // Sends the input of a player for a frame.
+        void send(size_t, uint32_t, Input);
+
+        ////
+        // void tick(Session&)
+        //
+        // Advances the peer by a tick, delivering every packet that is due to
+        // the session, in the order they fall due. A packet sent later with
+        // less jitter can overtake an earlier one.
+        void tick(Session&);
+
+        ////
+        // size_t inFlight()
+        //
+        // The number of packets that have not been delivered yet.
+        size_t inFlight() const;
+    };
+}
+
+#endif
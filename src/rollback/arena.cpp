@@ -0,0 +1,198 @@
+#include "../rollback.hpp"
+
+#include <cstring>
+#include <new>
+
+////
+// Constants for the hash (these are the XXH64 primes).
+static const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hashRound(uint64_t acc, uint64_t lane) {
+    acc += lane * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc, uint64_t lane) {
+    acc ^= hashRound(0, lane);
+    return acc * prime1 + prime4;
+}
+
+////
+// size_t alignUp(size_t, size_t)
+//
+// Rounds a size up to a multiple of a (power of two) alignment.
+static size_t alignUp(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+namespace wfn_eng::rollback {
+    ////
+    // uint64_t hash(const void *, size_t)
+    //
+    // A fast, deterministic 64-bit hash over a block of memory. Used to
+    // checksum simulation state so that peers can detect desyncs. The result
+    // only depends on the bytes, so it is identical on every machine with the
+    // same endianness.
+    //
+    // This is XXH64 with a seed of 0: four independent lanes keep the
+    // multipliers busy, so hashing runs close to memcpy speed.
+    uint64_t hash(const void *data, size_t size) {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        const uint8_t *end = p + size;
+        uint64_t h;
+
+        if (size >= 32) {
+            uint64_t v1 = prime1 + prime2;
+            uint64_t v2 = prime2;
+            uint64_t v3 = 0;
+            uint64_t v4 = 0 - prime1;
+
+            const uint8_t *limit = end - 32;
+            do {
+                v1 = hashRound(v1, read64(p));
+                v2 = hashRound(v2, read64(p + 8));
+                v3 = hashRound(v3, read64(p + 16));
+                v4 = hashRound(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        } else {
+            h = prime5;
+        }
+
+        h += static_cast<uint64_t>(size);
+
+        for (; p + 8 <= end; p += 8) {
+            h ^= hashRound(0, read64(p));
+            h = rotl(h, 27) * prime1 + prime4;
+        }
+
+        if (p + 4 <= end) {
+            h ^= static_cast<uint64_t>(read32(p)) * prime1;
+            h = rotl(h, 23) * prime2 + prime3;
+            p += 4;
+        }
+
+        for (; p < end; p++) {
+            h ^= (*p) * prime5;
+            h = rotl(h, 11) * prime1;
+        }
+
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+
+        return h;
+    }
+
+    ////
+    // class StateArena
+    //
+    // A fixed-capacity, contiguous block of memory that holds the entire
+    // simulation state. Everything the simulation needs to rewind must be
+    // allocated out of the arena and must be trivially copyable, so that
+    // taking a snapshot is a single memcpy of the used bytes.
+
+    ////
+    // StateArena(size_t)
+    //
+    // Reserves an arena able to hold the provided number of bytes.
+    StateArena::StateArena(size_t capacity) :
+            _capacity(alignUp(capacity, alignment)),
+            _used(0) {
+        _data = static_cast<std::byte *>(
+            ::operator new(_capacity, std::align_val_t(alignment))
+        );
+
+        std::memset(_data, 0, _capacity);
+    }
+
+    ////
+    // ~StateArena()
+    //
+    // Releases the arena memory.
+    StateArena::~StateArena() {
+        ::operator delete(_data, std::align_val_t(alignment));
+    }
+
+    ////
+    // void *allocate(size_t, size_t)
+    //
+    // Allocates a zeroed block of the provided size and alignment out of
+    // the arena. Throws a WfnError when the arena is exhausted, since the
+    // arena never grows (growing would invalidate every pointer into it).
+    void *StateArena::allocate(size_t size, size_t align) {
+        size_t offset = alignUp(_used, align);
+        if (offset + size > _capacity) {
+            throw WfnError(
+                "wfn_eng::rollback::StateArena",
+                "allocate",
+                "Arena exhausted"
+            );
+        }
+
+        _used = offset + size;
+        return _data + offset;
+    }
+
+    ////
+    // void clear()
+    //
+    // Discards every allocation, zeroing the used bytes.
+    void StateArena::clear() {
+        std::memset(_data, 0, _used);
+        _used = 0;
+    }
+
+    ////
+    // std::byte *data()
+    //
+    // Provides access to the start of the arena.
+    std::byte *StateArena::data() { return _data; }
+
+    ////
+    // size_t used()
+    //
+    // The number of bytes currently allocated, aka the snapshot size.
+    size_t StateArena::used() const { return _used; }
+
+    ////
+    // size_t capacity()
+    //
+    // The total number of bytes the arena can hold.
+    size_t StateArena::capacity() const { return _capacity; }
+
+    ////
+    // uint64_t checksum()
+    //
+    // Hashes the used bytes of the arena.
+    uint64_t StateArena::checksum() const { return hash(_data, _used); }
+}
@@ -0,0 +1,68 @@
+#include "../rollback.hpp"
+
+#include <algorithm>
+
+namespace wfn_eng::rollback {
+    ////
+    // class LoopbackPeer
+    //
+    // A local stand-in for a network connection. Inputs sent into it are
+    // delivered after a fixed number of ticks (plus optional deterministic
+    // jitter, which reorders them like datagrams), which is enough to
+    // exercise prediction and rollback without a socket.
+
+    ////
+    // LoopbackPeer(uint32_t, uint32_t)
+    //
+    // Constructs a loopback peer that delays every packet by the first
+    // argument in ticks, plus up to the second argument in jitter.
+    LoopbackPeer::LoopbackPeer(uint32_t delay, uint32_t jitter) :
+            _delay(delay),
+            _jitter(jitter),
+            _tick(0),
+            _seed(0x2545F4914F6CDD1DULL) { }
+
+    ////
+    // void send(size_t, uint32_t, Input)
+    //
+    // Sends the input of a player for a frame. The packets stay sorted by
+    // when they fall due, and ones due on the same tick in the order they
+    // were sent.
+    void LoopbackPeer::send(size_t player, uint32_t frame, Input input) {
+        uint64_t deliverAt = _tick + _delay;
+        if (_jitter > 0) {
+            // xorshift64, so that runs are reproducible.
+            _seed ^= _seed << 13;
+            _seed ^= _seed >> 7;
+            _seed ^= _seed << 17;
+            deliverAt += _seed % (_jitter + 1);
+        }
+
+        auto at = std::upper_bound(
+            _packets.begin(), _packets.end(), deliverAt,
+            [](uint64_t due, const Packet& packet) { return due < packet.deliverAt; }
+        );
+        _packets.insert(at, Packet { deliverAt, player, frame, input });
+    }
+
+    ////
+    // void tick(Session&)
+    //
+    // Advances the peer by a tick, delivering every packet that is due to
+    // the session, in the order they fall due. A packet sent later with
+    // less jitter can overtake an earlier one.
+    void LoopbackPeer::tick(Session& session) {
+        _tick++;
+        while (!_packets.empty() && _packets.front().deliverAt <= _tick) {
+            const Packet& packet = _packets.front();
+            session.addRemoteInput(packet.player, packet.frame, packet.input);
+            _packets.pop_front();
+        }
+    }
+
+    ////
+    // size_t inFlight()
+    //
+    // The number of packets that have not been delivered yet.
+    size_t LoopbackPeer::inFlight() const { return _packets.size(); }
+}
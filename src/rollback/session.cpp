@@ -0,0 +1,253 @@
+#include "../rollback.hpp"
+
+#include <algorithm>
+
+namespace wfn_eng::rollback {
+    ////
+    // class Session
+    //
+    // Drives a rollback simulation. Inputs of remote players are predicted
+    // (by repeating their last known input) until the real inputs arrive. If a
+    // prediction turns out to be wrong, the state is restored to the first
+    // mispredicted frame and re-simulated up to the present.
+
+    ////
+    // size_t slot(uint32_t)
+    //
+    // Finds the index of a frame in the input ring, clearing the slot if
+    // it last held an older frame.
+    size_t Session::slot(uint32_t frame) {
+        size_t index = frame % _ring.depth();
+        if (_slotFrame[index] != frame) {
+            std::fill_n(_inputs.begin() + index * _players, _players, 0);
+            std::fill_n(_known.begin() + index * _players, _players, 0);
+            _slotFrame[index] = frame;
+        }
+
+        return index * _players;
+    }
+
+    ////
+    // void predict(uint32_t)
+    //
+    // Fills in the predicted inputs of a frame.
+    void Session::predict(uint32_t frame) {
+        size_t base = slot(frame);
+        for (size_t p = 0; p < _players; p++) {
+            if (!_known[base + p])
+                _inputs[base + p] = _lastKnown[p];
+        }
+    }
+
+    ////
+    // void simulate(uint32_t)
+    //
+    // Saves the state of a frame and then steps it.
+    void Session::simulate(uint32_t frame) {
+        predict(frame);
+        _ring.save(frame);
+        _step(_inputs.data() + slot(frame));
+    }
+
+    ////
+    // Session(StateArena&, size_t, size_t, size_t, Step)
+    //
+    // Constructs a session over the provided arena, with the following
+    // information (in order of argument list):
+    //   - Depth        (the maximum number of frames to roll back)
+    //   - Players      (the number of players)
+    //   - Local player (the index of the player on this machine)
+    //   - Step         (the simulation step function)
+    Session::Session(StateArena& arena, size_t depth, size_t players, size_t localPlayer, Step step) :
+            _arena(arena),
+            _ring(arena, depth),
+            _step(step),
+            _players(players),
+            _localPlayer(localPlayer),
+            _inputs(depth * players, 0),
+            _known(depth * players, 0),
+            _slotFrame(depth, -1),
+            _lastKnown(players, 0),
+            _lastKnownFrame(players, -1),
+            _confirmedFrame(players, -1),
+            _frame(0),
+            _rollbackTo(-1) {
+        if (players == 0 || localPlayer >= players) {
+            throw WfnError(
+                "wfn_eng::rollback::Session",
+                "Constructor",
+                "Invalid player configuration"
+            );
+        }
+    }
+
+    ////
+    // void addLocalInput(Input)
+    //
+    // Registers the input of the local player for the current frame.
+    void Session::addLocalInput(Input input) {
+        size_t base = slot(_frame);
+        _inputs[base + _localPlayer] = input;
+        _known[base + _localPlayer] = 1;
+
+        _lastKnown[_localPlayer] = input;
+        _lastKnownFrame[_localPlayer] = _frame;
+        _confirmedFrame[_localPlayer] = _frame;
+    }
+
+    ////
+    // void addRemoteInput(size_t, uint32_t, Input)
+    //
+    // Registers the real input of a remote player for a frame, scheduling
+    // a rollback if the frame was already simulated with a different
+    // prediction. A player's inputs are confirmed up to the first frame
+    // still missing, so one that arrives early waits for the ones before it.
+    void Session::addRemoteInput(size_t player, uint32_t frame, Input input) {
+        int64_t confirmed = confirmedFrame();
+        if (player >= _players || player == _localPlayer) {
+            throw WfnError(
+                "wfn_eng::rollback::Session",
+                "addRemoteInput",
+                "Invalid player"
+            );
+        }
+
+        // Inputs must land inside the window of frames that can still be
+        // rolled back to, and must not overwrite unconfirmed inputs.
+        if (frame <= confirmed || frame >= confirmed + 1 + _ring.depth()) {
+            throw WfnError(
+                "wfn_eng::rollback::Session",
+                "addRemoteInput",
+                "Frame outside rollback window"
+            );
+        }
+
+        size_t base = slot(frame);
+        if (static_cast<int64_t>(frame) <= _confirmedFrame[player] || _known[base + player]) {
+            throw WfnError(
+                "wfn_eng::rollback::Session",
+                "addRemoteInput",
+                "Input already known"
+            );
+        }
+
+        if (frame < _frame && _inputs[base + player] != input) {
+            if (_rollbackTo < 0 || frame < _rollbackTo)
+                _rollbackTo = frame;
+        }
+
+        _inputs[base + player] = input;
+        _known[base + player] = 1;
+
+        if (static_cast<int64_t>(frame) > _lastKnownFrame[player]) {
+            _lastKnown[player] = input;
+            _lastKnownFrame[player] = frame;
+        }
+
+        while (true) {
+            int64_t next = _confirmedFrame[player] + 1;
+            size_t index = static_cast<size_t>(next % static_cast<int64_t>(_ring.depth()));
+            if (_slotFrame[index] != next || !_known[index * _players + player])
+                break;
+            _confirmedFrame[player] = next;
+        }
+    }
+
+    ////
+    // bool canAdvance()
+    //
+    // Whether the current frame can be simulated without getting further
+    // ahead of the remote players than the snapshot ring can rewind.
+    bool Session::canAdvance() const {
+        return static_cast<int64_t>(_frame) - confirmedFrame() <
+            static_cast<int64_t>(_ring.depth());
+    }
+
+    ////
+    // void advance()
+    //
+    // Performs any pending rollback and then simulates the current frame.
+    void Session::advance() {
+        if (!canAdvance()) {
+            throw WfnError(
+                "wfn_eng::rollback::Session",
+                "advance",
+                "Too far ahead of remote players"
+            );
+        }
+
+        if (_rollbackTo >= 0) {
+            uint32_t from = static_cast<uint32_t>(_rollbackTo);
+            _ring.restore(from);
+
+            for (uint32_t frame = from; frame < _frame; frame++)
+                simulate(frame);
+
+            uint32_t distance = _frame - from;
+            _stats.rollbacks++;
+            _stats.resimulatedFrames += distance;
+            _stats.maxRollback = std::max(_stats.maxRollback, distance);
+            _rollbackTo = -1;
+        }
+
+        simulate(_frame);
+        _frame++;
+    }
+
+    ////
+    // bool verify(uint32_t, uint64_t)
+    //
+    // Compares the checksum of a confirmed frame against the one reported
+    // by a remote peer, counting a desync on mismatch. Only meaningful
+    // after advance, once any pending rollback has been applied.
+    bool Session::verify(uint32_t frame, uint64_t remoteChecksum) {
+        if (static_cast<int64_t>(frame) > confirmedFrame() + 1) {
+            throw WfnError(
+                "wfn_eng::rollback::Session",
+                "verify",
+                "Frame not confirmed"
+            );
+        }
+
+        if (_ring.checksum(frame) == remoteChecksum)
+            return true;
+
+        _stats.desyncs++;
+        return false;
+    }
+
+    ////
+    // uint32_t frame()
+    //
+    // The next frame to be simulated.
+    uint32_t Session::frame() const { return _frame; }
+
+    ////
+    // int64_t confirmedFrame()
+    //
+    // The latest frame up to which the inputs of every player are known,
+    // or -1 if there is none yet.
+    int64_t Session::confirmedFrame() const {
+        return *std::min_element(_confirmedFrame.begin(), _confirmedFrame.end());
+    }
+
+    ////
+    // uint64_t checksum(uint32_t)
+    //
+    // The checksum of the state at the start of a held frame.
+    uint64_t Session::checksum(uint32_t frame) {
+        return _ring.checksum(frame);
+    }
+
+    ////
+    // const SnapshotRing& snapshots()
+    //
+    // Provides access to the snapshot ring (and its timings).
+    const SnapshotRing& Session::snapshots() const { return _ring; }
+
+    ////
+    // const SessionStats& stats()
+    //
+    // Provides the rollback counters of the session.
+    const SessionStats& Session::stats() const { return _stats; }
+}
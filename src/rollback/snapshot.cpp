@@ -0,0 +1,192 @@
+#include "../rollback.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+////
+// uint64_t nanosSince(time_point)
+//
+// Nanoseconds elapsed since the provided time point.
+static uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start
+        ).count()
+    );
+}
+
+namespace wfn_eng::rollback {
+    ////
+    // class SnapshotRing
+    //
+    // A ring of snapshots of a StateArena, indexed by frame number. Every
+    // slot is a full copy of the arena in one contiguous allocation, so saving
+    // and restoring are straight memcpys.
+
+    ////
+    // Slot& slot(uint32_t)
+    //
+    // Finds the slot a frame maps onto.
+    SnapshotRing::Slot& SnapshotRing::slot(uint32_t frame) {
+        return _slots[frame % _slots.size()];
+    }
+
+    const SnapshotRing::Slot& SnapshotRing::slot(uint32_t frame) const {
+        return _slots[frame % _slots.size()];
+    }
+
+    ////
+    // SnapshotRing(StateArena&, size_t)
+    //
+    // Constructs a ring holding the provided number of snapshots of a
+    // StateArena.
+    SnapshotRing::SnapshotRing(StateArena& arena, size_t depth) :
+            _arena(arena),
+            _stride(arena.capacity()),
+            _slots(depth, Slot { 0, false, false, 0, 0 }) {
+        if (depth == 0) {
+            throw WfnError(
+                "wfn_eng::rollback::SnapshotRing",
+                "Constructor",
+                "Zero depth"
+            );
+        }
+
+        _storage = static_cast<std::byte *>(
+            ::operator new(_stride * depth, std::align_val_t(StateArena::alignment))
+        );
+    }
+
+    ////
+    // ~SnapshotRing()
+    //
+    // Releases the snapshot storage.
+    SnapshotRing::~SnapshotRing() {
+        ::operator delete(_storage, std::align_val_t(StateArena::alignment));
+    }
+
+    ////
+    // void save(uint32_t)
+    //
+    // Copies the current state of the arena into the slot for the provided
+    // frame. The snapshot is only hashed once its checksum is asked for.
+    void SnapshotRing::save(uint32_t frame) {
+        auto start = std::chrono::steady_clock::now();
+
+        Slot& s = slot(frame);
+        size_t index = frame % _slots.size();
+
+        s.frame = frame;
+        s.valid = true;
+        s.hashed = false;
+        s.size = _arena.used();
+        std::memcpy(_storage + index * _stride, _arena.data(), s.size);
+
+        uint64_t nanos = nanosSince(start);
+        _stats.saves++;
+        _stats.lastSaveNanos = nanos;
+        _stats.totalSaveNanos += nanos;
+        _stats.maxSaveNanos = std::max(_stats.maxSaveNanos, nanos);
+    }
+
+    ////
+    // void restore(uint32_t)
+    //
+    // Copies the snapshot of the provided frame back into the arena.
+    // Throws a WfnError if the frame is no longer held by the ring.
+    void SnapshotRing::restore(uint32_t frame) {
+        if (!holds(frame)) {
+            throw WfnError(
+                "wfn_eng::rollback::SnapshotRing",
+                "restore",
+                "Frame not held"
+            );
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        const Slot& s = slot(frame);
+        size_t index = frame % _slots.size();
+
+        // Anything allocated after the snapshot was taken is simply dropped;
+        // the arena layout itself is part of the state.
+        std::memcpy(_arena._data, _storage + index * _stride, s.size);
+        if (_arena._used > s.size)
+            std::memset(_arena._data + s.size, 0, _arena._used - s.size);
+        _arena._used = s.size;
+
+        uint64_t nanos = nanosSince(start);
+        _stats.restores++;
+        _stats.lastRestoreNanos = nanos;
+        _stats.totalRestoreNanos += nanos;
+        _stats.maxRestoreNanos = std::max(_stats.maxRestoreNanos, nanos);
+    }
+
+    ////
+    // bool holds(uint32_t)
+    //
+    // Checks whether the ring still holds a snapshot of the frame.
+    bool SnapshotRing::holds(uint32_t frame) const {
+        const Slot& s = slot(frame);
+        return s.valid && s.frame == frame;
+    }
+
+    ////
+    // uint64_t checksum(uint32_t)
+    //
+    // Provides the checksum of a held snapshot, hashing it the first time
+    // it's asked for.
+    uint64_t SnapshotRing::checksum(uint32_t frame) {
+        if (!holds(frame)) {
+            throw WfnError(
+                "wfn_eng::rollback::SnapshotRing",
+                "checksum",
+                "Frame not held"
+            );
+        }
+
+        Slot& s = slot(frame);
+        if (!s.hashed) {
+            auto start = std::chrono::steady_clock::now();
+
+            s.checksum = hash(_storage + (frame % _slots.size()) * _stride, s.size);
+            s.hashed = true;
+
+            _stats.hashes++;
+            _stats.totalHashNanos += nanosSince(start);
+        }
+
+        return s.checksum;
+    }
+
+    ////
+    // size_t depth()
+    //
+    // The number of snapshots the ring can hold.
+    size_t SnapshotRing::depth() const { return _slots.size(); }
+
+    ////
+    // const SnapshotStats& stats()
+    //
+    // Provides the save and restore timings of the ring.
+    const SnapshotStats& SnapshotRing::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the average and worst save and restore times, and the average
+    // hash time.
+    void SnapshotRing::report(std::ostream& out) const {
+        auto average = [](uint64_t total, uint64_t count) {
+            return count > 0 ? total / 1000.0 / count : 0.0;
+        };
+
+        out << "Snapshots: " << _stats.saves << " saves (avg " << average(_stats.totalSaveNanos, _stats.saves)
+            << "us, max " << _stats.maxSaveNanos / 1000.0 << "us), " << _stats.restores << " restores (avg "
+            << average(_stats.totalRestoreNanos, _stats.restores) << "us, max " << _stats.maxRestoreNanos / 1000.0
+            << "us), " << _stats.hashes << " hashes (avg " << average(_stats.totalHashNanos, _stats.hashes)
+            << "us)" << std::endl;
+    }
+}
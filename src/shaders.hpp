@@ -0,0 +1,206 @@
+#ifndef __WFN_ENG_SHADERS_HPP__
+#define __WFN_ENG_SHADERS_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "error.hpp"
+
+namespace wfn_eng::shaders {
+    ////
+    // class Spirv
+    //
+    // The code of a compiled shader: either a view of a module embedded in
+    // the binary, or words read from a file.
+    class Spirv {
+        std::vector<uint32_t> _storage;
+        const uint32_t *_code;
+        size_t _words;
+        bool _embedded;
+
+    public:
+        ////
+        // Spirv(const uint32_t *, size_t)
+        //
+        // Views an embedded module of the provided number of words.
+        Spirv(const uint32_t *, size_t);
+
+        ////
+        // Spirv(std::vector<uint32_t>)
+        //
+        // Takes the words of a module read at runtime.
+        explicit Spirv(std::vector<uint32_t>);
+
+        Spirv(Spirv&&);
+        Spirv& operator=(Spirv&&);
+
+        ////
+        // const uint32_t *code()
+        //
+        // The words of the module.
+        const uint32_t *code() const;
+
+        ////
+        // size_t words()
+        //
+        // The number of words of the module.
+        size_t words() const;
+
+        ////
+        // size_t bytes()
+        //
+        // The size of the module, for VkShaderModuleCreateInfo.
+        size_t bytes() const;
+
+        ////
+        // bool embedded()
+        //
+        // Whether the module is embedded in the binary.
+        bool embedded() const;
+
+        // Following Rule of 3's
+        Spirv(const Spirv&) = delete;
+        Spirv& operator=(const Spirv&) = delete;
+    };
+
+    ////
+    // Spirv load(const std::string&)
+    //
+    // Provides a compiled shader by file name (e.g. "vert.spv"): the
+    // embedded copy when the build embeds shaders (WFN_ENG_EMBED_SHADERS),
+    // otherwise the file from the shader directory the build wrote them to.
+    Spirv load(const std::string&);
+
+    ////
+    // Spirv loadFile(const std::string&)
+    //
+    // Reads a compiled shader from the shader directory, even when the build
+    // embeds shaders (e.g. to pick up a shader rebuilt while running).
+    Spirv loadFile(const std::string&);
+
+    ////
+    // std::string directory()
+    //
+    // The directory compiled shaders are read from.
+    std::string directory();
+
+    ////
+    // uint64_t fileLoads()
+    //
+    // The number of shaders read from files so far.
+    uint64_t fileLoads();
+
+    ////
+    // struct Source
+    //
+    // How a compiled shader is built: the GLSL file (in the source
+    // directory) and the -D defines of its permutation, as in CMakeLists.txt.
+    struct Source {
+        std::string name;
+        std::string source;
+        std::vector<std::string> defines;
+    };
+
+    ////
+    // struct Reload
+    //
+    // A compiled shader rebuilt after its source changed, with the time
+    // (steady clock nanoseconds) the change was seen and how long the
+    // compile took.
+    struct Reload {
+        std::string name;
+        Spirv code;
+        uint64_t editNanos;
+        uint64_t compileNanos;
+    };
+
+    ////
+    // struct ReloadStats
+    //
+    // Counters on a HotReload. Changes are saves of a watched source;
+    // several saves in a quick burst count as one.
+    struct ReloadStats {
+        std::atomic<uint64_t> changes { 0 };
+        std::atomic<uint64_t> compiled { 0 };
+        std::atomic<uint64_t> failed { 0 };
+        std::atomic<uint64_t> compileNanos { 0 };
+        std::atomic<uint64_t> maxCompileNanos { 0 };
+    };
+
+    ////
+    // class HotReload
+    //
+    // Watches the shader sources with inotify and, on a worker thread,
+    // recompiles every compiled shader built from a changed source into the
+    // shader directory. The results are taken from the render thread, at a
+    // frame boundary. A compile that fails leaves the previous file in
+    // place. Linux only; elsewhere the constructor throws.
+    class HotReload {
+        std::vector<Source> _sources;
+        std::string _sourceDirectory;
+        int _inotify;
+
+        std::thread _worker;
+        std::atomic<bool> _quitting;
+
+        std::mutex _mutex;
+        std::vector<Reload> _ready;
+
+        ReloadStats _stats;
+
+        ////
+        // void workLoop()
+        //
+        // The body of the worker thread.
+        void workLoop();
+
+        ////
+        // void compile(const Source&, uint64_t)
+        //
+        // Rebuilds a compiled shader and queues it as ready.
+        void compile(const Source&, uint64_t);
+
+    public:
+        ////
+        // HotReload(std::vector<Source>)
+        //
+        // Starts watching the sources of the provided compiled shaders.
+        explicit HotReload(std::vector<Source>);
+
+        ////
+        // ~HotReload()
+        //
+        // Stops watching, waiting for a running compile.
+        ~HotReload();
+
+        ////
+        // std::vector<Reload> take()
+        //
+        // The shaders rebuilt since the last call, oldest first.
+        std::vector<Reload> take();
+
+        ////
+        // const ReloadStats& stats()
+        //
+        // The counters of the watcher.
+        const ReloadStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters along with the average and worst compile time.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        HotReload(const HotReload&) = delete;
+        HotReload& operator=(const HotReload&) = delete;
+    };
+}
+
+#endif
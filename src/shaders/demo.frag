@@ -1,9 +1,35 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Specialized features (see wfn_eng::vulkan::shader): the driver folds the
+// branches on these away when it builds the pipeline.
+layout(constant_id = 0) const bool GRAYSCALE = false;
+layout(constant_id = 1) const bool SEPIA = false;
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragUV;
 layout(location = 0) out vec4 outColor;
 
+layout(set = 0, binding = 0) uniform sampler2D albedo;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    // Tiled, so the triangle is minified enough to sample the mips.
+    vec3 color = fragColor * texture(albedo, fragUV * 4.0).rgb;
+
+#ifdef CUTOUT
+    // Built as its own SPIR-V rather than specialized: some GPUs turn off
+    // early depth testing for any shader that can discard.
+    if (max(color.r, max(color.g, color.b)) < 0.6)
+        discard;
+#endif
+
+    if (GRAYSCALE)
+        color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+
+    if (SEPIA)
+        color = mat3(0.393, 0.349, 0.272,
+                     0.769, 0.686, 0.534,
+                     0.189, 0.168, 0.131) * color;
+
+    outColor = vec4(color, 1.0);
 }
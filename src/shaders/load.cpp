@@ -0,0 +1,161 @@
+#include "../shaders.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+// Where the build wrote the compiled shaders (compile_shaders.sh writes
+// them next to their sources).
+#ifndef WFN_ENG_SHADER_DIR
+#define WFN_ENG_SHADER_DIR "src/shaders"
+#endif
+
+namespace wfn_eng::shaders {
+    ////
+    // struct Embedded
+    //
+    // A module embedded in the binary.
+    struct Embedded {
+        const char *name;
+        const uint32_t *code;
+        size_t words;
+    };
+}
+
+#ifdef WFN_ENG_EMBED_SHADERS
+// Generated by CMake: includes every embedded module, and defines
+// wfn_eng::shaders::embedded[] and embeddedCount.
+#include "embedded_shaders.inc"
+#else
+namespace wfn_eng::shaders {
+    static const Embedded *embedded = nullptr;
+    static const size_t embeddedCount = 0;
+}
+#endif
+
+static std::atomic<uint64_t> loadsFromFiles { 0 };
+
+namespace wfn_eng::shaders {
+    ////
+    // class Spirv
+    //
+    // The code of a compiled shader.
+
+    ////
+    // Spirv(const uint32_t *, size_t)
+    //
+    // Views an embedded module of the provided number of words.
+    Spirv::Spirv(const uint32_t *code, size_t words)
+            : _code(code)
+            , _words(words)
+            , _embedded(true) { }
+
+    ////
+    // Spirv(std::vector<uint32_t>)
+    //
+    // Takes the words of a module read at runtime.
+    Spirv::Spirv(std::vector<uint32_t> words)
+            : _storage(std::move(words))
+            , _code(_storage.data())
+            , _words(_storage.size())
+            , _embedded(false) { }
+
+    Spirv::Spirv(Spirv&& other)
+            : _storage(std::move(other._storage))
+            , _code(other._embedded ? other._code : _storage.data())
+            , _words(other._words)
+            , _embedded(other._embedded) { }
+
+    Spirv& Spirv::operator=(Spirv&& other) {
+        if (this != &other) {
+            _storage = std::move(other._storage);
+            _code = other._embedded ? other._code : _storage.data();
+            _words = other._words;
+            _embedded = other._embedded;
+        }
+
+        return *this;
+    }
+
+    ////
+    // const uint32_t *code()
+    //
+    // The words of the module.
+    const uint32_t *Spirv::code() const { return _code; }
+
+    ////
+    // size_t words()
+    //
+    // The number of words of the module.
+    size_t Spirv::words() const { return _words; }
+
+    ////
+    // size_t bytes()
+    //
+    // The size of the module, for VkShaderModuleCreateInfo.
+    size_t Spirv::bytes() const { return _words * sizeof(uint32_t); }
+
+    ////
+    // bool embedded()
+    //
+    // Whether the module is embedded in the binary.
+    bool Spirv::embedded() const { return _embedded; }
+
+    ////
+    // Spirv load(const std::string&)
+    //
+    // Provides a compiled shader by file name: the embedded copy when the
+    // build embeds shaders, otherwise the file.
+    Spirv load(const std::string& name) {
+        for (size_t i = 0; i < embeddedCount; i++) {
+            if (name == embedded[i].name)
+                return Spirv(embedded[i].code, embedded[i].words);
+        }
+
+        return loadFile(name);
+    }
+
+    ////
+    // Spirv loadFile(const std::string&)
+    //
+    // Reads a compiled shader from the shader directory.
+    Spirv loadFile(const std::string& name) {
+        std::string path = directory() + "/" + name;
+
+        FILE *file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            throw WfnError("wfn_eng::shaders", "loadFile", "Open " + path);
+
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+
+        if (size <= 0 || size % sizeof(uint32_t) != 0) {
+            std::fclose(file);
+            throw WfnError("wfn_eng::shaders", "loadFile", "Read " + path);
+        }
+
+        // Read straight into words, so the code is aligned for Vulkan.
+        std::vector<uint32_t> words(size / sizeof(uint32_t));
+        size_t read = std::fread(words.data(), 1, size, file);
+        std::fclose(file);
+
+        if (read != static_cast<size_t>(size))
+            throw WfnError("wfn_eng::shaders", "loadFile", "Read " + path);
+
+        loadsFromFiles++;
+        return Spirv(std::move(words));
+    }
+
+    ////
+    // std::string directory()
+    //
+    // The directory compiled shaders are read from.
+    std::string directory() { return WFN_ENG_SHADER_DIR; }
+
+    ////
+    // uint64_t fileLoads()
+    //
+    // The number of shaders read from files so far.
+    uint64_t fileLoads() { return loadsFromFiles.load(); }
+}
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex {
+    vec4 gl_Position;
+    float gl_PointSize;
+};
+
+// The particles particles.comp wrote this frame, one point each.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inVelocity;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    gl_Position = vec4(inPosition, 0.0, 1.0);
+    gl_PointSize = 1.0;
+
+    // Slow particles are blue and fast ones orange, dim enough that dense
+    // orbits add up without saturating at once.
+    float speed = clamp(length(inVelocity) * 2.0, 0.0, 1.0);
+    fragColor = mix(vec3(0.2, 0.4, 1.0), vec3(1.0, 0.6, 0.2), speed) * 0.25;
+}
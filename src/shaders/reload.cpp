@@ -0,0 +1,239 @@
+#include "../shaders.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <set>
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+extern char **environ;
+
+// The compiler and sources the build used (CMakeLists.txt passes both).
+#ifndef WFN_ENG_GLSLANG_VALIDATOR
+#define WFN_ENG_GLSLANG_VALIDATOR "glslangValidator"
+#endif
+
+#ifndef WFN_ENG_SHADER_SOURCE_DIR
+#define WFN_ENG_SHADER_SOURCE_DIR "src/shaders"
+#endif
+
+// How long the watcher waits for the rest of a burst of events: editors
+// save in several steps (write, rename, chmod).
+static const int settleMillis = 50;
+
+////
+// uint64_t nowNanos()
+//
+// The steady clock, in nanoseconds.
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count()
+    );
+}
+
+namespace wfn_eng::shaders {
+    ////
+    // class HotReload
+    //
+    // Watches the shader sources with inotify, recompiling the compiled
+    // shaders built from changed ones on a worker thread.
+
+    ////
+    // HotReload(std::vector<Source>)
+    //
+    // Starts watching the sources of the provided compiled shaders. Watches
+    // the directory rather than the files, so that editors which save by
+    // renaming a new file over the old one are seen too.
+    HotReload::HotReload(std::vector<Source> sources)
+            : _sources(std::move(sources))
+            , _sourceDirectory(WFN_ENG_SHADER_SOURCE_DIR)
+            , _inotify(-1)
+            , _quitting(false) {
+#ifdef __linux__
+        _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_inotify < 0)
+            throw WfnError("wfn_eng::shaders::HotReload", "HotReload", "Initialize inotify");
+
+        if (inotify_add_watch(_inotify, _sourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(_inotify);
+            throw WfnError("wfn_eng::shaders::HotReload", "HotReload", "Watch " + _sourceDirectory);
+        }
+
+        _worker = std::thread(&HotReload::workLoop, this);
+#else
+        throw WfnError("wfn_eng::shaders::HotReload", "HotReload", "Watch Shaders (needs inotify)");
+#endif
+    }
+
+    ////
+    // ~HotReload()
+    //
+    // Stops watching, waiting for a running compile.
+    HotReload::~HotReload() {
+        _quitting.store(true);
+        if (_worker.joinable())
+            _worker.join();
+
+        if (_inotify >= 0)
+            close(_inotify);
+    }
+
+    ////
+    // void workLoop()
+    //
+    // The body of the worker thread: waits for saves (checking for the
+    // destructor every 100ms), gathers a burst of them, then recompiles
+    // everything built from the saved sources.
+    void HotReload::workLoop() {
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+
+        auto drain = [&](std::set<std::string>& changed) {
+            ssize_t length;
+            while ((length = read(_inotify, buffer, sizeof(buffer))) > 0) {
+                for (char *at = buffer; at < buffer + length; ) {
+                    const inotify_event *event = reinterpret_cast<const inotify_event *>(at);
+                    if (event->len > 0)
+                        changed.insert(event->name);
+                    at += sizeof(inotify_event) + event->len;
+                }
+            }
+        };
+
+        pollfd watch = {};
+        watch.fd = _inotify;
+        watch.events = POLLIN;
+
+        while (!_quitting.load()) {
+            if (poll(&watch, 1, 100) <= 0)
+                continue;
+
+            uint64_t edit = nowNanos();
+
+            std::set<std::string> changed;
+            drain(changed);
+            while (poll(&watch, 1, settleMillis) > 0)
+                drain(changed);
+
+            bool watched = false;
+            for (const Source& source : _sources) {
+                if (changed.count(source.source) == 0)
+                    continue;
+
+                watched = true;
+                compile(source, edit);
+            }
+
+            if (watched)
+                _stats.changes++;
+        }
+#endif
+    }
+
+    ////
+    // void compile(const Source&, uint64_t)
+    //
+    // Rebuilds a compiled shader with glslangValidator, into a temporary
+    // file that replaces the previous one only if the compile succeeds, and
+    // queues it as ready. Compiler errors go to the terminal.
+    void HotReload::compile(const Source& source, uint64_t edit) {
+        uint64_t start = nowNanos();
+
+        std::string input = _sourceDirectory + "/" + source.source;
+        std::string output = directory() + "/" + source.name;
+        std::string temporary = output + ".reload";
+
+        std::vector<std::string> args;
+        args.push_back(WFN_ENG_GLSLANG_VALIDATOR);
+        args.push_back("-V");
+        args.insert(args.end(), source.defines.begin(), source.defines.end());
+        args.push_back(input);
+        args.push_back("-o");
+        args.push_back(temporary);
+
+        std::vector<char *> argv;
+        for (std::string& arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+
+        pid_t pid;
+        int status = 0;
+        bool succeeded =
+            posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) == 0 &&
+            waitpid(pid, &status, 0) == pid &&
+            WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+            std::rename(temporary.c_str(), output.c_str()) == 0;
+
+        if (!succeeded) {
+            std::remove(temporary.c_str());
+            _stats.failed++;
+            return;
+        }
+
+        Reload reload { source.name, Spirv(std::vector<uint32_t> {}), edit, 0 };
+        try {
+            reload.code = loadFile(source.name);
+        } catch (const WfnError&) {
+            _stats.failed++;
+            return;
+        }
+
+        uint64_t nanos = nowNanos() - start;
+        _stats.compiled++;
+        _stats.compileNanos += nanos;
+
+        uint64_t worst = _stats.maxCompileNanos.load();
+        while (nanos > worst && !_stats.maxCompileNanos.compare_exchange_weak(worst, nanos));
+
+        reload.compileNanos = nanos;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ready.push_back(std::move(reload));
+    }
+
+    ////
+    // std::vector<Reload> take()
+    //
+    // The shaders rebuilt since the last call, oldest first.
+    std::vector<Reload> HotReload::take() {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::vector<Reload> ready;
+        ready.swap(_ready);
+        return ready;
+    }
+
+    ////
+    // const ReloadStats& stats()
+    //
+    // The counters of the watcher.
+    const ReloadStats& HotReload::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters along with the average and worst compile time.
+    void HotReload::report(std::ostream& out) const {
+        uint64_t compiled = _stats.compiled.load();
+
+        out << "Hot reload: " << _stats.changes.load() << " changes, "
+            << compiled << " compiled, "
+            << _stats.failed.load() << " failed";
+
+        if (compiled > 0) {
+            out << ", compile avg " << _stats.compileNanos.load() / compiled / 1000000.0 << "ms"
+                << " / max " << _stats.maxCompileNanos.load() / 1000000.0 << "ms";
+        }
+
+        out << std::endl;
+    }
+}
@@ -0,0 +1,12 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+// The atlas page the draw's tiles are on.
+layout(set = 0, binding = 0) uniform sampler2D page;
+
+void main() {
+    outColor = texture(page, fragUV);
+}
@@ -0,0 +1,24 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+// The chunk vertices a tilemap bakes (wfn_eng::atlas::SpriteVertex): a
+// world position, then where it lands on its atlas page.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUV;
+
+layout(location = 0) out vec2 fragUV;
+
+// The camera: scales then offsets a world position into clip space.
+layout(push_constant) uniform Camera {
+    vec2 scale;
+    vec2 offset;
+} camera;
+
+void main() {
+    gl_Position = vec4(inPosition * camera.scale + camera.offset, 0.0, 1.0);
+    fragUV = inUV;
+}
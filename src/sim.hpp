@@ -0,0 +1,121 @@
+#ifndef __WFN_ENG_SIM_HPP__
+#define __WFN_ENG_SIM_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "physics.hpp"
+#include "rollback.hpp"
+
+namespace wfn_eng::sim {
+    ////
+    // uint32_t tickRate
+    //
+    // The number of fixed simulation steps per second.
+    const uint32_t tickRate = 60;
+
+    ////
+    // size_t players
+    //
+    // The number of fighters in a match.
+    const size_t players = 2;
+
+    ////
+    // struct Fighter
+    //
+    // The simulated state of a single fighter. Positions and velocities are in
+    // fixed-point pixels so that the simulation is integer-only and therefore
+    // identical on every machine.
+    struct Fighter {
+        physics::Fixed x;
+        physics::Fixed y;
+        physics::Fixed vx;
+        physics::Fixed vy;
+        rollback::Input input;
+        int16_t health;
+        uint8_t hitstun;
+        uint8_t attack;
+        uint8_t attackHit;
+    };
+
+    ////
+    // struct State
+    //
+    // The complete simulation state. Lives in the World's StateArena, so it
+    // must remain trivially copyable.
+    struct State {
+        uint32_t tick;
+        Fighter fighters[players];
+    };
+
+    ////
+    // class World
+    //
+    // Owns the simulation state and advances it one fixed step at a time.
+    class World {
+        rollback::StateArena _arena;
+        State *_state;
+
+        // Rebuilt every tick from the state, so they live outside the arena.
+        physics::BoxSet _boxes;
+        physics::Broadphase _broadphase;
+        std::vector<physics::Pair> _pairs;
+
+        ////
+        // void move(Fighter&)
+        //
+        // Applies a fighter's input and integrates its motion.
+        void move(Fighter&);
+
+        ////
+        // void collide()
+        //
+        // Builds the push, hurt and hit boxes of every fighter, runs the
+        // broadphase and resolves the resulting pairs.
+        void collide();
+
+    public:
+        ////
+        // World()
+        //
+        // Constructs a world with both fighters at their starting positions.
+        World();
+
+        ////
+        // void step(const rollback::Input *)
+        //
+        // Advances the simulation by one tick, given one Input per player.
+        void step(const rollback::Input *);
+
+        ////
+        // rollback::StateArena& arena()
+        //
+        // Provides access to the arena holding the state (e.g. for snapshots).
+        rollback::StateArena& arena();
+
+        ////
+        // const physics::BroadphaseStats& collisionStats()
+        //
+        // Provides the broadphase counters of the last tick.
+        const physics::BroadphaseStats& collisionStats() const;
+
+        ////
+        // const State& state()
+        //
+        // Provides read access to the current state.
+        const State& state() const;
+
+        ////
+        // uint64_t checksum()
+        //
+        // Hashes the current state.
+        uint64_t checksum() const;
+
+        // Following Rule of 3's
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include "../sim.hpp"
+#include "../input.hpp"
+
+#include <algorithm>
+
+using wfn_eng::physics::Fixed;
+
+////
+// Movement tuning, in pixels (per tick).
+static const Fixed walkSpeed = Fixed::fromInt(3);
+static const Fixed jumpSpeed = Fixed::fromInt(14);
+static const Fixed gravity = Fixed::fromInt(1);
+static const Fixed stageHalfWidth = Fixed::fromInt(300);
+
+////
+// Box sizes, in pixels, relative to a fighter's feet.
+static const Fixed pushHalfWidth = Fixed::fromInt(15);
+static const Fixed pushHeight = Fixed::fromInt(80);
+static const Fixed hurtHalfWidth = Fixed::fromInt(18);
+static const Fixed hurtHeight = Fixed::fromInt(90);
+static const Fixed hitReach = Fixed::fromInt(45);
+static const Fixed hitBottom = Fixed::fromInt(50);
+static const Fixed hitTop = Fixed::fromInt(65);
+static const Fixed knockback = Fixed::fromInt(6);
+
+////
+// Attack timing, in ticks.
+static const uint8_t attackLength = 18;
+static const uint8_t attackActiveStart = 5;
+static const uint8_t attackActiveEnd = 8;
+static const uint8_t hitstunLength = 20;
+static const int16_t attackDamage = 50;
+static const int16_t startingHealth = 1000;
+
+namespace wfn_eng::sim {
+    ////
+    // class World
+    //
+    // Owns the simulation state and advances it one fixed step at a time.
+
+    ////
+    // void move(Fighter&)
+    //
+    // Applies a fighter's input and integrates its motion.
+    void World::move(Fighter& f) {
+        bool grounded = f.y == Fixed::fromInt(0);
+        bool actionable = f.hitstun == 0 && f.attack == 0;
+
+        if (f.hitstun > 0)
+            f.hitstun--;
+
+        if (f.attack > 0 && ++f.attack > attackLength) {
+            f.attack = 0;
+            f.attackHit = 0;
+        }
+
+        if (grounded && actionable) {
+            f.vx = Fixed::fromInt(0);
+            if (f.input & input::Left)
+                f.vx -= walkSpeed;
+            if (f.input & input::Right)
+                f.vx += walkSpeed;
+            if (f.input & input::Up)
+                f.vy = jumpSpeed;
+            if (f.input & input::LightPunch) {
+                f.attack = 1;
+                f.vx = Fixed::fromInt(0);
+            }
+        } else if (!grounded) {
+            f.vy -= gravity;
+        }
+
+        f.x += f.vx;
+        f.y += f.vy;
+
+        if (f.y <= Fixed::fromInt(0)) {
+            f.y = Fixed::fromInt(0);
+            f.vy = Fixed::fromInt(0);
+            if (f.hitstun == 0 && f.attack == 0)
+                f.vx = Fixed::fromInt(0);
+        }
+
+        f.x = std::min(std::max(f.x, -stageHalfWidth), stageHalfWidth);
+    }
+
+    ////
+    // void collide()
+    //
+    // Builds the push, hurt and hit boxes of every fighter, runs the
+    // broadphase and resolves the resulting pairs.
+    void World::collide() {
+        _boxes.clear();
+        _pairs.clear();
+
+        for (size_t p = 0; p < players; p++) {
+            const Fighter& f = _state->fighters[p];
+            uint16_t owner = static_cast<uint16_t>(p);
+
+            _boxes.add(
+                { f.x - pushHalfWidth, f.y, f.x + pushHalfWidth, f.y + pushHeight },
+                owner,
+                physics::Push,
+                physics::Push
+            );
+
+            _boxes.add(
+                { f.x - hurtHalfWidth, f.y, f.x + hurtHalfWidth, f.y + hurtHeight },
+                owner,
+                physics::Hurt,
+                0
+            );
+
+            if (f.attack >= attackActiveStart && f.attack <= attackActiveEnd && !f.attackHit) {
+                const Fighter& opponent = _state->fighters[(p + 1) % players];
+                bool facingRight = opponent.x >= f.x;
+
+                Fixed nearX = facingRight ? f.x : f.x - hitReach;
+                Fixed farX = facingRight ? f.x + hitReach : f.x;
+                _boxes.add(
+                    { nearX, f.y + hitBottom, farX, f.y + hitTop },
+                    owner,
+                    physics::Hit,
+                    physics::Hurt
+                );
+            }
+        }
+
+        _broadphase.run(_boxes, _pairs);
+
+        const uint16_t *owner = _boxes.owner();
+        const uint8_t *layer = _boxes.layer();
+        for (const auto& pair: _pairs) {
+            Fighter& a = _state->fighters[owner[pair.a]];
+            Fighter& b = _state->fighters[owner[pair.b]];
+
+            if (layer[pair.a] == physics::Push && layer[pair.b] == physics::Push) {
+                // Push both fighters apart by half of the overlap each.
+                physics::Box boxA = _boxes.box(pair.a);
+                physics::Box boxB = _boxes.box(pair.b);
+                Fixed depth = std::min(boxA.maxX, boxB.maxX) - std::max(boxA.minX, boxB.minX);
+                Fixed half = Fixed::fromRaw(depth.raw / 2);
+
+                Fighter& left = a.x <= b.x ? a : b;
+                Fighter& right = a.x <= b.x ? b : a;
+                left.x -= half;
+                right.x += half;
+                continue;
+            }
+
+            uint32_t hit = layer[pair.a] == physics::Hit ? pair.a : pair.b;
+            uint32_t hurt = hit == pair.a ? pair.b : pair.a;
+            if (layer[hit] != physics::Hit || layer[hurt] != physics::Hurt)
+                continue;
+
+            Fighter& attacker = _state->fighters[owner[hit]];
+            Fighter& defender = _state->fighters[owner[hurt]];
+            if (attacker.attackHit)
+                continue;
+
+            attacker.attackHit = 1;
+            defender.health -= attackDamage;
+            defender.hitstun = hitstunLength;
+            defender.vx = defender.x >= attacker.x ? knockback : -knockback;
+        }
+    }
+
+    ////
+    // World()
+    //
+    // Constructs a world with both fighters at their starting positions.
+    World::World() :
+            _arena(64 * 1024) {
+        _state = _arena.allocate<State>();
+        _state->fighters[0].x = Fixed::fromInt(-100);
+        _state->fighters[1].x = Fixed::fromInt(100);
+        for (size_t p = 0; p < players; p++)
+            _state->fighters[p].health = startingHealth;
+
+        _boxes.reserve(players * 3);
+        _pairs.reserve(players * players * 3);
+    }
+
+    ////
+    // void step(const rollback::Input *)
+    //
+    // Advances the simulation by one tick, given one Input per player.
+    void World::step(const rollback::Input *inputs) {
+        for (size_t p = 0; p < players; p++)
+            _state->fighters[p].input = inputs[p];
+
+        for (size_t p = 0; p < players; p++)
+            move(_state->fighters[p]);
+
+        collide();
+
+        for (size_t p = 0; p < players; p++) {
+            Fighter& f = _state->fighters[p];
+            f.x = std::min(std::max(f.x, -stageHalfWidth), stageHalfWidth);
+        }
+
+        _state->tick++;
+    }
+
+    ////
+    // rollback::StateArena& arena()
+    //
+    // Provides access to the arena holding the state (e.g. for snapshots).
+    rollback::StateArena& World::arena() { return _arena; }
+
+    ////
+    // const physics::BroadphaseStats& collisionStats()
+    //
+    // Provides the broadphase counters of the last tick.
+    const physics::BroadphaseStats& World::collisionStats() const {
+        return _broadphase.stats();
+    }
+
+    ////
+    // const State& state()
+    //
+    // Provides read access to the current state.
+    const State& World::state() const { return *_state; }
+
+    ////
+    // uint64_t checksum()
+    //
+    // Hashes the current state.
+    uint64_t World::checksum() const { return _arena.checksum(); }
+}
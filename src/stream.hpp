@@ -0,0 +1,280 @@
+#ifndef __WFN_ENG_STREAM_HPP__
+#define __WFN_ENG_STREAM_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "asset.hpp"
+#include "error.hpp"
+#include "io.hpp"
+#include "vulkan.hpp"
+
+namespace wfn_eng::stream {
+    ////
+    // typedef Ticket
+    //
+    // Names a request, to cancel it. 0 is never a ticket.
+    typedef uint64_t Ticket;
+
+    ////
+    // enum class Priority
+    //
+    // How soon a request is needed. Every stage serves higher priorities
+    // first, and requests of one priority in the order they were made.
+    enum class Priority : uint8_t {
+        Now        = 0,
+        Soon       = 1,
+        Later      = 2,
+        Background = 3
+    };
+
+    ////
+    // Decode
+    //
+    // Turns what was read into what gets uploaded, in place, on a worker
+    // thread. Returns false if the data is bad.
+    typedef std::function<bool (std::vector<uint8_t>&)> Decode;
+
+    ////
+    // Upload
+    //
+    // Records the copies out of the staged data (which already holds the
+    // decoded bytes) into the command buffer of the frame, on the render
+    // thread.
+    typedef std::function<void (VkCommandBuffer, const vulkan::Staged&)> Upload;
+
+    ////
+    // Failed
+    //
+    // Called on the render thread instead of the Upload when the read or
+    // the decode failed.
+    typedef std::function<void ()> Failed;
+
+    ////
+    // struct Request
+    //
+    // An asset to stream in: a range of a file (size 0 for the rest of the
+    // file, e.g. a whole loose file), or an asset of a mapped pack, what to
+    // do with it, and how soon. A pack asset stored uncompressed and
+    // without a decode is copied straight from the mapping into the
+    // staging ring; the others are unpacked by a worker. The pack must
+    // outlive the request.
+    struct Request {
+        std::string path;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        const asset::Pack *pack = nullptr;
+        asset::AssetId asset = 0;
+        Priority priority = Priority::Later;
+        Decode decode;
+        Upload upload;
+        Failed failed;
+    };
+
+    ////
+    // struct Budget
+    //
+    // How much uploading a frame may do: bytes copied to the staging ring,
+    // and time spent on the render thread (copying and recording). The first
+    // upload of a frame always goes ahead, so an asset larger than the
+    // budget still gets its own frame.
+    struct Budget {
+        uint64_t bytes = 4 * 1024 * 1024;
+        uint64_t nanos = 1000000;
+    };
+
+    ////
+    // struct StreamStats
+    //
+    // Counters on a Streamer. A frame over budget is one whose single first
+    // upload was itself over budget. Viewed assets are the pack ones staged
+    // straight from the mapping, whose bytes are never read into memory.
+    struct StreamStats {
+        std::atomic<uint64_t> requested { 0 };
+        std::atomic<uint64_t> read { 0 };
+        std::atomic<uint64_t> decoded { 0 };
+        std::atomic<uint64_t> cancelled { 0 };
+        std::atomic<uint64_t> failed { 0 };
+        std::atomic<uint64_t> bytesRead { 0 };
+        std::atomic<uint64_t> viewed { 0 };
+        std::atomic<uint64_t> bytesViewed { 0 };
+        uint64_t uploaded = 0;
+        uint64_t bytesUploaded = 0;
+        uint64_t uploadFrames = 0;
+        uint64_t framesOverBudget = 0;
+        uint64_t stalls = 0;
+        uint64_t maxFrameBytes = 0;
+        uint64_t maxFrameNanos = 0;
+    };
+
+    ////
+    // class Streamer
+    //
+    // Loads assets in the background, in three stages:
+    //
+    //   1. I/O threads read the requested ranges, in batches (through
+    //      io_uring where there is one), or page in pack assets,
+    //   2. worker threads unpack compressed pack assets and decode,
+    //   3. the render thread copies them into a staging ring and records
+    //      their uploads, a frame's budget at a time.
+    //
+    // Each stage is a priority queue, so a late urgent request overtakes
+    // the background ones still waiting. A cancelled request is dropped by
+    // whichever stage holds it next, and its callbacks are never called.
+    class Streamer {
+        ////
+        // struct Job
+        //
+        // A request on its way through the stages. What gets staged is the
+        // view, for a pack asset used as stored, or else the data. The
+        // entry is a pack asset left for a worker to unpack.
+        struct Job {
+            Ticket ticket;
+            Request request;
+            std::vector<uint8_t> data;
+            asset::Blob view = { nullptr, 0 };
+            const asset::PackEntry *entry = nullptr;
+            bool failed = false;
+
+            const uint8_t *staged() const;
+            size_t stagedSize() const;
+        };
+
+        ////
+        // struct Queue
+        //
+        // A stage's queue: a heap ordered by priority, then ticket.
+        struct Queue {
+            std::vector<std::unique_ptr<Job>> heap;
+
+            static bool later(const std::unique_ptr<Job>&, const std::unique_ptr<Job>&);
+            void push(std::unique_ptr<Job>);
+            std::unique_ptr<Job> pop();
+            const Job& top() const;
+            bool empty() const;
+        };
+
+        std::mutex _mutex;
+        std::condition_variable _readWake;
+        std::condition_variable _decodeWake;
+        Queue _reads;
+        Queue _decodes;
+        Queue _uploads;
+        std::unordered_set<Ticket> _live;
+        std::unordered_set<Ticket> _cancelled;
+        Ticket _next = 1;
+        bool _quitting = false;
+
+        std::vector<std::thread> _readers;
+        std::vector<std::thread> _decoders;
+
+        StreamStats _stats;
+
+        ////
+        // bool drop(const Job&)
+        //
+        // Whether a job was cancelled, forgetting it if so. Called with the
+        // mutex held.
+        bool drop(const Job&);
+
+        ////
+        // void readLoop()
+        //
+        // The body of an I/O thread.
+        void readLoop();
+
+        ////
+        // void decodeLoop()
+        //
+        // The body of a worker thread.
+        void decodeLoop();
+
+        ////
+        // void read(io::Reader&, std::vector<std::unique_ptr<Job>>&)
+        //
+        // Reads the ranges of a batch of jobs.
+        void read(io::Reader&, std::vector<std::unique_ptr<Job>>&);
+
+        ////
+        // void readPacked(Job&)
+        //
+        // Finds the pack asset of a job, paging it in if it's staged as
+        // stored.
+        void readPacked(Job&);
+
+    public:
+        ////
+        // Streamer(size_t, size_t)
+        //
+        // Starts the provided number of I/O threads and decode workers (0
+        // for one per hardware thread, minus the render thread).
+        Streamer(size_t = 2, size_t = 0);
+
+        ////
+        // ~Streamer()
+        //
+        // Drops every request and joins the threads.
+        ~Streamer();
+
+        ////
+        // Ticket request(Request)
+        //
+        // Queues an asset to stream in.
+        Ticket request(Request);
+
+        ////
+        // bool cancel(Ticket)
+        //
+        // Cancels a request, returning false if it was already uploaded
+        // (or failed, or cancelled).
+        bool cancel(Ticket);
+
+        ////
+        // bool ready()
+        //
+        // Whether anything is waiting to be uploaded.
+        bool ready();
+
+        ////
+        // size_t pending()
+        //
+        // The number of requests not uploaded (or failed) yet.
+        size_t pending();
+
+        ////
+        // size_t upload(VkCommandBuffer, vulkan::StagingRing&, const Budget&)
+        //
+        // Stages and records the uploads of the frame, most urgent first,
+        // within the budget and the room left in the ring, returning how
+        // many were recorded. The caller submits the ring with the frame.
+        size_t upload(VkCommandBuffer, vulkan::StagingRing&, const Budget&);
+
+        ////
+        // const StreamStats& stats()
+        //
+        // The counters of the streamer.
+        const StreamStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        Streamer(const Streamer&) = delete;
+        Streamer& operator=(const Streamer&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,436 @@
+#include "../stream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <unistd.h>
+
+// The most reads an I/O thread takes at once. Enough to keep io_uring busy,
+// few enough that an urgent request never waits long behind a batch.
+static const size_t readBatch = 64;
+
+////
+// uint64_t nowNanos()
+//
+// The steady clock, in nanoseconds.
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count()
+    );
+}
+
+namespace wfn_eng::stream {
+    ////
+    // struct Job
+    //
+    // A request on its way through the stages. What gets staged is its
+    // view of a pack, if it has one, or else its data.
+    const uint8_t *Streamer::Job::staged() const {
+        return view.data != nullptr ? view.data : data.data();
+    }
+
+    size_t Streamer::Job::stagedSize() const {
+        return view.data != nullptr ? view.size : data.size();
+    }
+
+    ////
+    // struct Queue
+    //
+    // A stage's queue: a heap ordered by priority, then ticket (the heap
+    // keeps the greatest on top, so the comparison is reversed).
+    bool Streamer::Queue::later(const std::unique_ptr<Job>& a, const std::unique_ptr<Job>& b) {
+        if (a->request.priority != b->request.priority)
+            return a->request.priority > b->request.priority;
+        return a->ticket > b->ticket;
+    }
+
+    void Streamer::Queue::push(std::unique_ptr<Job> job) {
+        heap.push_back(std::move(job));
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    std::unique_ptr<Streamer::Job> Streamer::Queue::pop() {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        std::unique_ptr<Job> job = std::move(heap.back());
+        heap.pop_back();
+        return job;
+    }
+
+    const Streamer::Job& Streamer::Queue::top() const { return *heap.front(); }
+
+    bool Streamer::Queue::empty() const { return heap.empty(); }
+
+    ////
+    // class Streamer
+    //
+    // Loads assets in the background: read, decode, then upload within a
+    // per-frame budget.
+
+    ////
+    // Streamer(size_t, size_t)
+    //
+    // Starts the provided number of I/O threads and decode workers.
+    Streamer::Streamer(size_t readers, size_t decoders) {
+        if (decoders == 0) {
+            unsigned hardware = std::thread::hardware_concurrency();
+            decoders = hardware > 1 ? hardware - 1 : 1;
+        }
+
+        for (size_t i = 0; i < std::max<size_t>(readers, 1); i++)
+            _readers.emplace_back(&Streamer::readLoop, this);
+        for (size_t i = 0; i < decoders; i++)
+            _decoders.emplace_back(&Streamer::decodeLoop, this);
+    }
+
+    ////
+    // ~Streamer()
+    //
+    // Drops every request and joins the threads.
+    Streamer::~Streamer() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quitting = true;
+        }
+        _readWake.notify_all();
+        _decodeWake.notify_all();
+
+        for (auto& reader : _readers)
+            reader.join();
+        for (auto& decoder : _decoders)
+            decoder.join();
+    }
+
+    ////
+    // bool drop(const Job&)
+    //
+    // Whether a job was cancelled, forgetting it if so.
+    bool Streamer::drop(const Job& job) {
+        if (_cancelled.erase(job.ticket) == 0)
+            return false;
+
+        _stats.cancelled++;
+        return true;
+    }
+
+    ////
+    // void readLoop()
+    //
+    // The body of an I/O thread: reads the most urgent requests together,
+    // then hands each to the decoders, or straight to the uploads if it has
+    // nothing to decode or unpack.
+    void Streamer::readLoop() {
+        io::Reader reader;
+        std::vector<std::unique_ptr<Job>> batch;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _readWake.wait(lock, [&] { return _quitting || !_reads.empty(); });
+                if (_quitting)
+                    return;
+
+                while (!_reads.empty() && batch.size() < readBatch) {
+                    std::unique_ptr<Job> job = _reads.pop();
+                    if (!drop(*job))
+                        batch.push_back(std::move(job));
+                }
+            }
+
+            read(reader, batch);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (std::unique_ptr<Job>& job : batch) {
+                if (drop(*job))
+                    continue;
+
+                if (job->failed || (!job->request.decode && job->entry == nullptr)) {
+                    _uploads.push(std::move(job));
+                } else {
+                    _decodes.push(std::move(job));
+                    _decodeWake.notify_one();
+                }
+            }
+            batch.clear();
+        }
+    }
+
+    ////
+    // void decodeLoop()
+    //
+    // The body of a worker thread: unpacks a pack asset, then decodes.
+    void Streamer::decodeLoop() {
+        while (true) {
+            std::unique_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _decodeWake.wait(lock, [&] { return _quitting || !_decodes.empty(); });
+                if (_quitting)
+                    return;
+
+                job = _decodes.pop();
+                if (drop(*job))
+                    continue;
+            }
+
+            bool decoded = true;
+            if (job->entry != nullptr) {
+                try {
+                    job->data.resize(job->entry->size);
+                    job->request.pack->read(*job->entry, job->data.data());
+                } catch (const WfnError&) {
+                    decoded = false;
+                }
+            }
+
+            if (decoded && job->request.decode)
+                decoded = job->request.decode(job->data);
+
+            if (decoded) {
+                _stats.decoded++;
+            } else {
+                job->failed = true;
+                _stats.failed++;
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!drop(*job))
+                _uploads.push(std::move(job));
+        }
+    }
+
+    ////
+    // void read(io::Reader&, std::vector<std::unique_ptr<Job>>&)
+    //
+    // Reads the ranges of a batch of jobs in one go, marking a job failed
+    // if its file is missing or shorter than its range.
+    void Streamer::read(io::Reader& reader, std::vector<std::unique_ptr<Job>>& batch) {
+        std::vector<std::unique_ptr<io::File>> files(batch.size());
+        std::vector<io::Read> reads;
+        std::vector<Job *> reading;
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            Job& job = *batch[i];
+            if (job.request.pack != nullptr) {
+                readPacked(job);
+                continue;
+            }
+
+            try {
+                files[i] = std::make_unique<io::File>(job.request.path);
+            } catch (const WfnError&) {
+                job.failed = true;
+                _stats.failed++;
+                continue;
+            }
+
+            uint64_t size = job.request.size;
+            if (size == 0 && files[i]->size() > job.request.offset)
+                size = files[i]->size() - job.request.offset;
+            job.data.resize(size);
+
+            io::Read read;
+            read.file = files[i].get();
+            read.offset = job.request.offset;
+            read.size = size;
+            read.data = job.data.data();
+            reads.push_back(read);
+            reading.push_back(&job);
+        }
+
+        reader.read(reads.data(), reads.size());
+
+        for (size_t i = 0; i < reads.size(); i++) {
+            if (reads[i].result != static_cast<int64_t>(reads[i].size)) {
+                reading[i]->failed = true;
+                _stats.failed++;
+                continue;
+            }
+
+            _stats.read++;
+            _stats.bytesRead += reads[i].size;
+        }
+    }
+
+    ////
+    // void readPacked(Job&)
+    //
+    // Finds the pack asset of a job. One stored as is, with no decode, is
+    // staged straight from the mapping: its pages are faulted in here, a
+    // byte a page, so that the render thread's copy out of them never
+    // waits on the disk. Any other is left to a worker to unpack.
+    void Streamer::readPacked(Job& job) {
+        const asset::Pack& pack = *job.request.pack;
+        const asset::PackEntry *entry = pack.find(job.request.asset);
+        if (entry == nullptr) {
+            job.failed = true;
+            _stats.failed++;
+            return;
+        }
+
+        pack.prefetch(*entry);
+        if (entry->codec != asset::Codec::None || job.request.decode) {
+            job.entry = entry;
+            return;
+        }
+
+        job.view = pack.view(*entry);
+
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        volatile uint8_t touched = 0;
+        for (size_t at = 0; at < job.view.size; at += page)
+            touched = touched ^ job.view.data[at];
+
+        _stats.viewed++;
+        _stats.bytesViewed += job.view.size;
+    }
+
+    ////
+    // Ticket request(Request)
+    //
+    // Queues an asset to stream in.
+    Ticket Streamer::request(Request request) {
+        std::unique_ptr<Job> job = std::make_unique<Job>();
+        job->request = std::move(request);
+
+        Ticket ticket;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ticket = job->ticket = _next++;
+            _live.insert(ticket);
+            _reads.push(std::move(job));
+        }
+        _readWake.notify_one();
+
+        _stats.requested++;
+        return ticket;
+    }
+
+    ////
+    // bool cancel(Ticket)
+    //
+    // Cancels a request, returning false if it was already uploaded (or
+    // failed, or cancelled).
+    bool Streamer::cancel(Ticket ticket) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_live.erase(ticket) == 0)
+            return false;
+
+        _cancelled.insert(ticket);
+        return true;
+    }
+
+    ////
+    // bool ready()
+    //
+    // Whether anything is waiting to be uploaded.
+    bool Streamer::ready() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_uploads.empty();
+    }
+
+    ////
+    // size_t pending()
+    //
+    // The number of requests not uploaded (or failed) yet.
+    size_t Streamer::pending() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _live.size();
+    }
+
+    ////
+    // size_t upload(VkCommandBuffer, vulkan::StagingRing&, const Budget&)
+    //
+    // Stages and records the uploads of the frame, most urgent first. Stops
+    // at the first upload past the budget, or that doesn't fit in the ring
+    // (it waits for earlier uploads to complete rather than letting smaller
+    // ones overtake it). An asset larger than the whole ring fails.
+    size_t Streamer::upload(VkCommandBuffer cmd, vulkan::StagingRing& ring, const Budget& budget) {
+        uint64_t start = nowNanos();
+        uint64_t bytes = 0;
+        size_t count = 0;
+
+        while (true) {
+            std::unique_ptr<Job> job;
+            vulkan::Staged staged;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                while (!_uploads.empty() && _cancelled.count(_uploads.top().ticket) != 0)
+                    drop(*_uploads.pop());
+
+                if (_uploads.empty())
+                    break;
+
+                const Job& next = _uploads.top();
+                if (!next.failed) {
+                    uint64_t size = next.stagedSize();
+                    if (count > 0 && (bytes + size > budget.bytes || nowNanos() - start >= budget.nanos))
+                        break;
+
+                    if (size <= ring.capacity() && !ring.allocate(size, 16, staged)) {
+                        _stats.stalls++;
+                        break;
+                    }
+                }
+
+                job = _uploads.pop();
+                _live.erase(job->ticket);
+            }
+
+            size_t size = job->stagedSize();
+            if (!job->failed && size > ring.capacity()) {
+                job->failed = true;
+                _stats.failed++;
+            }
+
+            if (job->failed) {
+                if (job->request.failed)
+                    job->request.failed();
+                continue;
+            }
+
+            std::memcpy(staged.data, job->staged(), size);
+            job->request.upload(cmd, staged);
+
+            bytes += size;
+            count++;
+        }
+
+        if (count > 0) {
+            uint64_t nanos = nowNanos() - start;
+
+            _stats.uploaded += count;
+            _stats.bytesUploaded += bytes;
+            _stats.uploadFrames++;
+            if (bytes > budget.bytes || nanos > budget.nanos)
+                _stats.framesOverBudget++;
+            _stats.maxFrameBytes = std::max(_stats.maxFrameBytes, bytes);
+            _stats.maxFrameNanos = std::max(_stats.maxFrameNanos, nanos);
+        }
+
+        return count;
+    }
+
+    ////
+    // const StreamStats& stats()
+    //
+    // The counters of the streamer.
+    const StreamStats& Streamer::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void Streamer::report(std::ostream& out) const {
+        out << "Streaming: " << _stats.requested.load() << " requested, "
+            << _stats.uploaded << " uploaded (" << _stats.bytesUploaded << " bytes over "
+            << _stats.uploadFrames << " frames), " << _stats.viewed.load() << " staged straight from a pack ("
+            << _stats.bytesViewed.load() << " bytes), " << _stats.cancelled.load() << " cancelled, "
+            << _stats.failed.load() << " failed, " << _stats.stalls << " ring stalls, "
+            << _stats.framesOverBudget << " frames over budget, max "
+            << _stats.maxFrameBytes << " bytes / " << _stats.maxFrameNanos / 1000 << "us a frame"
+            << std::endl;
+    }
+}
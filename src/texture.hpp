@@ -0,0 +1,354 @@
+#ifndef __WFN_ENG_TEXTURE_HPP__
+#define __WFN_ENG_TEXTURE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "error.hpp"
+#include "stream.hpp"
+#include "vulkan.hpp"
+
+namespace wfn_eng::texture {
+    ////
+    // const uint32_t maxLevels
+    //
+    // The most mip levels a texture has: enough for 32768x32768.
+    const uint32_t maxLevels = 16;
+
+    ////
+    // struct FormatInfo
+    //
+    // The size of a texel block of a format, and the texels it covers. An
+    // unknown format has blockBytes 0.
+    struct FormatInfo {
+        uint32_t blockBytes = 0;
+        uint32_t blockWidth = 1;
+        uint32_t blockHeight = 1;
+        bool compressed = false;
+    };
+
+    ////
+    // FormatInfo formatInfo(VkFormat)
+    //
+    // The block layout of the formats textures can be loaded in: the common
+    // 8, 16 and 32-bit per channel ones, BC1 to BC7 and the ASTC LDR
+    // formats.
+    FormatInfo formatInfo(VkFormat);
+
+    ////
+    // bool sampleable(VkPhysicalDevice, VkFormat)
+    //
+    // Whether the device can sample optimally tiled images of a format with
+    // a linear filter.
+    bool sampleable(VkPhysicalDevice, VkFormat);
+
+    ////
+    // bool blittable(VkPhysicalDevice, VkFormat)
+    //
+    // Whether the device can generate mips of a format with linear blits.
+    bool blittable(VkPhysicalDevice, VkFormat);
+
+    ////
+    // uint32_t fullChain(uint32_t, uint32_t)
+    //
+    // The number of levels of a full mip chain.
+    uint32_t fullChain(uint32_t, uint32_t);
+
+    ////
+    // struct Level
+    //
+    // One mip level of an Image: where it starts in the data, and its size.
+    struct Level {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    ////
+    // struct Image
+    //
+    // A 2D texture in memory: every level it comes with, packed level 0
+    // first, each at a 16-byte offset (as copies out of a staging buffer
+    // need). With generateMips, only level 0 is provided and the rest of
+    // the chain is blitted on the GPU.
+    struct Image {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<Level> levels;
+        bool generateMips = false;
+        std::vector<uint8_t> data;
+    };
+
+    ////
+    // Image readKtx2(const uint8_t *, size_t)
+    //
+    // Reads a KTX2 file, throwing if it isn't one this loader supports: a
+    // single 2D image (no arrays, cube maps or 3D), in a format formatInfo
+    // knows, not supercompressed (or zstd supercompressed, when built with
+    // zstd). An uncompressed file with a single level, or with a level count
+    // of 0 (the spec's way of asking for generated mips), gets its mips
+    // generated.
+    Image readKtx2(const uint8_t *, size_t);
+
+    ////
+    // std::vector<uint8_t> writeKtx2(const Image&)
+    //
+    // Writes an RGBA8 image (UNORM or SRGB) and every level it comes with
+    // as a KTX2 file, for the offline tools. Throws on any other format.
+    std::vector<uint8_t> writeKtx2(const Image&);
+
+    ////
+    // Image checkerboard(uint32_t, uint32_t)
+    //
+    // A square RGBA8 checkerboard of the provided size and number of
+    // squares per side, with its mips to be generated.
+    Image checkerboard(uint32_t, uint32_t);
+
+    ////
+    // struct SamplerKey
+    //
+    // Everything a sampler is built from.
+    struct SamplerKey {
+        VkFilter filter = VK_FILTER_LINEAR;
+        VkSamplerMipmapMode mipmap = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        VkSamplerAddressMode address = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+        bool operator==(const SamplerKey&) const;
+    };
+
+    ////
+    // struct SamplerStats
+    //
+    // Counters on a SamplerCache. A hit is a sampler found already built.
+    struct SamplerStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    ////
+    // class SamplerCache
+    //
+    // Keeps every sampler it builds, keyed by content, so textures sampled
+    // the same way share one VkSampler (drivers allow as few as 4000). The
+    // Device must outlive the cache.
+    class SamplerCache {
+        struct KeyHash {
+            size_t operator()(const SamplerKey&) const;
+        };
+
+        VkDevice _device;
+        vulkan::DeviceTable _vk;
+
+        std::unordered_map<SamplerKey, vulkan::Handle<VkSampler>, KeyHash> _samplers;
+
+        SamplerStats _stats;
+
+    public:
+        ////
+        // SamplerCache(vulkan::Device&)
+        //
+        // Constructs an empty cache.
+        SamplerCache(vulkan::Device&);
+
+        ////
+        // VkSampler get(const SamplerKey&)
+        //
+        // The sampler built from a key, building it the first time.
+        VkSampler get(const SamplerKey&);
+
+        ////
+        // const SamplerStats& stats()
+        //
+        // The counters of the cache.
+        const SamplerStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        SamplerCache(const SamplerCache&) = delete;
+        SamplerCache& operator=(const SamplerCache&) = delete;
+    };
+
+    ////
+    // class Texture
+    //
+    // A sampled image in device-local memory, with a view of every level
+    // and a sampler from a SamplerCache.
+    class Texture {
+        vulkan::Handle<VkImage> _image;
+        vulkan::Handle<VkDeviceMemory> _memory;
+        vulkan::Handle<VkImageView> _view;
+        VkSampler _sampler;
+
+        VkFormat _format;
+        uint32_t _width;
+        uint32_t _height;
+        uint32_t _levels;
+        uint64_t _bytes;
+
+    public:
+        ////
+        // Texture(vulkan::Device&, const Image&, VkSampler)
+        //
+        // Creates the image, with room for the whole chain when its mips
+        // are generated. Its contents are undefined until an upload is
+        // recorded.
+        Texture(vulkan::Device&, const Image&, VkSampler);
+
+        ////
+        // void record(VkCommandBuffer, const vulkan::DeviceTable&, const Image&, const vulkan::Staged&)
+        //
+        // Records the copy of every level out of a staged copy of the image
+        // data, the blits of the generated mips, and the transition of the
+        // whole image for sampling from fragment shaders.
+        void record(VkCommandBuffer, const vulkan::DeviceTable&, const Image&, const vulkan::Staged&);
+
+        VkImage image() const;
+        VkImageView view() const;
+        VkSampler sampler() const;
+        VkFormat format() const;
+        uint32_t width() const;
+        uint32_t height() const;
+        uint32_t levels() const;
+
+        ////
+        // uint64_t bytes()
+        //
+        // The device memory the image takes.
+        uint64_t bytes() const;
+
+        // Following Rule of 3's
+        Texture(const Texture&) = delete;
+        Texture& operator=(const Texture&) = delete;
+    };
+
+    ////
+    // typedef TextureId
+    //
+    // Names a texture of a Textures.
+    typedef uint32_t TextureId;
+
+    ////
+    // struct TextureStats
+    //
+    // Counters on a Textures. The RGBA8 bytes are what the same textures
+    // would take uncompressed, with full chains, to show what compression
+    // saves.
+    struct TextureStats {
+        uint64_t textures = 0;
+        uint64_t compressed = 0;
+        uint64_t generated = 0;
+        uint64_t unblittable = 0;
+        uint64_t failed = 0;
+        uint64_t bytes = 0;
+        uint64_t rgba8Bytes = 0;
+    };
+
+    ////
+    // class Textures
+    //
+    // Owns every texture, and the sampler cache they share. A texture
+    // exists once its upload is recorded: for an added Image, by the next
+    // upload; for a loaded file, once the Streamer uploads it. Every later
+    // submission on the same queue may sample it. Lives on the render
+    // thread, and the Device must outlive it.
+    class Textures {
+        struct Pending {
+            TextureId id;
+            Image image;
+            SamplerKey sampler;
+        };
+
+        vulkan::Device& _device;
+        SamplerCache _samplers;
+
+        std::vector<std::unique_ptr<Texture>> _textures;
+        std::vector<Pending> _pending;
+
+        TextureStats _stats;
+
+        ////
+        // Texture& create(TextureId, Image&, const SamplerKey&)
+        //
+        // Creates a texture, falling back to the provided levels if the
+        // device can't blit its format.
+        Texture& create(TextureId, Image&, const SamplerKey&);
+
+    public:
+        ////
+        // Textures(vulkan::Device&)
+        //
+        // Constructs an empty set of textures.
+        Textures(vulkan::Device&);
+
+        ////
+        // TextureId add(Image, const SamplerKey&)
+        //
+        // Queues an image to upload, throwing if the device can't sample
+        // its format.
+        TextureId add(Image, const SamplerKey& = SamplerKey());
+
+        ////
+        // TextureId load(stream::Streamer&, const std::string&, const SamplerKey&, stream::Priority)
+        //
+        // Streams in a KTX2 file, read and parsed in the background. A file
+        // that fails to load, or that the device can't sample, is counted
+        // and never becomes a texture.
+        TextureId load(stream::Streamer&, const std::string&, const SamplerKey& = SamplerKey(), stream::Priority = stream::Priority::Later);
+
+        ////
+        // size_t upload(VkCommandBuffer, vulkan::StagingRing&)
+        //
+        // Records the uploads of the added images that fit in the ring,
+        // returning how many were recorded. The caller submits the ring
+        // with the command buffer.
+        size_t upload(VkCommandBuffer, vulkan::StagingRing&);
+
+        ////
+        // bool pending()
+        //
+        // Whether any added image waits for an upload.
+        bool pending() const;
+
+        ////
+        // const Texture *get(TextureId)
+        //
+        // A texture, or nullptr until its upload is recorded.
+        const Texture *get(TextureId) const;
+
+        ////
+        // SamplerCache& samplers()
+        //
+        // The samplers of the textures.
+        SamplerCache& samplers();
+
+        ////
+        // const TextureStats& stats()
+        //
+        // The counters of the textures.
+        const TextureStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        Textures(const Textures&) = delete;
+        Textures& operator=(const Textures&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "../texture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef WFN_ENG_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// «KTX 20»\r\n\x1A\n
+static const uint8_t identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+// The header, then the index, then one level index entry per level.
+static const size_t headerSize = 80;
+static const size_t levelEntrySize = 24;
+
+static const uint32_t supercompressionNone = 0;
+static const uint32_t supercompressionZstd = 2;
+
+// The basic data format descriptor of an RGBA8 image: its size, then a
+// block header of 6 words and a sample of 4 words per channel.
+static const size_t dfdSize = 4 + 24 + 4 * 16;
+
+////
+// uint32_t read32(const uint8_t *)
+//
+// A little-endian 32-bit field.
+static uint32_t read32(const uint8_t *at) {
+    uint32_t value;
+    std::memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+////
+// uint64_t read64(const uint8_t *)
+//
+// A little-endian 64-bit field.
+static uint64_t read64(const uint8_t *at) {
+    uint64_t value;
+    std::memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+////
+// void write32(std::vector<uint8_t>&, size_t, uint32_t)
+//
+// Writes a little-endian 32-bit field.
+static void write32(std::vector<uint8_t>& file, size_t at, uint32_t value) {
+    std::memcpy(file.data() + at, &value, sizeof(value));
+}
+
+////
+// void write64(std::vector<uint8_t>&, size_t, uint64_t)
+//
+// Writes a little-endian 64-bit field.
+static void write64(std::vector<uint8_t>& file, size_t at, uint64_t value) {
+    std::memcpy(file.data() + at, &value, sizeof(value));
+}
+
+namespace wfn_eng::texture {
+    ////
+    // Image readKtx2(const uint8_t *, size_t)
+    //
+    // Reads a KTX2 file into an Image. The file stores its smallest level
+    // first, and the level index says where each is; the Image packs them
+    // largest first instead, in the order they're copied.
+    Image readKtx2(const uint8_t *file, size_t size) {
+        if (size < headerSize || std::memcmp(file, identifier, sizeof(identifier)) != 0)
+            throw WfnError("wfn_eng::texture", "readKtx2", "Read Header");
+
+        VkFormat format = static_cast<VkFormat>(read32(file + 12));
+        uint32_t width = read32(file + 20);
+        uint32_t height = read32(file + 24);
+        uint32_t depth = read32(file + 28);
+        uint32_t layers = read32(file + 32);
+        uint32_t faces = read32(file + 36);
+        uint32_t levelCount = read32(file + 40);
+        uint32_t supercompression = read32(file + 44);
+
+        if (width == 0 || height == 0 || depth != 0 || layers > 1 || faces != 1)
+            throw WfnError("wfn_eng::texture", "readKtx2", "Load (only single 2D images)");
+
+        FormatInfo info = formatInfo(format);
+        if (info.blockBytes == 0)
+            throw WfnError("wfn_eng::texture", "readKtx2", "Load (format " + std::to_string(format) + ")");
+
+        uint32_t stored = std::max(levelCount, 1u);
+        if (stored > std::min(maxLevels, fullChain(width, height)) || headerSize + stored * levelEntrySize > size)
+            throw WfnError("wfn_eng::texture", "readKtx2", "Read Level Index");
+
+        bool zstd = supercompression == supercompressionZstd;
+#ifndef WFN_ENG_HAVE_ZSTD
+        zstd = false;
+#endif
+        if (supercompression != supercompressionNone && !zstd)
+            throw WfnError("wfn_eng::texture", "readKtx2", "Load (supercompression " + std::to_string(supercompression) + ")");
+
+        Image image;
+        image.format = format;
+        image.width = width;
+        image.height = height;
+        image.generateMips = !info.compressed && stored == 1;
+
+        for (uint32_t i = 0; i < stored; i++) {
+            const uint8_t *entry = file + headerSize + i * levelEntrySize;
+            uint64_t byteOffset = read64(entry);
+            uint64_t byteLength = read64(entry + 8);
+            if (byteOffset > size || byteLength > size - byteOffset)
+                throw WfnError("wfn_eng::texture", "readKtx2", "Read Level " + std::to_string(i));
+
+            Level level;
+            level.width = std::max(width >> i, 1u);
+            level.height = std::max(height >> i, 1u);
+            level.size = (uint64_t)((level.width + info.blockWidth - 1) / info.blockWidth) *
+                ((level.height + info.blockHeight - 1) / info.blockHeight) * info.blockBytes;
+            level.offset = (image.data.size() + 15) & ~(uint64_t)15;
+            image.data.resize(level.offset + level.size);
+
+            bool read = false;
+            if (!zstd) {
+                read = byteLength >= level.size;
+                if (read)
+                    std::memcpy(image.data.data() + level.offset, file + byteOffset, level.size);
+            }
+#ifdef WFN_ENG_HAVE_ZSTD
+            else {
+                size_t got = ZSTD_decompress(image.data.data() + level.offset, level.size, file + byteOffset, byteLength);
+                read = !ZSTD_isError(got) && got == level.size;
+            }
+#endif
+
+            if (!read)
+                throw WfnError("wfn_eng::texture", "readKtx2", "Read Level " + std::to_string(i));
+
+            image.levels.push_back(level);
+        }
+
+        return image;
+    }
+
+    ////
+    // std::vector<uint8_t> writeKtx2(const Image&)
+    //
+    // Writes an RGBA8 image as a KTX2 file: the header, the level index,
+    // the data format descriptor, then the levels, smallest first as the
+    // spec orders them, each on 4 bytes.
+    std::vector<uint8_t> writeKtx2(const Image& image) {
+        bool srgb = image.format == VK_FORMAT_R8G8B8A8_SRGB;
+        if (!srgb && image.format != VK_FORMAT_R8G8B8A8_UNORM)
+            throw WfnError("wfn_eng::texture", "writeKtx2", "Write (format " + std::to_string(image.format) + ")");
+
+        uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+        size_t dfdOffset = headerSize + levelCount * levelEntrySize;
+
+        std::vector<uint8_t> file(dfdOffset + dfdSize);
+        std::memcpy(file.data(), identifier, sizeof(identifier));
+        write32(file, 12, image.format);
+        write32(file, 16, 1);
+        write32(file, 20, image.width);
+        write32(file, 24, image.height);
+        write32(file, 36, 1);
+        write32(file, 40, levelCount);
+        write32(file, 48, static_cast<uint32_t>(dfdOffset));
+        write32(file, 52, static_cast<uint32_t>(dfdSize));
+
+        // RGBSDA color model, BT.709 primaries, linear or sRGB transfer,
+        // one 4-byte plane, then an 8-bit sample per channel (alpha always
+        // linear).
+        size_t at = dfdOffset;
+        write32(file, at, static_cast<uint32_t>(dfdSize));
+        write32(file, at + 4, 0);
+        write32(file, at + 8, static_cast<uint32_t>(dfdSize - 4) << 16 | 2);
+        write32(file, at + 12, 1 | 1 << 8 | (srgb ? 2 : 1) << 16);
+        write32(file, at + 16, 0);
+        write32(file, at + 20, 4);
+        write32(file, at + 24, 0);
+        const uint32_t channels[4] = { 0, 1, 2, 15 | 0x10 };
+        for (uint32_t c = 0; c < 4; c++) {
+            size_t sample = at + 28 + c * 16;
+            write32(file, sample, c * 8 | 7 << 16 | channels[c] << 24);
+            write32(file, sample + 4, 0);
+            write32(file, sample + 8, 0);
+            write32(file, sample + 12, 255);
+        }
+
+        for (uint32_t i = levelCount; i-- > 0;) {
+            const Level& level = image.levels[i];
+            if (level.offset + level.size > image.data.size())
+                throw WfnError("wfn_eng::texture", "writeKtx2", "Write Level " + std::to_string(i));
+
+            size_t offset = (file.size() + 3) & ~(size_t)3;
+            file.resize(offset + level.size);
+            std::memcpy(file.data() + offset, image.data.data() + level.offset, level.size);
+
+            size_t entry = headerSize + i * levelEntrySize;
+            write64(file, entry, offset);
+            write64(file, entry + 8, level.size);
+            write64(file, entry + 16, level.size);
+        }
+
+        return file;
+    }
+
+    ////
+    // Image checkerboard(uint32_t, uint32_t)
+    //
+    // A square RGBA8 checkerboard of the provided size and number of
+    // squares per side, light and dark gray, with its mips to be
+    // generated.
+    Image checkerboard(uint32_t size, uint32_t squares) {
+        Image image;
+        image.format = VK_FORMAT_R8G8B8A8_UNORM;
+        image.width = size;
+        image.height = size;
+        image.generateMips = true;
+        image.levels.push_back(Level { 0, (uint64_t)size * size * 4, size, size });
+        image.data.resize(image.levels[0].size);
+
+        uint32_t square = std::max(size / std::max(squares, 1u), 1u);
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                uint8_t value = ((x / square + y / square) & 1) != 0 ? 96 : 255;
+                uint8_t *texel = image.data.data() + ((uint64_t)y * size + x) * 4;
+                texel[0] = texel[1] = texel[2] = value;
+                texel[3] = 255;
+            }
+        }
+
+        return image;
+    }
+}
@@ -0,0 +1,82 @@
+#include "../texture.hpp"
+
+namespace wfn_eng::texture {
+    ////
+    // struct SamplerKey
+    //
+    // Everything a sampler is built from.
+    bool SamplerKey::operator==(const SamplerKey& o) const {
+        return filter == o.filter && mipmap == o.mipmap && address == o.address;
+    }
+
+    ////
+    // class SamplerCache
+    //
+    // Keeps every sampler it builds, keyed by content.
+
+    size_t SamplerCache::KeyHash::operator()(const SamplerKey& key) const {
+        return static_cast<size_t>(key.filter) |
+            static_cast<size_t>(key.mipmap) << 8 |
+            static_cast<size_t>(key.address) << 16;
+    }
+
+    ////
+    // SamplerCache(vulkan::Device&)
+    //
+    // Constructs an empty cache.
+    SamplerCache::SamplerCache(vulkan::Device& device)
+            : _device(device.logical())
+            , _vk(device.table()) { }
+
+    ////
+    // VkSampler get(const SamplerKey&)
+    //
+    // The sampler built from a key, building it the first time. Every level
+    // of a texture may be sampled.
+    VkSampler SamplerCache::get(const SamplerKey& key) {
+        auto it = _samplers.find(key);
+        if (it != _samplers.end()) {
+            _stats.hits++;
+            return it->second.get();
+        }
+
+        VkSamplerCreateInfo samplerInfo = {};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = key.filter;
+        samplerInfo.minFilter = key.filter;
+        samplerInfo.mipmapMode = key.mipmap;
+        samplerInfo.addressModeU = key.address;
+        samplerInfo.addressModeV = key.address;
+        samplerInfo.addressModeW = key.address;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+        VkSampler sampler;
+        if (_vk.vkCreateSampler(_device, &samplerInfo, vulkan::allocator::callbacks(), &sampler) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::texture::SamplerCache",
+                "get",
+                "Create Sampler"
+            );
+        }
+
+        _stats.misses++;
+        _samplers.emplace(key, vulkan::Handle<VkSampler>(_device, sampler));
+        return sampler;
+    }
+
+    ////
+    // const SamplerStats& stats()
+    //
+    // The counters of the cache.
+    const SamplerStats& SamplerCache::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void SamplerCache::report(std::ostream& out) const {
+        out << "Samplers: " << _samplers.size() << " built (" << _stats.hits << " hits)" << std::endl;
+    }
+}
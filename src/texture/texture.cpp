@@ -0,0 +1,435 @@
+#include "../texture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+////
+// VkImageMemoryBarrier levelBarrier(VkImage, uint32_t, uint32_t, VkImageLayout, VkImageLayout, VkAccessFlags, VkAccessFlags)
+//
+// A barrier moving a range of levels of a color image from one layout to
+// another.
+static VkImageMemoryBarrier levelBarrier(
+        VkImage image,
+        uint32_t first,
+        uint32_t count,
+        VkImageLayout from,
+        VkImageLayout to,
+        VkAccessFlags src,
+        VkAccessFlags dst) {
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src;
+    barrier.dstAccessMask = dst;
+    barrier.oldLayout = from;
+    barrier.newLayout = to;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = first;
+    barrier.subresourceRange.levelCount = count;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+
+namespace wfn_eng::texture {
+    ////
+    // bool sampleable(VkPhysicalDevice, VkFormat)
+    //
+    // Whether the device can sample optimally tiled images of a format with
+    // a linear filter. BCn is near universal on desktop GPUs and ASTC on
+    // mobile ones, but neither is required. Kept apart from the format
+    // tables so that the offline tools don't need a Vulkan library.
+    bool sampleable(VkPhysicalDevice device, VkFormat format) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(device, format, &properties);
+
+        const VkFormatFeatureFlags wanted =
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+            VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        return (properties.optimalTilingFeatures & wanted) == wanted;
+    }
+
+    ////
+    // bool blittable(VkPhysicalDevice, VkFormat)
+    //
+    // Whether the device can generate mips of a format with linear blits.
+    bool blittable(VkPhysicalDevice device, VkFormat format) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(device, format, &properties);
+
+        const VkFormatFeatureFlags wanted =
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+            VK_FORMAT_FEATURE_BLIT_DST_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & wanted) == wanted;
+    }
+
+    ////
+    // class Texture
+    //
+    // A sampled image in device-local memory.
+
+    ////
+    // Texture(vulkan::Device&, const Image&, VkSampler)
+    //
+    // Creates the image, its memory and a view of every level.
+    Texture::Texture(vulkan::Device& device, const Image& image, VkSampler sampler)
+            : _sampler(sampler)
+            , _format(image.format)
+            , _width(image.width)
+            , _height(image.height)
+            , _levels(image.generateMips ? std::min(maxLevels, fullChain(image.width, image.height)) : (uint32_t)image.levels.size())
+            , _bytes(0) {
+        VkDevice logical = device.logical();
+        const vulkan::DeviceTable& vk = device.table();
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = _format;
+        imageInfo.extent = { _width, _height, 1 };
+        imageInfo.mipLevels = _levels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (image.generateMips)
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage handle;
+        if (vk.vkCreateImage(logical, &imageInfo, vulkan::allocator::callbacks(), &handle) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::texture::Texture",
+                "Texture",
+                "Create Image"
+            );
+        }
+        _image = vulkan::Handle<VkImage>(logical, handle);
+
+        VkMemoryRequirements requirements;
+        vk.vkGetImageMemoryRequirements(logical, handle, &requirements);
+
+        VkMemoryAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = requirements.size;
+        allocateInfo.memoryTypeIndex = vulkan::util::memoryType(
+            device.physical(),
+            requirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+
+        VkDeviceMemory memory;
+        if (vk.vkAllocateMemory(logical, &allocateInfo, vulkan::allocator::callbacks(), &memory) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::texture::Texture",
+                "Texture",
+                "Allocate Memory"
+            );
+        }
+        _memory = vulkan::Handle<VkDeviceMemory>(logical, memory);
+        _bytes = requirements.size;
+
+        if (vk.vkBindImageMemory(logical, handle, memory, 0) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::texture::Texture",
+                "Texture",
+                "Bind Memory"
+            );
+        }
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = handle;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = _format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = _levels;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if (vk.vkCreateImageView(logical, &viewInfo, vulkan::allocator::callbacks(), &view) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::texture::Texture",
+                "Texture",
+                "Create Image View"
+            );
+        }
+        _view = vulkan::Handle<VkImageView>(logical, view);
+    }
+
+    ////
+    // void record(VkCommandBuffer, const vulkan::DeviceTable&, const Image&, const vulkan::Staged&)
+    //
+    // Records the upload. Every provided level is copied in one command.
+    // A generated chain is then blitted level by level, each from the one
+    // before it, which is first moved to a transfer source; so at the end
+    // every level but the last is a transfer source, and the last is still
+    // a transfer destination.
+    void Texture::record(VkCommandBuffer cmd, const vulkan::DeviceTable& vk, const Image& image, const vulkan::Staged& staged) {
+        VkImage handle = _image.get();
+
+        VkImageMemoryBarrier toCopy = levelBarrier(
+            handle, 0, _levels,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT
+        );
+        vk.vkCmdPipelineBarrier(
+            cmd,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &toCopy
+        );
+
+        VkBufferImageCopy regions[maxLevels] = {};
+        uint32_t provided = std::min((uint32_t)image.levels.size(), _levels);
+        for (uint32_t i = 0; i < provided; i++) {
+            regions[i].bufferOffset = staged.offset + image.levels[i].offset;
+            regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            regions[i].imageSubresource.mipLevel = i;
+            regions[i].imageSubresource.baseArrayLayer = 0;
+            regions[i].imageSubresource.layerCount = 1;
+            regions[i].imageExtent = { image.levels[i].width, image.levels[i].height, 1 };
+        }
+        vk.vkCmdCopyBufferToImage(cmd, staged.buffer, handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, provided, regions);
+
+        for (uint32_t i = provided; i < _levels; i++) {
+            VkImageMemoryBarrier toSource = levelBarrier(
+                handle, i - 1, 1,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT
+            );
+            vk.vkCmdPipelineBarrier(
+                cmd,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &toSource
+            );
+
+            VkImageBlit blit = {};
+            blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1 };
+            blit.srcOffsets[1] = { (int32_t)std::max(_width >> (i - 1), 1u), (int32_t)std::max(_height >> (i - 1), 1u), 1 };
+            blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+            blit.dstOffsets[1] = { (int32_t)std::max(_width >> i, 1u), (int32_t)std::max(_height >> i, 1u), 1 };
+
+            vk.vkCmdBlitImage(
+                cmd,
+                handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR
+            );
+        }
+
+        VkImageMemoryBarrier toSample[2];
+        uint32_t count = 0;
+        uint32_t sources = _levels > provided ? _levels - 1 : 0;
+        if (sources > 0) {
+            toSample[count++] = levelBarrier(
+                handle, 0, sources,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT
+            );
+        }
+        toSample[count++] = levelBarrier(
+            handle, sources, _levels - sources,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+        vk.vkCmdPipelineBarrier(
+            cmd,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, count, toSample
+        );
+    }
+
+    VkImage Texture::image() const { return _image.get(); }
+    VkImageView Texture::view() const { return _view.get(); }
+    VkSampler Texture::sampler() const { return _sampler; }
+    VkFormat Texture::format() const { return _format; }
+    uint32_t Texture::width() const { return _width; }
+    uint32_t Texture::height() const { return _height; }
+    uint32_t Texture::levels() const { return _levels; }
+
+    ////
+    // uint64_t bytes()
+    //
+    // The device memory the image takes.
+    uint64_t Texture::bytes() const { return _bytes; }
+
+    ////
+    // class Textures
+    //
+    // Owns every texture, and the sampler cache they share.
+
+    ////
+    // Textures(vulkan::Device&)
+    //
+    // Constructs an empty set of textures.
+    Textures::Textures(vulkan::Device& device)
+            : _device(device)
+            , _samplers(device) { }
+
+    ////
+    // Texture& create(TextureId, Image&, const SamplerKey&)
+    //
+    // Creates a texture, falling back to the provided levels only if the
+    // device can't blit its format.
+    Texture& Textures::create(TextureId id, Image& image, const SamplerKey& key) {
+        if (image.generateMips && !blittable(_device.physical(), image.format)) {
+            image.generateMips = false;
+            _stats.unblittable++;
+        }
+
+        _textures[id] = std::make_unique<Texture>(_device, image, _samplers.get(key));
+        const Texture& texture = *_textures[id];
+
+        _stats.textures++;
+        if (formatInfo(image.format).compressed)
+            _stats.compressed++;
+        if (image.generateMips && texture.levels() > 1)
+            _stats.generated++;
+        _stats.bytes += texture.bytes();
+        for (uint32_t i = 0; i < texture.levels(); i++)
+            _stats.rgba8Bytes += (uint64_t)std::max(texture.width() >> i, 1u) * std::max(texture.height() >> i, 1u) * 4;
+
+        return *_textures[id];
+    }
+
+    ////
+    // TextureId add(Image, const SamplerKey&)
+    //
+    // Queues an image to upload, throwing if the device can't sample its
+    // format.
+    TextureId Textures::add(Image image, const SamplerKey& key) {
+        if (!sampleable(_device.physical(), image.format)) {
+            throw WfnError(
+                "wfn_eng::texture::Textures",
+                "add",
+                "Sample (format " + std::to_string(image.format) + ")"
+            );
+        }
+
+        TextureId id = static_cast<TextureId>(_textures.size());
+        _textures.emplace_back();
+        _pending.push_back(Pending { id, std::move(image), key });
+        return id;
+    }
+
+    ////
+    // TextureId load(stream::Streamer&, const std::string&, const SamplerKey&, stream::Priority)
+    //
+    // Streams in a KTX2 file. A worker parses it and checks the format; the
+    // upload then creates the texture and records its copies out of the
+    // staged levels. The Textures must outlive the request.
+    TextureId Textures::load(stream::Streamer& streamer, const std::string& path, const SamplerKey& key, stream::Priority priority) {
+        TextureId id = static_cast<TextureId>(_textures.size());
+        _textures.emplace_back();
+
+        // Everything but the data, which moves through the streamer.
+        std::shared_ptr<Image> image = std::make_shared<Image>();
+        VkPhysicalDevice physical = _device.physical();
+
+        stream::Request request;
+        request.path = path;
+        request.priority = priority;
+        request.decode = [image, physical](std::vector<uint8_t>& data) {
+            try {
+                *image = readKtx2(data.data(), data.size());
+            } catch (const WfnError&) {
+                return false;
+            }
+
+            if (!sampleable(physical, image->format))
+                return false;
+
+            data.swap(image->data);
+            image->data = std::vector<uint8_t>();
+            return true;
+        };
+        request.upload = [this, id, image, key](VkCommandBuffer cmd, const vulkan::Staged& staged) {
+            create(id, *image, key).record(cmd, _device.table(), *image, staged);
+        };
+        request.failed = [this]() {
+            _stats.failed++;
+        };
+
+        streamer.request(std::move(request));
+        return id;
+    }
+
+    ////
+    // size_t upload(VkCommandBuffer, vulkan::StagingRing&)
+    //
+    // Records the uploads of the added images in the order they were
+    // added, stopping at the first that doesn't fit in the ring. One larger
+    // than the whole ring is dropped as failed.
+    size_t Textures::upload(VkCommandBuffer cmd, vulkan::StagingRing& ring) {
+        size_t count = 0;
+
+        auto it = _pending.begin();
+        for (; it != _pending.end(); it++) {
+            if (it->image.data.size() > ring.capacity()) {
+                _stats.failed++;
+                continue;
+            }
+
+            vulkan::Staged staged;
+            if (!ring.allocate(it->image.data.size(), 16, staged))
+                break;
+
+            std::memcpy(staged.data, it->image.data.data(), it->image.data.size());
+            create(it->id, it->image, it->sampler).record(cmd, _device.table(), it->image, staged);
+            count++;
+        }
+
+        _pending.erase(_pending.begin(), it);
+        return count;
+    }
+
+    ////
+    // bool pending()
+    //
+    // Whether any added image waits for an upload.
+    bool Textures::pending() const { return !_pending.empty(); }
+
+    ////
+    // const Texture *get(TextureId)
+    //
+    // A texture, or nullptr until its upload is recorded.
+    const Texture *Textures::get(TextureId id) const {
+        return id < _textures.size() ? _textures[id].get() : nullptr;
+    }
+
+    ////
+    // SamplerCache& samplers()
+    //
+    // The samplers of the textures.
+    SamplerCache& Textures::samplers() { return _samplers; }
+
+    ////
+    // const TextureStats& stats()
+    //
+    // The counters of the textures.
+    const TextureStats& Textures::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters, and how much smaller the textures are than if
+    // they were all RGBA8.
+    void Textures::report(std::ostream& out) const {
+        out << "Textures: " << _stats.textures << " (" << _stats.compressed << " compressed, "
+            << _stats.generated << " with generated mips, " << _stats.unblittable << " unblittable, "
+            << _stats.failed << " failed), " << _stats.bytes / 1024 << "KiB on the GPU, "
+            << _stats.rgba8Bytes / 1024 << "KiB as RGBA8";
+        if (_stats.bytes > 0)
+            out << " (" << (double)_stats.rgba8Bytes / _stats.bytes << "x)";
+        out << std::endl;
+        _samplers.report(out);
+    }
+}
@@ -0,0 +1,271 @@
+#ifndef __WFN_ENG_TILEMAP_HPP__
+#define __WFN_ENG_TILEMAP_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "atlas.hpp"
+#include "cull.hpp"
+#include "error.hpp"
+#include "render.hpp"
+#include "vulkan.hpp"
+
+namespace wfn_eng::tilemap {
+    ////
+    // typedef TileId
+    //
+    // Names a tile of a Tilemap's tileset: tile t is drawn with the
+    // tileset's frame t - 1, and 0 is an empty cell.
+    typedef uint16_t TileId;
+
+    ////
+    // const TileId noTile
+    //
+    // An empty cell.
+    const TileId noTile = 0;
+
+    ////
+    // const uint32_t maxChunkSize
+    //
+    // The largest chunk side, in tiles, which keeps a full chunk's bake
+    // (64 bytes a tile) to 1MiB of a staging ring.
+    const uint32_t maxChunkSize = 128;
+
+    ////
+    // class Tilemap
+    //
+    // A grid of tiles drawn from the frames of an Atlas, split into square
+    // chunks of chunkSize tiles. Editing a tile marks its chunk dirty; a
+    // chunk is baked (turned into quads) again only once it is. Which
+    // chunks a camera sees is worked out from their grid, so it costs as
+    // much as the chunks found, however large the map is. The Atlas must
+    // outlive the map.
+    class Tilemap {
+        const atlas::Atlas& _atlas;
+        std::vector<atlas::FrameId> _tileset;
+
+        uint32_t _width;
+        uint32_t _height;
+        float _tileSize;
+        uint32_t _chunkSize;
+        uint32_t _chunksX;
+        uint32_t _chunksY;
+
+        std::vector<TileId> _tiles;
+        std::vector<bool> _isDirty;
+        std::vector<uint32_t> _dirty;
+        std::vector<uint32_t> _pageCounts;
+
+        ////
+        // void markDirty(uint32_t)
+        //
+        // Queues a chunk to bake, once.
+        void markDirty(uint32_t);
+
+    public:
+        ////
+        // Tilemap(const atlas::Atlas&, std::vector<atlas::FrameId>, uint32_t, uint32_t, float, uint32_t)
+        //
+        // Constructs an empty map of the provided width and height in
+        // tiles, each tileSize world units square, from a tileset of atlas
+        // frames. Throws if the chunk size is 0 or above maxChunkSize, or
+        // if a frame isn't in the atlas.
+        Tilemap(const atlas::Atlas&, std::vector<atlas::FrameId>, uint32_t, uint32_t, float, uint32_t = 32);
+
+        ////
+        // TileId get(uint32_t, uint32_t)
+        //
+        // The tile of a cell.
+        TileId get(uint32_t, uint32_t) const;
+
+        ////
+        // void set(uint32_t, uint32_t, TileId)
+        //
+        // Changes the tile of a cell, marking its chunk dirty if it changed.
+        // Throws if the cell is outside of the map or the tile isn't in the
+        // tileset.
+        void set(uint32_t, uint32_t, TileId);
+
+        ////
+        // void fill(const TileId *)
+        //
+        // Replaces every tile, in rows, marking every chunk dirty.
+        void fill(const TileId *);
+
+        ////
+        // uint32_t bake(uint32_t, std::vector<atlas::SpriteVertex>&, std::vector<uint32_t>&)
+        //
+        // Turns the tiles of a chunk into quads, four vertices each (see
+        // Tilemap::quadIndices), replacing the vertices. The quads are
+        // grouped by page, and the second vector gets the number on each
+        // page. Returns the number of quads. Doesn't change the map.
+        uint32_t bake(uint32_t, std::vector<atlas::SpriteVertex>&, std::vector<uint32_t>&);
+
+        ////
+        // const std::vector<uint32_t>& dirty()
+        //
+        // The chunks waiting to be baked, in the order they were dirtied.
+        const std::vector<uint32_t>& dirty() const;
+
+        ////
+        // void clean(size_t)
+        //
+        // Drops the provided number of chunks from the front of dirty(),
+        // once their bakes are uploaded.
+        void clean(size_t);
+
+        ////
+        // size_t visible(const cull::Rect&, std::vector<uint32_t>&)
+        //
+        // Replaces the chunks with those overlapping a camera rectangle, in
+        // rows, returning how many there are.
+        size_t visible(const cull::Rect&, std::vector<uint32_t>&) const;
+
+        ////
+        // cull::Rect bounds(uint32_t)
+        //
+        // The world rectangle a chunk covers.
+        cull::Rect bounds(uint32_t) const;
+
+        ////
+        // void quadIndices(uint32_t, uint32_t *)
+        //
+        // The indices of the provided number of quads, six each, as baked.
+        static void quadIndices(uint32_t, uint32_t *);
+
+        const atlas::Atlas& atlas() const;
+        uint32_t width() const;
+        uint32_t height() const;
+        float tileSize() const;
+        uint32_t chunkSize() const;
+        uint32_t chunksX() const;
+        uint32_t chunksY() const;
+
+        ////
+        // uint32_t chunks()
+        //
+        // The number of chunks.
+        uint32_t chunks() const;
+
+        // Following Rule of 3's
+        Tilemap(const Tilemap&) = delete;
+        Tilemap& operator=(const Tilemap&) = delete;
+    };
+
+    ////
+    // struct TileMaterial
+    //
+    // How the chunks of a map are drawn: a pipeline taking
+    // atlas::SpriteVertex vertices, a material per atlas page, and the
+    // layer and pipeline fields of their sort keys.
+    struct TileMaterial {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSet> pages;
+        uint32_t layer = 0;
+        uint32_t pipelineKey = 0;
+    };
+
+    ////
+    // struct ChunkStats
+    //
+    // Counters on a ChunkBuffers. The upload ones add up; the push ones
+    // are the last push's. A deferred chunk is one left dirty for the next
+    // upload because the staging ring was full.
+    struct ChunkStats {
+        uint64_t bytes = 0;
+        uint64_t baked = 0;
+        uint64_t bakedQuads = 0;
+        uint64_t uploadedBytes = 0;
+        uint64_t deferred = 0;
+        uint64_t bakeNanos = 0;
+
+        uint64_t visible = 0;
+        uint64_t draws = 0;
+        uint64_t pushNanos = 0;
+    };
+
+    ////
+    // class ChunkBuffers
+    //
+    // The baked chunks of a Tilemap on the GPU: one device-local vertex
+    // buffer with a fixed slot per chunk, and one index buffer every chunk
+    // shares, so every draw shares the same binds but its material.
+    // Uploading bakes only the dirty chunks; pushing adds a draw per
+    // page of each visible chunk to a RenderQueue, so a static map costs
+    // the CPU nothing per frame but its visible chunks. Lives on the render
+    // thread; the Device and the Tilemap must outlive it, and it must
+    // outlive the submissions drawing from it.
+    class ChunkBuffers {
+        ////
+        // struct Slot
+        //
+        // What a chunk's slot holds: the number of quads on each page, as
+        // last uploaded.
+        struct Slot {
+            std::vector<uint32_t> pageQuads;
+            uint32_t quads = 0;
+        };
+
+        vulkan::Device& _device;
+        Tilemap& _map;
+
+        vulkan::Handle<VkBuffer> _vertices;
+        vulkan::Handle<VkDeviceMemory> _vertexMemory;
+        vulkan::Handle<VkBuffer> _indices;
+        vulkan::Handle<VkDeviceMemory> _indexMemory;
+        VkDeviceSize _slotSize;
+        bool _indicesUploaded;
+
+        std::vector<Slot> _slots;
+        std::vector<atlas::SpriteVertex> _scratch;
+        std::vector<uint32_t> _pageQuads;
+        std::vector<uint32_t> _visible;
+
+        ChunkStats _stats;
+
+    public:
+        ////
+        // ChunkBuffers(vulkan::Device&, Tilemap&)
+        //
+        // Creates the buffers of every chunk of a map. Their contents are
+        // undefined until the first upload is recorded.
+        ChunkBuffers(vulkan::Device&, Tilemap&);
+
+        ////
+        // size_t upload(VkCommandBuffer, vulkan::StagingRing&)
+        //
+        // Bakes the dirty chunks that fit in the ring and records their
+        // copies, returning how many were recorded. The caller submits the
+        // ring with the command buffer, before (or as part of) the frame
+        // drawing them.
+        size_t upload(VkCommandBuffer, vulkan::StagingRing&);
+
+        ////
+        // size_t push(const cull::Rect&, const TileMaterial&, render::RenderQueue&)
+        //
+        // Pushes the draws of the chunks overlapping a camera rectangle,
+        // returning how many were pushed.
+        size_t push(const cull::Rect&, const TileMaterial&, render::RenderQueue&);
+
+        ////
+        // const ChunkStats& stats()
+        //
+        // The counters of the buffers.
+        const ChunkStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        ChunkBuffers(const ChunkBuffers&) = delete;
+        ChunkBuffers& operator=(const ChunkBuffers&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,278 @@
+#include "../tilemap.hpp"
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+////
+// VkDeviceSize createBuffer(vulkan::Device&, VkDeviceSize, VkBufferUsageFlags, vulkan::Handle<VkBuffer>&, vulkan::Handle<VkDeviceMemory>&)
+//
+// Creates a device-local buffer that is copied into, returning the memory
+// it takes.
+static VkDeviceSize createBuffer(
+        wfn_eng::vulkan::Device& device,
+        VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        wfn_eng::vulkan::Handle<VkBuffer>& buffer,
+        wfn_eng::vulkan::Handle<VkDeviceMemory>& memory) {
+    VkDevice logical = device.logical();
+    const wfn_eng::vulkan::DeviceTable& vk = device.table();
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer handle;
+    if (vk.vkCreateBuffer(logical, &bufferInfo, wfn_eng::vulkan::allocator::callbacks(), &handle) != VK_SUCCESS) {
+        throw wfn_eng::WfnError(
+            "wfn_eng::tilemap::ChunkBuffers",
+            "ChunkBuffers",
+            "Create Buffer"
+        );
+    }
+    buffer = wfn_eng::vulkan::Handle<VkBuffer>(logical, handle);
+
+    VkMemoryRequirements requirements;
+    vk.vkGetBufferMemoryRequirements(logical, handle, &requirements);
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = requirements.size;
+    allocateInfo.memoryTypeIndex = wfn_eng::vulkan::util::memoryType(
+        device.physical(),
+        requirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+
+    VkDeviceMemory allocated;
+    if (vk.vkAllocateMemory(logical, &allocateInfo, wfn_eng::vulkan::allocator::callbacks(), &allocated) != VK_SUCCESS) {
+        throw wfn_eng::WfnError(
+            "wfn_eng::tilemap::ChunkBuffers",
+            "ChunkBuffers",
+            "Allocate Memory"
+        );
+    }
+    memory = wfn_eng::vulkan::Handle<VkDeviceMemory>(logical, allocated);
+
+    if (vk.vkBindBufferMemory(logical, handle, allocated, 0) != VK_SUCCESS) {
+        throw wfn_eng::WfnError(
+            "wfn_eng::tilemap::ChunkBuffers",
+            "ChunkBuffers",
+            "Bind Memory"
+        );
+    }
+
+    return requirements.size;
+}
+
+////
+// void barrier(VkCommandBuffer, const vulkan::DeviceTable&, VkPipelineStageFlags, VkPipelineStageFlags, VkAccessFlags, VkAccessFlags)
+//
+// Records a global memory barrier.
+static void barrier(
+        VkCommandBuffer cmd,
+        const wfn_eng::vulkan::DeviceTable& vk,
+        VkPipelineStageFlags srcStage,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags src,
+        VkAccessFlags dst) {
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = src;
+    memoryBarrier.dstAccessMask = dst;
+    vk.vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+namespace wfn_eng::tilemap {
+    ////
+    // class ChunkBuffers
+    //
+    // The baked chunks of a Tilemap on the GPU.
+
+    ////
+    // ChunkBuffers(vulkan::Device&, Tilemap&)
+    //
+    // Creates a vertex buffer with room for every chunk full, and an index
+    // buffer for one full chunk. Draws address a chunk's vertices with a
+    // base vertex, so it throws if the map has too many for one.
+    ChunkBuffers::ChunkBuffers(vulkan::Device& device, Tilemap& map)
+            : _device(device)
+            , _map(map)
+            , _slotSize((VkDeviceSize)map.chunkSize() * map.chunkSize() * 4 * sizeof(atlas::SpriteVertex))
+            , _indicesUploaded(false)
+            , _slots(map.chunks()) {
+        uint64_t slotVertices = (uint64_t)map.chunkSize() * map.chunkSize() * 4;
+        if (map.chunks() == 0 || slotVertices * map.chunks() > (uint64_t)INT_MAX) {
+            throw WfnError(
+                "wfn_eng::tilemap::ChunkBuffers",
+                "ChunkBuffers",
+                "Size the buffers"
+            );
+        }
+
+        _stats.bytes += createBuffer(device, _slotSize * map.chunks(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _vertices, _vertexMemory);
+        _stats.bytes += createBuffer(device, slotVertices / 4 * 6 * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _indices, _indexMemory);
+    }
+
+    ////
+    // size_t upload(VkCommandBuffer, vulkan::StagingRing&)
+    //
+    // Bakes the dirty chunks in order, stopping at the first one the ring
+    // has no room for (it stays dirty, with every one after it). The copies
+    // overwrite slots earlier submissions may still draw from, so they wait
+    // for every vertex read before them on the queue; the draws after them
+    // wait for the copies.
+    size_t ChunkBuffers::upload(VkCommandBuffer cmd, vulkan::StagingRing& ring) {
+        const std::vector<uint32_t>& dirty = _map.dirty();
+        if (dirty.empty() && _indicesUploaded)
+            return 0;
+
+        auto start = std::chrono::steady_clock::now();
+        const vulkan::DeviceTable& vk = _device.table();
+
+        barrier(
+            cmd, vk,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT
+        );
+
+        bool copied = false;
+        if (!_indicesUploaded) {
+            uint32_t quads = _map.chunkSize() * _map.chunkSize();
+            VkDeviceSize size = (VkDeviceSize)quads * 6 * sizeof(uint32_t);
+
+            vulkan::Staged staged;
+            if (ring.allocate(size, 16, staged)) {
+                Tilemap::quadIndices(quads, static_cast<uint32_t *>(staged.data));
+
+                VkBufferCopy region = { staged.offset, 0, size };
+                vk.vkCmdCopyBuffer(cmd, staged.buffer, _indices.get(), 1, &region);
+
+                _stats.uploadedBytes += size;
+                _indicesUploaded = copied = true;
+            }
+        }
+
+        size_t count = 0;
+        for (; _indicesUploaded && count < dirty.size(); count++) {
+            uint32_t chunk = dirty[count];
+            uint32_t quads = _map.bake(chunk, _scratch, _pageQuads);
+            VkDeviceSize size = _scratch.size() * sizeof(atlas::SpriteVertex);
+
+            if (quads > 0) {
+                vulkan::Staged staged;
+                if (!ring.allocate(size, 16, staged))
+                    break;
+
+                std::memcpy(staged.data, _scratch.data(), size);
+
+                VkBufferCopy region = { staged.offset, chunk * _slotSize, size };
+                vk.vkCmdCopyBuffer(cmd, staged.buffer, _vertices.get(), 1, &region);
+                copied = true;
+            }
+
+            Slot& slot = _slots[chunk];
+            slot.pageQuads.swap(_pageQuads);
+            slot.quads = quads;
+
+            _stats.baked++;
+            _stats.bakedQuads += quads;
+            _stats.uploadedBytes += size;
+        }
+
+        _stats.deferred += dirty.size() - count;
+        _map.clean(count);
+
+        if (copied) {
+            barrier(
+                cmd, vk,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+            );
+        }
+
+        _stats.bakeNanos += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+        );
+        return count;
+    }
+
+    ////
+    // size_t push(const cull::Rect&, const TileMaterial&, render::RenderQueue&)
+    //
+    // Pushes a draw per page of each visible chunk with any quads. They
+    // all bind the same buffers, and are keyed by page, so the queue groups
+    // every chunk's draws of a page together.
+    size_t ChunkBuffers::push(const cull::Rect& camera, const TileMaterial& material, render::RenderQueue& queue) {
+        auto start = std::chrono::steady_clock::now();
+
+        if (material.pages.size() < _map.atlas().pages()) {
+            throw WfnError(
+                "wfn_eng::tilemap::ChunkBuffers",
+                "push",
+                "Find Material"
+            );
+        }
+
+        render::Draw draw;
+        draw.pipeline = material.pipeline;
+        draw.layout = material.layout;
+        draw.vertexBuffer = _vertices.get();
+        draw.indexBuffer = _indices.get();
+
+        uint32_t slotVertices = _map.chunkSize() * _map.chunkSize() * 4;
+        size_t draws = 0;
+
+        _stats.visible = 0;
+        if (_indicesUploaded) {
+            _map.visible(camera, _visible);
+            for (uint32_t chunk : _visible) {
+                const Slot& slot = _slots[chunk];
+                if (slot.quads == 0)
+                    continue;
+
+                _stats.visible++;
+                uint32_t first = 0;
+                for (uint32_t page = 0; page < slot.pageQuads.size(); page++) {
+                    uint32_t quads = slot.pageQuads[page];
+                    if (quads == 0)
+                        continue;
+
+                    draw.material = material.pages[page];
+                    draw.indexCount = quads * 6;
+                    draw.baseVertex = static_cast<int32_t>(chunk * slotVertices + first * 4);
+                    queue.push(render::key::opaque(material.layer, material.pipelineKey, page, 0), draw);
+
+                    first += quads;
+                    draws++;
+                }
+            }
+        }
+
+        _stats.draws = draws;
+        _stats.pushNanos = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()
+        );
+        return draws;
+    }
+
+    ////
+    // const ChunkStats& stats()
+    //
+    // The counters of the buffers.
+    const ChunkStats& ChunkBuffers::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void ChunkBuffers::report(std::ostream& out) const {
+        out << "Tilemap: " << _map.chunks() << " chunks in " << _stats.bytes << " bytes; baked "
+            << _stats.baked << " chunks (" << _stats.bakedQuads << " quads, " << _stats.uploadedBytes
+            << " bytes) in " << _stats.bakeNanos / 1000.0 << "us, " << _stats.deferred << " deferred; last push "
+            << _stats.draws << " draws from " << _stats.visible << " chunks in " << _stats.pushNanos / 1000.0
+            << "us" << std::endl;
+    }
+}
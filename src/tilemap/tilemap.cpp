@@ -0,0 +1,261 @@
+#include "../tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+////
+// bool chunkRange(float, float, float, uint32_t, uint32_t&, uint32_t&)
+//
+// The chunks of one axis an interval overlaps, clamped to the map, or
+// false if it misses the map (or is NaN). An interval touching a chunk's
+// edge overlaps it.
+static bool chunkRange(float min, float max, float size, uint32_t count, uint32_t& first, uint32_t& last) {
+    float lo = std::floor(min / size), hi = std::floor(max / size);
+    if (!(hi >= 0.0f) || !(lo < static_cast<float>(count)) || !(lo <= hi))
+        return false;
+
+    first = lo < 0.0f ? 0 : static_cast<uint32_t>(lo);
+    last = hi >= static_cast<float>(count) ? count - 1 : static_cast<uint32_t>(hi);
+    return true;
+}
+
+namespace wfn_eng::tilemap {
+    ////
+    // class Tilemap
+    //
+    // A grid of tiles, split into chunks that are baked when dirty.
+
+    ////
+    // Tilemap(const atlas::Atlas&, std::vector<atlas::FrameId>, uint32_t, uint32_t, float, uint32_t)
+    //
+    // Constructs an empty map. An empty map has nothing to bake, so no
+    // chunk starts dirty.
+    Tilemap::Tilemap(
+            const atlas::Atlas& atlas,
+            std::vector<atlas::FrameId> tileset,
+            uint32_t width,
+            uint32_t height,
+            float tileSize,
+            uint32_t chunkSize)
+            : _atlas(atlas)
+            , _tileset(std::move(tileset))
+            , _width(width)
+            , _height(height)
+            , _tileSize(tileSize)
+            , _chunkSize(chunkSize)
+            , _chunksX(0)
+            , _chunksY(0) {
+        if (chunkSize == 0 || chunkSize > maxChunkSize)
+            throw WfnError("wfn_eng::tilemap::Tilemap", "Tilemap", "Size a chunk");
+        if (!(tileSize > 0.0f))
+            throw WfnError("wfn_eng::tilemap::Tilemap", "Tilemap", "Size a tile");
+        if (_tileset.size() >= 0xFFFF)
+            throw WfnError("wfn_eng::tilemap::Tilemap", "Tilemap", "Number the tiles");
+        for (atlas::FrameId frame : _tileset) {
+            if (frame >= atlas.count())
+                throw WfnError("wfn_eng::tilemap::Tilemap", "Tilemap", "Find Frame");
+        }
+
+        _chunksX = (width + chunkSize - 1) / chunkSize;
+        _chunksY = (height + chunkSize - 1) / chunkSize;
+
+        _tiles.assign((size_t)width * height, noTile);
+        _isDirty.assign((size_t)_chunksX * _chunksY, false);
+        _pageCounts.resize(atlas.pages());
+    }
+
+    ////
+    // void markDirty(uint32_t)
+    //
+    // Queues a chunk to bake, once.
+    void Tilemap::markDirty(uint32_t chunk) {
+        if (!_isDirty[chunk]) {
+            _isDirty[chunk] = true;
+            _dirty.push_back(chunk);
+        }
+    }
+
+    ////
+    // TileId get(uint32_t, uint32_t)
+    //
+    // The tile of a cell.
+    TileId Tilemap::get(uint32_t x, uint32_t y) const {
+        return _tiles[(size_t)y * _width + x];
+    }
+
+    ////
+    // void set(uint32_t, uint32_t, TileId)
+    //
+    // Changes the tile of a cell, marking its chunk dirty if it changed.
+    void Tilemap::set(uint32_t x, uint32_t y, TileId tile) {
+        if (x >= _width || y >= _height)
+            throw WfnError("wfn_eng::tilemap::Tilemap", "set", "Find Cell");
+        if (tile > _tileset.size())
+            throw WfnError("wfn_eng::tilemap::Tilemap", "set", "Find Tile");
+
+        TileId& cell = _tiles[(size_t)y * _width + x];
+        if (cell == tile)
+            return;
+
+        cell = tile;
+        markDirty((y / _chunkSize) * _chunksX + x / _chunkSize);
+    }
+
+    ////
+    // void fill(const TileId *)
+    //
+    // Replaces every tile, in rows, marking every chunk dirty.
+    void Tilemap::fill(const TileId *tiles) {
+        for (size_t i = 0; i < _tiles.size(); i++) {
+            if (tiles[i] > _tileset.size())
+                throw WfnError("wfn_eng::tilemap::Tilemap", "fill", "Find Tile");
+        }
+
+        std::copy(tiles, tiles + _tiles.size(), _tiles.begin());
+        for (uint32_t chunk = 0; chunk < chunks(); chunk++)
+            markDirty(chunk);
+    }
+
+    ////
+    // uint32_t bake(uint32_t, std::vector<atlas::SpriteVertex>&, std::vector<uint32_t>&)
+    //
+    // Bakes a chunk in two passes over its tiles: counting the quads of
+    // each page, then writing each quad after the ones of the pages before
+    // its own. A frame's trimmed texels are placed within the tile the way
+    // SpriteBatch places them within a sprite.
+    uint32_t Tilemap::bake(uint32_t chunk, std::vector<atlas::SpriteVertex>& vertices, std::vector<uint32_t>& pageQuads) {
+        uint32_t x0 = (chunk % _chunksX) * _chunkSize, x1 = std::min(x0 + _chunkSize, _width);
+        uint32_t y0 = (chunk / _chunksX) * _chunkSize, y1 = std::min(y0 + _chunkSize, _height);
+
+        pageQuads.assign(_atlas.pages(), 0);
+        for (uint32_t y = y0; y < y1; y++) {
+            const TileId *row = &_tiles[(size_t)y * _width];
+            for (uint32_t x = x0; x < x1; x++) {
+                if (row[x] == noTile)
+                    continue;
+
+                const atlas::Frame& frame = _atlas.frame(_tileset[row[x] - 1]);
+                if (frame.width > 0)
+                    pageQuads[frame.page]++;
+            }
+        }
+
+        uint32_t quads = 0;
+        for (uint32_t page = 0; page < pageQuads.size(); page++) {
+            _pageCounts[page] = quads;
+            quads += pageQuads[page];
+        }
+        vertices.resize((size_t)quads * 4);
+
+        for (uint32_t y = y0; y < y1; y++) {
+            const TileId *row = &_tiles[(size_t)y * _width];
+            for (uint32_t x = x0; x < x1; x++) {
+                if (row[x] == noTile)
+                    continue;
+
+                const atlas::Frame& frame = _atlas.frame(_tileset[row[x] - 1]);
+                if (frame.width == 0)
+                    continue;
+
+                float scaleX = _tileSize / frame.sourceWidth, scaleY = _tileSize / frame.sourceHeight;
+                float left = x * _tileSize + frame.offsetX * scaleX;
+                float top = y * _tileSize + frame.offsetY * scaleY;
+                float right = left + frame.width * scaleX;
+                float bottom = top + frame.height * scaleY;
+
+                atlas::SpriteVertex *quad = &vertices[(size_t)_pageCounts[frame.page]++ * 4];
+                quad[0] = atlas::SpriteVertex { left, top, frame.u0, frame.v0 };
+                quad[1] = atlas::SpriteVertex { right, top, frame.u1, frame.v0 };
+                quad[2] = atlas::SpriteVertex { right, bottom, frame.u1, frame.v1 };
+                quad[3] = atlas::SpriteVertex { left, bottom, frame.u0, frame.v1 };
+            }
+        }
+
+        return quads;
+    }
+
+    ////
+    // const std::vector<uint32_t>& dirty()
+    //
+    // The chunks waiting to be baked.
+    const std::vector<uint32_t>& Tilemap::dirty() const { return _dirty; }
+
+    ////
+    // void clean(size_t)
+    //
+    // Drops chunks from the front of dirty(). A chunk edited again after
+    // its bake was taken is still marked, so it stays queued.
+    void Tilemap::clean(size_t count) {
+        count = std::min(count, _dirty.size());
+        for (size_t i = 0; i < count; i++)
+            _isDirty[_dirty[i]] = false;
+        _dirty.erase(_dirty.begin(), _dirty.begin() + count);
+    }
+
+    ////
+    // size_t visible(const cull::Rect&, std::vector<uint32_t>&)
+    //
+    // The chunks overlapping a camera rectangle: the range of chunk rows
+    // and columns it spans, so nothing outside of it is looked at.
+    size_t Tilemap::visible(const cull::Rect& camera, std::vector<uint32_t>& chunks) const {
+        chunks.clear();
+
+        float size = _chunkSize * _tileSize;
+        uint32_t firstX, lastX, firstY, lastY;
+        if (!chunkRange(camera.minX, camera.maxX, size, _chunksX, firstX, lastX) ||
+            !chunkRange(camera.minY, camera.maxY, size, _chunksY, firstY, lastY))
+            return 0;
+
+        for (uint32_t y = firstY; y <= lastY; y++) {
+            for (uint32_t x = firstX; x <= lastX; x++)
+                chunks.push_back(y * _chunksX + x);
+        }
+        return chunks.size();
+    }
+
+    ////
+    // cull::Rect bounds(uint32_t)
+    //
+    // The world rectangle a chunk covers.
+    cull::Rect Tilemap::bounds(uint32_t chunk) const {
+        float size = _chunkSize * _tileSize;
+        float x = (chunk % _chunksX) * size, y = (chunk / _chunksX) * size;
+        return cull::Rect {
+            x,
+            y,
+            std::min(x + size, _width * _tileSize),
+            std::min(y + size, _height * _tileSize)
+        };
+    }
+
+    ////
+    // void quadIndices(uint32_t, uint32_t *)
+    //
+    // The indices of quads, as the two triangles SpriteBatch makes of a
+    // sprite.
+    void Tilemap::quadIndices(uint32_t quads, uint32_t *indices) {
+        for (uint32_t q = 0; q < quads; q++) {
+            uint32_t first = q * 4;
+            indices[q * 6 + 0] = first + 0;
+            indices[q * 6 + 1] = first + 1;
+            indices[q * 6 + 2] = first + 2;
+            indices[q * 6 + 3] = first + 0;
+            indices[q * 6 + 4] = first + 2;
+            indices[q * 6 + 5] = first + 3;
+        }
+    }
+
+    const atlas::Atlas& Tilemap::atlas() const { return _atlas; }
+    uint32_t Tilemap::width() const { return _width; }
+    uint32_t Tilemap::height() const { return _height; }
+    float Tilemap::tileSize() const { return _tileSize; }
+    uint32_t Tilemap::chunkSize() const { return _chunkSize; }
+    uint32_t Tilemap::chunksX() const { return _chunksX; }
+    uint32_t Tilemap::chunksY() const { return _chunksY; }
+
+    ////
+    // uint32_t chunks()
+    //
+    // The number of chunks.
+    uint32_t Tilemap::chunks() const { return _chunksX * _chunksY; }
+}
@@ -2,11 +2,151 @@
 #define __WFN_ENG_VULKAN_HPP__
 
 #include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "error.hpp"
 #include "sdl.hpp"
 
+////
+// Vulkan functions
+//
+// Every Vulkan function the engine calls, by the level it is loaded at (see
+// wfn_eng::vulkan::dispatch).
+#define WFN_ENG_VULKAN_GLOBAL_FUNCTIONS(X)                                     \
+    X(vkCreateInstance)                                                       \
+    X(vkEnumerateInstanceLayerProperties)                                     \
+    X(vkEnumerateInstanceExtensionProperties)
+
+#define WFN_ENG_VULKAN_INSTANCE_FUNCTIONS(X)                                   \
+    X(vkDestroyInstance)                                                      \
+    X(vkEnumeratePhysicalDevices)                                             \
+    X(vkEnumerateDeviceExtensionProperties)                                   \
+    X(vkGetPhysicalDeviceProperties)                                          \
+    X(vkGetPhysicalDeviceFeatures)                                            \
+    X(vkGetPhysicalDeviceFeatures2)                                           \
+    X(vkGetPhysicalDeviceFormatProperties)                                    \
+    X(vkGetPhysicalDeviceMemoryProperties)                                    \
+    X(vkGetPhysicalDeviceQueueFamilyProperties)                               \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR)                                   \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR)                              \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR)                                   \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR)                              \
+    X(vkDestroySurfaceKHR)                                                    \
+    X(vkCreateDevice)                                                         \
+    X(vkGetDeviceProcAddr)
+
+#define WFN_ENG_VULKAN_DEVICE_FUNCTIONS(X)                                     \
+    X(vkDestroyDevice)                                                        \
+    X(vkDeviceWaitIdle)                                                       \
+    X(vkGetDeviceQueue)                                                       \
+    X(vkQueueSubmit)                                                          \
+    X(vkQueueWaitIdle)                                                        \
+    X(vkCreateSwapchainKHR)                                                   \
+    X(vkDestroySwapchainKHR)                                                  \
+    X(vkGetSwapchainImagesKHR)                                                \
+    X(vkAcquireNextImageKHR)                                                  \
+    X(vkQueuePresentKHR)                                                      \
+    X(vkCreateImage)                                                          \
+    X(vkDestroyImage)                                                         \
+    X(vkCreateImageView)                                                      \
+    X(vkDestroyImageView)                                                     \
+    X(vkCreateBuffer)                                                         \
+    X(vkDestroyBuffer)                                                        \
+    X(vkCreateBufferView)                                                     \
+    X(vkDestroyBufferView)                                                    \
+    X(vkGetBufferMemoryRequirements)                                          \
+    X(vkGetImageMemoryRequirements)                                           \
+    X(vkAllocateMemory)                                                       \
+    X(vkFreeMemory)                                                           \
+    X(vkBindBufferMemory)                                                     \
+    X(vkBindImageMemory)                                                      \
+    X(vkMapMemory)                                                            \
+    X(vkUnmapMemory)                                                          \
+    X(vkFlushMappedMemoryRanges)                                              \
+    X(vkCreateSampler)                                                        \
+    X(vkDestroySampler)                                                       \
+    X(vkCreateFramebuffer)                                                    \
+    X(vkDestroyFramebuffer)                                                   \
+    X(vkCreateRenderPass)                                                     \
+    X(vkDestroyRenderPass)                                                    \
+    X(vkCreateShaderModule)                                                   \
+    X(vkDestroyShaderModule)                                                  \
+    X(vkCreateGraphicsPipelines)                                              \
+    X(vkCreateComputePipelines)                                               \
+    X(vkDestroyPipeline)                                                      \
+    X(vkCreatePipelineLayout)                                                 \
+    X(vkDestroyPipelineLayout)                                                \
+    X(vkCreatePipelineCache)                                                  \
+    X(vkDestroyPipelineCache)                                                 \
+    X(vkGetPipelineCacheData)                                                 \
+    X(vkCreateDescriptorSetLayout)                                            \
+    X(vkDestroyDescriptorSetLayout)                                           \
+    X(vkCreateDescriptorPool)                                                 \
+    X(vkDestroyDescriptorPool)                                                \
+    X(vkResetDescriptorPool)                                                  \
+    X(vkAllocateDescriptorSets)                                               \
+    X(vkUpdateDescriptorSets)                                                 \
+    X(vkCreateCommandPool)                                                    \
+    X(vkDestroyCommandPool)                                                   \
+    X(vkResetCommandPool)                                                     \
+    X(vkAllocateCommandBuffers)                                               \
+    X(vkBeginCommandBuffer)                                                   \
+    X(vkEndCommandBuffer)                                                     \
+    X(vkCreateSemaphore)                                                      \
+    X(vkDestroySemaphore)                                                     \
+    X(vkWaitSemaphores)                                                       \
+    X(vkSignalSemaphore)                                                      \
+    X(vkGetSemaphoreCounterValue)                                             \
+    X(vkCreateFence)                                                          \
+    X(vkDestroyFence)                                                         \
+    X(vkWaitForFences)                                                        \
+    X(vkResetFences)                                                          \
+    X(vkCreateEvent)                                                          \
+    X(vkDestroyEvent)                                                         \
+    X(vkCreateQueryPool)                                                      \
+    X(vkDestroyQueryPool)                                                     \
+    X(vkGetQueryPoolResults)                                                  \
+    X(vkCmdBeginRenderPass)                                                   \
+    X(vkCmdEndRenderPass)                                                     \
+    X(vkCmdBindPipeline)                                                      \
+    X(vkCmdBindDescriptorSets)                                                \
+    X(vkCmdBindVertexBuffers)                                                 \
+    X(vkCmdBindIndexBuffer)                                                   \
+    X(vkCmdPushConstants)                                                     \
+    X(vkCmdSetViewport)                                                       \
+    X(vkCmdSetScissor)                                                        \
+    X(vkCmdDraw)                                                              \
+    X(vkCmdDrawIndexed)                                                       \
+    X(vkCmdDrawIndexedIndirect)                                               \
+    X(vkCmdDispatch)                                                          \
+    X(vkCmdPipelineBarrier)                                                   \
+    X(vkCmdCopyBuffer)                                                        \
+    X(vkCmdCopyBufferToImage)                                                 \
+    X(vkCmdBlitImage)                                                         \
+    X(vkCmdResetQueryPool)                                                    \
+    X(vkCmdWriteTimestamp)
+
+#ifdef WFN_ENG_VULKAN_DYNAMIC
+#define WFN_ENG_VULKAN_DECLARE(NAME) extern PFN_##NAME NAME;
+extern PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr;
+WFN_ENG_VULKAN_GLOBAL_FUNCTIONS(WFN_ENG_VULKAN_DECLARE)
+WFN_ENG_VULKAN_INSTANCE_FUNCTIONS(WFN_ENG_VULKAN_DECLARE)
+WFN_ENG_VULKAN_DEVICE_FUNCTIONS(WFN_ENG_VULKAN_DECLARE)
+#undef WFN_ENG_VULKAN_DECLARE
+#endif
+
 namespace wfn_eng::vulkan {
     class Base;
     class Device;
@@ -37,6 +177,14 @@ namespace wfn_eng::vulkan {
             // The index of the presentation queue.
             int presentationFamily = -1;
 
+            ////
+            // int computeFamily
+            //
+            // The index of the compute queue: a family without graphics
+            // support if there is one (so compute can run alongside
+            // graphics), otherwise the graphics family.
+            int computeFamily = -1;
+
             ////
             // QueueFamilyIndices(VkSurfaceKHR, VkPhysicalDevice)
             //
@@ -91,46 +239,675 @@ namespace wfn_eng::vulkan {
             // to use.
             bool sufficient();
         };
+
+        ////
+        // uint32_t memoryType(VkPhysicalDevice, uint32_t, VkMemoryPropertyFlags)
+        //
+        // The first memory type allowed by a resource's type bits with all
+        // the provided properties, throwing if there is none.
+        uint32_t memoryType(VkPhysicalDevice, uint32_t, VkMemoryPropertyFlags);
+
+        ////
+        // const uint64_t hashSeed
+        //
+        // The starting value of a hash built with mix (the FNV-1a offset
+        // basis).
+        const uint64_t hashSeed = 0xcbf29ce484222325ull;
+
+        ////
+        // uint64_t mix(uint64_t, uint64_t)
+        //
+        // Folds a value into a hash (FNV-1a, a 64-bit word at a time, with a
+        // final avalanche so that nearby handles spread out). Shared by the
+        // pipeline and layout caches' keys.
+        inline uint64_t mix(uint64_t hash, uint64_t value) {
+            hash ^= value;
+            hash *= 0x100000001b3ull;
+            hash ^= hash >> 29;
+            return hash;
+        }
+    }
+
+    ////
+    // namespace allocator
+    //
+    // Engine-wide VkAllocationCallbacks that track the host memory the driver
+    // allocates, sorted by VkSystemAllocationScope. Command-scope allocations
+    // (which only live for the duration of a single Vulkan call) are served
+    // from a bump arena. Disabled by default, in which case callbacks()
+    // returns nullptr and Vulkan uses the system allocator.
+    namespace allocator {
+        ////
+        // struct ScopeStats
+        //
+        // Counters for a single allocation scope.
+        struct ScopeStats {
+            uint64_t allocations = 0;
+            uint64_t reallocations = 0;
+            uint64_t frees = 0;
+            uint64_t arenaAllocations = 0;
+            uint64_t liveBytes = 0;
+            uint64_t peakBytes = 0;
+            uint64_t totalBytes = 0;
+            uint64_t internalBytes = 0;
+        };
+
+        ////
+        // void enable()
+        //
+        // Switches the engine to the tracking callbacks. Must be called at
+        // startup, before any Vulkan object is created, since objects have to
+        // be destroyed with the same callbacks they were created with.
+        void enable();
+
+        ////
+        // bool enabled()
+        //
+        // Whether the tracking callbacks are in use.
+        bool enabled();
+
+        ////
+        // const VkAllocationCallbacks *callbacks()
+        //
+        // The callbacks to pass to every vkCreate* and vkDestroy* call.
+        const VkAllocationCallbacks *callbacks();
+
+        ////
+        // ScopeStats stats(VkSystemAllocationScope)
+        //
+        // Provides a copy of the counters of a scope.
+        ScopeStats stats(VkSystemAllocationScope);
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes a table of the counters of every scope.
+        void report(std::ostream&);
+    }
+
+    ////
+    // namespace dispatch
+    //
+    // Function tables that let the engine call straight into the driver,
+    // skipping the loader's trampolines. Every function the engine uses is
+    // listed once below, by the level it is loaded at:
+    //
+    //   - global functions are loaded with a null VkInstance,
+    //   - instance functions are loaded from the VkInstance, and
+    //   - device functions are loaded from the VkDevice (so they dispatch
+    //     directly to the driver's implementation).
+    //
+    // Building with WFN_ENG_VULKAN_DYNAMIC (which also defines
+    // VK_NO_PROTOTYPES) declares every listed function as a global pointer
+    // of the same name, filled in by loadGlobal, loadInstance and
+    // loadDevice, so the engine never links against libvulkan and uses
+    // whichever library SDL loaded instead.
+    namespace dispatch {
+        ////
+        // enum class Mode
+        //
+        // Where a DeviceTable gets its pointers from: the VkDevice (the
+        // default), or the loader's trampolines (for comparison).
+        enum class Mode {
+            Device,
+            Loader
+        };
+
+        ////
+        // void setMode(Mode)
+        //
+        // Chooses how device tables are loaded. Must be called before the
+        // Device is constructed.
+        void setMode(Mode);
+
+        ////
+        // Mode mode()
+        //
+        // How device tables are loaded.
+        Mode mode();
+
+        ////
+        // void loadGlobal()
+        //
+        // Fetches vkGetInstanceProcAddr from the library SDL loaded, then
+        // the global functions. Needs an SDL window to exist. Does nothing
+        // unless built with WFN_ENG_VULKAN_DYNAMIC.
+        void loadGlobal();
+
+        ////
+        // void loadInstance(VkInstance)
+        //
+        // Loads the instance functions. Does nothing unless built with
+        // WFN_ENG_VULKAN_DYNAMIC.
+        void loadInstance(VkInstance);
+
+        ////
+        // void loadDevice(VkDevice)
+        //
+        // Loads the device functions into the global pointers. Does nothing
+        // unless built with WFN_ENG_VULKAN_DYNAMIC.
+        void loadDevice(VkDevice);
     }
 
+    ////
+    // struct DeviceTable
+    //
+    // A pointer to every device function, loaded for a single VkDevice.
+    // Hot paths (command recording, submission and presentation) call
+    // through the table of their Device.
+    struct DeviceTable {
+#define WFN_ENG_VULKAN_MEMBER(NAME) PFN_##NAME NAME = nullptr;
+        WFN_ENG_VULKAN_DEVICE_FUNCTIONS(WFN_ENG_VULKAN_MEMBER)
+#undef WFN_ENG_VULKAN_MEMBER
+
+        ////
+        // void load(VkInstance, VkDevice)
+        //
+        // Loads every pointer for the provided device, either from the
+        // device itself or from the instance (whose pointers are the
+        // loader's trampolines), depending on the dispatch::Mode.
+        void load(VkInstance, VkDevice);
+    };
+
+    ////
+    // struct HandleTraits<T>
+    //
+    // Describes how to destroy a Vulkan handle type: its Parent (the object
+    // it was created from, or std::nullptr_t for the root objects) and a
+    // destroy function. Every engine-created object uses the engine's
+    // allocation callbacks, so the traits pass them along.
+    //
+    // Objects that are freed with their pool (VkCommandBuffer and
+    // VkDescriptorSet) have no traits; their pool's Handle owns them.
+    template <typename T>
+    struct HandleTraits;
+
+#define WFN_ENG_HANDLE_TRAITS(TYPE, PARENT, DESTROY)                          \
+    template <>                                                               \
+    struct HandleTraits<TYPE> {                                               \
+        typedef PARENT Parent;                                                \
+        static void destroy(PARENT parent, TYPE handle) {                     \
+            DESTROY(parent, handle, allocator::callbacks());                  \
+        }                                                                     \
+    };
+
+    template <>
+    struct HandleTraits<VkInstance> {
+        typedef std::nullptr_t Parent;
+        static void destroy(std::nullptr_t, VkInstance handle) {
+            vkDestroyInstance(handle, allocator::callbacks());
+        }
+    };
+
+    template <>
+    struct HandleTraits<VkDevice> {
+        typedef std::nullptr_t Parent;
+        static void destroy(std::nullptr_t, VkDevice handle) {
+            vkDestroyDevice(handle, allocator::callbacks());
+        }
+    };
+
+    // SDL creates surfaces with the default allocator, so they have to be
+    // destroyed with it too.
+    template <>
+    struct HandleTraits<VkSurfaceKHR> {
+        typedef VkInstance Parent;
+        static void destroy(VkInstance parent, VkSurfaceKHR handle) {
+            vkDestroySurfaceKHR(parent, handle, nullptr);
+        }
+    };
+
+    WFN_ENG_HANDLE_TRAITS(VkSwapchainKHR, VkDevice, vkDestroySwapchainKHR)
+    WFN_ENG_HANDLE_TRAITS(VkImage, VkDevice, vkDestroyImage)
+    WFN_ENG_HANDLE_TRAITS(VkImageView, VkDevice, vkDestroyImageView)
+    WFN_ENG_HANDLE_TRAITS(VkBuffer, VkDevice, vkDestroyBuffer)
+    WFN_ENG_HANDLE_TRAITS(VkBufferView, VkDevice, vkDestroyBufferView)
+    WFN_ENG_HANDLE_TRAITS(VkDeviceMemory, VkDevice, vkFreeMemory)
+    WFN_ENG_HANDLE_TRAITS(VkSampler, VkDevice, vkDestroySampler)
+    WFN_ENG_HANDLE_TRAITS(VkFramebuffer, VkDevice, vkDestroyFramebuffer)
+    WFN_ENG_HANDLE_TRAITS(VkRenderPass, VkDevice, vkDestroyRenderPass)
+    WFN_ENG_HANDLE_TRAITS(VkShaderModule, VkDevice, vkDestroyShaderModule)
+    WFN_ENG_HANDLE_TRAITS(VkPipeline, VkDevice, vkDestroyPipeline)
+    WFN_ENG_HANDLE_TRAITS(VkPipelineLayout, VkDevice, vkDestroyPipelineLayout)
+    WFN_ENG_HANDLE_TRAITS(VkPipelineCache, VkDevice, vkDestroyPipelineCache)
+    WFN_ENG_HANDLE_TRAITS(VkDescriptorSetLayout, VkDevice, vkDestroyDescriptorSetLayout)
+    WFN_ENG_HANDLE_TRAITS(VkDescriptorPool, VkDevice, vkDestroyDescriptorPool)
+    WFN_ENG_HANDLE_TRAITS(VkCommandPool, VkDevice, vkDestroyCommandPool)
+    WFN_ENG_HANDLE_TRAITS(VkSemaphore, VkDevice, vkDestroySemaphore)
+    WFN_ENG_HANDLE_TRAITS(VkFence, VkDevice, vkDestroyFence)
+    WFN_ENG_HANDLE_TRAITS(VkEvent, VkDevice, vkDestroyEvent)
+    WFN_ENG_HANDLE_TRAITS(VkQueryPool, VkDevice, vkDestroyQueryPool)
+
+#undef WFN_ENG_HANDLE_TRAITS
+
+    ////
+    // class Handle<T>
+    //
+    // Sole owner of a single Vulkan object. Destroys the object when it goes
+    // out of scope; can be moved but not copied, so ownership is always
+    // explicit. Is the size of the raw handle plus its parent.
+    template <typename T>
+    class Handle {
+    public:
+        typedef typename HandleTraits<T>::Parent Parent;
+
+    private:
+        Parent _parent;
+        T _handle;
+
+    public:
+        ////
+        // Handle()
+        //
+        // Constructs an empty handle.
+        Handle() : _parent(), _handle(VK_NULL_HANDLE) { }
+
+        ////
+        // Handle(T)
+        //
+        // Takes ownership of a root object (VkInstance or VkDevice).
+        explicit Handle(T handle) : _parent(), _handle(handle) { }
+
+        ////
+        // Handle(Parent, T)
+        //
+        // Takes ownership of an object created from the provided parent.
+        Handle(Parent parent, T handle) : _parent(parent), _handle(handle) { }
+
+        ////
+        // ~Handle()
+        //
+        // Destroys the object, if any.
+        ~Handle() { reset(); }
+
+        Handle(Handle&& other) noexcept :
+                _parent(other._parent),
+                _handle(other._handle) {
+            other._handle = VK_NULL_HANDLE;
+        }
+
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                _parent = other._parent;
+                _handle = other._handle;
+                other._handle = VK_NULL_HANDLE;
+            }
+
+            return *this;
+        }
+
+        ////
+        // void reset()
+        //
+        // Destroys the object now, leaving the handle empty.
+        void reset() {
+            if (_handle != VK_NULL_HANDLE)
+                HandleTraits<T>::destroy(_parent, _handle);
+            _handle = VK_NULL_HANDLE;
+        }
+
+        ////
+        // T release()
+        //
+        // Gives up ownership of the object without destroying it (e.g. to
+        // hand it to a DeletionQueue).
+        T release() {
+            T handle = _handle;
+            _handle = VK_NULL_HANDLE;
+            return handle;
+        }
+
+        ////
+        // T get()
+        //
+        // Provides the raw handle.
+        T get() const { return _handle; }
+
+        ////
+        // Parent parent()
+        //
+        // Provides the parent the object was created from.
+        Parent parent() const { return _parent; }
+
+        ////
+        // const T *address()
+        //
+        // Provides the address of the raw handle, for the Vulkan calls that
+        // take arrays of handles.
+        const T *address() const { return &_handle; }
+
+        explicit operator bool() const { return _handle != VK_NULL_HANDLE; }
+
+        // Following Rule of 3's
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+    };
+
+    ////
+    // struct DeletionStats
+    //
+    // Counters on a DeletionQueue. Latency is measured from the moment a
+    // resource is retired to the moment it is actually destroyed, both in
+    // calls to collect (i.e. frames) and in time.
+    struct DeletionStats {
+        uint64_t pushed = 0;
+        uint64_t destroyed = 0;
+        size_t length = 0;
+        size_t maxLength = 0;
+        uint64_t maxLatencyCollects = 0;
+        uint64_t maxLatencyNanos = 0;
+        uint64_t totalLatencyNanos = 0;
+    };
+
+    ////
+    // class DeletionQueue
+    //
+    // Defers the destruction of Vulkan objects until the GPU has provably
+    // finished with them, instead of stalling on vkDeviceWaitIdle. Every
+    // resource is pushed along with the submission value it was last used
+    // by (a frame number or a timeline semaphore value; anything that only
+    // ever increases), and is destroyed by the first collect that reports
+    // that value as complete.
+    class DeletionQueue {
+    public:
+        ////
+        // Destroy
+        //
+        // Destroys a single retired resource.
+        typedef std::function<void ()> Destroy;
+
+    private:
+        struct Entry {
+            uint64_t value;
+            uint64_t retiredCollect;
+            uint64_t retiredNanos;
+            Destroy destroy;
+        };
+
+        std::deque<Entry> _entries;
+        uint64_t _collects = 0;
+        DeletionStats _stats;
+
+        ////
+        // void destroy(Entry&)
+        //
+        // Destroys a single entry, updating the latency counters.
+        void destroy(Entry&);
+
+    public:
+        DeletionQueue() = default;
+
+        ////
+        // ~DeletionQueue()
+        //
+        // Destroys anything still queued. The owner is expected to have
+        // waited for the GPU first (see flush).
+        ~DeletionQueue();
+
+        ////
+        // void push(uint64_t, Destroy)
+        //
+        // Retires a resource that is in use until the provided submission
+        // value completes. Values must be pushed in non-decreasing order.
+        void push(uint64_t, Destroy);
+
+        ////
+        // void push(uint64_t, Handle<T>&&)
+        //
+        // Retires an owned Vulkan object.
+        template <typename T>
+        void push(uint64_t value, Handle<T>&& handle) {
+            typename Handle<T>::Parent parent = handle.parent();
+            T raw = handle.release();
+            push(value, [parent, raw]() { HandleTraits<T>::destroy(parent, raw); });
+        }
+
+        ////
+        // size_t collect(uint64_t)
+        //
+        // Destroys every resource whose value is at or below the provided
+        // completed value, returning the number destroyed.
+        size_t collect(uint64_t);
+
+        ////
+        // size_t flush()
+        //
+        // Destroys everything, regardless of value. Only valid once the GPU
+        // is idle (i.e. at shutdown).
+        size_t flush();
+
+        ////
+        // size_t size()
+        //
+        // The number of resources waiting to be destroyed.
+        size_t size() const;
+
+        ////
+        // const DeletionStats& stats()
+        //
+        // Provides the queue length and latency counters.
+        const DeletionStats& stats() const;
+
+        // Following Rule of 3's
+        DeletionQueue(const DeletionQueue&) = delete;
+        DeletionQueue& operator=(const DeletionQueue&) = delete;
+    };
+
+    ////
+    // struct SyncPoint
+    //
+    // A point on a queue's timeline: the work submitted to that queue is
+    // complete once its timeline semaphore reaches the value. Anything the
+    // GPU uses can record the SyncPoint of its last use, which is all it
+    // takes to later ask whether it is free.
+    struct SyncPoint {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t value = 0;
+    };
+
+    ////
+    // class Submission
+    //
+    // The contents of a single vkQueueSubmit: the SyncPoints (or binary
+    // semaphores, for the swapchain) to wait on, the command buffers, and
+    // any binary semaphores to signal. Fixed capacity, so building one never
+    // touches the heap.
+    class Submission {
+    public:
+        static const size_t capacity = 8;
+
+    private:
+        VkSemaphore _waitSemaphores[capacity];
+        uint64_t _waitValues[capacity];
+        VkPipelineStageFlags _waitStages[capacity];
+        uint32_t _waitCount = 0;
+
+        VkCommandBuffer _commandBuffers[capacity];
+        uint32_t _commandBufferCount = 0;
+
+        // One slot is kept for the timeline's own signal.
+        VkSemaphore _signalSemaphores[capacity + 1];
+        uint64_t _signalValues[capacity + 1];
+        uint32_t _signalCount = 0;
+
+        friend class Timeline;
+
+    public:
+        ////
+        // Submission& wait(SyncPoint, VkPipelineStageFlags)
+        //
+        // Waits, at the provided stages, for another queue's timeline to
+        // reach a value.
+        Submission& wait(SyncPoint, VkPipelineStageFlags);
+
+        ////
+        // Submission& wait(VkSemaphore, VkPipelineStageFlags)
+        //
+        // Waits, at the provided stages, on a binary semaphore (e.g. a
+        // swapchain image becoming available).
+        Submission& wait(VkSemaphore, VkPipelineStageFlags);
+
+        ////
+        // Submission& execute(VkCommandBuffer)
+        //
+        // Adds a command buffer.
+        Submission& execute(VkCommandBuffer);
+
+        ////
+        // Submission& signal(VkSemaphore)
+        //
+        // Signals a binary semaphore (e.g. for presentation) on completion.
+        Submission& signal(VkSemaphore);
+    };
+
+    ////
+    // class Timeline
+    //
+    // The timeline of a single queue: a timeline semaphore that every
+    // submission to the queue signals with the next value in sequence. The
+    // CPU waits on (and cross-queue dependencies are expressed as) values
+    // on it, which replaces per-submission fences.
+    class Timeline {
+        Handle<VkSemaphore> _semaphore;
+        VkQueue _queue = VK_NULL_HANDLE;
+        uint64_t _submitted = 0;
+
+        // Last value read back from the semaphore; only ever increases.
+        mutable uint64_t _completed = 0;
+
+        // Copied out of the DeviceTable so the Timeline stays valid if the
+        // Device that owns both is moved.
+        PFN_vkQueueSubmit _queueSubmit = nullptr;
+        PFN_vkWaitSemaphores _waitSemaphores = nullptr;
+        PFN_vkGetSemaphoreCounterValue _getCounterValue = nullptr;
+
+    public:
+        ////
+        // Timeline()
+        //
+        // Constructs an empty timeline.
+        Timeline() = default;
+
+        ////
+        // Timeline(VkDevice, VkQueue, const DeviceTable&)
+        //
+        // Constructs the timeline of a queue, starting at 0.
+        Timeline(VkDevice, VkQueue, const DeviceTable&);
+
+        Timeline(Timeline&&) = default;
+        Timeline& operator=(Timeline&&) = default;
+
+        ////
+        // SyncPoint submit(Submission&)
+        //
+        // Submits to the queue, signaling the next value on the timeline,
+        // and returns the point at which the submission is complete.
+        SyncPoint submit(Submission&);
+
+        ////
+        // SyncPoint next()
+        //
+        // The point the next submission will signal. Resources retired
+        // while recording it are free once it is reached.
+        SyncPoint next() const;
+
+        ////
+        // SyncPoint last()
+        //
+        // The point signaled by the latest submission.
+        SyncPoint last() const;
+
+        ////
+        // uint64_t submitted()
+        //
+        // The value signaled by the latest submission.
+        uint64_t submitted() const;
+
+        ////
+        // uint64_t completed()
+        //
+        // Reads back the value the GPU has reached.
+        uint64_t completed() const;
+
+        ////
+        // bool reached(uint64_t)
+        //
+        // Whether the GPU has reached a value. Only queries the semaphore
+        // if the last value read back is not already enough.
+        bool reached(uint64_t) const;
+
+        ////
+        // bool wait(uint64_t, uint64_t)
+        //
+        // Blocks until the GPU reaches a value, or the timeout (in
+        // nanoseconds) expires. Returns whether the value was reached.
+        bool wait(uint64_t, uint64_t = UINT64_MAX) const;
+
+        ////
+        // void waitIdle()
+        //
+        // Blocks until everything submitted so far has completed.
+        void waitIdle() const;
+
+        ////
+        // VkSemaphore semaphore()
+        //
+        // The underlying timeline semaphore.
+        VkSemaphore semaphore() const;
+
+        ////
+        // VkQueue queue()
+        //
+        // The queue the timeline belongs to.
+        VkQueue queue() const;
+
+        // Following Rule of 3's
+        Timeline(const Timeline&) = delete;
+        Timeline& operator=(const Timeline&) = delete;
+    };
+
     ////
     // class Base
     //
     // A container for the base-level features of Vulkan, aka the VkInstance and
     // the VkSurfaceKHR.
     class Base {
-        VkInstance _instance;
-        VkSurfaceKHR _surface;
+        // Declared in this order so that the surface is destroyed first.
+        Handle<VkInstance> _instance;
+        Handle<VkSurfaceKHR> _surface;
 
     public:
         inline static const std::vector<const char *> deviceExtensions = {
             VK_KHR_SWAPCHAIN_EXTENSION_NAME
         };
 
+        inline static const std::vector<const char *> validationLayers = {
+            "VK_LAYER_LUNARG_standard_validation"
+        };
+
         ////
-        // Base(sdl::Window&)
+        // Base(sdl::Window&, bool)
         //
         // Construct the base of the Vulkan instance (VkInstance and
-        // VkSurfaceKHR) from an SDL window wrapper.
-        Base(sdl::Window&);
+        // VkSurfaceKHR) from an SDL window wrapper, optionally enabling the
+        // validation layers (and the debug report extension they use).
+        Base(sdl::Window&, bool = false);
 
-        ////
-        // ~Base()
-        //
-        // Destroying the VkInstance and VkSurfaceKHR.
-        ~Base();
+        Base(Base&&) = default;
+        Base& operator=(Base&&);
 
         ////
         // VkInstance instance()
         //
         // Provides access to the VkInstance.
-        VkInstance& instance();
+        VkInstance instance() const;
 
         ////
         // VkSurfaceKHR surface()
         //
         // Provides access to the VkSurfaceKHR.
-        VkSurfaceKHR& surface();
+        VkSurfaceKHR surface() const;
 
 
         // Following Rule of 3's
@@ -144,10 +921,19 @@ namespace wfn_eng::vulkan {
     // A container for the device-related features of Vulkan, that includes the
     // physical and logical devices, along with their relevant queues.
     class Device {
-        VkPhysicalDevice _physical;
-        VkDevice _logical;
-        VkQueue _graphicsQueue;
-        VkQueue _presentationQueue;
+        VkPhysicalDevice _physical = VK_NULL_HANDLE;
+        Handle<VkDevice> _logical;
+        VkQueue _graphicsQueue = VK_NULL_HANDLE;
+        VkQueue _presentationQueue = VK_NULL_HANDLE;
+        VkQueue _computeQueue = VK_NULL_HANDLE;
+        uint32_t _graphicsFamily = 0;
+        uint32_t _presentationFamily = 0;
+        uint32_t _computeFamily = 0;
+        DeviceTable _table;
+
+        // Declared after the VkDevice so they are destroyed first.
+        Timeline _graphicsTimeline;
+        Timeline _computeTimeline;
 
         ////
         // makePhysicalDevice
@@ -169,85 +955,1042 @@ namespace wfn_eng::vulkan {
         // Constructing a device from a Base.
         Device(Base&);
 
-        ////
-        // ~Device()
-        //
-        // Destroying the Device.
-        ~Device();
+        Device(Device&&) = default;
+        Device& operator=(Device&&);
 
         ////
         // VkPhysicalDevice physical()
         //
-        // Getting the reference to the VkPhysicalDevice.
-        VkPhysicalDevice& physical();
+        // Getting the VkPhysicalDevice.
+        VkPhysicalDevice physical() const;
 
         ////
         // VkDevice logical()
         //
-        // Getting the reference to the VkDevice.
-        VkDevice& logical();
+        // Getting the VkDevice.
+        VkDevice logical() const;
 
         ////
         // VkQueue graphicsQueue()
         //
         // Getting the graphics queue.
-        VkQueue& graphicsQueue();
+        VkQueue graphicsQueue() const;
 
         ////
         // VkQueue presentationQueue()
         //
         // Getting the presentation queue.
-        VkQueue& presentationQueue();
+        VkQueue presentationQueue() const;
 
+        ////
+        // VkQueue computeQueue()
+        //
+        // Getting the compute queue. Is the graphics queue when the device
+        // has no dedicated compute family.
+        VkQueue computeQueue() const;
 
-        // Following Rule of 3's
-        Device(const Device&) = delete;
-        Device& operator=(const Device&) = delete;
-    };
+        ////
+        // uint32_t graphicsFamily()
+        //
+        // Getting the queue family index of the graphics queue.
+        uint32_t graphicsFamily() const;
 
-    ////
-    // Swapchain
-    //
-    // TODO: Documentation
+        ////
+        // uint32_t presentationFamily()
+        //
+        // Getting the queue family index of the presentation queue.
+        uint32_t presentationFamily() const;
+
+        ////
+        // uint32_t computeFamily()
+        //
+        // Getting the queue family index of the compute queue.
+        uint32_t computeFamily() const;
+
+        ////
+        // bool asyncCompute()
+        //
+        // Whether compute work runs on its own queue family, and so can
+        // overlap with graphics work.
+        bool asyncCompute() const;
+
+        ////
+        // const DeviceTable& table()
+        //
+        // The device functions loaded for the VkDevice. Calls that happen
+        // every frame should go through it.
+        const DeviceTable& table() const;
+
+        ////
+        // Timeline& graphicsTimeline()
+        //
+        // The timeline of the graphics queue.
+        Timeline& graphicsTimeline();
+
+        ////
+        // Timeline& computeTimeline()
+        //
+        // The timeline of the compute queue.
+        Timeline& computeTimeline();
+
+
+        // Following Rule of 3's
+        Device(const Device&) = delete;
+        Device& operator=(const Device&) = delete;
+    };
+
+    ////
+    // class Swapchain
+    //
+    // The VkSwapchainKHR of a window, along with a view of each of its images
+    // and (once a render pass exists) a framebuffer for each of them.
     class Swapchain {
-        VkSwapchainKHR _swapchain;
+        // Declared in this order so that dependents are destroyed first.
+        Handle<VkSwapchainKHR> _swapchain;
         std::vector<VkImage> _images;
         VkFormat _format;
         VkExtent2D _extent;
-        std::vector<VkImageView> _imageViews;
-        std::vector<VkFramebuffer> _frameBuffers;
+        VkPresentModeKHR _presentMode;
+        std::vector<Handle<VkImageView>> _imageViews;
+        std::vector<Handle<VkFramebuffer>> _frameBuffers;
+
+        ////
+        // void makeImageViews(VkDevice)
+        //
+        // Constructs a VkImageView for every swapchain image.
+        void makeImageViews(VkDevice);
 
     public:
-        Swapchain();
-        ~Swapchain();
+        ////
+        // Swapchain(sdl::Window&, Base&, Device&)
+        //
+        // Constructs a swapchain for the window's surface, preferring a
+        // B8G8R8A8 sRGB format and mailbox presentation.
+        Swapchain(sdl::Window&, Base&, Device&);
+
+        Swapchain(Swapchain&&) = default;
+        Swapchain& operator=(Swapchain&&);
 
-        VkSwapchainKHR& get();
-        std::vector<VkImage>& images();
-        VkFormat& format();
-        VkExtent2D& extent();
-        std::vector<VkImageView&> imageViews();
-        std::vector<VkFramebuffer&> frameBuffers();
+        ////
+        // void makeFrameBuffers(VkRenderPass)
+        //
+        // (Re)builds a framebuffer over every image view for a render pass.
+        void makeFrameBuffers(VkRenderPass);
 
+        ////
+        // VkSwapchainKHR get()
+        //
+        // Provides access to the VkSwapchainKHR.
+        VkSwapchainKHR get() const;
+
+        ////
+        // const std::vector<VkImage>& images()
+        //
+        // The images of the swapchain.
+        const std::vector<VkImage>& images() const;
+
+        ////
+        // VkFormat format()
+        //
+        // The format of the images.
+        VkFormat format() const;
+
+        ////
+        // VkExtent2D extent()
+        //
+        // The size of the images.
+        VkExtent2D extent() const;
+
+        ////
+        // VkPresentModeKHR presentMode()
+        //
+        // The presentation mode in use.
+        VkPresentModeKHR presentMode() const;
+
+        ////
+        // size_t size()
+        //
+        // The number of images.
+        size_t size() const;
+
+        ////
+        // VkImageView imageView(size_t)
+        //
+        // The view of an image.
+        VkImageView imageView(size_t) const;
+
+        ////
+        // VkFramebuffer frameBuffer(size_t)
+        //
+        // The framebuffer of an image.
+        VkFramebuffer frameBuffer(size_t) const;
+
+        // Following Rule of 3's
         Swapchain(const Swapchain&) = delete;
         Swapchain& operator=(const Swapchain&) = delete;
     };
 
     ////
-    // Core
+    // class Core
     //
-    // TODO: Documentation
+    // Everything needed to render into a window: the Base, the Device and
+    // the Swapchain, constructed (and destroyed) in the right order.
     class Core {
-        Base base;
-        Device device;
-        Swapchain swapchain;
+        Base _base;
+        Device _device;
+        Swapchain _swapchain;
 
     public:
-        Core(wfn_eng::sdl::Window&);
-        ~Core();
+        ////
+        // Core(sdl::Window&, bool)
+        //
+        // Constructs the core of the renderer for a window, optionally with
+        // the validation layers.
+        Core(sdl::Window&, bool = false);
+
+        Core(Core&&) = default;
+        Core& operator=(Core&&);
+
+        ////
+        // Base& base()
+        //
+        // Provides access to the Base.
+        Base& base();
+
+        ////
+        // Device& device()
+        //
+        // Provides access to the Device.
+        Device& device();
+
+        ////
+        // Swapchain& swapchain()
+        //
+        // Provides access to the Swapchain.
+        Swapchain& swapchain();
 
+        // Following Rule of 3's
         Core(const Core&) = delete;
         Core& operator=(const Core&) = delete;
     };
+
+    ////
+    // struct BufferTransfer
+    //
+    // A buffer range handed from one queue to the other: how the releasing
+    // queue last accessed it, and how the acquiring queue will access it
+    // first.
+    struct BufferTransfer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = VK_WHOLE_SIZE;
+        VkPipelineStageFlags srcStages = 0;
+        VkAccessFlags srcAccess = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags dstAccess = 0;
+    };
+
+    ////
+    // struct ImageTransfer
+    //
+    // An image handed from one queue to the other, optionally changing its
+    // layout on the way.
+    struct ImageTransfer {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        VkImageLayout oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        VkImageLayout newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        VkPipelineStageFlags srcStages = 0;
+        VkAccessFlags srcAccess = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags dstAccess = 0;
+    };
+
+    ////
+    // struct OverlapStats
+    //
+    // How long the compute and graphics work of the profiled frames took on
+    // the GPU, and how much of the compute time ran alongside graphics work
+    // (of the same or the previous frame).
+    struct OverlapStats {
+        uint64_t frames = 0;
+        uint64_t computeNanos = 0;
+        uint64_t graphicsNanos = 0;
+        uint64_t overlapNanos = 0;
+    };
+
+    ////
+    // class AsyncCompute
+    //
+    // Schedules a frame's compute work (particles, culling,
+    // post-processing) on the compute queue so that it can overlap the
+    // graphics work, taking care of the semaphores between the two queues
+    // and of queue family ownership transfers. Each frame goes:
+    //
+    //   1. beginCompute, then record the dispatches,
+    //   2. submitCompute,
+    //   3. beginGraphics, add the frame's command buffers, endGraphics,
+    //   4. submit the graphics Submission on the graphics timeline.
+    //
+    // Compute only waits on graphics when graphics handed it something
+    // back in the previous frame; otherwise a frame's compute work can run
+    // while the previous frame is still rendering.
+    //
+    // Also profiles both queues with timestamps, assuming they share a time
+    // domain (true of desktop drivers). Holds on to the Device's timelines,
+    // so the Device must outlive it and must not be moved.
+    class AsyncCompute {
+    public:
+        ////
+        // enum class Queue
+        //
+        // The queue releasing a resource.
+        enum class Queue {
+            Graphics,
+            Compute
+        };
+
+    private:
+        struct Transfer {
+            VkPipelineStageFlags srcStages;
+            VkPipelineStageFlags dstStages;
+            bool isImage;
+            VkBufferMemoryBarrier buffer;
+            VkImageMemoryBarrier image;
+        };
+
+        struct Frame {
+            Handle<VkCommandPool> computePool;
+            Handle<VkCommandPool> graphicsPool;
+
+            // Freed along with their pools.
+            VkCommandBuffer compute;
+            VkCommandBuffer graphicsBegin;
+            VkCommandBuffer graphicsEnd;
+
+            uint64_t computeSubmitted = 0;
+            bool profiled = false;
+        };
+
+        VkDevice _device;
+        DeviceTable _vk;
+        uint32_t _graphicsFamily;
+        uint32_t _computeFamily;
+        Timeline *_graphics;
+        Timeline *_compute;
+
+        std::vector<Frame> _frames;
+        Handle<VkQueryPool> _queries;
+        bool _profiling = false;
+        double _timestampPeriod = 1;
+        uint64_t _timestampMask = ~0ull;
+
+        // Released by compute, acquired by graphics in the same frame.
+        std::vector<Transfer> _toGraphics;
+
+        // Released by graphics this frame, acquired by compute next frame.
+        std::vector<Transfer> _toCompute;
+        std::vector<Transfer> _acquireByCompute;
+
+        SyncPoint _computeDone;
+        SyncPoint _graphicsReleased;
+
+        uint64_t _lastGraphicsBegin = 0;
+        uint64_t _lastGraphicsEnd = 0;
+        OverlapStats _stats;
+
+        ////
+        // void schedule(Queue, Transfer)
+        //
+        // Queues a transfer for release and acquisition.
+        void schedule(Queue, Transfer);
+
+        ////
+        // void release(VkCommandBuffer, const std::vector<Transfer>&)
+        //
+        // Records the releasing half of every transfer.
+        void release(VkCommandBuffer, const std::vector<Transfer>&);
+
+        ////
+        // VkPipelineStageFlags acquire(VkCommandBuffer, const std::vector<Transfer>&)
+        //
+        // Records the acquiring half of every transfer, returning the
+        // stages that wait on them.
+        VkPipelineStageFlags acquire(VkCommandBuffer, const std::vector<Transfer>&);
+
+        ////
+        // void collect(size_t)
+        //
+        // Reads back the timestamps of a frame slot into the stats.
+        void collect(size_t);
+
+    public:
+        ////
+        // AsyncCompute(Device&, size_t)
+        //
+        // Constructs the command pools and timestamp queries for a number
+        // of frames in flight.
+        AsyncCompute(Device&, size_t);
+
+        ////
+        // VkCommandBuffer beginCompute(size_t)
+        //
+        // Starts the compute work of a frame slot, returning the command
+        // buffer to record the dispatches into. The slot's previous
+        // graphics submission must have completed; its previous compute
+        // submission is waited on here.
+        VkCommandBuffer beginCompute(size_t);
+
+        ////
+        // void transfer(Queue, const BufferTransfer&)
+        //
+        // Hands a buffer over to the other queue: from compute to graphics
+        // within the frame, or from graphics to compute for the next frame.
+        void transfer(Queue, const BufferTransfer&);
+
+        ////
+        // void transfer(Queue, const ImageTransfer&)
+        //
+        // Hands an image over to the other queue.
+        void transfer(Queue, const ImageTransfer&);
+
+        ////
+        // SyncPoint submitCompute(size_t)
+        //
+        // Submits the compute work of a frame slot.
+        SyncPoint submitCompute(size_t);
+
+        ////
+        // void beginGraphics(size_t, Submission&, VkPipelineStageFlags)
+        //
+        // Makes a graphics Submission wait, at the provided stages, for the
+        // frame's compute work, acquiring what compute handed over.
+        void beginGraphics(size_t, Submission&, VkPipelineStageFlags);
+
+        ////
+        // void endGraphics(size_t, Submission&)
+        //
+        // Finishes a graphics Submission, releasing what graphics hands
+        // back to compute. The Submission must be the next one submitted
+        // on the graphics timeline.
+        void endGraphics(size_t, Submission&);
+
+        ////
+        // bool profiling()
+        //
+        // Whether both queues support timestamps.
+        bool profiling() const;
+
+        ////
+        // const OverlapStats& stats()
+        //
+        // The GPU time of the profiled frames.
+        const OverlapStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the average compute and graphics time per frame, and how
+        // much of the compute time overlapped graphics.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        AsyncCompute(const AsyncCompute&) = delete;
+        AsyncCompute& operator=(const AsyncCompute&) = delete;
+    };
+
+    ////
+    // namespace shader
+    //
+    // Shader permutations. A shader's features are toggled in one of two
+    // ways:
+    //
+    //   - specialized: a boolean specialization constant (constant_id N for
+    //     the feature 1 << N, defaulting to false in the shader). The driver
+    //     folds the branches away when it compiles the pipeline, so these
+    //     cost nothing at runtime and need no extra SPIR-V.
+    //   - offline: a separate SPIR-V file compiled with a define, for the
+    //     features that can't be a constant (e.g. ones that add discard or
+    //     change the shader's interface).
+    //
+    // A shader is described by a traits struct:
+    //
+    //   struct DemoFrag {
+    //       enum class Feature : uint32_t { Grayscale = 1 << 0, ... };
+    //       static constexpr uint32_t offline = ...;   // offline features
+    //       static constexpr bool valid(uint32_t);     // allowed combinations
+    //       static const char *path(uint32_t);         // SPIR-V per offline mask
+    //   };
+    //
+    // and a permutation is named at compile time with Permutation, which
+    // rejects features of another shader, repeated features and invalid
+    // combinations.
+    namespace shader {
+        ////
+        // bool distinct(uint32_t...)
+        //
+        // Whether no bit is set in more than one of the provided masks.
+        constexpr bool distinct() { return true; }
+
+        template <typename... Rest>
+        constexpr bool distinct(uint32_t first, Rest... rest) {
+            return ((first & (0u | ... | static_cast<uint32_t>(rest))) == 0) && distinct(rest...);
+        }
+
+        ////
+        // template <typename Shader, typename Shader::Feature...> struct Permutation
+        //
+        // One permutation of a shader: the mask of its features, split into
+        // the specialized ones (for the PipelineKey) and the offline ones
+        // (picking the SPIR-V file).
+        template <typename Shader, typename Shader::Feature... Features>
+        struct Permutation {
+            static constexpr uint32_t mask = (0u | ... | static_cast<uint32_t>(Features));
+            static constexpr uint32_t specialized = mask & ~Shader::offline;
+            static constexpr uint32_t offline = mask & Shader::offline;
+
+            static_assert(distinct(static_cast<uint32_t>(Features)...), "Repeated shader feature");
+            static_assert(Shader::valid(mask), "Invalid shader feature combination");
+
+            ////
+            // const char *path()
+            //
+            // The SPIR-V file of the permutation.
+            static const char *path() { return Shader::path(offline); }
+        };
+
+        ////
+        // class Specialization
+        //
+        // The VkSpecializationInfo turning on the specialized features of a
+        // mask. Points into itself, so it can't be copied.
+        class Specialization {
+            VkSpecializationMapEntry _entries[32];
+            VkBool32 _values[32];
+            VkSpecializationInfo _info;
+
+        public:
+            ////
+            // Specialization(uint32_t)
+            //
+            // Sets constant_id N to true for every bit N of the mask.
+            explicit Specialization(uint32_t);
+
+            ////
+            // const VkSpecializationInfo *info()
+            //
+            // The info to hand to a shader stage, or nullptr if no feature
+            // is on.
+            const VkSpecializationInfo *info() const;
+
+            // Following Rule of 3's
+            Specialization(const Specialization&) = delete;
+            Specialization& operator=(const Specialization&) = delete;
+        };
+
+        ////
+        // struct Binding
+        //
+        // A descriptor a shader declares. Arrays of descriptors have their
+        // length as the count (runtime arrays count as 1).
+        struct Binding {
+            uint32_t set;
+            uint32_t binding;
+            VkDescriptorType type;
+            uint32_t count;
+            VkShaderStageFlags stages;
+
+            bool operator==(const Binding& o) const {
+                return set == o.set && binding == o.binding && type == o.type &&
+                       count == o.count && stages == o.stages;
+            }
+        };
+
+        ////
+        // struct VertexInput
+        //
+        // A vertex attribute a vertex shader reads.
+        struct VertexInput {
+            uint32_t location;
+            VkFormat format;
+            uint32_t size;
+        };
+
+        ////
+        // struct Reflection
+        //
+        // What a SPIR-V module declares: its stage, its descriptors (sorted
+        // by set then binding), the range of its push constant block (a
+        // size of 0 if it has none), and for vertex shaders the attributes
+        // it reads (sorted by location).
+        struct Reflection {
+            VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+            std::vector<Binding> bindings;
+            uint32_t pushConstantOffset = 0;
+            uint32_t pushConstantSize = 0;
+            std::vector<VertexInput> inputs;
+        };
+
+        ////
+        // Reflection reflect(const uint32_t *, size_t)
+        //
+        // Reads the interface of a SPIR-V module of the provided number of
+        // words, for its first entry point. Throws on anything that isn't
+        // SPIR-V or that the engine can't express as a layout.
+        Reflection reflect(const uint32_t *, size_t);
+    }
+
+    ////
+    // uint32_t maxVertexAttributes
+    //
+    // The most attributes a VertexLayout holds.
+    const uint32_t maxVertexAttributes = 8;
+
+    ////
+    // struct VertexLayout
+    //
+    // The vertex input of a pipeline: attributes interleaved in a single
+    // binding.
+    struct VertexLayout {
+        uint32_t stride = 0;
+        uint32_t count = 0;
+        VkVertexInputAttributeDescription attributes[maxVertexAttributes] = {};
+
+        ////
+        // VertexLayout packed(const shader::Reflection&)
+        //
+        // Packs the inputs of a vertex shader tightly, in location order.
+        static VertexLayout packed(const shader::Reflection&);
+
+        bool operator==(const VertexLayout&) const;
+    };
+
+    ////
+    // enum class Blend
+    //
+    // The color blending of a pipeline.
+    enum class Blend : uint8_t {
+        Opaque,
+        Alpha,
+        Additive
+    };
+
+    ////
+    // struct PipelineKey
+    //
+    // Everything a graphics pipeline is built from. Viewport and scissor
+    // are always dynamic, so pipelines don't depend on the swapchain's
+    // extent. The shader modules, layout and render pass are borrowed: they
+    // must outlive any compile of the key. The feature masks are the
+    // specialized features of each stage (see shader::Permutation).
+    struct PipelineKey {
+        VkShaderModule vertex = VK_NULL_HANDLE;
+        VkShaderModule fragment = VK_NULL_HANDLE;
+        uint32_t vertexFeatures = 0;
+        uint32_t fragmentFeatures = 0;
+        VertexLayout vertexLayout;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        uint32_t subpass = 0;
+
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        Blend blend = Blend::Opaque;
+        bool depthTest = false;
+        bool depthWrite = false;
+        VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+
+        ////
+        // uint64_t hash()
+        //
+        // Hashes every field.
+        uint64_t hash() const;
+
+        bool operator==(const PipelineKey&) const;
+        bool operator!=(const PipelineKey& o) const { return !(*this == o); }
+    };
+
+    ////
+    // struct PipelineKeyHash
+    //
+    // Lets PipelineKeys be used as unordered_map keys.
+    struct PipelineKeyHash {
+        size_t operator()(const PipelineKey& key) const {
+            return static_cast<size_t>(key.hash());
+        }
+    };
+
+    ////
+    // uint32_t maxDescriptorSets
+    //
+    // The most descriptor sets a pipeline layout made by a LayoutCache has.
+    const uint32_t maxDescriptorSets = 4;
+
+    ////
+    // struct ReflectedLayout
+    //
+    // A pipeline layout along with the descriptor set layouts it was made
+    // of, all owned by a LayoutCache.
+    struct ReflectedLayout {
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        uint32_t setCount = 0;
+        VkDescriptorSetLayout sets[maxDescriptorSets] = {};
+        VkPushConstantRange pushConstants = {};
+    };
+
+    ////
+    // struct LayoutStats
+    //
+    // Counters on a LayoutCache. A hit is a layout found already built.
+    struct LayoutStats {
+        uint64_t setHits = 0;
+        uint64_t setMisses = 0;
+        uint64_t layoutHits = 0;
+        uint64_t layoutMisses = 0;
+    };
+
+    ////
+    // class LayoutCache
+    //
+    // Builds pipeline layouts from the reflection of their shaders, and
+    // keeps every descriptor set and pipeline layout it builds, keyed by
+    // content. Pipelines whose shaders declare the same interface get the
+    // very same VkPipelineLayout, so descriptor sets stay bound when
+    // switching between them. The Device must outlive the cache.
+    class LayoutCache {
+        struct SetKeyHash {
+            size_t operator()(const std::vector<shader::Binding>&) const;
+        };
+
+        struct LayoutKey {
+            uint32_t setCount;
+            VkDescriptorSetLayout sets[maxDescriptorSets];
+            VkPushConstantRange pushConstants;
+
+            bool operator==(const LayoutKey&) const;
+        };
+
+        struct LayoutKeyHash {
+            size_t operator()(const LayoutKey&) const;
+        };
+
+        VkDevice _device;
+        DeviceTable _vk;
+
+        std::unordered_map<std::vector<shader::Binding>, Handle<VkDescriptorSetLayout>, SetKeyHash> _sets;
+        std::unordered_map<LayoutKey, Handle<VkPipelineLayout>, LayoutKeyHash> _layouts;
+
+        LayoutStats _stats;
+
+    public:
+        ////
+        // LayoutCache(Device&)
+        //
+        // Constructs an empty cache.
+        LayoutCache(Device&);
+
+        ////
+        // VkDescriptorSetLayout setLayout(const std::vector<shader::Binding>&)
+        //
+        // The layout of one descriptor set (the bindings' set numbers are
+        // ignored).
+        VkDescriptorSetLayout setLayout(const std::vector<shader::Binding>&);
+
+        ////
+        // ReflectedLayout layout(std::initializer_list<const shader::Reflection *>)
+        //
+        // The layout of a pipeline made of the provided shader stages. A
+        // binding declared by several stages must have the same type and
+        // count in each; the push constant blocks are merged into one
+        // range.
+        ReflectedLayout layout(std::initializer_list<const shader::Reflection *>);
+
+        ////
+        // const LayoutStats& stats()
+        //
+        // The counters of the cache.
+        const LayoutStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        LayoutCache(const LayoutCache&) = delete;
+        LayoutCache& operator=(const LayoutCache&) = delete;
+    };
+
+    ////
+    // typedef PipelineId
+    //
+    // Names a pipeline of a PipelineManager.
+    typedef uint32_t PipelineId;
+
+    ////
+    // PipelineId noPipeline
+    //
+    // The PipelineId of nothing, e.g. of a missing fallback.
+    const PipelineId noPipeline = ~0u;
+
+    ////
+    // struct PipelineStats
+    //
+    // Counters on a PipelineManager. A deduplicated request found its key
+    // already built or compiling; a fallback use is a get that returned
+    // another pipeline because the requested one wasn't ready.
+    struct PipelineStats {
+        uint64_t requests = 0;
+        uint64_t deduplicated = 0;
+        uint64_t fallbackUses = 0;
+        std::atomic<uint64_t> compiled { 0 };
+        std::atomic<uint64_t> failed { 0 };
+        std::atomic<uint64_t> compileNanos { 0 };
+        std::atomic<uint64_t> maxCompileNanos { 0 };
+    };
+
+    ////
+    // class PipelineManager
+    //
+    // Owns every graphics pipeline, keyed by PipelineKey so that identical
+    // requests share one pipeline. New pipelines compile on worker threads,
+    // all through one VkPipelineCache (optionally loaded from and saved to
+    // a file); until a pipeline is ready, get returns its fallback, so the
+    // renderer never waits on a first-use compile. build compiles on the
+    // calling thread, for the fallbacks themselves (at load time).
+    //
+    // request, build and get must all be called from one thread; only the
+    // compiles run elsewhere. The Device must outlive the manager.
+    class PipelineManager {
+        struct Entry {
+            PipelineKey key;
+            PipelineId fallback;
+            std::atomic<VkPipeline> pipeline { VK_NULL_HANDLE };
+            std::atomic<bool> failed { false };
+        };
+
+        VkDevice _device;
+        VkPhysicalDevice _physical;
+        DeviceTable _vk;
+        Handle<VkPipelineCache> _cache;
+        std::string _cachePath;
+
+        // A deque, so that the workers' pointers survive new requests.
+        std::deque<Entry> _entries;
+        std::unordered_map<PipelineKey, PipelineId, PipelineKeyHash> _ids;
+
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::deque<Entry *> _pending;
+        size_t _compiling;
+        bool _quitting;
+
+        PipelineStats _stats;
+
+        ////
+        // void makeCache()
+        //
+        // Creates the pipeline cache, seeded from the cache file when it
+        // was written by the same driver and GPU.
+        void makeCache();
+
+        ////
+        // void workLoop()
+        //
+        // The body of a worker thread.
+        void workLoop();
+
+        ////
+        // VkPipeline compile(const PipelineKey&)
+        //
+        // Builds a pipeline, returning VK_NULL_HANDLE on failure. Safe to
+        // call from any thread.
+        VkPipeline compile(const PipelineKey&);
+
+        ////
+        // PipelineId add(const PipelineKey&, PipelineId, bool&)
+        //
+        // Finds or adds the entry of a key, reporting whether it was new.
+        PipelineId add(const PipelineKey&, PipelineId, bool&);
+
+    public:
+        ////
+        // PipelineManager(Device&, const std::string&, size_t)
+        //
+        // Constructs a manager compiling on the provided number of threads
+        // (0 for one per hardware thread, minus the calling one). A
+        // non-empty path names the file the pipeline cache is read from now
+        // and written to on destruction.
+        PipelineManager(Device&, const std::string& = "", size_t = 1);
+
+        ////
+        // ~PipelineManager()
+        //
+        // Drops the compiles that haven't started, waits for the others,
+        // saves the cache and destroys every pipeline. No pipeline may be in
+        // use on the GPU.
+        ~PipelineManager();
+
+        ////
+        // PipelineId request(const PipelineKey&, PipelineId)
+        //
+        // Returns the pipeline of a key, queueing its compile if it's new.
+        // Until it's ready, get returns the provided fallback instead.
+        PipelineId request(const PipelineKey&, PipelineId = noPipeline);
+
+        ////
+        // PipelineId build(const PipelineKey&)
+        //
+        // Returns the pipeline of a key, compiling it on the calling thread
+        // if it's new. Throws if the compile fails.
+        PipelineId build(const PipelineKey&);
+
+        ////
+        // VkPipeline get(PipelineId)
+        //
+        // The pipeline if it's ready, otherwise the first ready one along
+        // its fallbacks, otherwise VK_NULL_HANDLE. Never blocks.
+        VkPipeline get(PipelineId);
+
+        ////
+        // bool ready(PipelineId)
+        //
+        // Whether the pipeline itself is ready.
+        bool ready(PipelineId) const;
+
+        ////
+        // bool failed(PipelineId)
+        //
+        // Whether the pipeline failed to compile (get keeps returning its
+        // fallback).
+        bool failed(PipelineId) const;
+
+        ////
+        // Handle<VkPipeline> retire(PipelineId)
+        //
+        // Gives up a ready (or failed) pipeline that is being replaced, for
+        // the caller to destroy once the GPU is done with it. The key is
+        // forgotten, so requesting it again compiles a new pipeline, and
+        // get skips the entry for its fallback from now on.
+        Handle<VkPipeline> retire(PipelineId);
+
+        ////
+        // size_t pending()
+        //
+        // The number of compiles queued or running.
+        size_t pending();
+
+        ////
+        // void save()
+        //
+        // Writes the pipeline cache to its file, if it has one.
+        void save();
+
+        ////
+        // const PipelineStats& stats()
+        //
+        // The counters of the manager.
+        const PipelineStats& stats() const;
+
+        ////
+        // void report(std::ostream&)
+        //
+        // Writes the counters along with the average and worst compile time.
+        void report(std::ostream&) const;
+
+        // Following Rule of 3's
+        PipelineManager(const PipelineManager&) = delete;
+        PipelineManager& operator=(const PipelineManager&) = delete;
+    };
+
+    ////
+    // struct Staged
+    //
+    // A range of a staging buffer, written through its mapping and copied
+    // from on the GPU.
+    struct Staged {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void *data = nullptr;
+    };
+
+    ////
+    // class StagingRing
+    //
+    // A persistently mapped, host-coherent buffer handed out front to back
+    // for uploads. The ranges allocated before a submit are in use until
+    // the submission value it's given completes (a graphics timeline value),
+    // and collect gives them back, so the ring never waits on the GPU: when
+    // it's full, allocate fails until earlier uploads complete. An
+    // allocation never wraps around the end of the buffer.
+    class StagingRing {
+        struct Region {
+            uint64_t end;
+            uint64_t value;
+        };
+
+        Handle<VkBuffer> _buffer;
+        Handle<VkDeviceMemory> _memory;
+        uint8_t *_mapped;
+        VkDeviceSize _capacity;
+
+        // Positions only ever grow; the offset is the position modulo the
+        // capacity.
+        uint64_t _head = 0;
+        uint64_t _tail = 0;
+        uint64_t _submitted = 0;
+        std::deque<Region> _regions;
+
+    public:
+        ////
+        // StagingRing(Device&, VkDeviceSize)
+        //
+        // Creates and maps a staging buffer of the provided size.
+        StagingRing(Device&, VkDeviceSize);
+
+        ////
+        // bool allocate(VkDeviceSize, VkDeviceSize, Staged&)
+        //
+        // Hands out a range of the provided size and (power of two)
+        // alignment, returning false if the ring is full.
+        bool allocate(VkDeviceSize, VkDeviceSize, Staged&);
+
+        ////
+        // void submit(uint64_t)
+        //
+        // Marks every range allocated since the last submit as in use until
+        // the provided value completes. Values must not decrease.
+        void submit(uint64_t);
+
+        ////
+        // void collect(uint64_t)
+        //
+        // Gives back the ranges of every submit up to the provided
+        // completed value.
+        void collect(uint64_t);
+
+        ////
+        // VkDeviceSize capacity()
+        //
+        // The size of the ring.
+        VkDeviceSize capacity() const;
+
+        ////
+        // VkDeviceSize used()
+        //
+        // The bytes allocated and not given back yet.
+        VkDeviceSize used() const;
+
+        // Following Rule of 3's
+        StagingRing(const StagingRing&) = delete;
+        StagingRing& operator=(const StagingRing&) = delete;
+    };
 }
 
 #endif
@@ -0,0 +1,303 @@
+#include "../vulkan.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+
+////
+// The number of VkSystemAllocationScope values (COMMAND through INSTANCE).
+static const size_t scopeCount = 5;
+
+////
+// The size of the arena serving command-scope allocations.
+static const size_t commandArenaSize = 4 * 1024 * 1024;
+
+////
+// struct Header
+//
+// Stored immediately before every pointer handed to the driver, so that
+// frees and reallocations know where the block came from.
+struct Header {
+    void *base;
+    size_t size;
+    uint32_t scope;
+    uint32_t fromArena;
+};
+
+////
+// struct AtomicScopeStats
+//
+// The live, thread-safe version of ScopeStats (the driver may allocate from
+// any thread).
+struct AtomicScopeStats {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> reallocations;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> arenaAllocations;
+    std::atomic<uint64_t> liveBytes;
+    std::atomic<uint64_t> peakBytes;
+    std::atomic<uint64_t> totalBytes;
+    std::atomic<uint64_t> internalBytes;
+};
+
+static bool isEnabled = false;
+static AtomicScopeStats scopeStats[scopeCount];
+
+////
+// The command arena: a bump allocator that rewinds to the start whenever
+// its last live allocation is freed.
+static std::mutex arenaMutex;
+static std::byte *arenaData = nullptr;
+static size_t arenaOffset = 0;
+static size_t arenaLive = 0;
+
+static size_t scopeIndex(VkSystemAllocationScope scope) {
+    return std::min(static_cast<size_t>(scope), scopeCount - 1);
+}
+
+////
+// void *arenaAllocate(size_t)
+//
+// Takes a block from the command arena, or returns nullptr if it is full.
+static void *arenaAllocate(size_t size) {
+    std::lock_guard<std::mutex> lock(arenaMutex);
+    if (arenaData == nullptr)
+        arenaData = static_cast<std::byte *>(std::malloc(commandArenaSize));
+
+    if (arenaData == nullptr || arenaOffset + size > commandArenaSize)
+        return nullptr;
+
+    void *block = arenaData + arenaOffset;
+    arenaOffset += (size + 15) & ~size_t(15);
+    arenaLive++;
+
+    return block;
+}
+
+////
+// void arenaFree()
+//
+// Releases a block of the command arena.
+static void arenaFree() {
+    std::lock_guard<std::mutex> lock(arenaMutex);
+    if (--arenaLive == 0)
+        arenaOffset = 0;
+}
+
+////
+// void *trackedAllocate(void *, size_t, size_t, VkSystemAllocationScope)
+//
+// PFN_vkAllocationFunction
+static VKAPI_ATTR void *VKAPI_CALL trackedAllocate(
+        void *userData,
+        size_t size,
+        size_t alignment,
+        VkSystemAllocationScope scope) {
+    if (size == 0)
+        return nullptr;
+
+    alignment = std::max(alignment, alignof(std::max_align_t));
+    size_t total = size + alignment + sizeof(Header);
+    size_t index = scopeIndex(scope);
+
+    void *base = nullptr;
+    bool fromArena = false;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+        base = arenaAllocate(total);
+        fromArena = base != nullptr;
+    }
+
+    if (base == nullptr)
+        base = std::malloc(total);
+
+    if (base == nullptr)
+        return nullptr;
+
+    uintptr_t user = reinterpret_cast<uintptr_t>(base) + sizeof(Header);
+    user = (user + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+    Header *header = reinterpret_cast<Header *>(user) - 1;
+    header->base = base;
+    header->size = size;
+    header->scope = static_cast<uint32_t>(index);
+    header->fromArena = fromArena;
+
+    AtomicScopeStats& stats = scopeStats[index];
+    stats.allocations.fetch_add(1, std::memory_order_relaxed);
+    if (fromArena)
+        stats.arenaAllocations.fetch_add(1, std::memory_order_relaxed);
+    stats.totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+    uint64_t live = stats.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = stats.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !stats.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+
+    return reinterpret_cast<void *>(user);
+}
+
+////
+// void trackedFree(void *, void *)
+//
+// PFN_vkFreeFunction
+static VKAPI_ATTR void VKAPI_CALL trackedFree(void *userData, void *memory) {
+    if (memory == nullptr)
+        return;
+
+    Header *header = static_cast<Header *>(memory) - 1;
+
+    AtomicScopeStats& stats = scopeStats[header->scope];
+    stats.frees.fetch_add(1, std::memory_order_relaxed);
+    stats.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+    if (header->fromArena)
+        arenaFree();
+    else
+        std::free(header->base);
+}
+
+////
+// void *trackedReallocate(void *, void *, size_t, size_t, VkSystemAllocationScope)
+//
+// PFN_vkReallocationFunction
+static VKAPI_ATTR void *VKAPI_CALL trackedReallocate(
+        void *userData,
+        void *original,
+        size_t size,
+        size_t alignment,
+        VkSystemAllocationScope scope) {
+    if (original == nullptr)
+        return trackedAllocate(userData, size, alignment, scope);
+
+    if (size == 0) {
+        trackedFree(userData, original);
+        return nullptr;
+    }
+
+    void *memory = trackedAllocate(userData, size, alignment, scope);
+    if (memory == nullptr)
+        return nullptr;
+
+    Header *header = static_cast<Header *>(original) - 1;
+    std::memcpy(memory, original, std::min(size, header->size));
+    scopeStats[scopeIndex(scope)].reallocations.fetch_add(1, std::memory_order_relaxed);
+
+    trackedFree(userData, original);
+    return memory;
+}
+
+////
+// void internalAllocation(void *, size_t, VkInternalAllocationType,
+//                         VkSystemAllocationScope)
+//
+// PFN_vkInternalAllocationNotification
+static VKAPI_ATTR void VKAPI_CALL internalAllocation(
+        void *userData,
+        size_t size,
+        VkInternalAllocationType type,
+        VkSystemAllocationScope scope) {
+    scopeStats[scopeIndex(scope)].internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+////
+// void internalFree(void *, size_t, VkInternalAllocationType,
+//                   VkSystemAllocationScope)
+//
+// PFN_vkInternalFreeNotification
+static VKAPI_ATTR void VKAPI_CALL internalFree(
+        void *userData,
+        size_t size,
+        VkInternalAllocationType type,
+        VkSystemAllocationScope scope) {
+    scopeStats[scopeIndex(scope)].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static const VkAllocationCallbacks trackingCallbacks = {
+    nullptr,
+    trackedAllocate,
+    trackedReallocate,
+    trackedFree,
+    internalAllocation,
+    internalFree
+};
+
+namespace wfn_eng::vulkan::allocator {
+    ////
+    // void enable()
+    //
+    // Switches the engine to the tracking callbacks. Must be called at
+    // startup, before any Vulkan object is created, since objects have to
+    // be destroyed with the same callbacks they were created with.
+    void enable() { isEnabled = true; }
+
+    ////
+    // bool enabled()
+    //
+    // Whether the tracking callbacks are in use.
+    bool enabled() { return isEnabled; }
+
+    ////
+    // const VkAllocationCallbacks *callbacks()
+    //
+    // The callbacks to pass to every vkCreate* and vkDestroy* call.
+    const VkAllocationCallbacks *callbacks() {
+        return isEnabled ? &trackingCallbacks : nullptr;
+    }
+
+    ////
+    // ScopeStats stats(VkSystemAllocationScope)
+    //
+    // Provides a copy of the counters of a scope.
+    ScopeStats stats(VkSystemAllocationScope scope) {
+        const AtomicScopeStats& live = scopeStats[scopeIndex(scope)];
+
+        ScopeStats copy;
+        copy.allocations = live.allocations.load(std::memory_order_relaxed);
+        copy.reallocations = live.reallocations.load(std::memory_order_relaxed);
+        copy.frees = live.frees.load(std::memory_order_relaxed);
+        copy.arenaAllocations = live.arenaAllocations.load(std::memory_order_relaxed);
+        copy.liveBytes = live.liveBytes.load(std::memory_order_relaxed);
+        copy.peakBytes = live.peakBytes.load(std::memory_order_relaxed);
+        copy.totalBytes = live.totalBytes.load(std::memory_order_relaxed);
+        copy.internalBytes = live.internalBytes.load(std::memory_order_relaxed);
+
+        return copy;
+    }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes a table of the counters of every scope.
+    void report(std::ostream& out) {
+        static const char *names[scopeCount] = {
+            "command", "object", "cache", "device", "instance"
+        };
+
+        out << "Vulkan host allocations ("
+            << (isEnabled ? "tracking" : "system, not tracked") << ")" << std::endl;
+        out << std::setw(10) << "scope"
+            << std::setw(10) << "allocs"
+            << std::setw(10) << "reallocs"
+            << std::setw(10) << "frees"
+            << std::setw(10) << "arena"
+            << std::setw(12) << "live"
+            << std::setw(12) << "peak"
+            << std::setw(12) << "total"
+            << std::setw(12) << "internal" << std::endl;
+
+        for (size_t i = 0; i < scopeCount; i++) {
+            ScopeStats s = stats(static_cast<VkSystemAllocationScope>(i));
+            out << std::setw(10) << names[i]
+                << std::setw(10) << s.allocations
+                << std::setw(10) << s.reallocations
+                << std::setw(10) << s.frees
+                << std::setw(10) << s.arenaAllocations
+                << std::setw(12) << s.liveBytes
+                << std::setw(12) << s.peakBytes
+                << std::setw(12) << s.totalBytes
+                << std::setw(12) << s.internalBytes << std::endl;
+        }
+    }
+}
@@ -1,25 +1,56 @@
 #include "../vulkan.hpp"
 
+#include "../memory.hpp"
+
 #include <SDL_vulkan.h>
+#include <cstring>
 
 ////
-// std::vector<const char *> getRequiredExtensions(wfn_eng::sdl::Window&)
+// std::vector<const char *> getRequiredExtensions(wfn_eng::sdl::Window&, bool)
 //
-// Returns the required set of extensions necessary for the
-static std::vector<const char *> getRequiredExtensions(wfn_eng::sdl::Window& window) {
+// Returns the required set of extensions necessary for the window's surface
+// (plus debug reporting when validating).
+static std::vector<const char *> getRequiredExtensions(wfn_eng::sdl::Window& window, bool validation) {
     uint32_t sdlExtCount;
     SDL_Vulkan_GetInstanceExtensions(window.ref(), &sdlExtCount, nullptr);
 
-    const char **pNames = new const char *[sdlExtCount];
-    SDL_Vulkan_GetInstanceExtensions(window.ref(), &sdlExtCount, pNames);
-
-    std::vector<const char *> exts(pNames, pNames + sdlExtCount);
+    std::vector<const char *> exts(sdlExtCount);
+    SDL_Vulkan_GetInstanceExtensions(window.ref(), &sdlExtCount, exts.data());
 
-    // TODO: Add any additional extensions?
+    if (validation)
+        exts.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 
     return exts;
 }
 
+////
+// bool checkValidationLayerSupport()
+//
+// Checks if every validation layer is available.
+static bool checkValidationLayerSupport() {
+    uint32_t layerCount;
+    vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+    wfn_eng::memory::ScratchScope scratch;
+    wfn_eng::memory::ArenaVector<VkLayerProperties> availableLayers(layerCount, scratch.arena());
+    vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+    for (const char *layerName: wfn_eng::vulkan::Base::validationLayers) {
+        bool found = false;
+        for (const auto& layerProperties: availableLayers) {
+            if (strcmp(layerName, layerProperties.layerName) == 0) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
 namespace wfn_eng::vulkan {
     ////
     // class Base
@@ -28,28 +59,46 @@ namespace wfn_eng::vulkan {
     // the VkSurfaceKHR.
 
     ////
-    // Base(sdl::Window&)
+    // Base(sdl::Window&, bool)
     //
     // Construct the base of the Vulkan instance (VkInstance and
-    // VkSurfaceKHR) from an SDL window wrapper.
-    Base::Base(sdl::Window& window) {
+    // VkSurfaceKHR) from an SDL window wrapper, optionally enabling the
+    // validation layers (and the debug report extension they use).
+    Base::Base(sdl::Window& window, bool validation) {
+        dispatch::loadGlobal();
+
+        if (validation && !checkValidationLayerSupport()) {
+            throw WfnError(
+                "wfn_eng::vulkan::Base",
+                "Constructor",
+                "Find Validation Layers"
+            );
+        }
+
         VkApplicationInfo appInfo = {};
         appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
         appInfo.pApplicationName = "We Fight Now";
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "wfn_eng";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // Timeline semaphores are core in 1.2.
+        appInfo.apiVersion = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
-        auto reqExts = getRequiredExtensions(window);
+        auto reqExts = getRequiredExtensions(window, validation);
         createInfo.enabledExtensionCount = static_cast<uint32_t>(reqExts.size());
         createInfo.ppEnabledExtensionNames = reqExts.data();
 
-        if (vkCreateInstance(&createInfo, nullptr, &_instance) != VK_SUCCESS) {
+        if (validation) {
+            createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+            createInfo.ppEnabledLayerNames = validationLayers.data();
+        }
+
+        VkInstance instance;
+        if (vkCreateInstance(&createInfo, allocator::callbacks(), &instance) != VK_SUCCESS) {
             throw WfnError(
                 "wfn_eng::vulkan::Base",
                 "Constructor",
@@ -57,33 +106,41 @@ namespace wfn_eng::vulkan {
             );
         }
 
-        if (!SDL_Vulkan_CreateSurface(window.ref(), _instance, &_surface)) {
+        _instance = Handle<VkInstance>(instance);
+        dispatch::loadInstance(instance);
+
+        VkSurfaceKHR surface;
+        if (!SDL_Vulkan_CreateSurface(window.ref(), instance, &surface)) {
             throw WfnError(
                 "wfn_eng::vulkan::Base",
                 "Constructor",
                 "Create Surface"
             );
         }
+
+        _surface = Handle<VkSurfaceKHR>(instance, surface);
     }
 
     ////
-    // ~Base()
+    // Base& operator=(Base&&)
     //
-    // Destroying the VkInstance and VkSurfaceKHR.
-    Base::~Base() {
-        vkDestroySurfaceKHR(_instance, _surface, nullptr);
-        vkDestroyInstance(_instance, nullptr);
+    // Moves a Base, destroying the surface before the instance it belongs
+    // to.
+    Base& Base::operator=(Base&& other) {
+        _surface = std::move(other._surface);
+        _instance = std::move(other._instance);
+        return *this;
     }
 
     ////
     // VkInstance instance()
     //
     // Provides access to the VkInstance.
-    VkInstance& Base::instance() { return _instance; }
+    VkInstance Base::instance() const { return _instance.get(); }
 
     ////
     // VkSurfaceKHR surface()
     //
     // Provides access to the VkSurfaceKHR.
-    VkSurfaceKHR& Base::surface() { return _surface; }
+    VkSurfaceKHR Base::surface() const { return _surface.get(); }
 }
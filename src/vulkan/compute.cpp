@@ -0,0 +1,489 @@
+#include "../vulkan.hpp"
+
+#include <algorithm>
+
+////
+// uint64_t intersection(uint64_t, uint64_t, uint64_t, uint64_t)
+//
+// The length of the intersection of two intervals.
+static uint64_t intersection(uint64_t begin0, uint64_t end0, uint64_t begin1, uint64_t end1) {
+    uint64_t begin = std::max(begin0, begin1);
+    uint64_t end = std::min(end0, end1);
+    return end > begin ? end - begin : 0;
+}
+
+// Timestamps per frame slot: compute begin/end, then graphics begin/end.
+static const uint32_t queriesPerFrame = 4;
+
+// Transfers per frame before the lists have to grow.
+static const size_t reservedTransfers = 16;
+
+namespace wfn_eng::vulkan {
+    ////
+    // class AsyncCompute
+    //
+    // Schedules a frame's compute work on the compute queue so that it can
+    // overlap the graphics work.
+
+    ////
+    // AsyncCompute(Device&, size_t)
+    //
+    // Constructs the command pools and timestamp queries for a number of
+    // frames in flight.
+    AsyncCompute::AsyncCompute(Device& device, size_t frames) :
+            _device(device.logical()),
+            _vk(device.table()),
+            _graphicsFamily(device.graphicsFamily()),
+            _computeFamily(device.computeFamily()),
+            _graphics(&device.graphicsTimeline()),
+            _compute(&device.computeTimeline()) {
+        _frames.resize(frames);
+
+        for (Frame& frame: _frames) {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            VkCommandPool computePool, graphicsPool;
+            poolInfo.queueFamilyIndex = _computeFamily;
+            if (_vk.vkCreateCommandPool(_device, &poolInfo, allocator::callbacks(), &computePool) != VK_SUCCESS) {
+                throw WfnError(
+                    "wfn_eng::vulkan::AsyncCompute",
+                    "Constructor",
+                    "Create Command Pool"
+                );
+            }
+            frame.computePool = Handle<VkCommandPool>(_device, computePool);
+
+            poolInfo.queueFamilyIndex = _graphicsFamily;
+            if (_vk.vkCreateCommandPool(_device, &poolInfo, allocator::callbacks(), &graphicsPool) != VK_SUCCESS) {
+                throw WfnError(
+                    "wfn_eng::vulkan::AsyncCompute",
+                    "Constructor",
+                    "Create Command Pool"
+                );
+            }
+            frame.graphicsPool = Handle<VkCommandPool>(_device, graphicsPool);
+
+            VkCommandBufferAllocateInfo allocateInfo = {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+            allocateInfo.commandPool = computePool;
+            allocateInfo.commandBufferCount = 1;
+            VkResult computeResult = _vk.vkAllocateCommandBuffers(_device, &allocateInfo, &frame.compute);
+
+            VkCommandBuffer graphics[2];
+            allocateInfo.commandPool = graphicsPool;
+            allocateInfo.commandBufferCount = 2;
+            VkResult graphicsResult = _vk.vkAllocateCommandBuffers(_device, &allocateInfo, graphics);
+
+            if (computeResult != VK_SUCCESS || graphicsResult != VK_SUCCESS) {
+                throw WfnError(
+                    "wfn_eng::vulkan::AsyncCompute",
+                    "Constructor",
+                    "Allocate Command Buffers"
+                );
+            }
+
+            frame.graphicsBegin = graphics[0];
+            frame.graphicsEnd = graphics[1];
+        }
+
+        // Profiling needs timestamps on both queue families.
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device.physical(), &properties);
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.physical(), &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.physical(), &familyCount, families.data());
+
+        uint32_t validBits = std::min(
+            families[_graphicsFamily].timestampValidBits,
+            families[_computeFamily].timestampValidBits
+        );
+
+        if (validBits > 0 && properties.limits.timestampPeriod > 0) {
+            VkQueryPoolCreateInfo queryInfo = {};
+            queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryInfo.queryCount = static_cast<uint32_t>(frames) * queriesPerFrame;
+
+            VkQueryPool queries;
+            if (_vk.vkCreateQueryPool(_device, &queryInfo, allocator::callbacks(), &queries) == VK_SUCCESS) {
+                _queries = Handle<VkQueryPool>(_device, queries);
+                _profiling = true;
+                _timestampPeriod = properties.limits.timestampPeriod;
+                _timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+            }
+        }
+
+        _toGraphics.reserve(reservedTransfers);
+        _toCompute.reserve(reservedTransfers);
+        _acquireByCompute.reserve(reservedTransfers);
+    }
+
+    ////
+    // void schedule(Queue, Transfer)
+    //
+    // Queues a transfer for release and acquisition.
+    void AsyncCompute::schedule(Queue from, Transfer transfer) {
+        uint32_t srcFamily = from == Queue::Compute ? _computeFamily : _graphicsFamily;
+        uint32_t dstFamily = from == Queue::Compute ? _graphicsFamily : _computeFamily;
+
+        // Within a single family the semaphore already orders the two
+        // queues; only the acquiring barrier (for its layout transition and
+        // visibility) is recorded.
+        if (srcFamily == dstFamily) {
+            srcFamily = VK_QUEUE_FAMILY_IGNORED;
+            dstFamily = VK_QUEUE_FAMILY_IGNORED;
+        }
+
+        transfer.buffer.srcQueueFamilyIndex = srcFamily;
+        transfer.buffer.dstQueueFamilyIndex = dstFamily;
+        transfer.image.srcQueueFamilyIndex = srcFamily;
+        transfer.image.dstQueueFamilyIndex = dstFamily;
+
+        if (from == Queue::Compute)
+            _toGraphics.push_back(transfer);
+        else
+            _toCompute.push_back(transfer);
+    }
+
+    ////
+    // void release(VkCommandBuffer, const std::vector<Transfer>&)
+    //
+    // Records the releasing half of every transfer.
+    void AsyncCompute::release(VkCommandBuffer commandBuffer, const std::vector<Transfer>& transfers) {
+        if (_graphicsFamily == _computeFamily)
+            return;
+
+        for (Transfer transfer: transfers) {
+            transfer.buffer.dstAccessMask = 0;
+            transfer.image.dstAccessMask = 0;
+
+            _vk.vkCmdPipelineBarrier(
+                commandBuffer,
+                transfer.srcStages,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0,
+                0, nullptr,
+                transfer.isImage ? 0 : 1, &transfer.buffer,
+                transfer.isImage ? 1 : 0, &transfer.image
+            );
+        }
+    }
+
+    ////
+    // VkPipelineStageFlags acquire(VkCommandBuffer, const std::vector<Transfer>&)
+    //
+    // Records the acquiring half of every transfer, returning the stages
+    // that wait on them.
+    VkPipelineStageFlags AsyncCompute::acquire(VkCommandBuffer commandBuffer, const std::vector<Transfer>& transfers) {
+        VkPipelineStageFlags stages = 0;
+
+        for (Transfer transfer: transfers) {
+            transfer.buffer.srcAccessMask = 0;
+            transfer.image.srcAccessMask = 0;
+
+            _vk.vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                transfer.dstStages,
+                0,
+                0, nullptr,
+                transfer.isImage ? 0 : 1, &transfer.buffer,
+                transfer.isImage ? 1 : 0, &transfer.image
+            );
+
+            stages |= transfer.dstStages;
+        }
+
+        return stages;
+    }
+
+    ////
+    // void collect(size_t)
+    //
+    // Reads back the timestamps of a frame slot into the stats.
+    void AsyncCompute::collect(size_t index) {
+        uint64_t timestamps[queriesPerFrame];
+        VkResult result = _vk.vkGetQueryPoolResults(
+            _device,
+            _queries.get(),
+            static_cast<uint32_t>(index) * queriesPerFrame,
+            queriesPerFrame,
+            sizeof(timestamps),
+            timestamps,
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+
+        if (result != VK_SUCCESS)
+            return;
+
+        uint64_t nanos[queriesPerFrame];
+        for (uint32_t i = 0; i < queriesPerFrame; i++)
+            nanos[i] = static_cast<uint64_t>((timestamps[i] & _timestampMask) * _timestampPeriod);
+
+        uint64_t computeBegin = nanos[0], computeEnd = nanos[1];
+        uint64_t graphicsBegin = nanos[2], graphicsEnd = nanos[3];
+
+        _stats.frames++;
+        _stats.computeNanos += computeEnd - computeBegin;
+        _stats.graphicsNanos += graphicsEnd - graphicsBegin;
+        _stats.overlapNanos +=
+            intersection(computeBegin, computeEnd, _lastGraphicsBegin, _lastGraphicsEnd) +
+            intersection(computeBegin, computeEnd, graphicsBegin, graphicsEnd);
+
+        _lastGraphicsBegin = graphicsBegin;
+        _lastGraphicsEnd = graphicsEnd;
+    }
+
+    ////
+    // VkCommandBuffer beginCompute(size_t)
+    //
+    // Starts the compute work of a frame slot, returning the command buffer
+    // to record the dispatches into. The slot's previous graphics submission
+    // must have completed; its previous compute submission is waited on
+    // here.
+    VkCommandBuffer AsyncCompute::beginCompute(size_t index) {
+        Frame& frame = _frames[index];
+
+        // Usually long done, since graphics waited for it; only blocks if
+        // the previous frame's graphics work didn't depend on compute.
+        _compute->wait(frame.computeSubmitted);
+
+        if (frame.profiled)
+            collect(index);
+
+        _vk.vkResetCommandPool(_device, frame.computePool.get(), 0);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (_vk.vkBeginCommandBuffer(frame.compute, &beginInfo) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::AsyncCompute",
+                "beginCompute",
+                "Begin Command Buffer"
+            );
+        }
+
+        if (_profiling) {
+            uint32_t query = static_cast<uint32_t>(index) * queriesPerFrame;
+            _vk.vkCmdResetQueryPool(frame.compute, _queries.get(), query, 2);
+            _vk.vkCmdWriteTimestamp(frame.compute, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queries.get(), query);
+        }
+
+        acquire(frame.compute, _acquireByCompute);
+        return frame.compute;
+    }
+
+    ////
+    // void transfer(Queue, const BufferTransfer&)
+    //
+    // Hands a buffer over to the other queue.
+    void AsyncCompute::transfer(Queue from, const BufferTransfer& buffer) {
+        Transfer transfer = {};
+        transfer.srcStages = buffer.srcStages;
+        transfer.dstStages = buffer.dstStages;
+        transfer.isImage = false;
+
+        transfer.buffer.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        transfer.buffer.srcAccessMask = buffer.srcAccess;
+        transfer.buffer.dstAccessMask = buffer.dstAccess;
+        transfer.buffer.buffer = buffer.buffer;
+        transfer.buffer.offset = buffer.offset;
+        transfer.buffer.size = buffer.size;
+
+        schedule(from, transfer);
+    }
+
+    ////
+    // void transfer(Queue, const ImageTransfer&)
+    //
+    // Hands an image over to the other queue.
+    void AsyncCompute::transfer(Queue from, const ImageTransfer& image) {
+        Transfer transfer = {};
+        transfer.srcStages = image.srcStages;
+        transfer.dstStages = image.dstStages;
+        transfer.isImage = true;
+
+        transfer.image.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        transfer.image.srcAccessMask = image.srcAccess;
+        transfer.image.dstAccessMask = image.dstAccess;
+        transfer.image.oldLayout = image.oldLayout;
+        transfer.image.newLayout = image.newLayout;
+        transfer.image.image = image.image;
+        transfer.image.subresourceRange = image.range;
+
+        schedule(from, transfer);
+    }
+
+    ////
+    // SyncPoint submitCompute(size_t)
+    //
+    // Submits the compute work of a frame slot.
+    SyncPoint AsyncCompute::submitCompute(size_t index) {
+        Frame& frame = _frames[index];
+
+        release(frame.compute, _toGraphics);
+
+        if (_profiling) {
+            uint32_t query = static_cast<uint32_t>(index) * queriesPerFrame;
+            _vk.vkCmdWriteTimestamp(frame.compute, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queries.get(), query + 1);
+        }
+
+        if (_vk.vkEndCommandBuffer(frame.compute) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::AsyncCompute",
+                "submitCompute",
+                "End Command Buffer"
+            );
+        }
+
+        Submission submission;
+        if (!_acquireByCompute.empty()) {
+            VkPipelineStageFlags stages = 0;
+            for (const Transfer& transfer: _acquireByCompute)
+                stages |= transfer.dstStages;
+            submission.wait(_graphicsReleased, stages);
+        }
+        submission.execute(frame.compute);
+
+        _acquireByCompute.clear();
+        _computeDone = _compute->submit(submission);
+        frame.computeSubmitted = _computeDone.value;
+        return _computeDone;
+    }
+
+    ////
+    // void beginGraphics(size_t, Submission&, VkPipelineStageFlags)
+    //
+    // Makes a graphics Submission wait, at the provided stages, for the
+    // frame's compute work, acquiring what compute handed over.
+    void AsyncCompute::beginGraphics(size_t index, Submission& submission, VkPipelineStageFlags stages) {
+        Frame& frame = _frames[index];
+
+        _vk.vkResetCommandPool(_device, frame.graphicsPool.get(), 0);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (_vk.vkBeginCommandBuffer(frame.graphicsBegin, &beginInfo) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::AsyncCompute",
+                "beginGraphics",
+                "Begin Command Buffer"
+            );
+        }
+
+        if (_profiling) {
+            uint32_t query = static_cast<uint32_t>(index) * queriesPerFrame + 2;
+            _vk.vkCmdResetQueryPool(frame.graphicsBegin, _queries.get(), query, 2);
+            _vk.vkCmdWriteTimestamp(frame.graphicsBegin, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queries.get(), query);
+        }
+
+        stages |= acquire(frame.graphicsBegin, _toGraphics);
+        _toGraphics.clear();
+
+        if (_vk.vkEndCommandBuffer(frame.graphicsBegin) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::AsyncCompute",
+                "beginGraphics",
+                "End Command Buffer"
+            );
+        }
+
+        // Graphics that doesn't depend on the frame's compute work doesn't
+        // wait for it at all.
+        if (stages != 0)
+            submission.wait(_computeDone, stages);
+        submission.execute(frame.graphicsBegin);
+    }
+
+    ////
+    // void endGraphics(size_t, Submission&)
+    //
+    // Finishes a graphics Submission, releasing what graphics hands back to
+    // compute. The Submission must be the next one submitted on the
+    // graphics timeline.
+    void AsyncCompute::endGraphics(size_t index, Submission& submission) {
+        Frame& frame = _frames[index];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (_vk.vkBeginCommandBuffer(frame.graphicsEnd, &beginInfo) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::AsyncCompute",
+                "endGraphics",
+                "Begin Command Buffer"
+            );
+        }
+
+        release(frame.graphicsEnd, _toCompute);
+
+        if (_profiling) {
+            uint32_t query = static_cast<uint32_t>(index) * queriesPerFrame + 3;
+            _vk.vkCmdWriteTimestamp(frame.graphicsEnd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queries.get(), query);
+        }
+
+        if (_vk.vkEndCommandBuffer(frame.graphicsEnd) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::AsyncCompute",
+                "endGraphics",
+                "End Command Buffer"
+            );
+        }
+
+        submission.execute(frame.graphicsEnd);
+
+        if (!_toCompute.empty()) {
+            std::swap(_toCompute, _acquireByCompute);
+            _toCompute.clear();
+            _graphicsReleased = _graphics->next();
+        }
+
+        frame.profiled = _profiling;
+    }
+
+    ////
+    // bool profiling()
+    //
+    // Whether both queues support timestamps.
+    bool AsyncCompute::profiling() const { return _profiling; }
+
+    ////
+    // const OverlapStats& stats()
+    //
+    // The GPU time of the profiled frames.
+    const OverlapStats& AsyncCompute::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the average compute and graphics time per frame, and how much
+    // of the compute time overlapped graphics.
+    void AsyncCompute::report(std::ostream& out) const {
+        out << "Async compute ("
+            << (_graphicsFamily != _computeFamily ? "dedicated" : "shared")
+            << " queue family): ";
+
+        if (_stats.frames == 0) {
+            out << "not profiled" << std::endl;
+            return;
+        }
+
+        out << _stats.frames << " frames, compute "
+            << _stats.computeNanos / _stats.frames / 1000 << "us, graphics "
+            << _stats.graphicsNanos / _stats.frames / 1000 << "us, overlapped "
+            << (_stats.computeNanos > 0 ? _stats.overlapNanos * 100 / _stats.computeNanos : 0)
+            << "% of compute" << std::endl;
+    }
+}
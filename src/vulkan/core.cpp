@@ -0,0 +1,49 @@
+#include "../vulkan.hpp"
+
+namespace wfn_eng::vulkan {
+    ////
+    // class Core
+    //
+    // Everything needed to render into a window: the Base, the Device and
+    // the Swapchain, constructed (and destroyed) in the right order.
+
+    ////
+    // Core(sdl::Window&, bool)
+    //
+    // Constructs the core of the renderer for a window, optionally with the
+    // validation layers.
+    Core::Core(sdl::Window& window, bool validation) :
+            _base(window, validation),
+            _device(_base),
+            _swapchain(window, _base, _device) { }
+
+    ////
+    // Core& operator=(Core&&)
+    //
+    // Moves a Core, tearing down the old one in reverse order of
+    // construction.
+    Core& Core::operator=(Core&& other) {
+        _swapchain = std::move(other._swapchain);
+        _device = std::move(other._device);
+        _base = std::move(other._base);
+        return *this;
+    }
+
+    ////
+    // Base& base()
+    //
+    // Provides access to the Base.
+    Base& Core::base() { return _base; }
+
+    ////
+    // Device& device()
+    //
+    // Provides access to the Device.
+    Device& Core::device() { return _device; }
+
+    ////
+    // Swapchain& swapchain()
+    //
+    // Provides access to the Swapchain.
+    Swapchain& Core::swapchain() { return _swapchain; }
+}
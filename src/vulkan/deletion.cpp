@@ -0,0 +1,114 @@
+#include "../vulkan.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+////
+// uint64_t nowNanos()
+//
+// A monotonic timestamp in nanoseconds.
+static uint64_t nowNanos() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count()
+    );
+}
+
+namespace wfn_eng::vulkan {
+    ////
+    // ~DeletionQueue()
+    //
+    // Destroys anything still queued. The owner is expected to have waited
+    // for the GPU first (see flush).
+    DeletionQueue::~DeletionQueue() {
+        flush();
+    }
+
+    ////
+    // void destroy(Entry&)
+    //
+    // Destroys a single entry, updating the latency counters.
+    void DeletionQueue::destroy(Entry& entry) {
+        entry.destroy();
+
+        uint64_t nanos = nowNanos() - entry.retiredNanos;
+        _stats.destroyed++;
+        _stats.totalLatencyNanos += nanos;
+        _stats.maxLatencyNanos = std::max(_stats.maxLatencyNanos, nanos);
+        _stats.maxLatencyCollects = std::max(
+            _stats.maxLatencyCollects,
+            _collects - entry.retiredCollect
+        );
+    }
+
+    ////
+    // void push(uint64_t, Destroy)
+    //
+    // Retires a resource that is in use until the provided submission value
+    // completes. Values must be pushed in non-decreasing order.
+    void DeletionQueue::push(uint64_t value, Destroy destroy) {
+        if (!_entries.empty() && value < _entries.back().value) {
+            throw WfnError(
+                "wfn_eng::vulkan::DeletionQueue",
+                "push",
+                "Value went backwards"
+            );
+        }
+
+        _entries.push_back(Entry { value, _collects, nowNanos(), std::move(destroy) });
+
+        _stats.pushed++;
+        _stats.length = _entries.size();
+        _stats.maxLength = std::max(_stats.maxLength, _stats.length);
+    }
+
+    ////
+    // size_t collect(uint64_t)
+    //
+    // Destroys every resource whose value is at or below the provided
+    // completed value, returning the number destroyed.
+    size_t DeletionQueue::collect(uint64_t completed) {
+        _collects++;
+
+        size_t count = 0;
+        while (!_entries.empty() && _entries.front().value <= completed) {
+            destroy(_entries.front());
+            _entries.pop_front();
+            count++;
+        }
+
+        _stats.length = _entries.size();
+        return count;
+    }
+
+    ////
+    // size_t flush()
+    //
+    // Destroys everything, regardless of value. Only valid once the GPU is
+    // idle (i.e. at shutdown).
+    size_t DeletionQueue::flush() {
+        _collects++;
+
+        size_t count = _entries.size();
+        while (!_entries.empty()) {
+            destroy(_entries.front());
+            _entries.pop_front();
+        }
+
+        _stats.length = 0;
+        return count;
+    }
+
+    ////
+    // size_t size()
+    //
+    // The number of resources waiting to be destroyed.
+    size_t DeletionQueue::size() const { return _entries.size(); }
+
+    ////
+    // const DeletionStats& stats()
+    //
+    // Provides the queue length and latency counters.
+    const DeletionStats& DeletionQueue::stats() const { return _stats; }
+}
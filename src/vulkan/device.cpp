@@ -1,5 +1,7 @@
 #include "../vulkan.hpp"
+#include "../memory.hpp"
 
+#include <cstring>
 #include <set>
 
 ////
@@ -10,15 +12,49 @@ static bool checkExtensionSupport(wfn_eng::vulkan::Base& base, VkPhysicalDevice
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(physical, nullptr, &extensionCount, nullptr);
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    wfn_eng::memory::ScratchScope scratch;
+    wfn_eng::memory::ArenaVector<VkExtensionProperties> availableExtensions(
+        extensionCount,
+        scratch.arena()
+    );
     vkEnumerateDeviceExtensionProperties(physical, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(base.deviceExtensions.begin(), base.deviceExtensions.end());
-    for (const auto& extension: availableExtensions) {
-        requiredExtensions.erase(extension.extensionName);
+    for (const char *required: base.deviceExtensions) {
+        bool found = false;
+        for (const auto& extension: availableExtensions) {
+            if (strcmp(required, extension.extensionName) == 0) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            return false;
     }
 
-    return requiredExtensions.empty();
+    return true;
+}
+
+////
+// bool supportsTimelines(VkPhysicalDevice)
+//
+// Checking if a VkPhysicalDevice implements Vulkan 1.2 with timeline
+// semaphores.
+static bool supportsTimelines(VkPhysicalDevice physical) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+        return false;
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(physical, &features);
+
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
 }
 
 ////
@@ -35,7 +71,7 @@ static bool suitable(wfn_eng::vulkan::Base& base, VkPhysicalDevice physical) {
         swapchainAdequate = swapchainSupport.sufficient();
     }
 
-    return indices.sufficient() && extensionsSupported && swapchainAdequate;
+    return indices.sufficient() && extensionsSupported && swapchainAdequate && supportsTimelines(physical);
 }
 
 namespace wfn_eng::vulkan {
@@ -60,7 +96,8 @@ namespace wfn_eng::vulkan {
             );
         }
 
-        std::vector<VkPhysicalDevice> devices(deviceCount);
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkPhysicalDevice> devices(deviceCount, scratch.arena());
         vkEnumeratePhysicalDevices(base.instance(), &deviceCount, devices.data());
 
         for (const auto& device: devices) {
@@ -87,8 +124,13 @@ namespace wfn_eng::vulkan {
     void Device::makeLogicalDevice(Base& base) {
         wfn_eng::vulkan::util::QueueFamilyIndices indices(base.surface(), physical());
 
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<int> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentationFamily};
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkDeviceQueueCreateInfo> queueCreateInfos(scratch.arena());
+        std::set<int> uniqueQueueFamilies = {
+            indices.graphicsFamily,
+            indices.presentationFamily,
+            indices.computeFamily
+        };
 
         float queuePriority = 1.0f;
         for (int queueFamily: uniqueQueueFamilies) {
@@ -102,8 +144,13 @@ namespace wfn_eng::vulkan {
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
 
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &timelineFeatures;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -113,7 +160,8 @@ namespace wfn_eng::vulkan {
         createInfo.enabledExtensionCount = static_cast<uint32_t>(base.deviceExtensions.size());
         createInfo.ppEnabledExtensionNames = base.deviceExtensions.data();
 
-        if (vkCreateDevice(physical(), &createInfo, nullptr, &_logical) != VK_SUCCESS) {
+        VkDevice logical;
+        if (vkCreateDevice(physical(), &createInfo, allocator::callbacks(), &logical) != VK_SUCCESS) {
             throw WfnError(
                 "wfn_eng::vulkan::Device",
                 "makeLogicalDevice",
@@ -121,19 +169,36 @@ namespace wfn_eng::vulkan {
             );
         }
 
+        _logical = Handle<VkDevice>(logical);
+        dispatch::loadDevice(logical);
+        _table.load(base.instance(), logical);
+        _graphicsFamily = static_cast<uint32_t>(indices.graphicsFamily);
+        _presentationFamily = static_cast<uint32_t>(indices.presentationFamily);
+        _computeFamily = static_cast<uint32_t>(indices.computeFamily);
+
         vkGetDeviceQueue(
-            logical(),
+            logical,
             indices.graphicsFamily,
             0,
             &_graphicsQueue
         );
 
         vkGetDeviceQueue(
-            logical(),
+            logical,
             indices.presentationFamily,
             0,
             &_presentationQueue
         );
+
+        vkGetDeviceQueue(
+            logical,
+            indices.computeFamily,
+            0,
+            &_computeQueue
+        );
+
+        _graphicsTimeline = Timeline(logical, _graphicsQueue, _table);
+        _computeTimeline = Timeline(logical, _computeQueue, _table);
     }
 
     ////
@@ -146,34 +211,96 @@ namespace wfn_eng::vulkan {
     }
 
     ////
-    // ~Device()
+    // Device& operator=(Device&&)
     //
-    // Destroying the Device.
-    Device::~Device() {
-        vkDestroyDevice(logical(), nullptr);
+    // Moves a Device, destroying the old timelines before the VkDevice they
+    // belong to.
+    Device& Device::operator=(Device&& other) {
+        _computeTimeline = std::move(other._computeTimeline);
+        _graphicsTimeline = std::move(other._graphicsTimeline);
+        _logical = std::move(other._logical);
+        _physical = other._physical;
+        _graphicsQueue = other._graphicsQueue;
+        _presentationQueue = other._presentationQueue;
+        _computeQueue = other._computeQueue;
+        _graphicsFamily = other._graphicsFamily;
+        _presentationFamily = other._presentationFamily;
+        _computeFamily = other._computeFamily;
+        _table = other._table;
+        return *this;
     }
 
     ////
     // VkPhysicalDevice physical()
     //
-    // Getting the reference to the VkPhysicalDevice.
-    VkPhysicalDevice& Device::physical() { return _physical; }
+    // Getting the VkPhysicalDevice.
+    VkPhysicalDevice Device::physical() const { return _physical; }
 
     ////
     // VkDevice logical()
     //
-    // Getting the reference to the VkDevice.
-    VkDevice& Device::logical() { return _logical; }
+    // Getting the VkDevice.
+    VkDevice Device::logical() const { return _logical.get(); }
 
     ////
     // VkQueue graphicsQueue()
     //
     // Getting the graphics queue.
-    VkQueue& Device::graphicsQueue() { return _graphicsQueue; }
+    VkQueue Device::graphicsQueue() const { return _graphicsQueue; }
 
     ////
     // VkQueue presentationQueue()
     //
     // Getting the presentation queue.
-    VkQueue& Device::presentationQueue() { return _presentationQueue; }
+    VkQueue Device::presentationQueue() const { return _presentationQueue; }
+
+    ////
+    // VkQueue computeQueue()
+    //
+    // Getting the compute queue. Is the graphics queue when the device has
+    // no dedicated compute family.
+    VkQueue Device::computeQueue() const { return _computeQueue; }
+
+    ////
+    // uint32_t graphicsFamily()
+    //
+    // Getting the queue family index of the graphics queue.
+    uint32_t Device::graphicsFamily() const { return _graphicsFamily; }
+
+    ////
+    // uint32_t presentationFamily()
+    //
+    // Getting the queue family index of the presentation queue.
+    uint32_t Device::presentationFamily() const { return _presentationFamily; }
+
+    ////
+    // uint32_t computeFamily()
+    //
+    // Getting the queue family index of the compute queue.
+    uint32_t Device::computeFamily() const { return _computeFamily; }
+
+    ////
+    // bool asyncCompute()
+    //
+    // Whether compute work runs on its own queue family, and so can overlap
+    // with graphics work.
+    bool Device::asyncCompute() const { return _computeFamily != _graphicsFamily; }
+
+    ////
+    // const DeviceTable& table()
+    //
+    // The device functions loaded for the VkDevice.
+    const DeviceTable& Device::table() const { return _table; }
+
+    ////
+    // Timeline& graphicsTimeline()
+    //
+    // The timeline of the graphics queue.
+    Timeline& Device::graphicsTimeline() { return _graphicsTimeline; }
+
+    ////
+    // Timeline& computeTimeline()
+    //
+    // The timeline of the compute queue.
+    Timeline& Device::computeTimeline() { return _computeTimeline; }
 }
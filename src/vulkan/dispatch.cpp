@@ -0,0 +1,123 @@
+#include "../vulkan.hpp"
+
+#include <SDL_vulkan.h>
+
+#ifdef WFN_ENG_VULKAN_DYNAMIC
+#define WFN_ENG_VULKAN_DEFINE(NAME) PFN_##NAME NAME = nullptr;
+PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = nullptr;
+WFN_ENG_VULKAN_GLOBAL_FUNCTIONS(WFN_ENG_VULKAN_DEFINE)
+WFN_ENG_VULKAN_INSTANCE_FUNCTIONS(WFN_ENG_VULKAN_DEFINE)
+WFN_ENG_VULKAN_DEVICE_FUNCTIONS(WFN_ENG_VULKAN_DEFINE)
+#undef WFN_ENG_VULKAN_DEFINE
+#endif
+
+static wfn_eng::vulkan::dispatch::Mode currentMode = wfn_eng::vulkan::dispatch::Mode::Device;
+
+namespace wfn_eng::vulkan::dispatch {
+    ////
+    // void setMode(Mode)
+    //
+    // Chooses how device tables are loaded. Must be called before the
+    // Device is constructed.
+    void setMode(Mode mode) { currentMode = mode; }
+
+    ////
+    // Mode mode()
+    //
+    // How device tables are loaded.
+    Mode mode() { return currentMode; }
+
+    ////
+    // void loadGlobal()
+    //
+    // Fetches vkGetInstanceProcAddr from the library SDL loaded, then the
+    // global functions. Needs an SDL window to exist. Does nothing unless
+    // built with WFN_ENG_VULKAN_DYNAMIC.
+    void loadGlobal() {
+#ifdef WFN_ENG_VULKAN_DYNAMIC
+        vkGetInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(
+            SDL_Vulkan_GetVkGetInstanceProcAddr()
+        );
+
+        if (vkGetInstanceProcAddr == nullptr) {
+            throw WfnError(
+                "wfn_eng::vulkan::dispatch",
+                "loadGlobal",
+                "Load Vulkan Library"
+            );
+        }
+
+#define WFN_ENG_VULKAN_LOAD(NAME) \
+        NAME = reinterpret_cast<PFN_##NAME>(vkGetInstanceProcAddr(VK_NULL_HANDLE, #NAME));
+        WFN_ENG_VULKAN_GLOBAL_FUNCTIONS(WFN_ENG_VULKAN_LOAD)
+#undef WFN_ENG_VULKAN_LOAD
+#endif
+    }
+
+    ////
+    // void loadInstance(VkInstance)
+    //
+    // Loads the instance functions. Does nothing unless built with
+    // WFN_ENG_VULKAN_DYNAMIC.
+    void loadInstance(VkInstance instance) {
+#ifdef WFN_ENG_VULKAN_DYNAMIC
+#define WFN_ENG_VULKAN_LOAD(NAME) \
+        NAME = reinterpret_cast<PFN_##NAME>(vkGetInstanceProcAddr(instance, #NAME));
+        WFN_ENG_VULKAN_INSTANCE_FUNCTIONS(WFN_ENG_VULKAN_LOAD)
+#undef WFN_ENG_VULKAN_LOAD
+#else
+        (void)instance;
+#endif
+    }
+
+    ////
+    // void loadDevice(VkDevice)
+    //
+    // Loads the device functions into the global pointers. Does nothing
+    // unless built with WFN_ENG_VULKAN_DYNAMIC.
+    void loadDevice(VkDevice device) {
+#ifdef WFN_ENG_VULKAN_DYNAMIC
+#define WFN_ENG_VULKAN_LOAD(NAME) \
+        NAME = reinterpret_cast<PFN_##NAME>(vkGetDeviceProcAddr(device, #NAME));
+        WFN_ENG_VULKAN_DEVICE_FUNCTIONS(WFN_ENG_VULKAN_LOAD)
+#undef WFN_ENG_VULKAN_LOAD
+#else
+        (void)device;
+#endif
+    }
+}
+
+namespace wfn_eng::vulkan {
+    ////
+    // struct DeviceTable
+    //
+    // A pointer to every device function, loaded for a single VkDevice.
+
+    ////
+    // void load(VkInstance, VkDevice)
+    //
+    // Loads every pointer for the provided device, either from the device
+    // itself or from the instance (whose pointers are the loader's
+    // trampolines), depending on the dispatch::Mode.
+    void DeviceTable::load(VkInstance instance, VkDevice device) {
+        if (dispatch::mode() == dispatch::Mode::Device) {
+#define WFN_ENG_VULKAN_LOAD(NAME) \
+            NAME = reinterpret_cast<PFN_##NAME>(vkGetDeviceProcAddr(device, #NAME));
+            WFN_ENG_VULKAN_DEVICE_FUNCTIONS(WFN_ENG_VULKAN_LOAD)
+#undef WFN_ENG_VULKAN_LOAD
+        } else {
+#define WFN_ENG_VULKAN_LOAD(NAME) \
+            NAME = reinterpret_cast<PFN_##NAME>(vkGetInstanceProcAddr(instance, #NAME));
+            WFN_ENG_VULKAN_DEVICE_FUNCTIONS(WFN_ENG_VULKAN_LOAD)
+#undef WFN_ENG_VULKAN_LOAD
+        }
+
+        if (vkQueueSubmit == nullptr || vkCmdDraw == nullptr) {
+            throw WfnError(
+                "wfn_eng::vulkan::DeviceTable",
+                "load",
+                "Load Device Functions"
+            );
+        }
+    }
+}
@@ -0,0 +1,212 @@
+#include "../vulkan.hpp"
+
+#include <algorithm>
+
+namespace wfn_eng::vulkan {
+    ////
+    // class LayoutCache
+    //
+    // Builds pipeline layouts from the reflection of their shaders, keyed
+    // by content.
+
+    size_t LayoutCache::SetKeyHash::operator()(const std::vector<shader::Binding>& bindings) const {
+        uint64_t h = util::hashSeed;
+        for (const shader::Binding& binding : bindings) {
+            h = util::mix(h, (uint64_t)binding.binding << 32 | binding.type);
+            h = util::mix(h, (uint64_t)binding.count << 32 | binding.stages);
+        }
+        return static_cast<size_t>(h);
+    }
+
+    bool LayoutCache::LayoutKey::operator==(const LayoutKey& o) const {
+        if (setCount != o.setCount ||
+            pushConstants.stageFlags != o.pushConstants.stageFlags ||
+            pushConstants.offset != o.pushConstants.offset ||
+            pushConstants.size != o.pushConstants.size) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < setCount; i++) {
+            if (sets[i] != o.sets[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    size_t LayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+        uint64_t h = util::hashSeed;
+        h = util::mix(h, key.setCount);
+        for (uint32_t i = 0; i < key.setCount; i++)
+            h = util::mix(h, (uint64_t)key.sets[i]);
+        h = util::mix(h, (uint64_t)key.pushConstants.stageFlags << 32 | key.pushConstants.offset);
+        h = util::mix(h, key.pushConstants.size);
+        return static_cast<size_t>(h);
+    }
+
+    ////
+    // LayoutCache(Device&)
+    //
+    // Constructs an empty cache.
+    LayoutCache::LayoutCache(Device& device)
+            : _device(device.logical())
+            , _vk(device.table()) { }
+
+    ////
+    // VkDescriptorSetLayout setLayout(const std::vector<shader::Binding>&)
+    //
+    // The layout of one descriptor set (the bindings' set numbers are
+    // ignored).
+    VkDescriptorSetLayout LayoutCache::setLayout(const std::vector<shader::Binding>& bindings) {
+        std::vector<shader::Binding> key = bindings;
+        for (shader::Binding& binding : key)
+            binding.set = 0;
+        std::sort(key.begin(), key.end(), [](const shader::Binding& a, const shader::Binding& b) {
+            return a.binding < b.binding;
+        });
+
+        auto it = _sets.find(key);
+        if (it != _sets.end()) {
+            _stats.setHits++;
+            return it->second.get();
+        }
+        _stats.setMisses++;
+
+        std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+        layoutBindings.reserve(key.size());
+        for (const shader::Binding& binding : key) {
+            VkDescriptorSetLayoutBinding layoutBinding = {};
+            layoutBinding.binding = binding.binding;
+            layoutBinding.descriptorType = binding.type;
+            layoutBinding.descriptorCount = binding.count;
+            layoutBinding.stageFlags = binding.stages;
+            layoutBindings.push_back(layoutBinding);
+        }
+
+        VkDescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+        createInfo.pBindings = layoutBindings.data();
+
+        VkDescriptorSetLayout layout;
+        if (_vk.vkCreateDescriptorSetLayout(_device, &createInfo, allocator::callbacks(), &layout) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::LayoutCache",
+                "setLayout",
+                "Create Descriptor Set Layout"
+            );
+        }
+
+        _sets.emplace(std::move(key), Handle<VkDescriptorSetLayout>(_device, layout));
+        return layout;
+    }
+
+    ////
+    // ReflectedLayout layout(std::initializer_list<const shader::Reflection *>)
+    //
+    // The layout of a pipeline made of the provided shader stages. A binding
+    // declared by several stages must have the same type and count in each;
+    // the push constant blocks are merged into one range.
+    ReflectedLayout LayoutCache::layout(std::initializer_list<const shader::Reflection *> stages) {
+        std::vector<shader::Binding> sets[maxDescriptorSets];
+
+        ReflectedLayout result;
+        uint32_t pushEnd = 0;
+        result.pushConstants.offset = ~0u;
+
+        for (const shader::Reflection *stage : stages) {
+            for (const shader::Binding& binding : stage->bindings) {
+                if (binding.set >= maxDescriptorSets) {
+                    throw WfnError(
+                        "wfn_eng::vulkan::LayoutCache",
+                        "layout",
+                        "Fit Descriptor Sets"
+                    );
+                }
+
+                std::vector<shader::Binding>& set = sets[binding.set];
+                auto it = std::find_if(set.begin(), set.end(), [&](const shader::Binding& b) {
+                    return b.binding == binding.binding;
+                });
+
+                if (it == set.end()) {
+                    set.push_back(binding);
+                } else if (it->type != binding.type || it->count != binding.count) {
+                    throw WfnError(
+                        "wfn_eng::vulkan::LayoutCache",
+                        "layout",
+                        "Merge Shader Bindings"
+                    );
+                } else {
+                    it->stages |= binding.stages;
+                }
+
+                result.setCount = std::max(result.setCount, binding.set + 1);
+            }
+
+            if (stage->pushConstantSize > 0) {
+                result.pushConstants.stageFlags |= stage->stage;
+                result.pushConstants.offset = std::min(result.pushConstants.offset, stage->pushConstantOffset);
+                pushEnd = std::max(pushEnd, stage->pushConstantOffset + stage->pushConstantSize);
+            }
+        }
+
+        if (pushEnd > 0)
+            result.pushConstants.size = pushEnd - result.pushConstants.offset;
+        else
+            result.pushConstants = VkPushConstantRange {};
+
+        // Unused sets below the last one still need a (empty) layout.
+        for (uint32_t i = 0; i < result.setCount; i++)
+            result.sets[i] = setLayout(sets[i]);
+
+        LayoutKey key = {};
+        key.setCount = result.setCount;
+        std::copy(result.sets, result.sets + result.setCount, key.sets);
+        key.pushConstants = result.pushConstants;
+
+        auto it = _layouts.find(key);
+        if (it != _layouts.end()) {
+            _stats.layoutHits++;
+            result.layout = it->second.get();
+            return result;
+        }
+        _stats.layoutMisses++;
+
+        VkPipelineLayoutCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        createInfo.setLayoutCount = result.setCount;
+        createInfo.pSetLayouts = result.sets;
+        createInfo.pushConstantRangeCount = pushEnd > 0 ? 1 : 0;
+        createInfo.pPushConstantRanges = pushEnd > 0 ? &result.pushConstants : nullptr;
+
+        VkPipelineLayout layout;
+        if (_vk.vkCreatePipelineLayout(_device, &createInfo, allocator::callbacks(), &layout) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::LayoutCache",
+                "layout",
+                "Create Pipeline Layout"
+            );
+        }
+
+        _layouts.emplace(key, Handle<VkPipelineLayout>(_device, layout));
+        result.layout = layout;
+        return result;
+    }
+
+    ////
+    // const LayoutStats& stats()
+    //
+    // The counters of the cache.
+    const LayoutStats& LayoutCache::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters.
+    void LayoutCache::report(std::ostream& out) const {
+        out << "Layouts: " << _sets.size() << " set layouts ("
+            << _stats.setHits << " hits), " << _layouts.size() << " pipeline layouts ("
+            << _stats.layoutHits << " hits)" << std::endl;
+    }
+}
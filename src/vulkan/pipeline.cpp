@@ -0,0 +1,581 @@
+#include "../vulkan.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace wfn_eng::vulkan {
+    ////
+    // uint64_t handleBits(T)
+    //
+    // The bits of a handle, whether it's a pointer or a 64-bit integer.
+    template <typename T>
+    static uint64_t handleBits(T handle) {
+        return (uint64_t)handle;
+    }
+
+    ////
+    // class Specialization
+    //
+    // The VkSpecializationInfo turning on the specialized features of a
+    // mask.
+
+    ////
+    // Specialization(uint32_t)
+    //
+    // Sets constant_id N to true for every bit N of the mask.
+    shader::Specialization::Specialization(uint32_t mask) {
+        uint32_t count = 0;
+        for (uint32_t bit = 0; bit < 32; bit++) {
+            if ((mask & (1u << bit)) == 0)
+                continue;
+
+            _values[count] = VK_TRUE;
+            _entries[count].constantID = bit;
+            _entries[count].offset = count * sizeof(VkBool32);
+            _entries[count].size = sizeof(VkBool32);
+            count++;
+        }
+
+        _info.mapEntryCount = count;
+        _info.pMapEntries = _entries;
+        _info.dataSize = count * sizeof(VkBool32);
+        _info.pData = _values;
+    }
+
+    ////
+    // const VkSpecializationInfo *info()
+    //
+    // The info to hand to a shader stage, or nullptr if no feature is on.
+    const VkSpecializationInfo *shader::Specialization::info() const {
+        return _info.mapEntryCount > 0 ? &_info : nullptr;
+    }
+
+    ////
+    // struct PipelineKey
+    //
+    // Everything a graphics pipeline is built from.
+
+    ////
+    // uint64_t hash()
+    //
+    // Hashes every field.
+    uint64_t PipelineKey::hash() const {
+        uint64_t h = util::hashSeed;
+        h = util::mix(h, handleBits(vertex));
+        h = util::mix(h, handleBits(fragment));
+        h = util::mix(h, (uint64_t)vertexFeatures << 32 | fragmentFeatures);
+        h = util::mix(h, (uint64_t)vertexLayout.stride << 32 | vertexLayout.count);
+        for (uint32_t i = 0; i < vertexLayout.count; i++) {
+            const VkVertexInputAttributeDescription& attribute = vertexLayout.attributes[i];
+            h = util::mix(h, (uint64_t)attribute.location << 48 | (uint64_t)attribute.format << 32 | attribute.offset);
+        }
+        h = util::mix(h, handleBits(layout));
+        h = util::mix(h, handleBits(renderPass));
+        h = util::mix(h, subpass);
+        h = util::mix(h, (uint64_t)topology | (uint64_t)polygonMode << 8 | (uint64_t)cullMode << 16 |
+                   (uint64_t)frontFace << 24 | (uint64_t)samples << 32 | (uint64_t)blend << 40 |
+                   (uint64_t)depthTest << 48 | (uint64_t)depthWrite << 49 | (uint64_t)depthCompare << 52);
+        return h;
+    }
+
+    bool PipelineKey::operator==(const PipelineKey& o) const {
+        return vertex == o.vertex &&
+               fragment == o.fragment &&
+               vertexFeatures == o.vertexFeatures &&
+               fragmentFeatures == o.fragmentFeatures &&
+               vertexLayout == o.vertexLayout &&
+               layout == o.layout &&
+               renderPass == o.renderPass &&
+               subpass == o.subpass &&
+               topology == o.topology &&
+               polygonMode == o.polygonMode &&
+               cullMode == o.cullMode &&
+               frontFace == o.frontFace &&
+               samples == o.samples &&
+               blend == o.blend &&
+               depthTest == o.depthTest &&
+               depthWrite == o.depthWrite &&
+               depthCompare == o.depthCompare;
+    }
+
+    ////
+    // class PipelineManager
+    //
+    // Owns every graphics pipeline, keyed by PipelineKey.
+
+    ////
+    // PipelineManager(Device&, const std::string&, size_t)
+    //
+    // Constructs a manager compiling on the provided number of threads (0
+    // for one per hardware thread, minus the calling one). A non-empty path
+    // names the file the pipeline cache is read from now and written to on
+    // destruction.
+    PipelineManager::PipelineManager(Device& device, const std::string& cachePath, size_t threads)
+            : _device(device.logical())
+            , _physical(device.physical())
+            , _vk(device.table())
+            , _cachePath(cachePath)
+            , _compiling(0)
+            , _quitting(false) {
+        makeCache();
+
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+        for (size_t i = 0; i < threads; i++)
+            _workers.emplace_back(&PipelineManager::workLoop, this);
+    }
+
+    ////
+    // ~PipelineManager()
+    //
+    // Drops the compiles that haven't started, waits for the others, saves
+    // the cache and destroys every pipeline. No pipeline may be in use on
+    // the GPU.
+    PipelineManager::~PipelineManager() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quitting = true;
+            _pending.clear();
+        }
+        _wake.notify_all();
+
+        for (auto& worker : _workers)
+            worker.join();
+
+        save();
+
+        for (Entry& entry : _entries) {
+            VkPipeline pipeline = entry.pipeline.load();
+            if (pipeline != VK_NULL_HANDLE)
+                _vk.vkDestroyPipeline(_device, pipeline, allocator::callbacks());
+        }
+    }
+
+    ////
+    // void makeCache()
+    //
+    // Creates the pipeline cache, seeded from the cache file when it was
+    // written by the same driver and GPU. The driver checks the header too,
+    // but some drivers crash on data from another GPU rather than ignoring
+    // it.
+    void PipelineManager::makeCache() {
+        std::vector<uint8_t> data;
+
+        FILE *file = _cachePath.empty() ? nullptr : std::fopen(_cachePath.c_str(), "rb");
+        if (file != nullptr) {
+            std::fseek(file, 0, SEEK_END);
+            long size = std::ftell(file);
+            std::fseek(file, 0, SEEK_SET);
+
+            if (size > 0) {
+                data.resize(size);
+                if (std::fread(data.data(), 1, data.size(), file) != data.size())
+                    data.clear();
+            }
+
+            std::fclose(file);
+        }
+
+        // The header: length, version, vendor ID, device ID, cache UUID.
+        const size_t headerSize = 16 + VK_UUID_SIZE;
+        if (data.size() >= headerSize) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(_physical, &properties);
+
+            uint32_t header[4];
+            std::memcpy(header, data.data(), sizeof(header));
+
+            if (header[0] < headerSize ||
+                header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+                header[2] != properties.vendorID ||
+                header[3] != properties.deviceID ||
+                std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+                data.clear();
+            }
+        } else {
+            data.clear();
+        }
+
+        VkPipelineCacheCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        VkPipelineCache cache;
+        if (_vk.vkCreatePipelineCache(_device, &createInfo, allocator::callbacks(), &cache) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::PipelineManager",
+                "makeCache",
+                "Create Pipeline Cache"
+            );
+        }
+
+        _cache = Handle<VkPipelineCache>(_device, cache);
+    }
+
+    ////
+    // void workLoop()
+    //
+    // The body of a worker thread.
+    void PipelineManager::workLoop() {
+        while (true) {
+            Entry *entry;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _quitting || !_pending.empty(); });
+                if (_quitting)
+                    return;
+
+                entry = _pending.front();
+                _pending.pop_front();
+                _compiling++;
+            }
+
+            // build may have compiled the same key meanwhile; keep its copy.
+            VkPipeline pipeline = compile(entry->key);
+            VkPipeline expected = VK_NULL_HANDLE;
+            if (pipeline == VK_NULL_HANDLE)
+                entry->failed.store(true, std::memory_order_release);
+            else if (!entry->pipeline.compare_exchange_strong(expected, pipeline, std::memory_order_acq_rel))
+                _vk.vkDestroyPipeline(_device, pipeline, allocator::callbacks());
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _compiling--;
+        }
+    }
+
+    ////
+    // VkPipeline compile(const PipelineKey&)
+    //
+    // Builds a pipeline, returning VK_NULL_HANDLE on failure. Safe to call
+    // from any thread: the cache is internally synchronized.
+    VkPipeline PipelineManager::compile(const PipelineKey& key) {
+        auto start = std::chrono::steady_clock::now();
+
+        shader::Specialization vertexSpecialization(key.vertexFeatures);
+        shader::Specialization fragmentSpecialization(key.fragmentFeatures);
+
+        VkPipelineShaderStageCreateInfo stages[2] = {};
+        stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stages[0].module = key.vertex;
+        stages[0].pName = "main";
+        stages[0].pSpecializationInfo = vertexSpecialization.info();
+        stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stages[1].module = key.fragment;
+        stages[1].pName = "main";
+        stages[1].pSpecializationInfo = fragmentSpecialization.info();
+
+        VkVertexInputBindingDescription vertexBinding = {};
+        vertexBinding.binding = 0;
+        vertexBinding.stride = key.vertexLayout.stride;
+        vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkPipelineVertexInputStateCreateInfo vertexInput = {};
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        if (key.vertexLayout.count > 0) {
+            vertexInput.vertexBindingDescriptionCount = 1;
+            vertexInput.pVertexBindingDescriptions = &vertexBinding;
+            vertexInput.vertexAttributeDescriptionCount = key.vertexLayout.count;
+            vertexInput.pVertexAttributeDescriptions = key.vertexLayout.attributes;
+        }
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = key.topology;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkPipelineViewportStateCreateInfo viewport = {};
+        viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewport.viewportCount = 1;
+        viewport.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer = {};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.polygonMode = key.polygonMode;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = key.cullMode;
+        rasterizer.frontFace = key.frontFace;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        VkPipelineMultisampleStateCreateInfo multisampling = {};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = key.samples;
+        multisampling.minSampleShading = 1.0f;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = key.depthTest ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp = key.depthCompare;
+
+        VkPipelineColorBlendAttachmentState blend = {};
+        blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        blend.blendEnable = key.blend == Blend::Opaque ? VK_FALSE : VK_TRUE;
+        blend.srcColorBlendFactor = key.blend == Blend::Opaque ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA;
+        blend.dstColorBlendFactor = key.blend == Blend::Alpha ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA
+                                  : key.blend == Blend::Additive ? VK_BLEND_FACTOR_ONE
+                                  : VK_BLEND_FACTOR_ZERO;
+        blend.colorBlendOp = VK_BLEND_OP_ADD;
+        blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        blend.dstAlphaBlendFactor = key.blend == Blend::Opaque ? VK_BLEND_FACTOR_ZERO : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        blend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending = {};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &blend;
+
+        VkDynamicState dynamicStates[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicState = {};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
+
+        VkGraphicsPipelineCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        createInfo.stageCount = 2;
+        createInfo.pStages = stages;
+        createInfo.pVertexInputState = &vertexInput;
+        createInfo.pInputAssemblyState = &inputAssembly;
+        createInfo.pViewportState = &viewport;
+        createInfo.pRasterizationState = &rasterizer;
+        createInfo.pMultisampleState = &multisampling;
+        createInfo.pDepthStencilState = &depthStencil;
+        createInfo.pColorBlendState = &colorBlending;
+        createInfo.pDynamicState = &dynamicState;
+        createInfo.layout = key.layout;
+        createInfo.renderPass = key.renderPass;
+        createInfo.subpass = key.subpass;
+        createInfo.basePipelineHandle = VK_NULL_HANDLE;
+        createInfo.basePipelineIndex = -1;
+
+        VkPipeline pipeline;
+        if (_vk.vkCreateGraphicsPipelines(_device, _cache.get(), 1, &createInfo, allocator::callbacks(), &pipeline) != VK_SUCCESS) {
+            _stats.failed++;
+            return VK_NULL_HANDLE;
+        }
+
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start
+        ).count();
+
+        _stats.compiled++;
+        _stats.compileNanos += nanos;
+
+        uint64_t worst = _stats.maxCompileNanos.load();
+        while (nanos > worst && !_stats.maxCompileNanos.compare_exchange_weak(worst, nanos));
+
+        return pipeline;
+    }
+
+    ////
+    // PipelineId add(const PipelineKey&, PipelineId, bool&)
+    //
+    // Finds or adds the entry of a key, reporting whether it was new.
+    PipelineId PipelineManager::add(const PipelineKey& key, PipelineId fallback, bool& added) {
+        _stats.requests++;
+
+        auto it = _ids.find(key);
+        if (it != _ids.end()) {
+            _stats.deduplicated++;
+            added = false;
+            return it->second;
+        }
+
+        PipelineId id = static_cast<PipelineId>(_entries.size());
+        _entries.emplace_back();
+        _entries.back().key = key;
+        _entries.back().fallback = fallback;
+        _ids.emplace(key, id);
+
+        added = true;
+        return id;
+    }
+
+    ////
+    // PipelineId request(const PipelineKey&, PipelineId)
+    //
+    // Returns the pipeline of a key, queueing its compile if it's new.
+    // Until it's ready, get returns the provided fallback instead.
+    PipelineId PipelineManager::request(const PipelineKey& key, PipelineId fallback) {
+        bool added;
+        PipelineId id = add(key, fallback, added);
+
+        if (added) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _pending.push_back(&_entries[id]);
+            }
+            _wake.notify_one();
+        }
+
+        return id;
+    }
+
+    ////
+    // PipelineId build(const PipelineKey&)
+    //
+    // Returns the pipeline of a key, compiling it on the calling thread if
+    // it's new. Throws if the compile fails.
+    PipelineId PipelineManager::build(const PipelineKey& key) {
+        bool added;
+        PipelineId id = add(key, noPipeline, added);
+        Entry& entry = _entries[id];
+
+        if (added) {
+            VkPipeline pipeline = compile(key);
+            if (pipeline == VK_NULL_HANDLE)
+                entry.failed.store(true);
+            else
+                entry.pipeline.store(pipeline);
+        }
+
+        // The key may also be compiling on a worker already; rather than
+        // waiting for it, compile another copy and drop whichever loses.
+        if (!added && entry.pipeline.load(std::memory_order_acquire) == VK_NULL_HANDLE && !entry.failed.load()) {
+            VkPipeline pipeline = compile(key);
+            VkPipeline expected = VK_NULL_HANDLE;
+            if (pipeline != VK_NULL_HANDLE && !entry.pipeline.compare_exchange_strong(expected, pipeline))
+                _vk.vkDestroyPipeline(_device, pipeline, allocator::callbacks());
+        }
+
+        if (entry.pipeline.load(std::memory_order_acquire) == VK_NULL_HANDLE) {
+            throw WfnError(
+                "wfn_eng::vulkan::PipelineManager",
+                "build",
+                "Create Graphics Pipeline"
+            );
+        }
+
+        return id;
+    }
+
+    ////
+    // VkPipeline get(PipelineId)
+    //
+    // The pipeline if it's ready, otherwise the first ready one along its
+    // fallbacks, otherwise VK_NULL_HANDLE. Never blocks.
+    VkPipeline PipelineManager::get(PipelineId id) {
+        for (PipelineId at = id; at != noPipeline && at < _entries.size(); at = _entries[at].fallback) {
+            VkPipeline pipeline = _entries[at].pipeline.load(std::memory_order_acquire);
+            if (pipeline != VK_NULL_HANDLE) {
+                if (at != id)
+                    _stats.fallbackUses++;
+                return pipeline;
+            }
+        }
+
+        if (id != noPipeline)
+            _stats.fallbackUses++;
+        return VK_NULL_HANDLE;
+    }
+
+    ////
+    // bool ready(PipelineId)
+    //
+    // Whether the pipeline itself is ready.
+    bool PipelineManager::ready(PipelineId id) const {
+        return id < _entries.size() &&
+               _entries[id].pipeline.load(std::memory_order_acquire) != VK_NULL_HANDLE;
+    }
+
+    ////
+    // bool failed(PipelineId)
+    //
+    // Whether the pipeline failed to compile.
+    bool PipelineManager::failed(PipelineId id) const {
+        return id < _entries.size() && _entries[id].failed.load(std::memory_order_acquire);
+    }
+
+    ////
+    // Handle<VkPipeline> retire(PipelineId)
+    //
+    // Gives up a ready (or failed) pipeline that is being replaced. The
+    // entry stays, marked failed, so that ids remain stable and anything
+    // falling back to it falls through to its own fallback.
+    Handle<VkPipeline> PipelineManager::retire(PipelineId id) {
+        if (id >= _entries.size())
+            return Handle<VkPipeline>();
+
+        Entry& entry = _entries[id];
+
+        auto it = _ids.find(entry.key);
+        if (it != _ids.end() && it->second == id)
+            _ids.erase(it);
+
+        entry.failed.store(true, std::memory_order_release);
+        return Handle<VkPipeline>(_device, entry.pipeline.exchange(VK_NULL_HANDLE));
+    }
+
+    ////
+    // size_t pending()
+    //
+    // The number of compiles queued or running.
+    size_t PipelineManager::pending() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _pending.size() + _compiling;
+    }
+
+    ////
+    // void save()
+    //
+    // Writes the pipeline cache to its file, if it has one.
+    void PipelineManager::save() {
+        if (_cachePath.empty() || !_cache)
+            return;
+
+        size_t size = 0;
+        if (_vk.vkGetPipelineCacheData(_device, _cache.get(), &size, nullptr) != VK_SUCCESS || size == 0)
+            return;
+
+        std::vector<uint8_t> data(size);
+        if (_vk.vkGetPipelineCacheData(_device, _cache.get(), &size, data.data()) != VK_SUCCESS)
+            return;
+
+        FILE *file = std::fopen(_cachePath.c_str(), "wb");
+        if (file == nullptr)
+            return;
+
+        std::fwrite(data.data(), 1, size, file);
+        std::fclose(file);
+    }
+
+    ////
+    // const PipelineStats& stats()
+    //
+    // The counters of the manager.
+    const PipelineStats& PipelineManager::stats() const { return _stats; }
+
+    ////
+    // void report(std::ostream&)
+    //
+    // Writes the counters along with the average and worst compile time.
+    void PipelineManager::report(std::ostream& out) const {
+        uint64_t compiled = _stats.compiled.load();
+
+        out << "Pipelines: " << _stats.requests << " requests, "
+            << _stats.deduplicated << " deduplicated, "
+            << compiled << " compiled, "
+            << _stats.failed.load() << " failed, "
+            << _stats.fallbackUses << " fallback uses";
+
+        if (compiled > 0) {
+            out << ", compile avg " << _stats.compileNanos.load() / compiled / 1000 << "us"
+                << " / max " << _stats.maxCompileNanos.load() / 1000 << "us";
+        }
+
+        out << std::endl;
+    }
+}
@@ -0,0 +1,568 @@
+#include "../vulkan.hpp"
+
+#include <algorithm>
+
+namespace wfn_eng::vulkan::shader {
+    // The parts of the SPIR-V spec the reflection needs.
+    namespace spv {
+        const uint32_t magic = 0x07230203;
+
+        enum Op : uint32_t {
+            OpEntryPoint       = 15,
+            OpTypeBool         = 20,
+            OpTypeInt          = 21,
+            OpTypeFloat        = 22,
+            OpTypeVector       = 23,
+            OpTypeMatrix       = 24,
+            OpTypeImage        = 25,
+            OpTypeSampler      = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray        = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct       = 30,
+            OpTypePointer      = 32,
+            OpConstant         = 43,
+            OpVariable         = 59,
+            OpDecorate         = 71,
+            OpMemberDecorate   = 72
+        };
+
+        enum Decoration : uint32_t {
+            Block         = 2,
+            BufferBlock   = 3,
+            ArrayStride   = 6,
+            MatrixStride  = 7,
+            BuiltIn       = 11,
+            Location      = 30,
+            Binding       = 33,
+            DescriptorSet = 34,
+            Offset        = 35
+        };
+
+        enum StorageClass : uint32_t {
+            UniformConstant = 0,
+            Input           = 1,
+            Uniform         = 2,
+            PushConstant    = 9,
+            StorageBuffer   = 12
+        };
+
+        enum Dim : uint32_t {
+            Buffer      = 5,
+            SubpassData = 6
+        };
+    }
+
+    ////
+    // struct Id
+    //
+    // Everything the reflection records about one SPIR-V result id.
+    struct Id {
+        uint32_t op = 0;
+
+        // Types: the component, element, column or pointee type, and the
+        // component count, array length id, or storage class.
+        uint32_t type = 0;
+        uint32_t count = 0;
+        uint32_t storage = 0;
+        uint32_t width = 0;
+        bool isSigned = false;
+        uint32_t dim = 0;
+        uint32_t sampled = 0;
+        std::vector<uint32_t> members;
+        std::vector<uint32_t> memberOffsets;
+        std::vector<uint32_t> memberMatrixStrides;
+
+        // Constants.
+        uint32_t value = 0;
+
+        // Decorations.
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        uint32_t location = 0;
+        uint32_t arrayStride = 0;
+        bool hasBinding = false;
+        bool hasLocation = false;
+        bool builtIn = false;
+        bool block = false;
+        bool bufferBlock = false;
+    };
+
+    ////
+    // void fail(const char *)
+    //
+    // Throws the reflection's error.
+    static void fail(const char *action) {
+        throw WfnError("wfn_eng::vulkan::shader", "reflect", action);
+    }
+
+    ////
+    // uint32_t operandsOf(uint32_t)
+    //
+    // The fewest operand words the reflection reads of an instruction, so
+    // that a truncated one fails instead of reading the next.
+    static uint32_t operandsOf(uint32_t op) {
+        switch (op) {
+        case spv::OpEntryPoint:       return 1;
+        case spv::OpDecorate:         return 2;
+        case spv::OpMemberDecorate:   return 3;
+        case spv::OpTypeBool:         return 1;
+        case spv::OpTypeSampler:      return 1;
+        case spv::OpTypeInt:          return 3;
+        case spv::OpTypeFloat:        return 2;
+        case spv::OpTypeVector:       return 3;
+        case spv::OpTypeMatrix:       return 3;
+        case spv::OpTypeImage:        return 7;
+        case spv::OpTypeSampledImage: return 2;
+        case spv::OpTypeRuntimeArray: return 2;
+        case spv::OpTypeArray:        return 3;
+        case spv::OpTypeStruct:       return 1;
+        case spv::OpTypePointer:      return 3;
+        case spv::OpConstant:         return 2;
+        case spv::OpVariable:         return 3;
+        default:                      return 0;
+        }
+    }
+
+    ////
+    // VkShaderStageFlagBits stageOf(uint32_t)
+    //
+    // The stage of a SPIR-V execution model.
+    static VkShaderStageFlagBits stageOf(uint32_t model) {
+        switch (model) {
+        case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+        default:
+            fail("Read Execution Model");
+            return VK_SHADER_STAGE_ALL;
+        }
+    }
+
+    ////
+    // uint32_t sizeOf(const std::vector<Id>&, uint32_t, uint32_t)
+    //
+    // The size in bytes of a type as laid out in a block, given the matrix
+    // stride of the member holding it (0 if it has none).
+    static uint32_t sizeOf(const std::vector<Id>& ids, uint32_t type, uint32_t matrixStride) {
+        const Id& id = ids[type];
+        switch (id.op) {
+        case spv::OpTypeBool:
+            return 4;
+
+        case spv::OpTypeInt:
+        case spv::OpTypeFloat:
+            return id.width / 8;
+
+        case spv::OpTypeVector:
+            return id.count * sizeOf(ids, id.type, 0);
+
+        case spv::OpTypeMatrix:
+            return id.count * (matrixStride > 0 ? matrixStride : sizeOf(ids, id.type, 0));
+
+        case spv::OpTypeArray: {
+            uint32_t stride = id.arrayStride > 0 ? id.arrayStride : sizeOf(ids, id.type, matrixStride);
+            return ids[id.count].value * stride;
+        }
+
+        case spv::OpTypeStruct: {
+            uint32_t end = 0;
+            for (size_t i = 0; i < id.members.size(); i++) {
+                uint32_t size = sizeOf(ids, id.members[i], id.memberMatrixStrides[i]);
+                end = std::max(end, id.memberOffsets[i] + size);
+            }
+            return end;
+        }
+
+        default:
+            return 0;
+        }
+    }
+
+    ////
+    // VkDescriptorType descriptorOf(const std::vector<Id>&, uint32_t, uint32_t)
+    //
+    // The descriptor type of a variable of the provided (non-array) type
+    // in the provided storage class.
+    static VkDescriptorType descriptorOf(const std::vector<Id>& ids, uint32_t type, uint32_t storage) {
+        const Id& id = ids[type];
+
+        if (storage == spv::StorageBuffer)
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+        if (storage == spv::Uniform) {
+            if (id.bufferBlock)
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+
+        switch (id.op) {
+        case spv::OpTypeSampler:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+        case spv::OpTypeSampledImage:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+        case spv::OpTypeImage:
+            if (id.dim == spv::SubpassData)
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            if (id.dim == spv::Buffer)
+                return id.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            return id.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+
+        default:
+            fail("Read Descriptor Type");
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        }
+    }
+
+    ////
+    // VkFormat formatOf(const std::vector<Id>&, uint32_t)
+    //
+    // The vertex attribute format of a 32-bit scalar or vector type.
+    static VkFormat formatOf(const std::vector<Id>& ids, uint32_t type) {
+        const Id& id = ids[type];
+
+        uint32_t components = 1;
+        const Id *scalar = &id;
+        if (id.op == spv::OpTypeVector) {
+            components = id.count;
+            scalar = &ids[id.type];
+        }
+
+        if (scalar->width != 32 || components < 1 || components > 4)
+            fail("Read Vertex Input Format");
+
+        static const VkFormat floats[] = {
+            VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+            VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT
+        };
+        static const VkFormat ints[] = {
+            VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+            VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT
+        };
+        static const VkFormat uints[] = {
+            VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+            VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT
+        };
+
+        if (scalar->op == spv::OpTypeFloat)
+            return floats[components - 1];
+        if (scalar->op == spv::OpTypeInt)
+            return scalar->isSigned ? ints[components - 1] : uints[components - 1];
+
+        fail("Read Vertex Input Format");
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    ////
+    // Reflection reflect(const uint32_t *, size_t)
+    //
+    // Reads the interface of a SPIR-V module of the provided number of
+    // words, for its first entry point. Throws on anything that isn't
+    // SPIR-V or that the engine can't express as a layout.
+    Reflection reflect(const uint32_t *code, size_t words) {
+        if (words < 5 || code[0] != spv::magic)
+            fail("Read SPIR-V Header");
+
+        // Every id is the result of an instruction of two words or more,
+        // so a bound above the module's length is a corrupt header (and
+        // would size the table from garbage).
+        uint32_t bound = code[3];
+        if (bound > words)
+            fail("Read SPIR-V Header");
+        std::vector<Id> ids(bound);
+        std::vector<uint32_t> variables;
+
+        Reflection reflection;
+        bool hasEntryPoint = false;
+
+        // A single pass: decorations come before the types and variables
+        // they decorate, and types before their uses.
+        for (size_t at = 5; at < words;) {
+            uint32_t count = code[at] >> 16;
+            uint32_t op = code[at] & 0xffff;
+            const uint32_t *args = code + at + 1;
+
+            if (count == 0 || at + count > words || count - 1 < operandsOf(op))
+                fail("Read SPIR-V Instruction");
+            at += count;
+
+            // The id an operand names, checked against the bound.
+            auto id = [&](uint32_t index) -> Id& {
+                if (index >= count - 1 || args[index] >= bound)
+                    fail("Read SPIR-V Id");
+                return ids[args[index]];
+            };
+
+            // The id an instruction defines, which mustn't have been
+            // defined before (or the types could be made to loop).
+            auto result = [&](uint32_t index) -> Id& {
+                Id& defined = id(index);
+                if (defined.op != 0)
+                    fail("Read SPIR-V Id");
+                defined.op = op;
+                return defined;
+            };
+
+            // An id an operand refers to, which must be defined before the
+            // instruction (types and constants always are), so that every
+            // id the passes below index is within the bound. Taken before
+            // the result is defined, so nothing refers to itself.
+            auto use = [&](uint32_t index) -> uint32_t {
+                if (id(index).op == 0)
+                    fail("Read SPIR-V Id");
+                return args[index];
+            };
+
+            switch (op) {
+            case spv::OpEntryPoint:
+                if (!hasEntryPoint) {
+                    reflection.stage = stageOf(args[0]);
+                    hasEntryPoint = true;
+                }
+                break;
+
+            case spv::OpDecorate: {
+                Id& target = id(0);
+                uint32_t value = count > 3 ? args[2] : 0;
+                switch (args[1]) {
+                case spv::Block:         target.block = true; break;
+                case spv::BufferBlock:   target.bufferBlock = true; break;
+                case spv::ArrayStride:   target.arrayStride = value; break;
+                case spv::BuiltIn:       target.builtIn = true; break;
+                case spv::Location:      target.location = value; target.hasLocation = true; break;
+                case spv::Binding:       target.binding = value; target.hasBinding = true; break;
+                case spv::DescriptorSet: target.set = value; break;
+                }
+                break;
+            }
+
+            case spv::OpMemberDecorate: {
+                Id& target = id(0);
+                uint32_t member = args[1];
+                uint32_t value = count > 4 ? args[3] : 0;
+                if (member >= words)
+                    fail("Read SPIR-V Member");
+                if (target.memberOffsets.size() <= member) {
+                    target.memberOffsets.resize(member + 1);
+                    target.memberMatrixStrides.resize(member + 1);
+                }
+                if (args[2] == spv::Offset)
+                    target.memberOffsets[member] = value;
+                else if (args[2] == spv::MatrixStride)
+                    target.memberMatrixStrides[member] = value;
+                else if (args[2] == spv::BuiltIn)
+                    target.builtIn = true;
+                break;
+            }
+
+            case spv::OpTypeBool:
+            case spv::OpTypeSampler:
+                result(0);
+                break;
+
+            case spv::OpTypeInt: {
+                Id& type = result(0);
+                type.width = args[1];
+                type.isSigned = args[2] != 0;
+                break;
+            }
+
+            case spv::OpTypeFloat:
+                result(0).width = args[1];
+                break;
+
+            case spv::OpTypeVector:
+            case spv::OpTypeMatrix: {
+                uint32_t component = use(1);
+                Id& type = result(0);
+                type.type = component;
+                type.count = args[2];
+                break;
+            }
+
+            case spv::OpTypeImage: {
+                uint32_t sampled = use(1);
+                Id& type = result(0);
+                type.type = sampled;
+                type.dim = args[2];
+                type.sampled = args[6];
+                break;
+            }
+
+            case spv::OpTypeSampledImage:
+            case spv::OpTypeRuntimeArray: {
+                uint32_t element = use(1);
+                Id& type = result(0);
+                type.type = element;
+                break;
+            }
+
+            case spv::OpTypeArray: {
+                uint32_t element = use(1), length = use(2);
+                Id& type = result(0);
+                type.type = element;
+                type.count = length;
+                break;
+            }
+
+            case spv::OpTypeStruct: {
+                std::vector<uint32_t> members;
+                for (uint32_t member = 1; member < count - 1; member++)
+                    members.push_back(use(member));
+
+                Id& type = result(0);
+                type.members.swap(members);
+                type.memberOffsets.resize(type.members.size());
+                type.memberMatrixStrides.resize(type.members.size());
+                break;
+            }
+
+            case spv::OpTypePointer: {
+                uint32_t pointee = use(2);
+                Id& type = result(0);
+                type.storage = args[1];
+                type.type = pointee;
+                break;
+            }
+
+            case spv::OpConstant:
+                use(0);
+                result(1).value = count > 3 ? args[2] : 0;
+                break;
+
+            case spv::OpVariable: {
+                uint32_t pointer = use(0);
+                if (ids[pointer].op != spv::OpTypePointer)
+                    fail("Read SPIR-V Variable");
+
+                Id& var = result(1);
+                var.type = pointer;
+                var.storage = args[2];
+                variables.push_back(args[1]);
+                break;
+            }
+            }
+        }
+
+        if (!hasEntryPoint)
+            fail("Find Entry Point");
+
+        for (uint32_t variable : variables) {
+            const Id& var = ids[variable];
+            const Id& pointer = ids[var.type];
+            uint32_t type = pointer.type;
+
+            switch (var.storage) {
+            case spv::UniformConstant:
+            case spv::Uniform:
+            case spv::StorageBuffer: {
+                if (!var.hasBinding)
+                    break;
+
+                uint32_t arrayLength = 1;
+                if (ids[type].op == spv::OpTypeArray) {
+                    arrayLength = ids[ids[type].count].value;
+                    type = ids[type].type;
+                } else if (ids[type].op == spv::OpTypeRuntimeArray) {
+                    type = ids[type].type;
+                }
+
+                reflection.bindings.push_back(Binding {
+                    var.set,
+                    var.binding,
+                    descriptorOf(ids, type, var.storage),
+                    arrayLength,
+                    static_cast<VkShaderStageFlags>(reflection.stage)
+                });
+                break;
+            }
+
+            case spv::PushConstant: {
+                const Id& block = ids[type];
+                uint32_t begin = ~0u;
+                for (uint32_t offset : block.memberOffsets)
+                    begin = std::min(begin, offset);
+
+                reflection.pushConstantOffset = block.members.empty() ? 0 : begin;
+                reflection.pushConstantSize = sizeOf(ids, type, 0) - reflection.pushConstantOffset;
+                break;
+            }
+
+            case spv::Input: {
+                if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || var.builtIn || ids[type].builtIn || !var.hasLocation)
+                    break;
+
+                reflection.inputs.push_back(VertexInput {
+                    var.location,
+                    formatOf(ids, type),
+                    sizeOf(ids, type, 0)
+                });
+                break;
+            }
+            }
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const Binding& a, const Binding& b) {
+            return a.set < b.set || (a.set == b.set && a.binding < b.binding);
+        });
+
+        std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const VertexInput& a, const VertexInput& b) {
+            return a.location < b.location;
+        });
+
+        return reflection;
+    }
+}
+
+namespace wfn_eng::vulkan {
+    ////
+    // struct VertexLayout
+    //
+    // The vertex input of a pipeline.
+
+    ////
+    // VertexLayout packed(const shader::Reflection&)
+    //
+    // Packs the inputs of a vertex shader tightly, in location order.
+    VertexLayout VertexLayout::packed(const shader::Reflection& reflection) {
+        if (reflection.inputs.size() > maxVertexAttributes) {
+            throw WfnError(
+                "wfn_eng::vulkan::VertexLayout",
+                "packed",
+                "Fit Vertex Attributes"
+            );
+        }
+
+        VertexLayout layout;
+        for (const shader::VertexInput& input : reflection.inputs) {
+            VkVertexInputAttributeDescription& attribute = layout.attributes[layout.count++];
+            attribute.location = input.location;
+            attribute.binding = 0;
+            attribute.format = input.format;
+            attribute.offset = layout.stride;
+            layout.stride += input.size;
+        }
+
+        return layout;
+    }
+
+    bool VertexLayout::operator==(const VertexLayout& o) const {
+        if (stride != o.stride || count != o.count)
+            return false;
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (attributes[i].location != o.attributes[i].location ||
+                attributes[i].format != o.attributes[i].format ||
+                attributes[i].offset != o.attributes[i].offset) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
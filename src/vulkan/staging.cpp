@@ -0,0 +1,142 @@
+#include "../vulkan.hpp"
+
+namespace wfn_eng::vulkan {
+    ////
+    // class StagingRing
+    //
+    // A persistently mapped, host-coherent buffer handed out front to back
+    // for uploads.
+
+    ////
+    // StagingRing(Device&, VkDeviceSize)
+    //
+    // Creates and maps a staging buffer of the provided size. Coherent
+    // memory saves flushing every range; the GPU only reads it once, so
+    // where it lives matters less than for anything else.
+    StagingRing::StagingRing(Device& device, VkDeviceSize capacity)
+            : _mapped(nullptr)
+            , _capacity(capacity) {
+        VkDevice logical = device.logical();
+        const DeviceTable& vk = device.table();
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = capacity;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        if (vk.vkCreateBuffer(logical, &bufferInfo, allocator::callbacks(), &buffer) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::StagingRing",
+                "StagingRing",
+                "Create Buffer"
+            );
+        }
+        _buffer = Handle<VkBuffer>(logical, buffer);
+
+        VkMemoryRequirements requirements;
+        vk.vkGetBufferMemoryRequirements(logical, buffer, &requirements);
+
+        VkMemoryAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = requirements.size;
+        allocateInfo.memoryTypeIndex = util::memoryType(
+            device.physical(),
+            requirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+
+        VkDeviceMemory memory;
+        if (vk.vkAllocateMemory(logical, &allocateInfo, allocator::callbacks(), &memory) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::StagingRing",
+                "StagingRing",
+                "Allocate Memory"
+            );
+        }
+        _memory = Handle<VkDeviceMemory>(logical, memory);
+
+        // Freeing the memory unmaps it.
+        void *mapped;
+        if (vk.vkBindBufferMemory(logical, buffer, memory, 0) != VK_SUCCESS ||
+            vk.vkMapMemory(logical, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::StagingRing",
+                "StagingRing",
+                "Map Memory"
+            );
+        }
+        _mapped = static_cast<uint8_t *>(mapped);
+    }
+
+    ////
+    // bool allocate(VkDeviceSize, VkDeviceSize, Staged&)
+    //
+    // Hands out a range of the provided size and (power of two) alignment,
+    // returning false if the ring is full. A range that would cross the end
+    // of the buffer starts over at the front instead, wasting the rest.
+    bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, Staged& staged) {
+        if (size > _capacity)
+            return false;
+
+        // Nothing is in use: start over at the front, so that the largest
+        // allocations fit again.
+        if (_tail == _head) {
+            _head = _tail = (_head + _capacity - 1) / _capacity * _capacity;
+            _submitted = _head;
+        }
+
+        uint64_t position = (_head + alignment - 1) & ~(alignment - 1);
+        if (position % _capacity + size > _capacity)
+            position = (position / _capacity + 1) * _capacity;
+
+        if (position + size - _tail > _capacity)
+            return false;
+
+        _head = position + size;
+
+        staged.buffer = _buffer.get();
+        staged.offset = position % _capacity;
+        staged.size = size;
+        staged.data = _mapped + staged.offset;
+        return true;
+    }
+
+    ////
+    // void submit(uint64_t)
+    //
+    // Marks every range allocated since the last submit as in use until
+    // the provided value completes.
+    void StagingRing::submit(uint64_t value) {
+        if (_head == _submitted)
+            return;
+
+        _regions.push_back(Region { _head, value });
+        _submitted = _head;
+    }
+
+    ////
+    // void collect(uint64_t)
+    //
+    // Gives back the ranges of every submit up to the provided completed
+    // value.
+    void StagingRing::collect(uint64_t completed) {
+        while (!_regions.empty() && _regions.front().value <= completed) {
+            _tail = _regions.front().end;
+            _regions.pop_front();
+        }
+    }
+
+    ////
+    // VkDeviceSize capacity()
+    //
+    // The size of the ring.
+    VkDeviceSize StagingRing::capacity() const { return _capacity; }
+
+    ////
+    // VkDeviceSize used()
+    //
+    // The bytes allocated and not given back yet.
+    VkDeviceSize StagingRing::used() const { return _head - _tail; }
+}
@@ -0,0 +1,283 @@
+#include "../vulkan.hpp"
+
+#include <SDL_vulkan.h>
+#include <algorithm>
+#include <limits>
+
+////
+// VkSurfaceFormatKHR chooseFormat(const std::vector<VkSurfaceFormatKHR>&)
+//
+// Chooses a VkSurfaceFormatKHR given the set of available formats.
+static VkSurfaceFormatKHR chooseFormat(const std::vector<VkSurfaceFormatKHR>& formats) {
+    // If there is no preferred format, choose the best one.
+    if (formats.size() == 1 && formats[0].format == VK_FORMAT_UNDEFINED)
+        return { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+
+    for (const auto& format: formats) {
+        if (format.format == VK_FORMAT_B8G8R8A8_UNORM && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
+            return format;
+    }
+
+    return formats[0];
+}
+
+////
+// int presentModeRanking(VkPresentModeKHR)
+//
+// Ranks the presentation modes, higher is better.
+static int presentModeRanking(VkPresentModeKHR presentMode) {
+    switch (presentMode) {
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return 3;
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return 2;
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+////
+// VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>&)
+//
+// Chooses the best of the available presentation modes.
+static VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& presentModes) {
+    VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
+    int bestModeRanking = -1;
+
+    for (const auto& presentMode: presentModes) {
+        int n = presentModeRanking(presentMode);
+        if (n > bestModeRanking) {
+            bestMode = presentMode;
+            bestModeRanking = n;
+        }
+    }
+
+    return bestMode;
+}
+
+////
+// VkExtent2D chooseExtent(wfn_eng::sdl::Window&, const VkSurfaceCapabilitiesKHR&)
+//
+// Chooses the extent that best matches the drawable size of the window.
+static VkExtent2D chooseExtent(wfn_eng::sdl::Window& window, const VkSurfaceCapabilitiesKHR& capabilities) {
+    if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
+        return capabilities.currentExtent;
+
+    int width, height;
+    SDL_Vulkan_GetDrawableSize(window.ref(), &width, &height);
+
+    VkExtent2D extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    extent.width = std::max(
+        capabilities.minImageExtent.width,
+        std::min(capabilities.maxImageExtent.width, extent.width)
+    );
+    extent.height = std::max(
+        capabilities.minImageExtent.height,
+        std::min(capabilities.maxImageExtent.height, extent.height)
+    );
+
+    return extent;
+}
+
+namespace wfn_eng::vulkan {
+    ////
+    // class Swapchain
+    //
+    // The VkSwapchainKHR of a window, along with a view of each of its images
+    // and (once a render pass exists) a framebuffer for each of them.
+
+    ////
+    // Swapchain(sdl::Window&, Base&, Device&)
+    //
+    // Constructs a swapchain for the window's surface, preferring a
+    // B8G8R8A8 sRGB format and mailbox presentation.
+    Swapchain::Swapchain(sdl::Window& window, Base& base, Device& device) {
+        util::SwapchainSupport support(base, device);
+
+        VkSurfaceFormatKHR surfaceFormat = chooseFormat(support.formats);
+        _format = surfaceFormat.format;
+        _presentMode = choosePresentMode(support.presentModes);
+        _extent = chooseExtent(window, support.capabilities);
+
+        uint32_t imageCount = support.capabilities.minImageCount + 1;
+        if (support.capabilities.maxImageCount > 0 && imageCount > support.capabilities.maxImageCount)
+            imageCount = support.capabilities.maxImageCount;
+
+        VkSwapchainCreateInfoKHR createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        createInfo.surface = base.surface();
+        createInfo.minImageCount = imageCount;
+        createInfo.imageFormat = surfaceFormat.format;
+        createInfo.imageColorSpace = surfaceFormat.colorSpace;
+        createInfo.imageExtent = _extent;
+        createInfo.imageArrayLayers = 1;
+        createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+        uint32_t families[] = { device.graphicsFamily(), device.presentationFamily() };
+        if (families[0] != families[1]) {
+            createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = 2;
+            createInfo.pQueueFamilyIndices = families;
+        } else
+            createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        createInfo.preTransform = support.capabilities.currentTransform;
+        createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        createInfo.presentMode = _presentMode;
+        createInfo.clipped = VK_TRUE;
+        createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+        VkSwapchainKHR swapchain;
+        if (vkCreateSwapchainKHR(device.logical(), &createInfo, allocator::callbacks(), &swapchain) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::Swapchain",
+                "Constructor",
+                "Create Swapchain"
+            );
+        }
+
+        _swapchain = Handle<VkSwapchainKHR>(device.logical(), swapchain);
+
+        vkGetSwapchainImagesKHR(device.logical(), swapchain, &imageCount, nullptr);
+        _images.resize(imageCount);
+        vkGetSwapchainImagesKHR(device.logical(), swapchain, &imageCount, _images.data());
+
+        makeImageViews(device.logical());
+    }
+
+    ////
+    // void makeImageViews(VkDevice)
+    //
+    // Constructs a VkImageView for every swapchain image.
+    void Swapchain::makeImageViews(VkDevice device) {
+        _imageViews.clear();
+        _imageViews.reserve(_images.size());
+
+        for (VkImage image: _images) {
+            VkImageViewCreateInfo createInfo = {};
+            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            createInfo.image = image;
+            createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            createInfo.format = _format;
+            createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+            createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            createInfo.subresourceRange.baseMipLevel = 0;
+            createInfo.subresourceRange.levelCount = 1;
+            createInfo.subresourceRange.baseArrayLayer = 0;
+            createInfo.subresourceRange.layerCount = 1;
+
+            VkImageView imageView;
+            if (vkCreateImageView(device, &createInfo, allocator::callbacks(), &imageView) != VK_SUCCESS) {
+                throw WfnError(
+                    "wfn_eng::vulkan::Swapchain",
+                    "makeImageViews",
+                    "Create Image View"
+                );
+            }
+
+            _imageViews.emplace_back(device, imageView);
+        }
+    }
+
+    ////
+    // Swapchain& operator=(Swapchain&&)
+    //
+    // Moves a Swapchain, destroying the framebuffers and image views before
+    // the swapchain they refer to.
+    Swapchain& Swapchain::operator=(Swapchain&& other) {
+        _frameBuffers = std::move(other._frameBuffers);
+        _imageViews = std::move(other._imageViews);
+        _swapchain = std::move(other._swapchain);
+        _images = std::move(other._images);
+        _format = other._format;
+        _extent = other._extent;
+        _presentMode = other._presentMode;
+        return *this;
+    }
+
+    ////
+    // void makeFrameBuffers(VkRenderPass)
+    //
+    // (Re)builds a framebuffer over every image view for a render pass.
+    void Swapchain::makeFrameBuffers(VkRenderPass renderPass) {
+        VkDevice device = _swapchain.parent();
+
+        _frameBuffers.clear();
+        _frameBuffers.reserve(_imageViews.size());
+
+        for (const auto& imageView: _imageViews) {
+            VkFramebufferCreateInfo createInfo = {};
+            createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            createInfo.renderPass = renderPass;
+            createInfo.attachmentCount = 1;
+            createInfo.pAttachments = imageView.address();
+            createInfo.width = _extent.width;
+            createInfo.height = _extent.height;
+            createInfo.layers = 1;
+
+            VkFramebuffer frameBuffer;
+            if (vkCreateFramebuffer(device, &createInfo, allocator::callbacks(), &frameBuffer) != VK_SUCCESS) {
+                throw WfnError(
+                    "wfn_eng::vulkan::Swapchain",
+                    "makeFrameBuffers",
+                    "Create Framebuffer"
+                );
+            }
+
+            _frameBuffers.emplace_back(device, frameBuffer);
+        }
+    }
+
+    ////
+    // VkSwapchainKHR get()
+    //
+    // Provides access to the VkSwapchainKHR.
+    VkSwapchainKHR Swapchain::get() const { return _swapchain.get(); }
+
+    ////
+    // const std::vector<VkImage>& images()
+    //
+    // The images of the swapchain.
+    const std::vector<VkImage>& Swapchain::images() const { return _images; }
+
+    ////
+    // VkFormat format()
+    //
+    // The format of the images.
+    VkFormat Swapchain::format() const { return _format; }
+
+    ////
+    // VkExtent2D extent()
+    //
+    // The size of the images.
+    VkExtent2D Swapchain::extent() const { return _extent; }
+
+    ////
+    // VkPresentModeKHR presentMode()
+    //
+    // The presentation mode in use.
+    VkPresentModeKHR Swapchain::presentMode() const { return _presentMode; }
+
+    ////
+    // size_t size()
+    //
+    // The number of images.
+    size_t Swapchain::size() const { return _images.size(); }
+
+    ////
+    // VkImageView imageView(size_t)
+    //
+    // The view of an image.
+    VkImageView Swapchain::imageView(size_t index) const { return _imageViews[index].get(); }
+
+    ////
+    // VkFramebuffer frameBuffer(size_t)
+    //
+    // The framebuffer of an image.
+    VkFramebuffer Swapchain::frameBuffer(size_t index) const { return _frameBuffers[index].get(); }
+}
@@ -0,0 +1,255 @@
+#include "../vulkan.hpp"
+
+namespace wfn_eng::vulkan {
+    ////
+    // class Submission
+    //
+    // The contents of a single vkQueueSubmit.
+
+    ////
+    // Submission& wait(SyncPoint, VkPipelineStageFlags)
+    //
+    // Waits, at the provided stages, for another queue's timeline to reach a
+    // value.
+    Submission& Submission::wait(SyncPoint point, VkPipelineStageFlags stages) {
+        if (_waitCount == capacity) {
+            throw WfnError(
+                "wfn_eng::vulkan::Submission",
+                "wait",
+                "Too Many Waits"
+            );
+        }
+
+        _waitSemaphores[_waitCount] = point.semaphore;
+        _waitValues[_waitCount] = point.value;
+        _waitStages[_waitCount] = stages;
+        _waitCount++;
+        return *this;
+    }
+
+    ////
+    // Submission& wait(VkSemaphore, VkPipelineStageFlags)
+    //
+    // Waits, at the provided stages, on a binary semaphore (e.g. a swapchain
+    // image becoming available).
+    Submission& Submission::wait(VkSemaphore semaphore, VkPipelineStageFlags stages) {
+        // The value of a binary semaphore is ignored.
+        return wait(SyncPoint { semaphore, 0 }, stages);
+    }
+
+    ////
+    // Submission& execute(VkCommandBuffer)
+    //
+    // Adds a command buffer.
+    Submission& Submission::execute(VkCommandBuffer commandBuffer) {
+        if (_commandBufferCount == capacity) {
+            throw WfnError(
+                "wfn_eng::vulkan::Submission",
+                "execute",
+                "Too Many Command Buffers"
+            );
+        }
+
+        _commandBuffers[_commandBufferCount++] = commandBuffer;
+        return *this;
+    }
+
+    ////
+    // Submission& signal(VkSemaphore)
+    //
+    // Signals a binary semaphore (e.g. for presentation) on completion.
+    Submission& Submission::signal(VkSemaphore semaphore) {
+        if (_signalCount == capacity) {
+            throw WfnError(
+                "wfn_eng::vulkan::Submission",
+                "signal",
+                "Too Many Signals"
+            );
+        }
+
+        _signalSemaphores[_signalCount] = semaphore;
+        _signalValues[_signalCount] = 0;
+        _signalCount++;
+        return *this;
+    }
+
+    ////
+    // class Timeline
+    //
+    // The timeline of a single queue.
+
+    ////
+    // Timeline(VkDevice, VkQueue, const DeviceTable&)
+    //
+    // Constructs the timeline of a queue, starting at 0.
+    Timeline::Timeline(VkDevice device, VkQueue queue, const DeviceTable& table) :
+            _queue(queue),
+            _queueSubmit(table.vkQueueSubmit),
+            _waitSemaphores(table.vkWaitSemaphores),
+            _getCounterValue(table.vkGetSemaphoreCounterValue) {
+        VkSemaphoreTypeCreateInfo typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+
+        VkSemaphore semaphore;
+        if (table.vkCreateSemaphore(device, &createInfo, allocator::callbacks(), &semaphore) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::Timeline",
+                "Constructor",
+                "Create Timeline Semaphore"
+            );
+        }
+
+        _semaphore = Handle<VkSemaphore>(device, semaphore);
+    }
+
+    ////
+    // SyncPoint submit(Submission&)
+    //
+    // Submits to the queue, signaling the next value on the timeline, and
+    // returns the point at which the submission is complete.
+    SyncPoint Timeline::submit(Submission& submission) {
+        uint64_t value = _submitted + 1;
+
+        // The timeline's own signal goes in the reserved slot past the
+        // Submission's capacity.
+        uint32_t signalCount = submission._signalCount;
+        submission._signalSemaphores[signalCount] = _semaphore.get();
+        submission._signalValues[signalCount] = value;
+        signalCount++;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = submission._waitCount;
+        timelineInfo.pWaitSemaphoreValues = submission._waitValues;
+        timelineInfo.signalSemaphoreValueCount = signalCount;
+        timelineInfo.pSignalSemaphoreValues = submission._signalValues;
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = submission._waitCount;
+        submitInfo.pWaitSemaphores = submission._waitSemaphores;
+        submitInfo.pWaitDstStageMask = submission._waitStages;
+        submitInfo.commandBufferCount = submission._commandBufferCount;
+        submitInfo.pCommandBuffers = submission._commandBuffers;
+        submitInfo.signalSemaphoreCount = signalCount;
+        submitInfo.pSignalSemaphores = submission._signalSemaphores;
+
+        if (_queueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::Timeline",
+                "submit",
+                "Submit"
+            );
+        }
+
+        _submitted = value;
+        return last();
+    }
+
+    ////
+    // SyncPoint next()
+    //
+    // The point the next submission will signal.
+    SyncPoint Timeline::next() const { return { _semaphore.get(), _submitted + 1 }; }
+
+    ////
+    // SyncPoint last()
+    //
+    // The point signaled by the latest submission.
+    SyncPoint Timeline::last() const { return { _semaphore.get(), _submitted }; }
+
+    ////
+    // uint64_t submitted()
+    //
+    // The value signaled by the latest submission.
+    uint64_t Timeline::submitted() const { return _submitted; }
+
+    ////
+    // uint64_t completed()
+    //
+    // Reads back the value the GPU has reached.
+    uint64_t Timeline::completed() const {
+        uint64_t value;
+        if (_getCounterValue(_semaphore.parent(), _semaphore.get(), &value) != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::Timeline",
+                "completed",
+                "Get Semaphore Value"
+            );
+        }
+
+        if (value > _completed)
+            _completed = value;
+        return _completed;
+    }
+
+    ////
+    // bool reached(uint64_t)
+    //
+    // Whether the GPU has reached a value. Only queries the semaphore if the
+    // last value read back is not already enough.
+    bool Timeline::reached(uint64_t value) const {
+        if (value <= _completed)
+            return true;
+        return completed() >= value;
+    }
+
+    ////
+    // bool wait(uint64_t, uint64_t)
+    //
+    // Blocks until the GPU reaches a value, or the timeout (in nanoseconds)
+    // expires. Returns whether the value was reached.
+    bool Timeline::wait(uint64_t value, uint64_t timeout) const {
+        if (value <= _completed)
+            return true;
+
+        VkSemaphore semaphore = _semaphore.get();
+
+        VkSemaphoreWaitInfo waitInfo = {};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore;
+        waitInfo.pValues = &value;
+
+        VkResult result = _waitSemaphores(_semaphore.parent(), &waitInfo, timeout);
+        if (result == VK_TIMEOUT)
+            return false;
+
+        if (result != VK_SUCCESS) {
+            throw WfnError(
+                "wfn_eng::vulkan::Timeline",
+                "wait",
+                "Wait Semaphore"
+            );
+        }
+
+        if (value > _completed)
+            _completed = value;
+        return true;
+    }
+
+    ////
+    // void waitIdle()
+    //
+    // Blocks until everything submitted so far has completed.
+    void Timeline::waitIdle() const { wait(_submitted); }
+
+    ////
+    // VkSemaphore semaphore()
+    //
+    // The underlying timeline semaphore.
+    VkSemaphore Timeline::semaphore() const { return _semaphore.get(); }
+
+    ////
+    // VkQueue queue()
+    //
+    // The queue the timeline belongs to.
+    VkQueue Timeline::queue() const { return _queue; }
+}
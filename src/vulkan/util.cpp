@@ -1,4 +1,5 @@
 #include "../vulkan.hpp"
+#include "../memory.hpp"
 
 namespace wfn_eng::vulkan::util {
     ////
@@ -20,7 +21,11 @@ namespace wfn_eng::vulkan::util {
             nullptr
         );
 
-        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        memory::ScratchScope scratch;
+        memory::ArenaVector<VkQueueFamilyProperties> queueFamilies(
+            queueFamilyCount,
+            scratch.arena()
+        );
         vkGetPhysicalDeviceQueueFamilyProperties(
             device,
             &queueFamilyCount,
@@ -28,17 +33,28 @@ namespace wfn_eng::vulkan::util {
         );
 
         for (int i = 0; i < queueFamilies.size(); i++) {
-            if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+            if (queueFamilies[i].queueCount == 0)
+                continue;
+
+            VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if (computeFamily < 0 && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+                computeFamily = i;
+
+            if (sufficient())
+                continue;
+
+            if (flags & VK_QUEUE_GRAPHICS_BIT)
                 graphicsFamily = i;
 
             VkBool32 presentationSupport = false;
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
-            if (queueFamilies[i].queueCount > 0 && presentationSupport)
+            if (presentationSupport)
                 presentationFamily = i;
-
-            if (sufficient())
-                break;
         }
+
+        // Graphics queues always support compute.
+        if (computeFamily < 0)
+            computeFamily = graphicsFamily;
     }
 
     ////
@@ -114,4 +130,23 @@ namespace wfn_eng::vulkan::util {
     bool SwapchainSupport::sufficient() {
         return formats.size() > 0 && presentModes.size() > 0;
     }
+
+    ////
+    // uint32_t memoryType(VkPhysicalDevice, uint32_t, VkMemoryPropertyFlags)
+    //
+    // The first memory type allowed by a resource's type bits with all the
+    // provided properties, throwing if there is none. Drivers list the
+    // types best first.
+    uint32_t memoryType(VkPhysicalDevice device, uint32_t allowed, VkMemoryPropertyFlags wanted) {
+        VkPhysicalDeviceMemoryProperties properties;
+        vkGetPhysicalDeviceMemoryProperties(device, &properties);
+
+        for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+            if ((allowed & (1u << i)) != 0 &&
+                (properties.memoryTypes[i].propertyFlags & wanted) == wanted)
+                return i;
+        }
+
+        throw WfnError("wfn_eng::vulkan::util", "memoryType", "Find Memory Type");
+    }
 }